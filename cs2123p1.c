@@ -7,7 +7,8 @@ Command Parameters:
     n/a
 Input:
     The standard input file stream contains queries (one per input text line).
-    Tokens in the query will be separated by one space.  
+    Tokens in the query are separated by white space (one or more spaces
+    or tabs).  
     Some sample data:
         SMOKING = N AND GENDER = F
         SMOKING = N AND ( EXERCISE = HIKE OR EXERCISE = BIKE )
@@ -33,10 +34,10 @@ Returns:
   801 - improperly formatted input; missing right parenthesis
   802 - improperly formatted input; missing left parenthesis
 Notes:
-    1. This program uses an array to implement the stack.  It has a maximum of
-       MAX_STACK_ELEM elements. 
+    1. This program uses an array to implement the stack.  It grows as
+       needed out of the Out's arena. 
     2. This program uses an Out array for the resulting postfix expression.
-       It has a maximum of MAX_OUT_ITEM elements. 
+       It grows as needed. 
     3. The errors found will be as a result of improper format and 
        different constant integer error codes are returned to the
        main function accordlingly.  When formatting errors are encountered
@@ -49,6 +50,7 @@ Notes:
 #include <stdlib.h>
 #include <string.h>
 #include "cs2123p1.h"
+#include "cs2123p1Stats.h"
 
 /******************** processRemString ***********************************
 int processRemString(Stack stack, Out out)
@@ -166,7 +168,8 @@ Purpose:
 Parameters:
     I char *pszInfix       pointer to a string from input file
     O Out  out             pointer to a structure of type OutImp that will
-	                       store tokens from the input string 
+	                       store tokens from the input string.  It must be
+	                       created by newOut. 
 Returns:
     0   - conversion to postfix was successful
 	801 - WARN_MISSING_RPAREN
@@ -174,24 +177,28 @@ Returns:
 Notes:
     - Uses a while loop to traverse a line of text until their are no
       more tokens.
+    - Tokens are taken from pszInfix with getTokenView, so they are never
+      copied or truncated, and runs of white space are skipped.
 **************************************************************************/
 int convertToPostFix(char *pszInfix, Out out)
 {
-	Stack stack = newStack();               // new dynamically allocated structure
-	                                        // of type StackImp stored in a pointer
-	                                        // named stack
-	char *pszRemainingText;                 // stores address returned by getToken
-	                                        // which points to next token in string
-	                                        // after delimiter 
-	char szfromGetToken[MAX_TOKEN];         // stores token from getToken
-	Element element;                        // stores szfromGetToken 
+	Stack stack = newArenaStack(out->arena);// new structure of type StackImp
+	                                        // allocated from out's arena and
+	                                        // stored in a pointer named stack
+	char *pszRemainingText;                 // stores address returned by getTokenView
+	                                        // which points to the character after
+	                                        // the token
+	char *pszToken;                         // start of the token inside pszInfix
+	int iTokenLength;                       // number of characters in the token
+	Element element;                        // stores the interned token
 	int bValid = FALSE;                     // stores TRUE or FALSE
+	STATS_DECLARE_INT(iMaxDepth);           // deepest stack
 	
-	
-	pszRemainingText = getToken(pszInfix, element.szToken, sizeof(element.szToken) - 1);
+	pszRemainingText = getTokenView(pszInfix, &pszToken, &iTokenLength);
 	
 	while(pszRemainingText != NULL)
 	{	
+		element.iSymbol = internSymbol(pszToken, iTokenLength);
 		categorize(&element);                           // argument to categorize function
 	                                                    // is a pointer to element
 		// element can now be used to convert to postfix
@@ -221,18 +228,21 @@ int convertToPostFix(char *pszInfix, Out out)
 			{
 				// left parenthesis was never found on stack
 				freeStack(stack);
+				STATS_STACK_DEPTH(iMaxDepth);
 				return WARN_MISSING_LPAREN;
 			}
 		}
+		STATS_MAX(iMaxDepth, stack->iCount);
 		// retrieve next token
 		if (pszRemainingText != NULL)
-			pszRemainingText = getToken(pszRemainingText, element.szToken, sizeof(element.szToken) - 1);
+			pszRemainingText = getTokenView(pszRemainingText, &pszToken, &iTokenLength);
 	} // end while
 	// end of input string is reached
 	// if stack is not empty
 	// process remaining string
 	bValid = processRemString(stack, out);
 	freeStack(stack);
+	STATS_STACK_DEPTH(iMaxDepth);
 	// if right parenthesis is missing return warnring
 	if (!bValid)
 		return WARN_MISSING_RPAREN;	
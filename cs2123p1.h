@@ -10,23 +10,43 @@ Purpose:
    Defines typedef for 
        Token
        Element  (values placed in stack or out)
+       Symbol   (interned token text with its category and precedence)
+       LineReaderImp (block reader that splits a file into lines)
+       LineReader    (pointer to a LineReaderImp)
+       OutputBufferImp (large buffer for formatted output)
+       OutputBuffer  (pointer to an OutputBufferImp)
+       ArenaBlock (one block of memory in an arena)
+       ArenaImp (resettable bump allocator)
+       Arena    (pointer to an ArenaImp)
        StackImp (array stack implementation)
        Stack    (pointer to a StackImp)
        OutImp   (out implementation)
        Out      (pointer to an OutImp)
 Notes:
-   
+   - Elements refer to their token text by an interned symbol id so
+     that copying an Element into the stack or out stays cheap.
 **********************************************************************/
 /*** constants ***/
 // Maximum constants
-#define MAX_STACK_ELEM 20       // Maximum number of elements in the stack array
+#define MAX_STACK_ELEM 20       // Initial number of elements in the stack array
 #define MAX_TOKEN 50            // Maximum number of actual characters for a token
-#define MAX_OUT_ITEM 50         // Maximum number of Out items
+#define MAX_OUT_ITEM 50         // Initial number of Out items
+#define ARENA_BLOCK_SIZE 16384  // Initial size of an arena
+#define SYMBOL_HASH_SIZE 1024   // Initial size of the symbol hash table (power of 2)
+#define INPUT_BLOCK_SIZE 1048576    // Bytes read from the input file at a time
+#define OUTPUT_BUFFER_SIZE 1048576  // Bytes of output collected before a write
+#define CHUNK_QUERIES 1024          // Most queries a thread converts at a time
+#define CHUNK_TEXT_SIZE 262144      // Bytes of query text a thread converts at a time
+#define CHUNKS_PER_THREAD 4         // Chunks of input read ahead per thread
+#define PARALLEL_MIN_TEXT 65536     // Shortest query text converted on threads
 
 // Error constants (program exit values)
 #define ERR_STACK_USAGE    901
 #define ERR_OUT_OVERFLOW   902
 #define ERR_ALGORITHM      903
+#define ERR_SYMBOL_TABLE   905
+#define ERR_INPUT          906
+#define ERR_ARENA          907
 
 // Warning constants.  Warnings do not cause the program to exit.
 #define WARN_MISSING_RPAREN 801
@@ -38,6 +58,21 @@ Notes:
 #define CAT_OPERATOR 3      // Operators are =, NOTANY, ONLY, AND, OR
 #define CAT_OPERAND 4       // These are trait types and trait values
 
+// symbol ids of the parentheses and operators (see symbolDefM in
+// cs2123p1Lib.c)
+#define SYMBOL_LPAREN 0
+#define SYMBOL_RPAREN 1
+#define SYMBOL_EQUAL  2
+#define SYMBOL_NOTANY 3
+#define SYMBOL_ONLY   4
+#define SYMBOL_AND    5
+#define SYMBOL_OR     6
+
+// output formats
+#define FORMAT_TEXT 1       // query and postfix, 6 tokens per line
+#define FORMAT_POSTFIX 2    // one tab separated line per query
+#define FORMAT_JSON 3       // one JSON object per line
+
 // boolean constants
 #define FALSE 0
 #define TRUE 1
@@ -47,34 +82,101 @@ Notes:
 // Token typedef used for operators, operands, and parentheses
 typedef char Token[MAX_TOKEN + 1];
 
-// Element typedef used for Element values placed in the stack or out
+// Element typedef used for Element values placed in the stack or out.
+// The token text is kept once in the symbol table; use getSymbolText
+// to get it from iSymbol.
 typedef struct
 {
-    Token szToken;
-    int iCategory;
-    int iPrecedence;
+    int iSymbol;
+    short iCategory;
+    short iPrecedence;
 } Element;
 
-// StackImp typedef defines how we implement a stack using an array
+// Symbol typedef is one entry in the symbol table
+typedef struct
+{
+    char *pszText;              // zero terminated token text
+    int iLength;                // length of pszText
+    short iCategory;            // category found by categorize
+    short iPrecedence;          // precedence found by categorize
+} Symbol;
+
+// ArenaBlock typedef is the header of one block of arena memory.  The
+// memory handed out follows the header.
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *pPrev;   // block that filled up before this one
+    size_t iSize;               // bytes of memory in the block
+    size_t iUsed;               // bytes handed out
+} ArenaBlock;
+
+// ArenaImp typedef is a bump allocator.  Memory is handed out from the
+// current block and is all given back at once by resetArena.
+typedef struct
+{
+    ArenaBlock *pBlock;         // current block
+    size_t iTotalSize;          // bytes in all of the blocks
+    long lBlockCount;           // blocks allocated since newArena
+} ArenaImp;
+
+// Arena typedef defines a pointer to an arena
+typedef ArenaImp *Arena;
+
+// StackImp typedef defines how we implement a stack using an array.
+// The array grows as needed, out of the arena if there is one.
 typedef struct
 {
     int iCount;  // number of elements in stack.  0 is empty 
-    Element stackElementM[MAX_STACK_ELEM];
+    int iMax;    // allocated size of stackElementM
+    Element *stackElementM;
+    Arena arena; // arena the stack is allocated from (NULL if malloc)
 } StackImp;
 
 // Stack typedef defines a pointer to a stack
 typedef StackImp *Stack;
 
-// OutImp typedef defines how we implement out
+// OutImp typedef defines how we implement out.  outM grows as needed out
+// of the arena, which resetOut empties before each query.
 typedef struct
 {
     int iOutCount;
-    Element outM[MAX_OUT_ITEM];
+    int iOutMax;    // allocated size of outM
+    Element *outM;
+    Arena arena;    // memory for outM and the conversion stack
 } OutImp;
 
 // Out typedef defines a pointer to out
 typedef OutImp *Out;
 
+// LineReaderImp typedef reads a file in large blocks and returns its
+// lines in place.  The bytes from iStart to iEnd in pszBuffer have been
+// read but not yet returned.
+typedef struct
+{
+    FILE *pFile;
+    char *pszBuffer;
+    int iBufferSize;            // allocated size of pszBuffer
+    int iStart;                 // start of the next line
+    int iEnd;                   // end of the bytes read
+    int bEof;                   // TRUE once the file is exhausted
+} LineReaderImp;
+
+// LineReader typedef defines a pointer to a line reader
+typedef LineReaderImp *LineReader;
+
+// OutputBufferImp typedef collects formatted output so that it can be
+// written with a few large fwrite calls
+typedef struct
+{
+    FILE *pFile;
+    char *pszBuffer;
+    int iBufferSize;            // allocated size of pszBuffer
+    int iLength;                // number of bytes waiting to be written
+} OutputBufferImp;
+
+// OutputBuffer typedef defines a pointer to an output buffer
+typedef OutputBufferImp *OutputBuffer;
+
 /**********   prototypes ***********/
 
 // Stack functions
@@ -83,18 +185,58 @@ void push(Stack stack, Element value);
 Element pop(Stack stack);
 int isEmpty(Stack stack);
 Stack newStack();
+Stack newArenaStack(Arena arena);
 void freeStack(Stack stack);
 Element topElement(Stack stack);
 
 // Conversion to Postfix functions that Larry provided
 void categorize(Element *pElement);
 Out newOut();
+void resetOut(Out out);
+void freeOut(Out out);
 void addOut(Out out, Element element);
 void printOut(Out out);
 
 // Conversion to Postfix functions that each student must implement
 int convertToPostFix(char *pszInfix, Out out);
+void processOperator(Stack stack, Element newValue, Out out);
+int processRightParen(Stack stack, Out out);
+int processRemString(Stack stack, Out out);
+
+// Conversion of one large query on several threads (cs2123p1Parallel.c)
+int convertToPostFixParallel(char *pszInfix, Out out, int iThreads);
+
+// Arena functions
+Arena newArena(size_t iSize);
+void *arenaAlloc(Arena arena, size_t iSize);
+void resetArena(Arena arena);
+void freeArena(Arena arena);
+
+// Symbol table functions
+int internSymbol(char *pszText, int iLength);
+char *getSymbolText(int iSymbol);
+int getSymbolLength(int iSymbol);
+int getSymbolCount();
+void clearSymbols();
+
+// Input functions
+LineReader newLineReader(FILE *pFile);
+char *readLine(LineReader reader, int *piLength, int *pbNewline);
+void freeLineReader(LineReader reader);
+
+// Output functions
+OutputBuffer newOutputBuffer(FILE *pFile);
+void outputText(OutputBuffer output, char *pszText, int iLength);
+void outputString(OutputBuffer output, char *pszText);
+void outputInt(OutputBuffer output, int iValue);
+void outputJsonString(OutputBuffer output, char *pszText, int iLength);
+void formatOut(OutputBuffer output, Out out, int iFormat);
+void flushOutput(OutputBuffer output);
+void freeOutputBuffer(OutputBuffer output);
 
 // Utility routines
 void ErrExit(int iexitRC, char szFmt[], ...);
-char * getToken(char *pszInputTxt, char szToken[], int iTokenSize);
\ No newline at end of file
+int tryConvertToPostFix(char *pszInfix, Out out, char szError[], int iErrorSize);
+int trapErrors(void (*pfnWork)(void *), void *pArg, char szError[], int iErrorSize);
+char * getToken(char *pszInputTxt, char szToken[], int iTokenSize);
+char * getTokenView(char *pszInputTxt, char **ppszToken, int *piLength);
\ No newline at end of file
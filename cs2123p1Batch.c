@@ -0,0 +1,237 @@
+/**********************************************************************************
+Program cs2123p1Batch.c by Timothy Hennessy
+Purpose:
+    Merges a batch of compiled queries into one DAG in which identical
+    subexpressions are stored once, so countDagMatches evaluates each of
+    them once no matter how many queries use it.
+Command Parameters:
+    n/a
+Input:
+    Queries built by compileQuery (not optimized by optimizeQuery).
+Results:
+    addDagQuery returns the node whose result is the query's result.
+    For the queries
+        SMOKING = N AND GENDER = F
+        GENDER = F AND SMOKING = N AND EXERCISE = HIKE
+    the nodes are
+        0 SMOKING = N   1 GENDER = F   2 AND(0, 1)
+        3 EXERCISE = HIKE   4 AND(2, 3)
+    so the second query reuses all of the first.
+Returns:
+    n/a
+Notes:
+    1. Nodes are hash consed: before a node is added, the hash table is
+       searched for a node with the same operation and operands.
+    2. AND and OR are commutative, so their operands are stored in
+       ascending order.  Sharing is found between operands that are
+       written in the same grouping; A AND B AND C and A AND ( B AND C )
+       only share A, B and C.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+
+/******************** newQueryDag **************************************
+QueryDag newQueryDag()
+Purpose:
+    Creates an empty query DAG.
+Parameters:
+    n/a
+Returns:
+    The new DAG.  Use freeQueryDag to free it.
+**************************************************************************/
+QueryDag newQueryDag()
+{
+    QueryDag dag = calloc(1, sizeof(QueryDagImp));
+    if (dag == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a query DAG");
+    dag->iHashSize = DAG_HASH_SIZE;
+    dag->iHashM = malloc(dag->iHashSize * sizeof(int));
+    if (dag->iHashM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a query DAG");
+    memset(dag->iHashM, -1, dag->iHashSize * sizeof(int));
+    return dag;
+}
+
+/******************** hashNode **************************************
+unsigned int hashNode(DagNode *pNode)
+Purpose:
+    Computes the hash of a node's operation and operands.
+Parameters:
+    I   DagNode *pNode              node to hash
+Returns:
+    The hash value.
+**************************************************************************/
+static unsigned int hashNode(DagNode *pNode)
+{
+    unsigned int uHash = 2166136261u;
+    uHash = (uHash ^ (unsigned int) pNode->instr.iOp) * 16777619u;
+    uHash = (uHash ^ (unsigned int) pNode->instr.iTrait) * 16777619u;
+    uHash = (uHash ^ (unsigned int) pNode->instr.iValue) * 16777619u;
+    uHash = (uHash ^ (unsigned int) pNode->iLeft) * 16777619u;
+    uHash = (uHash ^ (unsigned int) pNode->iRight) * 16777619u;
+    return uHash;
+}
+
+/******************** growDagHash **************************************
+void growDagHash(QueryDag dag)
+Purpose:
+    Doubles the size of a DAG's hash table.
+Parameters:
+    I/O QueryDag dag                DAG whose table is half full
+Returns:
+    n/a
+Notes:
+    - The hash table uses open addressing with linear probing.
+**************************************************************************/
+static void growDagHash(QueryDag dag)
+{
+    int iSlot;
+    int i;
+
+    free(dag->iHashM);
+    dag->iHashSize *= 2;
+    dag->iHashM = malloc(dag->iHashSize * sizeof(int));
+    if (dag->iHashM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to grow a query DAG");
+    memset(dag->iHashM, -1, dag->iHashSize * sizeof(int));
+    for (i = 0; i < dag->iNodeCount; i++)
+    {
+        iSlot = hashNode(&dag->nodeM[i]) & (dag->iHashSize - 1);
+        while (dag->iHashM[iSlot] >= 0)
+            iSlot = (iSlot + 1) & (dag->iHashSize - 1);
+        dag->iHashM[iSlot] = i;
+    }
+}
+
+/******************** findOrAddNode **************************************
+int findOrAddNode(QueryDag dag, DagNode *pNode)
+Purpose:
+    Finds a node in the DAG, adding it if it is not there.
+Parameters:
+    I/O QueryDag dag                DAG to search
+    I   DagNode *pNode              node to find (bRoot is ignored)
+Returns:
+    The subscript of the node.
+**************************************************************************/
+static int findOrAddNode(QueryDag dag, DagNode *pNode)
+{
+    DagNode *pFound;
+    int iSlot;
+    int iNewMax;
+
+    iSlot = hashNode(pNode) & (dag->iHashSize - 1);
+    while (dag->iHashM[iSlot] >= 0)
+    {
+        pFound = &dag->nodeM[dag->iHashM[iSlot]];
+        if (pFound->instr.iOp == pNode->instr.iOp
+            && pFound->instr.iTrait == pNode->instr.iTrait
+            && pFound->instr.iValue == pNode->instr.iValue
+            && pFound->iLeft == pNode->iLeft && pFound->iRight == pNode->iRight)
+            return dag->iHashM[iSlot];
+        iSlot = (iSlot + 1) & (dag->iHashSize - 1);
+    }
+
+    if (dag->iNodeCount == dag->iNodeMax)
+    {
+        iNewMax = dag->iNodeMax > 0 ? dag->iNodeMax * 2 : 256;
+        dag->nodeM = realloc(dag->nodeM, iNewMax * sizeof(DagNode));
+        if (dag->nodeM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d DAG nodes", iNewMax);
+        dag->iNodeMax = iNewMax;
+    }
+    dag->nodeM[dag->iNodeCount] = *pNode;
+    dag->nodeM[dag->iNodeCount].bRoot = FALSE;
+    dag->iHashM[iSlot] = dag->iNodeCount;
+    dag->iNodeCount++;
+    if (2 * dag->iNodeCount > dag->iHashSize)
+        growDagHash(dag);
+    return dag->iNodeCount - 1;
+}
+
+/******************** addDagQuery **************************************
+int addDagQuery(QueryDag dag, Query query)
+Purpose:
+    Adds a compiled query to the DAG, sharing the nodes it has in common
+    with the queries already added.
+Parameters:
+    I/O QueryDag dag                DAG of the batch
+    I   Query query                 query from compileQuery
+Returns:
+    The subscript of the node giving the query's result.
+**************************************************************************/
+int addDagQuery(QueryDag dag, Query query)
+{
+    DagNode node;
+    int iTop = 0;
+    int iRoot;
+    int i;
+
+    if (query->iInstrCount > dag->iStackMax)
+    {
+        dag->iStackMax = query->iInstrCount;
+        dag->iStackM = realloc(dag->iStackM, dag->iStackMax * sizeof(int));
+        if (dag->iStackM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a DAG work area");
+    }
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        node.instr = query->instrM[i];
+        node.iLeft = node.iRight = -1;
+        node.bRoot = FALSE;
+        if (node.instr.iOp == OP_AND || node.instr.iOp == OP_OR)
+        {
+            node.iRight = dag->iStackM[--iTop];
+            node.iLeft = dag->iStackM[--iTop];
+            if (node.iLeft > node.iRight)
+            {
+                node.iLeft = node.iRight;
+                node.iRight = dag->iStackM[iTop];
+            }
+        }
+        dag->iStackM[iTop++] = findOrAddNode(dag, &node);
+    }
+    dag->lInstrCount += query->iInstrCount;
+    iRoot = dag->iStackM[0];
+    dag->nodeM[iRoot].bRoot = TRUE;
+    return iRoot;
+}
+
+/******************** resetQueryDag **************************************
+void resetQueryDag(QueryDag dag)
+Purpose:
+    Empties a DAG so that it can be used for the next batch.
+Parameters:
+    I/O QueryDag dag                DAG to empty
+Returns:
+    n/a
+Notes:
+    - The node array and hash table keep their size.
+**************************************************************************/
+void resetQueryDag(QueryDag dag)
+{
+    dag->iNodeCount = 0;
+    dag->lInstrCount = 0;
+    memset(dag->iHashM, -1, dag->iHashSize * sizeof(int));
+}
+
+/******************** freeQueryDag **************************************
+void freeQueryDag(QueryDag dag)
+Purpose:
+    Frees a query DAG.
+Parameters:
+    I/O QueryDag dag                DAG to free
+Returns:
+    n/a
+**************************************************************************/
+void freeQueryDag(QueryDag dag)
+{
+    free(dag->nodeM);
+    free(dag->iHashM);
+    free(dag->iStackM);
+    free(dag);
+}
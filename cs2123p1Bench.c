@@ -0,0 +1,3576 @@
+/******************************************************************************
+cs2123p1Bench.c by Timothy Hennessy
+Purpose:
+    Benchmarks the infix to postfix conversion, and optionally the query
+    evaluation, on synthetic queries.  The queries and customers come from
+    a seedable generator, so two builds given the same parameters work on
+    exactly the same data.
+Command Parameters:
+    bench [-n queries] [-r repeat] [-s seed] [-l terms] [-d depth]
+          [-a andPercent] [-e equalPercent] [-v vocabulary] [-m malformedPercent]
+          [-c customers] [-u updates] [-p events] [-b] [-t threads] [-k] [-g]
+          [-z distinct] [-q cacheEntries] [-j maxThreads] [-o] [-y]
+          [-i records] [-f megabytes] [-x driver -X statsDriver]
+        -n queries          - number of queries generated (default 10000)
+        -r repeat           - times each benchmark is run; the fastest run
+                              is reported (default 5)
+        -s seed             - generator seed (default 1)
+        -l terms            - comparisons per query (default 8)
+        -d depth            - deepest parenthesis nesting (default 3)
+        -a andPercent       - percent of AND among AND and OR (default 50)
+        -e equalPercent     - percent of = among the comparison operators.
+                              The rest are NOTANY and ONLY (default 80)
+        -v vocabulary       - number of distinct trait types and of trait
+                              values (default 64)
+        -m malformedPercent - percent of queries given an unmatched
+                              parenthesis (default 0)
+        -c customers        - number of customers generated for the
+                              evaluation benchmarks (default 0, which
+                              skips them).  The evaluators are first
+                              checked to give the same counts; the
+                              bench exits with ERR_ALGORITHM if not.
+        -u updates          - number of customer updates generated for the
+                              standing query benchmarks (default 0, which
+                              skips them; needs -c).  Every generated
+                              query is registered as a standing query.
+        -p events           - number of customer events generated for the
+                              match index benchmarks (default 0, which
+                              skips them).  Every generated query is
+                              registered with the match index.
+        -b                  - also benchmark the conversion of single large
+                              queries of 1000 to 1000000 tokens
+        -t threads          - threads used by convertToPostFixParallel for
+                              the large queries (default 4)
+        -k                  - also benchmark the column file of the
+                              generated customers (needs -c)
+        -g                  - write the generated queries to stdout, one
+                              per line, instead of benchmarking them
+        -z distinct         - draw the queries from this many distinct
+                              queries with Zipf frequencies, as a query
+                              log repeats its popular queries (default 0,
+                              which makes every query a new one)
+        -q cacheEntries     - most queries kept by the query cache of
+                              the convertCached benchmark (default 1024)
+        -j maxThreads       - also benchmark converting the queries on 1,
+                              2, 4, ... up to maxThreads threads (default
+                              0, which skips it)
+        -o                  - also benchmark writing the converted
+                              queries to a file
+        -y                  - skew the customers' values: the k-th value
+                              is drawn with a frequency proportional to
+                              1 / k instead of uniformly
+        -i records          - also benchmark loading this many customer
+                              records with the traits of
+                              cs2123p1Input.txt and evaluating its queries
+                              on them (default 0, which skips it; use a
+                              few million, such as -i 4000000)
+        -f megabytes        - also benchmark reading a query file of at
+                              least this many megabytes with a LineReader
+                              and converting its queries, as the driver
+                              does (default 0, which skips it; use a few
+                              gigabytes, such as -f 4096)
+        -x driver           - with -X, also benchmark the driver p1
+                              compiled without the statistics ...
+        -X statsDriver      - ... against it compiled with
+                              -DCS2123P1_STATS, run with -S text
+Input:
+    n/a
+Results:
+    A tab separated table, one line per benchmark, after a comment line
+    with the parameters.  Redirect it to a file and diff the files of two
+    builds to find performance regressions:
+        # cs2123p1Bench seed=1 queries=10000 ... tokens=239102
+        benchmark<TAB>ns_per_query<TAB>tokens_per_sec
+        getToken<TAB>412.3<TAB>57993212
+        ...
+    The benchmarks are:
+        getToken          split every query into tokens with getToken
+        getTokenView      split every query into tokens with getTokenView
+        categorize        categorize every token (already interned), which
+                          only reads its symbol's category and precedence
+        processOperator   the conversion stack algorithm (processOperator,
+                          processRightParen, processRemString) on tokens
+                          that are already interned and categorized
+        convertToPostFix  end to end conversion of the query text
+        convertNewOut     the same with a new Out for each query, so
+                          each conversion allocates its arena.  The
+                          arena blocks allocated per query by both are
+                          written to stderr
+        convertCached     the same through a query cache (cs2123p1Cache.c)
+                          that starts empty on each run.  Its hit rate is
+                          written to stderr
+        countStringMatches  count the matching customers of every query
+                          with a switch interpreter comparing value strings,
+                          each customer's values of a trait stored as a
+                          set of strings (needs -c)
+        countMatchesSwitch  the same with the switch interpreter, which
+                          tests the customers' value masks (needs -c)
+        countMatches      the same with the threaded interpreter and the
+                          fast path for conjunctions of = (needs -c)
+        countOptimized    the same after optimizeQuery (cs2123p1Optimize.c)
+                          with statistics collected from the customers.
+                          The time it saves against countMatches is
+                          written to stderr (needs -c; use -y for values
+                          whose selectivities differ)
+        countSimplified   the same after simplifyQuery (cs2123p1Simplify.c);
+                          queries it decides are not evaluated.  The
+                          number of queries it simplified is written to
+                          stderr (needs -c)
+        countColumnScalar the same a block of 1024 customers at a time
+                          (countColumnMatches) with the scalar kernels
+                          (needs -c)
+        countColumnMatches  the same with the AVX2 kernels when the
+                          processor has AVX2 (needs -c)
+        countIndexMatches the same with the customer index (buildIndex),
+                          whose memory is written to stderr next to that
+                          of one plain bitmap per value (needs -c)
+        countDagMatches   the same CHUNK_QUERIES queries at a time, as
+                          the driver's -b does: the queries of a chunk
+                          are added to a DAG (addDagQuery), whose shared
+                          subexpressions countDagMatches evaluates once.
+                          A chunk with fewer than DAG_MIN_SHARING
+                          instructions per 100 nodes is counted a query
+                          at a time instead.  The instructions per distinct
+                          node, the chunks counted a query at a time and
+                          the time saved against countIndexMatches are
+                          written to stderr (needs -c; use -z for
+                          queries that repeat)
+        standingUpdate    apply the updates to the standing queries,
+                          evaluating only the queries the index finds
+                          (needs -c and -u)
+        standingRerun     the same, evaluating every standing query on
+                          each update (needs -c and -u)
+        matchIndex        match every event against the queries with the
+                          match index (needs -p)
+        matchScan         the same, evaluating every query on the first
+                          MATCH_SCAN_EVENTS events (needs -p)
+    After them, the conversion before and after the Element held only a
+    symbol id, on the queries that fit the arrays of the first version:
+        convertLegacy     the conversion of the first version (commit
+                          7f49223), rebuilt in this file: Elements
+                          holding a 51 byte Token are copied on every
+                          push, pop and addOut, tokens are copied by
+                          getToken and compared with strcmp by
+                          categorize, and the stack is allocated for
+                          each query
+        convertCurrent    convertToPostFix on the same queries
+      The number of queries that fit is written to stderr.
+    Then the classification of the tokens, found with getTokenView, of
+    every query:
+        classifyStrcmp    copy each token and compare it with strcmp to
+                          each entry of the first version's symbolDefM
+                          until one matches, as its categorize did
+        classifyIntern    internSymbol and categorize each token, all of
+                          them seen before, as a long running converter
+                          mostly finds them
+        classifyNew       the same with every operand made a new one,
+                          so each is added to the symbol table and looked
+                          up in symbolDefM by its length and first
+                          character (lookupSymbolDef)
+      The share of the tokens that are operands is written to stderr.
+    With -b, for each size N of 1k, 10k, 100k and 1M tokens:
+        convertLargeN     convert one query of N tokens with convertToPostFix
+        parallelLargeN    the same with convertToPostFixParallel
+    With -k (see cs2123p1Column.c):
+        loadText          load the customers from a customer file with
+                          loadCustomers
+        openColumnFile    map their column file and load its dictionaries
+        columnFileCold    answer each of the first COLUMN_COLD_QUERIES
+                          queries on a newly opened column file: open it,
+                          convert, compile and count the query, close it
+        countColumnFile   count the matching customers of every query with
+                          countColumnFileMatches on one open column file
+                          whose blocks are already unpacked
+      The size of the column file and the bytes a query reads from a newly
+      opened one are written to stderr.
+    With -o, the converted queries are written to a temporary file:
+        printOut          the query header with printf, then printOut,
+                          with stdout redirected to the file
+        formatText        the same text with formatOut into an
+                          OutputBuffer on the file
+        formatPostfix     query number, return code and postfix on one
+                          line with FORMAT_POSTFIX, as -f postfix writes
+      The bytes written and the megabytes per second of each are written
+      to stderr.
+    With -i, on the generated records (see note 7), where the columns are
+    nanoseconds per record and records per second:
+        recordsLoad       load the records from a customer file with
+                          loadCustomers
+        recordsEvaluate   evaluate every valid query of cs2123p1Input.txt
+                          on one record at a time with evaluateQuery
+        recordsMatch      the same a query at a time with countMatches
+        recordsIndex      the same with countIndexMatches on the index
+                          of the records, which is built before timing
+      The size of the customer file and the number of records each query
+      matches are written to stderr.
+    With -f, the generated queries are written again and again to a
+    temporary query file of the given size:
+        readLines         read the file with newLineReader and readLine
+        ingestFile        the same, converting each line with
+                          convertToPostFix as the driver's main does
+      The columns are nanoseconds per query and queries per second.  The
+      size of the file and the gigabytes per second of each are written
+      to stderr.
+    With -x and -X, the generated queries are written again and again to
+    a temporary query file, which each driver converts with its output
+    discarded:
+        driverPlain       the driver without the statistics
+        driverStats       the driver with them, run with -S text
+      The columns are nanoseconds per query and queries per second,
+      including starting the driver.  The time the statistics add is
+      written to stderr.
+    With -j, for each thread count N:
+        convertThreadsN   convert and format every query on N threads,
+                          CHUNK_QUERIES queries at a time, and join the
+                          results in query order, as the driver's -t
+                          does.  The speedup over one thread is written
+                          to stderr
+    For the standing query benchmarks the columns are nanoseconds per
+    update and updates per second, and for the match benchmarks
+    nanoseconds per event and events per second.  loadText and
+    openColumnFile give nanoseconds per load and customers per second,
+    and columnFileCold nanoseconds per query and queries per second.
+Returns:
+    0 - normal
+    906 - ERR_INPUT; an invalid parameter
+Notes:
+    1. Times are wall clock times from CLOCK_MONOTONIC.
+    2. The generator uses its own random number generator (xorshift64*),
+       so the queries are the same on every platform.
+    3. A generated customer has each of the first MAX_TRAIT trait types
+       three times in four, with a second value a quarter of the time.
+       -e 100 -a 100 generates only conjunctions of =.
+    4. Events are generated like customers, from a different seed.
+       With -z, the k-th distinct query is drawn with a frequency
+       proportional to 1 / k, so the first few make up much of the log.
+    5. A large query is machine built: ( ... ) groups joined by AND,
+       nested four deep, around OR lists of 16 comparisons.
+    6. A generated update changes one or two of a customer's trait types.
+       Each gets one new value, or is removed one time in eight.  Every
+       run of a standing query benchmark applies different updates, since
+       applying the same ones again would mostly change nothing.
+    7. A generated record has SMOKING (N or Y) and GENDER (F or M), and
+       EXERCISE and BOOK each with none to three distinct values of
+       HIKE, BIKE, RUN, SWIM, YOGA and SCIFI, HISTORY, ROMANCE, MYSTERY.
+    8. Compile with:
+           gcc -O2 -pthread -o bench cs2123p1Bench.c cs2123p1Lib.c cs2123p1.c \
+               cs2123p1Eval.c cs2123p1Index.c cs2123p1Standing.c cs2123p1Match.c \
+               cs2123p1Parallel.c cs2123p1Simplify.c cs2123p1Column.c \
+               cs2123p1Cache.c cs2123p1Batch.c cs2123p1Optimize.c
+*******************************************************************************/
+// If compiling using visual studio, tell the compiler not to give its warnings
+// about the safety of scanf and printf
+#define _CRT_SECURE_NO_WARNINGS 1
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+#include "cs2123p1Column.h"
+#include "cs2123p1Cache.h"
+
+#define MATCH_SCAN_EVENTS 100   // events matched by matchScan
+#define COLUMN_COLD_QUERIES 100 // queries answered by columnFileCold
+#define LARGE_MIN_TOKENS 1000   // tokens in the smallest large query (-b)
+#define LARGE_MAX_TOKENS 1000000    // tokens in the largest large query (-b)
+#define LARGE_LIST_TERMS 16     // comparisons in an OR list of a large query
+#define LEGACY_STACK_ELEM 20    // stack size of the first version (MAX_STACK_ELEM)
+#define LEGACY_OUT_ITEM 50      // out size of the first version (MAX_OUT_ITEM)
+#define SAMPLE_MAX_VALUES 3     // most values of EXERCISE or BOOK in a record (-i)
+#define STATS_BENCH_QUERIES 200000  // least queries run by the drivers (-x)
+
+// GenParams typedef holds the query generator parameters
+typedef struct
+{
+    int iQueryCount;
+    unsigned long long ulSeed;
+    int iTerms;                 // comparisons per query
+    int iDepth;                 // deepest parenthesis nesting
+    int iAndPercent;            // percent of AND among AND and OR
+    int iEqualPercent;          // percent of = among the comparison operators
+    int iVocabulary;            // distinct trait types and trait values
+    int iMalformedPercent;      // percent of queries with an unmatched parenthesis
+    int iCustomerCount;         // customers for the evaluation benchmarks
+    int iUpdateCount;           // customer updates for the standing query benchmarks
+    int iEventCount;            // customer events for the match benchmarks
+    int iZipfDistinct;          // distinct queries drawn from (0 for none)
+    double *dValueSumM;         // Zipf sums of the customer values (NULL
+                                // unless they are skewed)
+} GenParams;
+
+// QuerySet typedef holds the generated queries, each zero terminated,
+// and the elements of their tokens
+typedef struct
+{
+    int iQueryCount;
+    char **pszQueryM;           // the text of each query
+    int iTokenCount;            // tokens in all of the queries
+    Element *elementM;          // interned and categorized tokens
+    int *iFirstElementM;        // first element of each query (plus one past the end)
+    long lConvertBlocks;        // arena blocks allocated by convertToPostFix
+    long lConvertCount;         // queries it converted
+    long lNewOutBlocks;         // the same for convertNewOut
+    long lNewOutCount;
+    int iCacheEntries;          // most queries kept by convertCached's cache
+    long lCacheHits;            // hits of the last convertCached run
+    long lCacheMisses;
+    long lDagInstrCount;        // instructions added by the last countDagMatches run
+    long lDagNodeCount;         // distinct nodes they made
+    int iDagCount;              // chunks of the last countDagMatches run
+    int iDagPerQueryCount;      // those it counted a query at a time
+    CustomerSet customerSet;    // generated customers (NULL without -c)
+    CustomerIndex customerIndex;    // index of customerSet (NULL without -c)
+    Query *queryM;              // each query compiled against customerSet
+                                // (NULL if it is not a valid query)
+    Query *simpleQueryM;        // the same queries after simplifyQuery
+    Query *optimizedQueryM;     // the same queries after optimizeQuery
+    QueryStats stats;           // statistics of customerSet for optimizeQuery
+    int *iSimpleResultM;        // simplifyQuery result of each query
+    int iSimplifiedCount;       // queries simplifyQuery shortened or decided
+    int iConstantCount;         // queries simplifyQuery decided
+    int iUpdateCount;           // updates applied by one standing query run
+    int *iUpdateCustomerM;      // customer of each update (iRepeat runs of them)
+    char **pszUpdateM;          // TRAIT=VALUE fields of each update
+    StandingSet standingSet;    // standing queries using the index (NULL without -u)
+    StandingSet rerunSet;       // the same queries, evaluating every one
+    int iStandingRun;           // runs of standingUpdate so far
+    int iRerunRun;              // runs of standingRerun so far
+    int iEventCount;
+    char **pszEventM;           // TRAIT=VALUE fields of each event
+    MatchIndex matchIndex;      // every query (NULL without -p)
+    char **pszStringM[MAX_TRAIT];   // copy of the value string of each
+                                    // customer value id (NULL without -c)
+} QuerySet;
+
+// sink keeps the benchmark loops from being optimized away
+static volatile long lSink;
+
+// the queries of cs2123p1Input.txt, evaluated on the records of -i.  The
+// ones with an unmatched parenthesis are skipped.
+static char *pszSampleQueryM[] =
+{
+    "SMOKING = N AND GENDER = F "
+    , "SMOKING = N AND ( EXERCISE = HIKE OR EXERCISE = BIKE )"
+    , "GENDER = F AND EXERCISE NOTANY YOGA"
+    , "SMOKING = N AND EXERCISE = HIKE OR EXERCISE = BIKE"
+    , "( BOOK = SCIFI )"
+    , "( ( ( BOOK ONLY SCIFI ) ) )"
+    , "( ( SMOKING = N )"
+    , "( ( SMOKING = N ) AND ( BOOK ONLY SCIFI ) AND ( EXERCISE = HIKE ) )"
+    , "( GENDER = M ) AND EXERCISE = BIKE )"
+    , NULL
+};
+
+// the values of the traits of the -i records
+static char *pszSmokingM[] = {"N", "Y", NULL};
+static char *pszGenderM[] = {"F", "M", NULL};
+static char *pszExerciseM[] = {"HIKE", "BIKE", "RUN", "SWIM", "YOGA", NULL};
+static char *pszBookM[] = {"SCIFI", "HISTORY", "ROMANCE", "MYSTERY", NULL};
+
+/******************** nextRandom **************************************
+unsigned long long nextRandom(unsigned long long *pulState)
+Purpose:
+    Returns the next number of an xorshift64* random number generator.
+Parameters:
+    I/O unsigned long long *pulState    generator state (never 0)
+Returns:
+    A 64 bit random number.
+**************************************************************************/
+static unsigned long long nextRandom(unsigned long long *pulState)
+{
+    *pulState ^= *pulState >> 12;
+    *pulState ^= *pulState << 25;
+    *pulState ^= *pulState >> 27;
+    return *pulState * 2685821657736338717ULL;
+}
+
+/******************** randomBelow **************************************
+int randomBelow(unsigned long long *pulState, int iLimit)
+Purpose:
+    Returns a random number from 0 to iLimit - 1.
+**************************************************************************/
+static int randomBelow(unsigned long long *pulState, int iLimit)
+{
+    return (int) ((nextRandom(pulState) >> 33) % (unsigned long long) iLimit);
+}
+
+/******************** newZipfSums **************************************
+double *newZipfSums(int iCount)
+Purpose:
+    Returns the running sums of the Zipf weights 1 / k of k = 1 to
+    iCount, for randomZipf.  Free the array with free.
+**************************************************************************/
+static double *newZipfSums(int iCount)
+{
+    double *dSumM = malloc(iCount * sizeof(double));
+    double dSum = 0;
+    int k;
+
+    if (dSumM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d Zipf weights", iCount);
+    for (k = 0; k < iCount; k++)
+    {
+        dSum += 1.0 / (k + 1);
+        dSumM[k] = dSum;
+    }
+    return dSumM;
+}
+
+/******************** randomZipf **************************************
+int randomZipf(unsigned long long *pulState, double dSumM[], int iCount)
+Purpose:
+    Returns a random number from 0 to iCount - 1, k - 1 drawn with a
+    frequency proportional to 1 / k.
+Parameters:
+    I/O unsigned long long *pulState    generator state (never 0)
+    I   double dSumM[]              running sums from newZipfSums(iCount)
+    I   int iCount                  number of choices
+Returns:
+    The number drawn.
+Notes:
+    - 53 random bits give a uniform draw below the sum of the weights,
+      which is searched for among the running sums.
+**************************************************************************/
+static int randomZipf(unsigned long long *pulState, double dSumM[], int iCount)
+{
+    double dDraw = (nextRandom(pulState) >> 11) * (1.0 / 9007199254740992.0)
+        * dSumM[iCount - 1];
+    int iLow = 0;
+    int iHigh = iCount - 1;
+    int iMid;
+
+    while (iLow < iHigh)
+    {
+        iMid = (iLow + iHigh) / 2;
+        if (dSumM[iMid] > dDraw)
+            iHigh = iMid;
+        else
+            iLow = iMid + 1;
+    }
+    return iLow;
+}
+
+/******************** genComparison **************************************
+void genComparison(OutputBuffer output, GenParams *pParams
+    , unsigned long long *pulState)
+Purpose:
+    Generates one comparison such as TRAIT3 = VALUE17.
+Parameters:
+    O   OutputBuffer output         receives the text
+    I   GenParams *pParams          generator parameters
+    I/O unsigned long long *pulState    random number generator state
+Returns:
+    n/a
+**************************************************************************/
+static void genComparison(OutputBuffer output, GenParams *pParams
+    , unsigned long long *pulState)
+{
+    outputString(output, "TRAIT");
+    outputInt(output, randomBelow(pulState, pParams->iVocabulary));
+    if (randomBelow(pulState, 100) < pParams->iEqualPercent)
+        outputString(output, " = ");
+    else if (randomBelow(pulState, 2) == 0)
+        outputString(output, " NOTANY ");
+    else
+        outputString(output, " ONLY ");
+    outputString(output, "VALUE");
+    outputInt(output, randomBelow(pulState, pParams->iVocabulary));
+}
+
+/******************** genExpression **************************************
+void genExpression(OutputBuffer output, GenParams *pParams
+    , unsigned long long *pulState, int iTerms, int iDepth)
+Purpose:
+    Generates an expression of iTerms comparisons joined by AND and OR,
+    with parentheses nested at most iDepth deep.
+Parameters:
+    O   OutputBuffer output         receives the text
+    I   GenParams *pParams          generator parameters
+    I/O unsigned long long *pulState    random number generator state
+    I   int iTerms                  number of comparisons
+    I   int iDepth                  parenthesis nesting still allowed
+Returns:
+    n/a
+Notes:
+    - The comparisons are split at a random point.  Each side of a split
+      is put in parentheses half of the time (a single comparison a
+      quarter of the time) while nesting is allowed.
+**************************************************************************/
+static void genExpression(OutputBuffer output, GenParams *pParams
+    , unsigned long long *pulState, int iTerms, int iDepth)
+{
+    int iLeftTerms;
+    int iSide;
+    int iSideTerms;
+    int bParen;
+
+    if (iTerms == 1)
+    {
+        genComparison(output, pParams, pulState);
+        return;
+    }
+    iLeftTerms = 1 + randomBelow(pulState, iTerms - 1);
+    for (iSide = 0; iSide < 2; iSide++)
+    {
+        iSideTerms = iSide == 0 ? iLeftTerms : iTerms - iLeftTerms;
+        if (iSide == 1)
+        {
+            if (randomBelow(pulState, 100) < pParams->iAndPercent)
+                outputString(output, " AND ");
+            else
+                outputString(output, " OR ");
+        }
+        bParen = iDepth > 0 && randomBelow(pulState, iSideTerms > 1 ? 2 : 4) == 0;
+        if (bParen)
+            outputString(output, "( ");
+        genExpression(output, pParams, pulState, iSideTerms, iDepth - bParen);
+        if (bParen)
+            outputString(output, " )");
+    }
+}
+
+static void genQueries(OutputBuffer output, GenParams *pParams);
+
+/******************** genZipfQueries **************************************
+void genZipfQueries(OutputBuffer output, GenParams *pParams)
+Purpose:
+    Generates the queries, one per line, by drawing them from
+    iZipfDistinct distinct queries with Zipf frequencies.
+Parameters:
+    O   OutputBuffer output         receives the queries
+    I   GenParams *pParams          generator parameters
+Returns:
+    n/a
+Notes:
+    - The distinct queries are generated as genQueries would generate
+      that many, and drawn with randomZipf.
+**************************************************************************/
+static void genZipfQueries(OutputBuffer output, GenParams *pParams)
+{
+    unsigned long long ulState = pParams->ulSeed * 16 + 9;  // never 0
+    GenParams distinctParams = *pParams;
+    OutputBuffer distinct = newOutputBuffer(NULL);
+    int *iStartM = malloc((pParams->iZipfDistinct + 1) * sizeof(int));
+    double *dSumM = newZipfSums(pParams->iZipfDistinct);
+    int k = 0;
+    int i;
+
+    if (iStartM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d distinct queries", pParams->iZipfDistinct);
+    distinctParams.iQueryCount = pParams->iZipfDistinct;
+    distinctParams.iZipfDistinct = 0;
+    genQueries(distinct, &distinctParams);
+    for (i = 0; i < distinct->iLength; i++)
+    {
+        if (i == 0 || distinct->pszBuffer[i - 1] == '\n')
+            iStartM[k++] = i;
+    }
+    iStartM[k] = distinct->iLength;
+
+    for (i = 0; i < pParams->iQueryCount; i++)
+    {
+        k = randomZipf(&ulState, dSumM, pParams->iZipfDistinct);
+        outputText(output, distinct->pszBuffer + iStartM[k], iStartM[k + 1] - iStartM[k]);
+    }
+    free(iStartM);
+    free(dSumM);
+    freeOutputBuffer(distinct);
+}
+
+/******************** genQueries **************************************
+void genQueries(OutputBuffer output, GenParams *pParams)
+Purpose:
+    Generates the queries, one per line.
+Parameters:
+    O   OutputBuffer output         receives the queries
+    I   GenParams *pParams          generator parameters
+Returns:
+    n/a
+Notes:
+    - A malformed query gets an extra ( at its start or ) at its end.
+**************************************************************************/
+static void genQueries(OutputBuffer output, GenParams *pParams)
+{
+    unsigned long long ulState = pParams->ulSeed * 2 + 1;  // never 0
+    int bMalformed;
+    int bLeft;
+    int i;
+
+    if (pParams->iZipfDistinct > 0)
+    {
+        genZipfQueries(output, pParams);
+        return;
+    }
+    for (i = 0; i < pParams->iQueryCount; i++)
+    {
+        bMalformed = randomBelow(&ulState, 100) < pParams->iMalformedPercent;
+        bLeft = randomBelow(&ulState, 2);
+        if (bMalformed && bLeft)
+            outputString(output, "( ");
+        genExpression(output, pParams, &ulState, pParams->iTerms, pParams->iDepth);
+        if (bMalformed && !bLeft)
+            outputString(output, " )");
+        outputText(output, "\n", 1);
+    }
+}
+
+/******************** genLargeExpression **************************************
+void genLargeExpression(OutputBuffer output, GenParams *pParams
+    , unsigned long long *pulState, int iTerms, int iDepth)
+Purpose:
+    Generates a machine built expression of iTerms comparisons: groups
+    joined by AND around OR lists.
+Parameters:
+    O   OutputBuffer output         receives the text
+    I   GenParams *pParams          generator parameters
+    I/O unsigned long long *pulState    random number generator state
+    I   int iTerms                  number of comparisons
+    I   int iDepth                  group nesting still allowed
+Returns:
+    n/a
+Notes:
+    - Up to LARGE_LIST_TERMS comparisons, or with no nesting left, the
+      comparisons are one OR list.  Otherwise they are split evenly into
+      four parenthesized groups.
+**************************************************************************/
+static void genLargeExpression(OutputBuffer output, GenParams *pParams
+    , unsigned long long *pulState, int iTerms, int iDepth)
+{
+    int iGroupTerms;
+    int i;
+
+    if (iTerms <= LARGE_LIST_TERMS || iDepth == 0)
+    {
+        for (i = 0; i < iTerms; i++)
+        {
+            if (i > 0)
+                outputString(output, " OR ");
+            genComparison(output, pParams, pulState);
+        }
+        return;
+    }
+    for (i = 0; i < 4; i++)
+    {
+        iGroupTerms = iTerms * (i + 1) / 4 - iTerms * i / 4;
+        if (iGroupTerms == 0)
+            continue;
+        if (i > 0)
+            outputString(output, " AND ");
+        outputString(output, "( ");
+        genLargeExpression(output, pParams, pulState, iGroupTerms, iDepth - 1);
+        outputString(output, " )");
+    }
+}
+
+/******************** genRecord **************************************
+void genRecord(OutputBuffer output, GenParams *pParams
+    , unsigned long long *pulState)
+Purpose:
+    Generates the TRAIT=VALUE fields of one customer, without a newline.
+Parameters:
+    O   OutputBuffer output         receives the text
+    I   GenParams *pParams          generator parameters
+    I/O unsigned long long *pulState    random number generator state
+Returns:
+    n/a
+**************************************************************************/
+static void genRecord(OutputBuffer output, GenParams *pParams
+    , unsigned long long *pulState)
+{
+    int iTraits = pParams->iVocabulary < MAX_TRAIT ? pParams->iVocabulary : MAX_TRAIT;
+    int iTrait;
+    int iValues;
+
+    for (iTrait = 0; iTrait < iTraits; iTrait++)
+    {
+        if (randomBelow(pulState, 4) == 0)
+            continue;
+        for (iValues = 0; iValues < 2; iValues++)
+        {
+            if (iValues == 1 && randomBelow(pulState, 4) != 0)
+                break;
+            outputString(output, "TRAIT");
+            outputInt(output, iTrait);
+            outputString(output, "=VALUE");
+            if (pParams->dValueSumM != NULL)
+                outputInt(output, randomZipf(pulState, pParams->dValueSumM
+                    , pParams->iVocabulary));
+            else
+                outputInt(output, randomBelow(pulState, pParams->iVocabulary));
+            outputText(output, " ", 1);
+        }
+    }
+}
+
+/******************** genSampleField **************************************
+void genSampleField(OutputBuffer output, char szTrait[], char *pszValueM[]
+    , int iMaxValues, unsigned long long *pulState)
+Purpose:
+    Generates the TRAIT=VALUE fields of one trait of a -i record, each
+    followed by a space.
+Parameters:
+    O   OutputBuffer output         receives the text
+    I   char szTrait[]              trait name
+    I   char *pszValueM[]           its values, ending with NULL
+    I   int iMaxValues              most values given; at least one is
+                                    given when it is 1
+    I/O unsigned long long *pulState    random number generator state
+Returns:
+    n/a
+Notes:
+    - A value is not given twice, so a record's values are a set as they
+      are in cs2123p1Input's customers.
+**************************************************************************/
+static void genSampleField(OutputBuffer output, char szTrait[], char *pszValueM[]
+    , int iMaxValues, unsigned long long *pulState)
+{
+    int iValueCount;
+    int iGiven;
+    int iChosen = 0;            // bit of each value already given
+    int iValue;
+
+    for (iValueCount = 0; pszValueM[iValueCount] != NULL; iValueCount++)
+        ;
+    iGiven = iMaxValues == 1 ? 1 : randomBelow(pulState, iMaxValues + 1);
+    while (iGiven-- > 0)
+    {
+        do
+            iValue = randomBelow(pulState, iValueCount);
+        while (iChosen & (1 << iValue));
+        iChosen |= 1 << iValue;
+        outputString(output, szTrait);
+        outputText(output, "=", 1);
+        outputString(output, pszValueM[iValue]);
+        outputText(output, " ", 1);
+    }
+}
+
+/******************** genSampleFile **************************************
+FILE *genSampleFile(GenParams *pParams, int iRecordCount)
+Purpose:
+    Writes the -i records to a temporary file in the customer file format.
+Parameters:
+    I   GenParams *pParams          generator parameters
+    I   int iRecordCount            number of records
+Returns:
+    The file, positioned at its start.
+**************************************************************************/
+static FILE *genSampleFile(GenParams *pParams, int iRecordCount)
+{
+    unsigned long long ulState = pParams->ulSeed * 2 + 5;  // never 0
+    OutputBuffer output;
+    FILE *pFile = tmpfile();
+    int iRecord;
+
+    if (pFile == NULL)
+        ErrExit(ERR_INPUT, "Unable to create a temporary record file");
+    output = newOutputBuffer(pFile);
+    for (iRecord = 0; iRecord < iRecordCount; iRecord++)
+    {
+        genSampleField(output, "SMOKING", pszSmokingM, 1, &ulState);
+        genSampleField(output, "GENDER", pszGenderM, 1, &ulState);
+        genSampleField(output, "EXERCISE", pszExerciseM, SAMPLE_MAX_VALUES, &ulState);
+        genSampleField(output, "BOOK", pszBookM, SAMPLE_MAX_VALUES, &ulState);
+        outputText(output, "\n", 1);
+    }
+    flushOutput(output);
+    freeOutputBuffer(output);
+    rewind(pFile);
+    return pFile;
+}
+
+/******************** genCustomerFile **************************************
+FILE *genCustomerFile(GenParams *pParams)
+Purpose:
+    Writes the customers for the evaluation benchmarks to a temporary
+    file in the customer file format.
+Parameters:
+    I   GenParams *pParams          generator parameters
+Returns:
+    The file, positioned at its start.
+**************************************************************************/
+static FILE *genCustomerFile(GenParams *pParams)
+{
+    unsigned long long ulState = pParams->ulSeed * 2 + 1;  // never 0
+    OutputBuffer output;
+    FILE *pFile = tmpfile();
+    int iCustomer;
+
+    if (pFile == NULL)
+        ErrExit(ERR_INPUT, "Unable to create a temporary customer file");
+    output = newOutputBuffer(pFile);
+    for (iCustomer = 0; iCustomer < pParams->iCustomerCount; iCustomer++)
+    {
+        genRecord(output, pParams, &ulState);
+        outputText(output, "\n", 1);
+    }
+    flushOutput(output);
+    freeOutputBuffer(output);
+    rewind(pFile);
+    return pFile;
+}
+
+/******************** genCustomers **************************************
+CustomerSet genCustomers(GenParams *pParams)
+Purpose:
+    Generates the customers for the evaluation benchmarks.
+Parameters:
+    I   GenParams *pParams          generator parameters
+Returns:
+    The customer set.
+Notes:
+    - The customers are written to a temporary file in the customer file
+      format and loaded with loadCustomers.
+**************************************************************************/
+static CustomerSet genCustomers(GenParams *pParams)
+{
+    CustomerSet customerSet;
+    FILE *pFile = genCustomerFile(pParams);
+
+    customerSet = loadCustomers(pFile);
+    fclose(pFile);
+    return customerSet;
+}
+
+/******************** buildValueStrings **************************************
+void buildValueStrings(QuerySet *pSet)
+Purpose:
+    Stores every customer's values as strings, for countStringMatches.
+Parameters:
+    I/O QuerySet *pSet              queries; customerSet must be set
+Returns:
+    n/a
+Notes:
+    - pszStringM[t] is parallel to iValueIdM of trait t.  Every entry is
+      its own copy, as a set of strings kept for each customer would be.
+**************************************************************************/
+static void buildValueStrings(QuerySet *pSet)
+{
+    TraitColumn *pColumn;
+    int iTrait;
+    int i;
+
+    for (iTrait = 0; iTrait < pSet->customerSet->iTraitCount; iTrait++)
+    {
+        pColumn = &pSet->customerSet->traitM[iTrait];
+        pSet->pszStringM[iTrait] = malloc((pColumn->iValueIdCount + 1) * sizeof(char *));
+        if (pSet->pszStringM[iTrait] == NULL)
+            ErrExit(ERR_INPUT, "Unable to allocate %d value strings"
+                , pColumn->iValueIdCount);
+        for (i = 0; i < pColumn->iValueIdCount; i++)
+        {
+            pSet->pszStringM[iTrait][i] = strdup(pColumn->szValueM[pColumn->iValueIdM[i]]);
+            if (pSet->pszStringM[iTrait][i] == NULL)
+                ErrExit(ERR_INPUT, "Unable to allocate a value string");
+        }
+    }
+}
+
+/******************** plainIndexBytes **************************************
+double plainIndexBytes(CustomerSet customerSet)
+Purpose:
+    Returns the bytes of an index keeping one bitmap of every customer
+    for each (trait, value), and one of the customers with several values
+    of each trait, to compare with the containers of buildIndex.
+**************************************************************************/
+static double plainIndexBytes(CustomerSet customerSet)
+{
+    double dWords = (customerSet->iCustomerCount + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    double dBitmaps = 1;        // all customers
+    int iTrait;
+
+    for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+        dBitmaps += customerSet->traitM[iTrait].iValueCount + 1;
+    return dBitmaps * dWords * sizeof(BitWord);
+}
+
+/******************** genEvents **************************************
+void genEvents(OutputBuffer output, GenParams *pParams, QuerySet *pSet)
+Purpose:
+    Generates the customer events for the match benchmarks.
+Parameters:
+    O   OutputBuffer output         receives the fields of the events.
+                                    They stay there, zero terminated.
+    I   GenParams *pParams          generator parameters
+    O   QuerySet *pSet              iEventCount and pszEventM
+Returns:
+    n/a
+**************************************************************************/
+static void genEvents(OutputBuffer output, GenParams *pParams, QuerySet *pSet)
+{
+    unsigned long long ulState = pParams->ulSeed * 8 + 5;  // never 0
+    int *iOffsetM;
+    int i;
+
+    pSet->iEventCount = pParams->iEventCount;
+    pSet->pszEventM = malloc(pSet->iEventCount * sizeof(char *));
+    iOffsetM = malloc(pSet->iEventCount * sizeof(int));
+    if (pSet->pszEventM == NULL || iOffsetM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d events", pSet->iEventCount);
+    for (i = 0; i < pSet->iEventCount; i++)
+    {
+        iOffsetM[i] = output->iLength;
+        genRecord(output, pParams, &ulState);
+        outputText(output, "", 1);     // zero terminator
+    }
+    // the buffer may have moved while it grew
+    for (i = 0; i < pSet->iEventCount; i++)
+        pSet->pszEventM[i] = output->pszBuffer + iOffsetM[i];
+    free(iOffsetM);
+}
+
+/******************** genUpdates **************************************
+void genUpdates(OutputBuffer output, GenParams *pParams, QuerySet *pSet
+    , int iRuns)
+Purpose:
+    Generates the customer updates for iRuns runs of the standing query
+    benchmarks.
+Parameters:
+    O   OutputBuffer output         receives the fields of the updates.
+                                    They stay there, zero terminated.
+    I   GenParams *pParams          generator parameters
+    O   QuerySet *pSet              iUpdateCustomerM and pszUpdateM
+    I   int iRuns                   number of runs
+Returns:
+    n/a
+**************************************************************************/
+static void genUpdates(OutputBuffer output, GenParams *pParams, QuerySet *pSet
+    , int iRuns)
+{
+    unsigned long long ulState = pParams->ulSeed * 4 + 3;  // never 0
+    int iTraits = pParams->iVocabulary < MAX_TRAIT ? pParams->iVocabulary : MAX_TRAIT;
+    int iUpdates = pParams->iUpdateCount * iRuns;
+    int *iOffsetM;
+    int iField;
+    int i;
+
+    pSet->iUpdateCount = pParams->iUpdateCount;
+    pSet->iUpdateCustomerM = malloc(iUpdates * sizeof(int));
+    pSet->pszUpdateM = malloc(iUpdates * sizeof(char *));
+    iOffsetM = malloc(iUpdates * sizeof(int));
+    if (pSet->iUpdateCustomerM == NULL || pSet->pszUpdateM == NULL || iOffsetM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d updates", iUpdates);
+    for (i = 0; i < iUpdates; i++)
+    {
+        pSet->iUpdateCustomerM[i] = randomBelow(&ulState, pParams->iCustomerCount);
+        iOffsetM[i] = output->iLength;
+        for (iField = 1 + randomBelow(&ulState, 2); iField > 0; iField--)
+        {
+            outputString(output, "TRAIT");
+            outputInt(output, randomBelow(&ulState, iTraits));
+            outputText(output, "=", 1);
+            if (randomBelow(&ulState, 8) != 0)
+            {
+                outputString(output, "VALUE");
+                outputInt(output, randomBelow(&ulState, pParams->iVocabulary));
+            }
+            outputText(output, " ", 1);
+        }
+        outputText(output, "", 1);     // zero terminator
+    }
+    // the buffer may have moved while it grew
+    for (i = 0; i < iUpdates; i++)
+        pSet->pszUpdateM[i] = output->pszBuffer + iOffsetM[i];
+    free(iOffsetM);
+}
+
+/******************** buildStandingSet **************************************
+StandingSet buildStandingSet(QuerySet *pSet, Out out, int bUseIndex)
+Purpose:
+    Registers every valid generated query as a standing query on the
+    generated customers.
+Parameters:
+    I   QuerySet *pSet              queries and customers
+    I/O Out out                     work area for the conversion
+    I   int bUseIndex               FALSE to evaluate every query on updates
+Returns:
+    The standing set.
+**************************************************************************/
+static StandingSet buildStandingSet(QuerySet *pSet, Out out, int bUseIndex)
+{
+    StandingSet set = newStandingSet(pSet->customerSet);
+    Query query = newQuery();
+    int i;
+
+    set->bUseIndex = bUseIndex;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        resetOut(out);
+        if (convertToPostFix(pSet->pszQueryM[i], out) == 0)
+            addStandingQuery(set, out, query);
+    }
+    freeQuery(query);
+    return set;
+}
+
+/******************** buildMatchIndex **************************************
+MatchIndex buildMatchIndex(QuerySet *pSet, Out out)
+Purpose:
+    Registers every valid generated query with a match index.
+Parameters:
+    I   QuerySet *pSet              queries
+    I/O Out out                     work area for the conversion
+Returns:
+    The match index.
+**************************************************************************/
+static MatchIndex buildMatchIndex(QuerySet *pSet, Out out)
+{
+    MatchIndex index = newMatchIndex();
+    Query query = newQuery();
+    int i;
+
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        resetOut(out);
+        if (convertToPostFix(pSet->pszQueryM[i], out) == 0)
+            addMatchQuery(index, out, query);
+    }
+    freeQuery(query);
+    return index;
+}
+
+/******************** compileQuerySet **************************************
+void compileQuerySet(QuerySet *pSet, Out out)
+Purpose:
+    Compiles every query against the generated customers, a second copy
+    of it that is simplified and a third that is optimized.
+Parameters:
+    I/O QuerySet *pSet              queries; customerSet must be set
+    I/O Out out                     work area for the conversion
+Returns:
+    n/a
+**************************************************************************/
+static void compileQuerySet(QuerySet *pSet, Out out)
+{
+    int i;
+
+    pSet->queryM = malloc(pSet->iQueryCount * sizeof(Query));
+    pSet->simpleQueryM = malloc(pSet->iQueryCount * sizeof(Query));
+    pSet->optimizedQueryM = malloc(pSet->iQueryCount * sizeof(Query));
+    pSet->iSimpleResultM = malloc(pSet->iQueryCount * sizeof(int));
+    if (pSet->queryM == NULL || pSet->simpleQueryM == NULL
+        || pSet->optimizedQueryM == NULL || pSet->iSimpleResultM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d queries", pSet->iQueryCount);
+    pSet->iSimplifiedCount = pSet->iConstantCount = 0;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        resetOut(out);
+        pSet->queryM[i] = newQuery();
+        pSet->simpleQueryM[i] = pSet->optimizedQueryM[i] = NULL;
+        if (convertToPostFix(pSet->pszQueryM[i], out) != 0
+            || compileQuery(out, pSet->customerSet, pSet->queryM[i]) != 0)
+        {
+            freeQuery(pSet->queryM[i]);
+            pSet->queryM[i] = NULL;
+            continue;
+        }
+        pSet->simpleQueryM[i] = newQuery();
+        compileQuery(out, pSet->customerSet, pSet->simpleQueryM[i]);
+        pSet->iSimpleResultM[i] = simplifyQuery(pSet->simpleQueryM[i]
+            , pSet->customerSet, out->arena);
+        if (pSet->iSimpleResultM[i] != SIMPLE_VARIES)
+            pSet->iConstantCount++;
+        if (pSet->iSimpleResultM[i] != SIMPLE_VARIES
+            || pSet->simpleQueryM[i]->iInstrCount < pSet->queryM[i]->iInstrCount)
+            pSet->iSimplifiedCount++;
+        pSet->optimizedQueryM[i] = newQuery();
+        compileQuery(out, pSet->customerSet, pSet->optimizedQueryM[i]);
+        optimizeQuery(pSet->optimizedQueryM[i], pSet->stats, out->arena);
+    }
+}
+
+/******************** buildQuerySet **************************************
+void buildQuerySet(OutputBuffer output, QuerySet *pSet)
+Purpose:
+    Splits the generated text into queries and interns their tokens.
+Parameters:
+    I/O OutputBuffer output         generated queries, one per line.  The
+                                    line ends are replaced by zero bytes.
+    O   QuerySet *pSet              the queries and their elements
+Returns:
+    n/a
+**************************************************************************/
+static void buildQuerySet(OutputBuffer output, QuerySet *pSet)
+{
+    char *pszRemainingText;
+    char *pszToken;
+    int iTokenLength;
+    int iElementMax = 1024;
+    int i;
+    int iQuery = 0;
+
+    pSet->pszQueryM = malloc(pSet->iQueryCount * sizeof(char *));
+    pSet->iFirstElementM = malloc((pSet->iQueryCount + 1) * sizeof(int));
+    pSet->elementM = malloc(iElementMax * sizeof(Element));
+    if (pSet->pszQueryM == NULL || pSet->iFirstElementM == NULL || pSet->elementM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d queries", pSet->iQueryCount);
+    pSet->iTokenCount = 0;
+
+    for (i = 0; i < output->iLength; i++)
+    {
+        if ((i == 0 || output->pszBuffer[i - 1] == '\0') && iQuery < pSet->iQueryCount)
+            pSet->pszQueryM[iQuery++] = output->pszBuffer + i;
+        if (output->pszBuffer[i] == '\n')
+            output->pszBuffer[i] = '\0';
+    }
+
+    for (iQuery = 0; iQuery < pSet->iQueryCount; iQuery++)
+    {
+        pSet->iFirstElementM[iQuery] = pSet->iTokenCount;
+        pszRemainingText = getTokenView(pSet->pszQueryM[iQuery], &pszToken
+            , &iTokenLength);
+        while (pszRemainingText != NULL)
+        {
+            if (pSet->iTokenCount == iElementMax)
+            {
+                iElementMax *= 2;
+                pSet->elementM = realloc(pSet->elementM, iElementMax * sizeof(Element));
+                if (pSet->elementM == NULL)
+                    ErrExit(ERR_INPUT, "Unable to allocate %d tokens", iElementMax);
+            }
+            pSet->elementM[pSet->iTokenCount].iSymbol = internSymbol(pszToken, iTokenLength);
+            categorize(&pSet->elementM[pSet->iTokenCount]);
+            pSet->iTokenCount++;
+            pszRemainingText = getTokenView(pszRemainingText, &pszToken, &iTokenLength);
+        }
+    }
+    pSet->iFirstElementM[pSet->iQueryCount] = pSet->iTokenCount;
+}
+
+/******************** elapsedNs **************************************
+double elapsedNs(struct timespec *pStart)
+Purpose:
+    Returns the nanoseconds since pStart.
+**************************************************************************/
+static double elapsedNs(struct timespec *pStart)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - pStart->tv_sec) * 1e9 + (end.tv_nsec - pStart->tv_nsec);
+}
+
+/******************** benchLarge **************************************
+void benchLarge(GenParams *pParams, int iThreads, int iRepeat, Out out)
+Purpose:
+    Times the conversion of single large queries, sequentially and on
+    iThreads threads, and prints their rows of the table.
+Parameters:
+    I   GenParams *pParams          generator parameters
+    I   int iThreads                threads for convertToPostFixParallel
+    I   int iRepeat                 times each conversion is run; the
+                                    fastest is reported
+    I/O Out out                     work area for the conversion
+Returns:
+    n/a
+Notes:
+    - Exits with ERR_ALGORITHM if the two conversions differ.
+**************************************************************************/
+static void benchLarge(GenParams *pParams, int iThreads, int iRepeat, Out out)
+{
+    unsigned long long ulState = pParams->ulSeed * 2 + 1;  // never 0
+    OutputBuffer output;
+    Element *elementM = NULL;
+    int iElementCount = 0;
+    struct timespec start;
+    double dNs;
+    double dBestNs;
+    int iTokens;
+    int iParallel;
+    int iRun;
+    int rc = 0;
+    char szName[40];
+
+    for (iTokens = LARGE_MIN_TOKENS; iTokens <= LARGE_MAX_TOKENS; iTokens *= 10)
+    {
+        // a comparison and its operator are 4 tokens; the groups add a few
+        output = newOutputBuffer(NULL);
+        genLargeExpression(output, pParams, &ulState, iTokens / 4, 4);
+        outputText(output, "", 1);
+        for (iParallel = 0; iParallel < 2; iParallel++)
+        {
+            dBestNs = 0;
+            for (iRun = 0; iRun < iRepeat; iRun++)
+            {
+                resetOut(out);
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                if (iParallel)
+                    rc = convertToPostFixParallel(output->pszBuffer, out, iThreads);
+                else
+                    rc = convertToPostFix(output->pszBuffer, out);
+                dNs = elapsedNs(&start);
+                if (iRun == 0 || dNs < dBestNs)
+                    dBestNs = dNs;
+            }
+            if (rc != 0)
+                ErrExit(ERR_ALGORITHM, "Large query of %d tokens failed with %d", iTokens, rc);
+            if (!iParallel)
+            {
+                iElementCount = out->iOutCount;
+                elementM = realloc(elementM, (iElementCount + 1) * sizeof(Element));
+                if (elementM == NULL)
+                    ErrExit(ERR_INPUT, "Unable to allocate %d elements", iElementCount);
+                memcpy(elementM, out->outM, iElementCount * sizeof(Element));
+            }
+            else if (out->iOutCount != iElementCount
+                || memcmp(elementM, out->outM, iElementCount * sizeof(Element)) != 0)
+                ErrExit(ERR_ALGORITHM, "Parallel conversion of %d tokens differs", iTokens);
+            sprintf(szName, "%s%d%s", iParallel ? "parallelLarge" : "convertLarge"
+                , iTokens >= 1000000 ? iTokens / 1000000 : iTokens / 1000
+                , iTokens >= 1000000 ? "M" : "k");
+            printf("%s\t%.1f\t%.0f\n", szName, dBestNs
+                , dBestNs > 0 ? iTokens / (dBestNs / 1e9) : 0.0);
+        }
+        freeOutputBuffer(output);
+    }
+    free(elementM);
+}
+
+/******************** benchColumnFile **************************************
+void benchColumnFile(QuerySet *pSet, GenParams *pParams, int iRepeat, Out out)
+Purpose:
+    Times loading the generated customers from text and from a column
+    file, and answering queries from the column file, and prints their
+    rows of the table.
+Parameters:
+    I   QuerySet *pSet              queries compiled against the customers
+    I   GenParams *pParams          generator parameters
+    I   int iRepeat                 times each benchmark is run; the
+                                    fastest is reported
+    I/O Out out                     work area for the conversion
+Returns:
+    n/a
+Notes:
+    - The column file keeps the value ids of the customer set, so the
+      queries compiled against it are used on the open file.
+    - Exits with ERR_ALGORITHM if the column file gives a different count
+      than countMatches.
+**************************************************************************/
+static void benchColumnFile(QuerySet *pSet, GenParams *pParams, int iRepeat, Out out)
+{
+    char szFileName[] = "/tmp/cs2123p1BenchXXXXXX";
+    FILE *pTextFile = genCustomerFile(pParams);
+    CustomerSet customerSet;
+    ColumnFile file;
+    Query query = newQuery();
+    struct timespec start;
+    double dNs = 0;
+    double dBestNs;
+    double dCustomers = pSet->customerSet->iCustomerCount;
+    long lTextSize;
+    long lColumnSize;
+    long lBytesRead = 0;
+    long lBlocks = 0;
+    long lSkipped = 0;
+    long lCount;
+    int iQueries = 0;
+    int iFd;
+    int iRun;
+    int bColumn;
+    int i;
+
+    iFd = mkstemp(szFileName);
+    if (iFd < 0)
+        ErrExit(ERR_INPUT, "Unable to create a temporary column file");
+    close(iFd);
+    writeColumnFile(pSet->customerSet, szFileName);
+    fseek(pTextFile, 0, SEEK_END);
+    lTextSize = ftell(pTextFile);
+
+    for (bColumn = FALSE; bColumn <= TRUE; bColumn++)
+    {
+        dBestNs = 0;
+        for (iRun = 0; iRun < iRepeat; iRun++)
+        {
+            rewind(pTextFile);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (bColumn)
+            {
+                file = openColumnFile(szFileName);
+                dNs = elapsedNs(&start);
+                closeColumnFile(file);
+            }
+            else
+            {
+                customerSet = loadCustomers(pTextFile);
+                dNs = elapsedNs(&start);
+                freeCustomerSet(customerSet);
+            }
+            if (iRun == 0 || dNs < dBestNs)
+                dBestNs = dNs;
+        }
+        printf("%s\t%.1f\t%.0f\n", bColumn ? "openColumnFile" : "loadText", dBestNs
+            , dBestNs > 0 ? dCustomers / (dBestNs / 1e9) : 0.0);
+    }
+
+    dBestNs = 0;
+    for (iRun = 0; iRun < iRepeat; iRun++)
+    {
+        iQueries = 0;
+        lBytesRead = lBlocks = lSkipped = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < pSet->iQueryCount && iQueries < COLUMN_COLD_QUERIES; i++)
+        {
+            if (pSet->queryM[i] == NULL)
+                continue;
+            file = openColumnFile(szFileName);
+            resetOut(out);
+            convertToPostFix(pSet->pszQueryM[i], out);
+            compileQuery(out, file->customerSet, query);
+            lSink += countColumnFileMatches(file, query);
+            lBytesRead += file->lBytesRead;
+            lBlocks += file->lBlocksSkipped + file->lBlocksEvaluated;
+            lSkipped += file->lBlocksSkipped;
+            closeColumnFile(file);
+            iQueries++;
+        }
+        dNs = elapsedNs(&start);
+        if (iRun == 0 || dNs < dBestNs)
+            dBestNs = dNs;
+    }
+    if (iQueries > 0)
+        printf("%s\t%.1f\t%.0f\n", "columnFileCold", dBestNs / iQueries
+            , dBestNs > 0 ? iQueries / (dBestNs / 1e9) : 0.0);
+
+    // check every query, which also unpacks the blocks for countColumnFile
+    file = openColumnFile(szFileName);
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->queryM[i] != NULL && countColumnFileMatches(file, pSet->queryM[i])
+            != countMatches(pSet->queryM[i], pSet->customerSet))
+            ErrExit(ERR_ALGORITHM, "Column file count of query %d differs", i + 1);
+    }
+    dBestNs = 0;
+    for (iRun = 0; iRun < iRepeat; iRun++)
+    {
+        lCount = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < pSet->iQueryCount; i++)
+        {
+            if (pSet->queryM[i] != NULL)
+                lCount += countColumnFileMatches(file, pSet->queryM[i]);
+        }
+        dNs = elapsedNs(&start);
+        lSink += lCount;
+        if (iRun == 0 || dNs < dBestNs)
+            dBestNs = dNs;
+    }
+    printf("%s\t%.1f\t%.0f\n", "countColumnFile", dBestNs / pSet->iQueryCount
+        , dBestNs > 0 ? pSet->iTokenCount / (dBestNs / 1e9) : 0.0);
+    lColumnSize = file->lFileSize;
+    closeColumnFile(file);
+
+    fprintf(stderr, "Column file: %ld bytes for %ld bytes of text; a query on a newly"
+        " opened file reads %.0f bytes and skips %.1f%% of its blocks\n"
+        , lColumnSize, lTextSize, iQueries > 0 ? (double) lBytesRead / iQueries : 0.0
+        , lBlocks > 0 ? 100.0 * lSkipped / lBlocks : 0.0);
+    unlink(szFileName);
+    fclose(pTextFile);
+    freeQuery(query);
+}
+
+/******************** benchRecords **************************************
+void benchRecords(GenParams *pParams, int iRecordCount, int iRepeat, Out out)
+Purpose:
+    Times loading records with the traits of cs2123p1Input.txt and
+    evaluating its queries on them, and prints their rows of the table.
+Parameters:
+    I   GenParams *pParams          generator parameters
+    I   int iRecordCount            number of records
+    I   int iRepeat                 times each benchmark is run; the
+                                    fastest is reported
+    I/O Out out                     work area for the conversion
+Returns:
+    n/a
+Notes:
+    - Exits with ERR_ALGORITHM if the evaluators give a query different
+      counts.
+**************************************************************************/
+static void benchRecords(GenParams *pParams, int iRecordCount, int iRepeat, Out out)
+{
+    FILE *pFile = genSampleFile(pParams, iRecordCount);
+    CustomerSet customerSet = NULL;
+    CustomerIndex index;
+    Query queryM[sizeof(pszSampleQueryM) / sizeof(pszSampleQueryM[0])];
+    int iCountM[sizeof(pszSampleQueryM) / sizeof(pszSampleQueryM[0])];
+    int iQueryCount = 0;        // valid sample queries
+    struct timespec start;
+    double dNs;
+    double dBestNs;
+    long lFileSize;
+    long lCount = 0;
+    int iMethod;                // 0 evaluateQuery, 1 countMatches, 2 countIndexMatches
+    int iRun;
+    int iCustomer;
+    int i;
+
+    fseek(pFile, 0, SEEK_END);
+    lFileSize = ftell(pFile);
+    dBestNs = 0;
+    for (iRun = 0; iRun < iRepeat; iRun++)
+    {
+        if (customerSet != NULL)
+            freeCustomerSet(customerSet);
+        rewind(pFile);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        customerSet = loadCustomers(pFile);
+        dNs = elapsedNs(&start);
+        if (iRun == 0 || dNs < dBestNs)
+            dBestNs = dNs;
+    }
+    fclose(pFile);
+    printf("%s\t%.1f\t%.0f\n", "recordsLoad", dBestNs / iRecordCount
+        , dBestNs > 0 ? iRecordCount / (dBestNs / 1e9) : 0.0);
+
+    for (i = 0; pszSampleQueryM[i] != NULL; i++)
+    {
+        resetOut(out);
+        queryM[iQueryCount] = newQuery();
+        if (convertToPostFix(pszSampleQueryM[i], out) != 0
+            || compileQuery(out, customerSet, queryM[iQueryCount]) != 0)
+            freeQuery(queryM[iQueryCount]);
+        else
+            iQueryCount++;
+    }
+    index = buildIndex(customerSet);
+    for (i = 0; i < iQueryCount; i++)
+    {
+        iCountM[i] = countMatches(queryM[i], customerSet);
+        if (countIndexMatches(queryM[i], index) != iCountM[i])
+            ErrExit(ERR_ALGORITHM, "Index count of sample query %d differs", i + 1);
+    }
+
+    for (iMethod = 0; iMethod < 3; iMethod++)
+    {
+        dBestNs = 0;
+        for (iRun = 0; iRun < iRepeat; iRun++)
+        {
+            lCount = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (iMethod == 0)
+            {
+                for (iCustomer = 0; iCustomer < iRecordCount; iCustomer++)
+                {
+                    for (i = 0; i < iQueryCount; i++)
+                        lCount += evaluateQuery(queryM[i], customerSet, iCustomer);
+                }
+            }
+            for (i = 0; iMethod > 0 && i < iQueryCount; i++)
+            {
+                if (iMethod == 1)
+                    lCount += countMatches(queryM[i], customerSet);
+                else
+                    lCount += countIndexMatches(queryM[i], index);
+            }
+            dNs = elapsedNs(&start);
+            lSink += lCount;
+            if (iRun == 0 || dNs < dBestNs)
+                dBestNs = dNs;
+        }
+        for (i = 0; i < iQueryCount; i++)
+            lCount -= iCountM[i];
+        if (lCount != 0)
+            ErrExit(ERR_ALGORITHM, "Sample query counts differ by %ld", lCount);
+        printf("%s\t%.1f\t%.0f\n", iMethod == 0 ? "recordsEvaluate"
+            : iMethod == 1 ? "recordsMatch" : "recordsIndex", dBestNs / iRecordCount
+            , dBestNs > 0 ? iRecordCount / (dBestNs / 1e9) : 0.0);
+    }
+
+    fprintf(stderr, "Records: %d in %ld bytes of text; the %d valid sample queries"
+        " match"
+        , iRecordCount, lFileSize, iQueryCount);
+    for (i = 0; i < iQueryCount; i++)
+        fprintf(stderr, " %d", iCountM[i]);
+    fprintf(stderr, " of them\n");
+    for (i = 0; i < iQueryCount; i++)
+        freeQuery(queryM[i]);
+    freeIndex(index);
+    freeCustomerSet(customerSet);
+}
+
+// ThreadJob typedef is the work shared by the threads of convertThreadsN.
+// A thread takes the next chunk of CHUNK_QUERIES queries and formats
+// them into the chunk's own output buffer.
+typedef struct
+{
+    QuerySet *pSet;
+    pthread_mutex_t lock;
+    int iNextChunk;             // next chunk not yet taken
+    int iChunkCount;
+    OutputBuffer *outputM;      // formatted results of each chunk
+} ThreadJob;
+
+/******************** convertThreadChunks **************************************
+void *convertThreadChunks(void *pArg)
+Purpose:
+    Thread routine that converts and formats chunks of queries until
+    none is left.
+Parameters:
+    I/O void *pArg              the ThreadJob
+Returns:
+    NULL
+**************************************************************************/
+static void *convertThreadChunks(void *pArg)
+{
+    ThreadJob *pJob = (ThreadJob *) pArg;
+    QuerySet *pSet = pJob->pSet;
+    Out out = newOut();
+    OutputBuffer output;
+    int iChunk;
+    int i;
+
+    while (TRUE)
+    {
+        pthread_mutex_lock(&pJob->lock);
+        iChunk = pJob->iNextChunk++;
+        pthread_mutex_unlock(&pJob->lock);
+        if (iChunk >= pJob->iChunkCount)
+            break;
+        output = pJob->outputM[iChunk];
+        for (i = iChunk * CHUNK_QUERIES; i < (iChunk + 1) * CHUNK_QUERIES
+            && i < pSet->iQueryCount; i++)
+        {
+            resetOut(out);
+            outputString(output, "Query # ");
+            outputInt(output, i + 1);
+            outputString(output, ": ");
+            outputString(output, pSet->pszQueryM[i]);
+            outputText(output, "\n", 1);
+            if (convertToPostFix(pSet->pszQueryM[i], out) == 0)
+                formatOut(output, out, FORMAT_TEXT);
+        }
+    }
+    freeOut(out);
+    return NULL;
+}
+
+/******************** benchIngest **************************************
+void benchIngest(QuerySet *pSet, int iMegabytes, int iRepeat, Out out)
+Purpose:
+    Times reading a large query file with a LineReader, and reading and
+    converting it, and prints their rows of the table.
+Parameters:
+    I   QuerySet *pSet              queries written to the file
+    I   int iMegabytes              least size of the file
+    I   int iRepeat                 times each benchmark is run; the
+                                    fastest is reported
+    I/O Out out                     work area for the conversion
+Returns:
+    n/a
+Notes:
+    - The file is streamed in INPUT_BLOCK_SIZE blocks rather than mapped,
+      as the driver reads stdin, so it works the same on a pipe.
+    - Exits with ERR_ALGORITHM if a different number of lines is read
+      than was written.
+**************************************************************************/
+static void benchIngest(QuerySet *pSet, int iMegabytes, int iRepeat, Out out)
+{
+    FILE *pFile = tmpfile();
+    OutputBuffer output;
+    LineReader reader;
+    struct timespec start;
+    double dNs;
+    double dBestNs;
+    double dGigabytes;
+    long lFileSize = 0;
+    long lQueryCount = 0;       // lines written
+    long lLines;
+    long lCount;
+    char *pszLine;
+    int iLineLength;
+    int bNewline;
+    int bConvert;
+    int iRun;
+    int i;
+
+    if (pFile == NULL)
+        ErrExit(ERR_INPUT, "Unable to create a temporary query file");
+    output = newOutputBuffer(pFile);
+    while (lFileSize < (long) iMegabytes * 1024 * 1024)
+    {
+        for (i = 0; i < pSet->iQueryCount; i++)
+        {
+            outputString(output, pSet->pszQueryM[i]);
+            outputText(output, "\n", 1);
+            lFileSize += strlen(pSet->pszQueryM[i]) + 1;
+        }
+        lQueryCount += pSet->iQueryCount;
+    }
+    flushOutput(output);
+    freeOutputBuffer(output);
+    dGigabytes = lFileSize / 1e9;
+
+    for (bConvert = FALSE; bConvert <= TRUE; bConvert++)
+    {
+        dBestNs = 0;
+        for (iRun = 0; iRun < iRepeat; iRun++)
+        {
+            rewind(pFile);
+            lLines = lCount = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            reader = newLineReader(pFile);
+            while ((pszLine = readLine(reader, &iLineLength, &bNewline)) != NULL)
+            {
+                if (bConvert)
+                {
+                    resetOut(out);
+                    lCount += convertToPostFix(pszLine, out) + out->iOutCount;
+                }
+                else
+                    lCount += iLineLength;
+                lLines++;
+            }
+            freeLineReader(reader);
+            dNs = elapsedNs(&start);
+            lSink += lCount;
+            if (lLines != lQueryCount)
+                ErrExit(ERR_ALGORITHM, "Read %ld lines of a query file of %ld"
+                    , lLines, lQueryCount);
+            if (iRun == 0 || dNs < dBestNs)
+                dBestNs = dNs;
+        }
+        printf("%s\t%.1f\t%.0f\n", bConvert ? "ingestFile" : "readLines"
+            , dBestNs / lQueryCount, dBestNs > 0 ? lQueryCount / (dBestNs / 1e9) : 0.0);
+        fprintf(stderr, "Query file: %ld queries in %.2f GB, %s at %.3f GB/s\n"
+            , lQueryCount, dGigabytes, bConvert ? "read and converted" : "read"
+            , dBestNs > 0 ? dGigabytes / (dBestNs / 1e9) : 0.0);
+    }
+    fclose(pFile);
+}
+
+/******************** runDriver **************************************
+double runDriver(char *pszDriver, char *pszOption, char *pszValue, int iInput)
+Purpose:
+    Runs the driver on a query file, its output discarded, and returns
+    the time it took.
+Parameters:
+    I   char *pszDriver             path of the driver
+    I   char *pszOption             option given to it (NULL for none)
+    I   char *pszValue              value of the option
+    I   int iInput                  descriptor of the query file
+Returns:
+    Nanoseconds from starting the driver until it exited.
+Notes:
+    - Exits with ERR_ALGORITHM if the driver does not exit with 0.
+**************************************************************************/
+static double runDriver(char *pszDriver, char *pszOption, char *pszValue, int iInput)
+{
+    struct timespec start;
+    double dNs;
+    int iNull;
+    int iStatus;
+    pid_t pid;
+
+    lseek(iInput, 0, SEEK_SET);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid = fork();
+    if (pid < 0)
+        ErrExit(ERR_INPUT, "Unable to start %s", pszDriver);
+    if (pid == 0)
+    {
+        iNull = open("/dev/null", O_WRONLY);
+        dup2(iInput, 0);
+        dup2(iNull, 1);
+        dup2(iNull, 2);
+        if (pszOption != NULL)
+            execl(pszDriver, pszDriver, pszOption, pszValue, (char *) NULL);
+        else
+            execl(pszDriver, pszDriver, (char *) NULL);
+        _exit(127);
+    }
+    waitpid(pid, &iStatus, 0);
+    dNs = elapsedNs(&start);
+    if (!WIFEXITED(iStatus) || WEXITSTATUS(iStatus) != 0)
+        ErrExit(ERR_ALGORITHM, "%s failed on the query file", pszDriver);
+    return dNs;
+}
+
+/******************** benchStats **************************************
+void benchStats(QuerySet *pSet, char *pszDriver, char *pszStatsDriver
+    , int iRepeat)
+Purpose:
+    Times the driver converting a query file without and with the
+    statistics of cs2123p1Stats.c, and prints their rows of the table.
+Parameters:
+    I   QuerySet *pSet              queries written to the file
+    I   char *pszDriver             driver compiled without CS2123P1_STATS
+    I   char *pszStatsDriver        driver compiled with -DCS2123P1_STATS
+    I   int iRepeat                 times each driver is run; the fastest
+                                    run is reported
+Returns:
+    n/a
+Notes:
+    - The statistics are compiled in, so they are timed in a separate
+      driver.  It is run with -S text, so they are also dumped.
+    - The file holds the queries again and again, STATS_BENCH_QUERIES
+      at least, so starting the driver is a small part of its time.
+      The two drivers are run in turn, so a change in the machine's load
+      affects both.
+**************************************************************************/
+static void benchStats(QuerySet *pSet, char *pszDriver, char *pszStatsDriver
+    , int iRepeat)
+{
+    FILE *pFile = tmpfile();
+    OutputBuffer output;
+    double dNs;
+    double dPlainNs = 0;
+    double dStatsNs = 0;
+    long lQueryCount = 0;
+    int iRun;
+    int i;
+
+    if (pFile == NULL)
+        ErrExit(ERR_INPUT, "Unable to create a temporary query file");
+    output = newOutputBuffer(pFile);
+    while (lQueryCount < STATS_BENCH_QUERIES)
+    {
+        for (i = 0; i < pSet->iQueryCount; i++)
+        {
+            outputString(output, pSet->pszQueryM[i]);
+            outputText(output, "\n", 1);
+        }
+        lQueryCount += pSet->iQueryCount;
+    }
+    flushOutput(output);
+    freeOutputBuffer(output);
+    fflush(pFile);
+
+    for (iRun = 0; iRun < iRepeat; iRun++)
+    {
+        dNs = runDriver(pszDriver, NULL, NULL, fileno(pFile));
+        if (iRun == 0 || dNs < dPlainNs)
+            dPlainNs = dNs;
+        dNs = runDriver(pszStatsDriver, "-S", "text", fileno(pFile));
+        if (iRun == 0 || dNs < dStatsNs)
+            dStatsNs = dNs;
+    }
+    printf("%s\t%.1f\t%.0f\n", "driverPlain", dPlainNs / lQueryCount
+        , dPlainNs > 0 ? lQueryCount / (dPlainNs / 1e9) : 0.0);
+    printf("%s\t%.1f\t%.0f\n", "driverStats", dStatsNs / lQueryCount
+        , dStatsNs > 0 ? lQueryCount / (dStatsNs / 1e9) : 0.0);
+    fprintf(stderr, "Statistics: %ld queries, %+.1f%% time with -S text\n"
+        , lQueryCount, dPlainNs > 0 ? 100.0 * (dStatsNs - dPlainNs) / dPlainNs : 0.0);
+    fclose(pFile);
+}
+
+/******************** benchThreads **************************************
+void benchThreads(QuerySet *pSet, int iMaxThreads, int iRepeat)
+Purpose:
+    Times converting the queries on 1, 2, 4, ... up to iMaxThreads
+    threads, and prints their rows of the table.
+Parameters:
+    I   QuerySet *pSet              queries
+    I   int iMaxThreads             most threads
+    I   int iRepeat                 times each thread count is run; the
+                                    fastest is reported
+Returns:
+    n/a
+Notes:
+    - The driver's convertParallel is part of the driver program, so
+      this does the same work the same way: chunks of CHUNK_QUERIES
+      queries taken by the next free thread, each formatted into its own
+      buffer, and the buffers joined in query order.
+    - Exits with ERR_ALGORITHM if the output differs from that of one
+      thread.
+**************************************************************************/
+static void benchThreads(QuerySet *pSet, int iMaxThreads, int iRepeat)
+{
+    ThreadJob job;
+    pthread_t *threadM = malloc(iMaxThreads * sizeof(pthread_t));
+    OutputBuffer output = newOutputBuffer(NULL);
+    char *pszFirst = NULL;      // output of one thread
+    int iFirstLength = 0;
+    struct timespec start;
+    double dNs;
+    double dBestNs;
+    double dOneThreadNs = 0;
+    int iThreads;
+    int iRun;
+    int i;
+    char szName[40];
+
+    job.pSet = pSet;
+    job.iChunkCount = (pSet->iQueryCount + CHUNK_QUERIES - 1) / CHUNK_QUERIES;
+    job.outputM = malloc(job.iChunkCount * sizeof(OutputBuffer));
+    if (threadM == NULL || job.outputM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d threads", iMaxThreads);
+    for (i = 0; i < job.iChunkCount; i++)
+        job.outputM[i] = newOutputBuffer(NULL);
+    pthread_mutex_init(&job.lock, NULL);
+
+    for (iThreads = 1; iThreads <= iMaxThreads; iThreads = iThreads * 2 > iMaxThreads
+        && iThreads < iMaxThreads ? iMaxThreads : iThreads * 2)
+    {
+        dBestNs = 0;
+        for (iRun = 0; iRun < iRepeat; iRun++)
+        {
+            output->iLength = 0;
+            job.iNextChunk = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (i = 0; i < iThreads; i++)
+            {
+                if (pthread_create(&threadM[i], NULL, convertThreadChunks, &job) != 0)
+                    ErrExit(ERR_INPUT, "Unable to create thread %d", i + 1);
+            }
+            for (i = 0; i < iThreads; i++)
+                pthread_join(threadM[i], NULL);
+            for (i = 0; i < job.iChunkCount; i++)
+            {
+                outputText(output, job.outputM[i]->pszBuffer, job.outputM[i]->iLength);
+                job.outputM[i]->iLength = 0;
+            }
+            dNs = elapsedNs(&start);
+            if (iRun == 0 || dNs < dBestNs)
+                dBestNs = dNs;
+        }
+        if (iThreads == 1)
+        {
+            dOneThreadNs = dBestNs;
+            iFirstLength = output->iLength;
+            pszFirst = malloc(iFirstLength + 1);
+            if (pszFirst == NULL)
+                ErrExit(ERR_INPUT, "Unable to allocate %d bytes of output", iFirstLength);
+            memcpy(pszFirst, output->pszBuffer, iFirstLength);
+        }
+        else if (output->iLength != iFirstLength
+            || memcmp(output->pszBuffer, pszFirst, iFirstLength) != 0)
+            ErrExit(ERR_ALGORITHM, "Output of %d threads differs from one thread", iThreads);
+        sprintf(szName, "convertThreads%d", iThreads);
+        printf("%s\t%.1f\t%.0f\n", szName, dBestNs / pSet->iQueryCount
+            , dBestNs > 0 ? pSet->iTokenCount / (dBestNs / 1e9) : 0.0);
+        fprintf(stderr, "Threads: %d, %.2f times as fast as one\n", iThreads
+            , dBestNs > 0 ? dOneThreadNs / dBestNs : 0.0);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    for (i = 0; i < job.iChunkCount; i++)
+        freeOutputBuffer(job.outputM[i]);
+    free(job.outputM);
+    free(threadM);
+    free(pszFirst);
+    freeOutputBuffer(output);
+}
+
+/******************** writeResults **************************************
+void writeResults(FILE *pFile, int iMode, QuerySet *pSet, OutImp resultM[]
+    , int rcM[])
+Purpose:
+    Writes the converted queries to a file in one way of the -o
+    benchmarks.
+Parameters:
+    I/O FILE *pFile                 file, empty
+    I   int iMode                   0 for printOut, 1 for formatText and
+                                    2 for formatPostfix
+    I   QuerySet *pSet              queries
+    I   OutImp resultM[]            postfix of each query
+    I   int rcM[]                   return code of each conversion
+Returns:
+    n/a
+Notes:
+    - printOut writes to stdout, so the stdout file descriptor is made
+      the file's while it runs.
+**************************************************************************/
+static void writeResults(FILE *pFile, int iMode, QuerySet *pSet, OutImp resultM[]
+    , int rcM[])
+{
+    OutputBuffer output;
+    int iSavedFd;
+    int i;
+
+    if (iMode == 0)
+    {
+        fflush(stdout);
+        iSavedFd = dup(STDOUT_FILENO);
+        if (iSavedFd < 0 || dup2(fileno(pFile), STDOUT_FILENO) < 0)
+            ErrExit(ERR_INPUT, "Unable to redirect stdout to the output file");
+        for (i = 0; i < pSet->iQueryCount; i++)
+        {
+            printf("Query # %d: %s\n", i + 1, pSet->pszQueryM[i]);
+            if (rcM[i] == 0)
+                printOut(&resultM[i]);
+            else
+                printf("\t warning = %d\n", rcM[i]);
+        }
+        fflush(stdout);
+        dup2(iSavedFd, STDOUT_FILENO);
+        close(iSavedFd);
+        return;
+    }
+    output = newOutputBuffer(pFile);
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (iMode == 2)
+        {
+            outputInt(output, i + 1);
+            outputText(output, "\t", 1);
+            outputInt(output, rcM[i]);
+            outputText(output, "\t", 1);
+            if (rcM[i] == 0)
+                formatOut(output, &resultM[i], FORMAT_POSTFIX);
+            outputText(output, "\n", 1);
+            continue;
+        }
+        outputString(output, "Query # ");
+        outputInt(output, i + 1);
+        outputString(output, ": ");
+        outputString(output, pSet->pszQueryM[i]);
+        outputText(output, "\n", 1);
+        if (rcM[i] == 0)
+            formatOut(output, &resultM[i], FORMAT_TEXT);
+        else
+        {
+            outputString(output, "\t warning = ");
+            outputInt(output, rcM[i]);
+            outputText(output, "\n", 1);
+        }
+    }
+    flushOutput(output);
+    freeOutputBuffer(output);
+}
+
+/******************** readWholeFile **************************************
+char *readWholeFile(FILE *pFile, long *plSize)
+Purpose:
+    Reads a file from its start into a dynamically allocated buffer.
+**************************************************************************/
+static char *readWholeFile(FILE *pFile, long *plSize)
+{
+    char *pszText;
+
+    fseek(pFile, 0, SEEK_END);
+    *plSize = ftell(pFile);
+    pszText = malloc(*plSize + 1);
+    if (pszText == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %ld bytes of output", *plSize);
+    rewind(pFile);
+    if (fread(pszText, 1, *plSize, pFile) != (size_t) *plSize)
+        ErrExit(ERR_INPUT, "Unable to read back the output file");
+    return pszText;
+}
+
+/******************** benchOutput **************************************
+void benchOutput(QuerySet *pSet, int iRepeat, Out out)
+Purpose:
+    Times writing the converted queries to a file with printOut, and with
+    formatOut in the text and postfix formats, and prints their rows of
+    the table.
+Parameters:
+    I   QuerySet *pSet              queries
+    I   int iRepeat                 times each is run; the fastest is
+                                    reported
+    I/O Out out                     work area for the conversion
+Returns:
+    n/a
+Notes:
+    - The queries are converted once beforehand, so only the output is
+      timed.  Each run empties the file first and ends with the data
+      handed to the system.
+    - Exits with ERR_ALGORITHM if formatText does not write exactly the
+      bytes printOut writes.
+**************************************************************************/
+static void benchOutput(QuerySet *pSet, int iRepeat, Out out)
+{
+    static char *pszNameM[] = {"printOut", "formatText", "formatPostfix"};
+    char szFileName[] = "/tmp/cs2123p1BenchXXXXXX";
+    OutImp *resultM = malloc(pSet->iQueryCount * sizeof(OutImp));
+    int *rcM = malloc(pSet->iQueryCount * sizeof(int));
+    Arena arena = newArena(ARENA_BLOCK_SIZE);
+    FILE *pFile;
+    char *pszPrintOut = NULL;   // what printOut wrote
+    char *pszText;
+    long lPrintOutSize = 0;
+    long lSize;
+    struct timespec start;
+    double dNs;
+    double dBestNs;
+    int iFd;
+    int iMode;
+    int iRun;
+    int i;
+
+    if (resultM == NULL || rcM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d results", pSet->iQueryCount);
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        resetOut(out);
+        rcM[i] = convertToPostFix(pSet->pszQueryM[i], out);
+        resultM[i].iOutCount = resultM[i].iOutMax = out->iOutCount;
+        resultM[i].outM = arenaAlloc(arena, out->iOutCount * sizeof(Element));
+        resultM[i].arena = NULL;
+        memcpy(resultM[i].outM, out->outM, out->iOutCount * sizeof(Element));
+    }
+    iFd = mkstemp(szFileName);
+    if (iFd < 0 || (pFile = fdopen(iFd, "w+")) == NULL)
+        ErrExit(ERR_INPUT, "Unable to create a temporary output file");
+
+    for (iMode = 0; iMode < 3; iMode++)
+    {
+        dBestNs = 0;
+        for (iRun = 0; iRun < iRepeat; iRun++)
+        {
+            fflush(pFile);
+            if (ftruncate(iFd, 0) != 0)
+                ErrExit(ERR_INPUT, "Unable to empty the output file");
+            rewind(pFile);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            writeResults(pFile, iMode, pSet, resultM, rcM);
+            dNs = elapsedNs(&start);
+            if (iRun == 0 || dNs < dBestNs)
+                dBestNs = dNs;
+        }
+        pszText = readWholeFile(pFile, &lSize);
+        if (iMode == 0)
+        {
+            pszPrintOut = pszText;
+            lPrintOutSize = lSize;
+        }
+        else
+        {
+            if (iMode == 1 && (lSize != lPrintOutSize
+                || memcmp(pszText, pszPrintOut, lSize) != 0))
+                ErrExit(ERR_ALGORITHM, "formatText output differs from printOut");
+            free(pszText);
+        }
+        printf("%s\t%.1f\t%.0f\n", pszNameM[iMode], dBestNs / pSet->iQueryCount
+            , dBestNs > 0 ? pSet->iTokenCount / (dBestNs / 1e9) : 0.0);
+        fprintf(stderr, "Output %s: %ld bytes, %.1f MB per second\n", pszNameM[iMode]
+            , lSize, dBestNs > 0 ? lSize / (dBestNs / 1e9) / 1e6 : 0.0);
+    }
+
+    fclose(pFile);
+    unlink(szFileName);
+    free(pszPrintOut);
+    free(resultM);
+    free(rcM);
+    freeArena(arena);
+}
+
+// The conversion of the first version (commit 7f49223), kept to time the
+// current one against.  Only the names are changed, so they do not
+// clash with the current functions.
+
+// LegacyElement typedef is the first version's Element, which carried
+// its token text
+typedef struct
+{
+    Token szToken;
+    int iCategory;
+    int iPrecedence;
+} LegacyElement;
+
+// LegacyStackImp typedef is the first version's fixed size array stack
+typedef struct
+{
+    int iCount;
+    LegacyElement stackElementM[LEGACY_STACK_ELEM];
+} LegacyStackImp;
+
+typedef LegacyStackImp *LegacyStack;
+
+// LegacyOutImp typedef is the first version's fixed size out
+typedef struct
+{
+    int iOutCount;
+    LegacyElement outM[LEGACY_OUT_ITEM];
+} LegacyOutImp;
+
+typedef LegacyOutImp *LegacyOut;
+
+// the first version's symbol definitions, searched by legacyCategorize
+static struct
+{
+    char szSymbol[MAX_TOKEN + 1];
+    int iCategory;
+    int iPrecedence;
+} legacySymbolDefM[] =
+{
+    {"(",        CAT_LPAREN,   0}
+    , {")",      CAT_RPAREN,   0}
+    , {"=",      CAT_OPERATOR, 2}
+    , {"NOTANY", CAT_OPERATOR, 2}
+    , {"ONLY",   CAT_OPERATOR, 2}
+    , {"AND",    CAT_OPERATOR, 1}
+    , {"OR",     CAT_OPERATOR, 1}
+    , {"", 0, 0}                // null terminating
+};
+
+static void legacyPush(LegacyStack stack, LegacyElement value)
+{
+    if (stack->iCount >= LEGACY_STACK_ELEM)
+        ErrExit(ERR_STACK_USAGE
+        , "Attempt to PUSH more than %d values on the array stack"
+        , LEGACY_STACK_ELEM);
+    stack->stackElementM[stack->iCount] = value;
+    stack->iCount++;
+}
+
+static int legacyIsEmpty(LegacyStack stack)
+{
+    return stack->iCount <= 0;
+}
+
+static LegacyElement legacyPop(LegacyStack stack)
+{
+    if (legacyIsEmpty(stack))
+        ErrExit(ERR_STACK_USAGE
+        , "Attempt to POP an empty array stack");
+    stack->iCount--;
+    return stack->stackElementM[stack->iCount];
+}
+
+static LegacyElement legacyTopElement(LegacyStack stack)
+{
+    if (legacyIsEmpty(stack))
+        ErrExit(ERR_STACK_USAGE
+        , "Attempt to examine topElement of an empty array stack");
+    return stack->stackElementM[stack->iCount - 1];
+}
+
+static LegacyStack legacyNewStack()
+{
+    LegacyStack stack = (LegacyStack) malloc(sizeof(LegacyStackImp));
+    stack->iCount = 0;
+    return stack;
+}
+
+static void legacyAddOut(LegacyOut out, LegacyElement element)
+{
+    if (out->iOutCount >= LEGACY_OUT_ITEM)
+        ErrExit(ERR_OUT_OVERFLOW
+        , "Overflow in the out array");
+    out->outM[out->iOutCount++] = element;
+}
+
+static void legacyCategorize(LegacyElement *pElement)
+{
+    int i;
+    for (i = 0; legacySymbolDefM[i].szSymbol[0] != '\0'; i++)
+    {
+        if (strcmp(pElement->szToken, legacySymbolDefM[i].szSymbol) == 0)
+        {
+            pElement->iPrecedence = legacySymbolDefM[i].iPrecedence;
+            pElement->iCategory = legacySymbolDefM[i].iCategory;
+            return;
+        }
+    }
+    pElement->iPrecedence = 0;
+    pElement->iCategory = CAT_OPERAND;
+}
+
+static char *legacyGetToken(char *pszInputTxt, char szToken[], int iTokenSize)
+{
+    int iDelimPos;
+    int iCopy;
+    char szDelims[20] = " \n\r";
+
+    szToken[0] = '\0';
+    if (pszInputTxt == NULL)
+        ErrExit(ERR_ALGORITHM
+        , "getToken passed a NULL pointer");
+    if (*pszInputTxt == '\0')
+        return NULL;
+    iDelimPos = strcspn(pszInputTxt, szDelims);
+    if (iDelimPos == 0)
+        return NULL;
+    if (iDelimPos > iTokenSize)
+        iCopy = iTokenSize;
+    else
+        iCopy = iDelimPos;
+    memcpy(szToken, pszInputTxt, iCopy);
+    szToken[iCopy] = '\0';
+    pszInputTxt += iDelimPos;
+    if (*pszInputTxt == '\0')
+        return pszInputTxt;
+    else
+        return pszInputTxt + 1;
+}
+
+static int legacyProcessRemString(LegacyStack stack, LegacyOut out)
+{
+    LegacyElement popElement;
+
+    while (!legacyIsEmpty(stack))
+    {
+        popElement = legacyPop(stack);
+        if (popElement.iCategory == CAT_LPAREN)
+            return FALSE;
+        legacyAddOut(out, popElement);
+    }
+    return TRUE;
+}
+
+static int legacyProcessRightParen(LegacyStack stack, LegacyOut out)
+{
+    LegacyElement popElement;
+
+    while (!legacyIsEmpty(stack))
+    {
+        popElement = legacyPop(stack);
+        if (popElement.iCategory == CAT_LPAREN)
+            return TRUE;
+        legacyAddOut(out, popElement);
+    }
+    return FALSE;
+}
+
+static void legacyProcessOperator(LegacyStack stack, LegacyElement newValue, LegacyOut out)
+{
+    LegacyElement popElement;
+    LegacyElement topStackElement;
+
+    while (!legacyIsEmpty(stack))
+    {
+        topStackElement = legacyTopElement(stack);
+        if (newValue.iPrecedence > topStackElement.iPrecedence)
+            break;
+        popElement = legacyPop(stack);
+        legacyAddOut(out, popElement);
+    }
+    legacyPush(stack, newValue);
+}
+
+static int legacyConvertToPostFix(char *pszInfix, LegacyOut out)
+{
+    LegacyStack stack = legacyNewStack();
+    char *pszRemainingText;
+    LegacyElement element;
+    int bValid = FALSE;
+
+    pszRemainingText = legacyGetToken(pszInfix, element.szToken, sizeof(element.szToken) - 1);
+    while (pszRemainingText != NULL)
+    {
+        legacyCategorize(&element);
+        if (element.iCategory == CAT_OPERAND)
+            legacyAddOut(out, element);
+        else if (element.iCategory == CAT_LPAREN)
+            legacyPush(stack, element);
+        else if (element.iCategory == CAT_OPERATOR)
+            legacyProcessOperator(stack, element, out);
+        else if (element.iCategory == CAT_RPAREN)
+        {
+            bValid = legacyProcessRightParen(stack, out);
+            if (bValid == FALSE)
+            {
+                free(stack);
+                return WARN_MISSING_LPAREN;
+            }
+        }
+        if (pszRemainingText != NULL)
+            pszRemainingText = legacyGetToken(pszRemainingText, element.szToken
+                , sizeof(element.szToken) - 1);
+    }
+    bValid = legacyProcessRemString(stack, out);
+    free(stack);
+    if (!bValid)
+        return WARN_MISSING_RPAREN;
+    return 0;
+}
+
+/******************** fitsLegacy **************************************
+int fitsLegacy(QuerySet *pSet, int iQuery)
+Purpose:
+    Determines whether the first version could convert a query without
+    overflowing its stack or out arrays.
+Parameters:
+    I   QuerySet *pSet              queries and their elements
+    I   int iQuery                  query subscript
+Returns:
+    TRUE if the query fits.
+Notes:
+    - Follows the conversion on the categorized elements, keeping only
+      the precedences on the stack and the count of out.
+**************************************************************************/
+static int fitsLegacy(QuerySet *pSet, int iQuery)
+{
+    int iPrecedenceM[LEGACY_STACK_ELEM];
+    int iTop = 0;
+    int iOutCount = 0;
+    Element *pElement;
+    int i;
+
+    for (i = pSet->iFirstElementM[iQuery]; i < pSet->iFirstElementM[iQuery + 1]; i++)
+    {
+        pElement = &pSet->elementM[i];
+        switch (pElement->iCategory)
+        {
+            case CAT_OPERAND:
+                iOutCount++;
+                break;
+            case CAT_LPAREN:
+                if (iTop == LEGACY_STACK_ELEM)
+                    return FALSE;
+                iPrecedenceM[iTop++] = -1;
+                break;
+            case CAT_RPAREN:
+                while (iTop > 0 && iPrecedenceM[iTop - 1] >= 0)
+                {
+                    iTop--;
+                    iOutCount++;
+                }
+                if (iTop == 0)
+                    return iOutCount <= LEGACY_OUT_ITEM;   // it stops here
+                iTop--;
+                break;
+            default:
+                // a ( has precedence 0, so it is popped by no operator
+                while (iTop > 0 && iPrecedenceM[iTop - 1] >= pElement->iPrecedence)
+                {
+                    iTop--;
+                    iOutCount++;
+                }
+                if (iTop == LEGACY_STACK_ELEM)
+                    return FALSE;
+                iPrecedenceM[iTop++] = pElement->iPrecedence;
+        }
+        if (iOutCount > LEGACY_OUT_ITEM)
+            return FALSE;
+    }
+    while (iTop > 0 && iPrecedenceM[iTop - 1] >= 0)
+    {
+        iTop--;
+        iOutCount++;
+    }
+    return iOutCount <= LEGACY_OUT_ITEM;
+}
+
+/******************** benchLegacy **************************************
+void benchLegacy(QuerySet *pSet, int iRepeat, Out out)
+Purpose:
+    Times the conversion of the first version and the current
+    convertToPostFix on the queries that fit the first version's arrays,
+    and prints their rows of the table.
+Parameters:
+    I   QuerySet *pSet              queries
+    I   int iRepeat                 times each is run; the fastest is
+                                    reported
+    I/O Out out                     work area for the conversion
+Returns:
+    n/a
+Notes:
+    - Exits with ERR_ALGORITHM if the two give a different return code
+      or postfix for a query.
+**************************************************************************/
+static void benchLegacy(QuerySet *pSet, int iRepeat, Out out)
+{
+    LegacyOut legacyOut = malloc(sizeof(LegacyOutImp));
+    int *iQueryM = malloc(pSet->iQueryCount * sizeof(int));
+    int iQueryCount = 0;        // queries that fit
+    int iTokenCount = 0;        // their tokens
+    long lCount;
+    struct timespec start;
+    double dNs;
+    double dBestNs;
+    int bLegacy;
+    int iRun;
+    int rc;
+    int i;
+    int j;
+
+    if (legacyOut == NULL || iQueryM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d queries", pSet->iQueryCount);
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (!fitsLegacy(pSet, i))
+            continue;
+        iQueryM[iQueryCount++] = i;
+        iTokenCount += pSet->iFirstElementM[i + 1] - pSet->iFirstElementM[i];
+        resetOut(out);
+        legacyOut->iOutCount = 0;
+        rc = convertToPostFix(pSet->pszQueryM[i], out);
+        if (legacyConvertToPostFix(pSet->pszQueryM[i], legacyOut) != rc
+            || (rc == 0 && legacyOut->iOutCount != out->iOutCount))
+            ErrExit(ERR_ALGORITHM, "The first version converts query %d differently", i + 1);
+        for (j = 0; rc == 0 && j < out->iOutCount; j++)
+        {
+            if (strcmp(legacyOut->outM[j].szToken, getSymbolText(out->outM[j].iSymbol)) != 0)
+                ErrExit(ERR_ALGORITHM, "The first version converts query %d differently"
+                    , i + 1);
+        }
+    }
+
+    for (bLegacy = TRUE; bLegacy >= FALSE && iQueryCount > 0; bLegacy--)
+    {
+        dBestNs = 0;
+        for (iRun = 0; iRun < iRepeat; iRun++)
+        {
+            lCount = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (i = 0; i < iQueryCount; i++)
+            {
+                if (bLegacy)
+                {
+                    legacyOut->iOutCount = 0;
+                    lCount += legacyConvertToPostFix(pSet->pszQueryM[iQueryM[i]], legacyOut)
+                        + legacyOut->iOutCount;
+                }
+                else
+                {
+                    resetOut(out);
+                    lCount += convertToPostFix(pSet->pszQueryM[iQueryM[i]], out)
+                        + out->iOutCount;
+                }
+            }
+            dNs = elapsedNs(&start);
+            lSink += lCount;
+            if (iRun == 0 || dNs < dBestNs)
+                dBestNs = dNs;
+        }
+        printf("%s\t%.1f\t%.0f\n", bLegacy ? "convertLegacy" : "convertCurrent"
+            , dBestNs / iQueryCount, dBestNs > 0 ? iTokenCount / (dBestNs / 1e9) : 0.0);
+    }
+    fprintf(stderr, "Legacy conversion: %d of %d queries fit its %d element stack and"
+        " %d element out; an Element was %d bytes and is %d\n", iQueryCount
+        , pSet->iQueryCount, LEGACY_STACK_ELEM, LEGACY_OUT_ITEM
+        , (int) sizeof(LegacyElement), (int) sizeof(Element));
+    free(legacyOut);
+    free(iQueryM);
+}
+
+/******************** benchClassify **************************************
+void benchClassify(QuerySet *pSet, int iRepeat)
+Purpose:
+    Times classifying the tokens of every query with the first version's
+    strcmp scan and with internSymbol and categorize, and prints their
+    rows of the table.
+Parameters:
+    I   QuerySet *pSet              queries
+    I   int iRepeat                 times each is run; the fastest is
+                                    reported
+Returns:
+    n/a
+Notes:
+    - The tokens are found with getTokenView before the timing, so the
+      rows time only the classification.
+    - classifyNew names each operand with its run and token number, so
+      no run finds an operand an earlier run added.  The new names are
+      made before the timing.
+    - Exits with ERR_ALGORITHM if the strcmp scan and internSymbol give a
+      token different categories.
+**************************************************************************/
+static void benchClassify(QuerySet *pSet, int iRepeat)
+{
+    char **pszTokenM = malloc(pSet->iTokenCount * sizeof(char *));
+    int *iLengthM = malloc(pSet->iTokenCount * sizeof(int));
+    char **pszNewM = malloc(pSet->iTokenCount * sizeof(char *));
+    int *iNewLengthM = malloc(pSet->iTokenCount * sizeof(int));
+    char *pszNewText = NULL;
+    LegacyElement legacyElement;
+    Element element;
+    char *pszRemainingText;
+    int iOperandCount = 0;
+    struct timespec start;
+    double dNs;
+    double dBestNs;
+    long lCount;
+    int iMethod;                // 0 strcmp scan, 1 seen tokens, 2 new operands
+    int iRun;
+    int iLength;
+    int iToken = 0;
+    int i;
+
+    if (pszTokenM == NULL || iLengthM == NULL || pszNewM == NULL || iNewLengthM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d tokens", pSet->iTokenCount);
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        pszRemainingText = getTokenView(pSet->pszQueryM[i], &pszTokenM[iToken]
+            , &iLengthM[iToken]);
+        while (pszRemainingText != NULL)
+        {
+            iToken++;
+            pszRemainingText = getTokenView(pszRemainingText, &pszTokenM[iToken]
+                , &iLengthM[iToken]);
+        }
+    }
+    for (i = 0; i < pSet->iTokenCount; i++)
+    {
+        iLength = iLengthM[i] < MAX_TOKEN ? iLengthM[i] : MAX_TOKEN;
+        memcpy(legacyElement.szToken, pszTokenM[i], iLength);
+        legacyElement.szToken[iLength] = '\0';
+        legacyCategorize(&legacyElement);
+        element.iSymbol = internSymbol(pszTokenM[i], iLengthM[i]);
+        categorize(&element);
+        if (legacyElement.iCategory != element.iCategory
+            || legacyElement.iPrecedence != element.iPrecedence)
+            ErrExit(ERR_ALGORITHM, "Token %s is classified differently"
+                , legacyElement.szToken);
+        if (element.iCategory == CAT_OPERAND)
+            iOperandCount++;
+    }
+
+    for (iMethod = 0; iMethod < 3; iMethod++)
+    {
+        dBestNs = 0;
+        for (iRun = 0; iRun < iRepeat; iRun++)
+        {
+            if (iMethod == 2)
+            {
+                // name every operand "<token>#<run>.<number>"
+                free(pszNewText);
+                pszNewText = malloc((size_t) pSet->iTokenCount * (MAX_TOKEN + 24));
+                if (pszNewText == NULL)
+                    ErrExit(ERR_INPUT, "Unable to allocate %d new operands"
+                        , pSet->iTokenCount);
+                for (i = 0; i < pSet->iTokenCount; i++)
+                {
+                    pszNewM[i] = pszTokenM[i];
+                    iNewLengthM[i] = iLengthM[i];
+                    if (pSet->elementM[i].iCategory != CAT_OPERAND)
+                        continue;
+                    pszNewM[i] = pszNewText + (size_t) i * (MAX_TOKEN + 24);
+                    iNewLengthM[i] = sprintf(pszNewM[i], "%.*s#%d.%d"
+                        , iLengthM[i] < MAX_TOKEN ? iLengthM[i] : MAX_TOKEN, pszTokenM[i]
+                        , iRun, i);
+                }
+            }
+            lCount = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (i = 0; i < pSet->iTokenCount; i++)
+            {
+                if (iMethod == 0)
+                {
+                    iLength = iLengthM[i] < MAX_TOKEN ? iLengthM[i] : MAX_TOKEN;
+                    memcpy(legacyElement.szToken, pszTokenM[i], iLength);
+                    legacyElement.szToken[iLength] = '\0';
+                    legacyCategorize(&legacyElement);
+                    lCount += legacyElement.iCategory;
+                    continue;
+                }
+                if (iMethod == 1)
+                    element.iSymbol = internSymbol(pszTokenM[i], iLengthM[i]);
+                else
+                    element.iSymbol = internSymbol(pszNewM[i], iNewLengthM[i]);
+                categorize(&element);
+                lCount += element.iCategory;
+            }
+            dNs = elapsedNs(&start);
+            lSink += lCount;
+            if (iRun == 0 || dNs < dBestNs)
+                dBestNs = dNs;
+        }
+        printf("%s\t%.1f\t%.0f\n", iMethod == 0 ? "classifyStrcmp"
+            : iMethod == 1 ? "classifyIntern" : "classifyNew", dBestNs / pSet->iQueryCount
+            , dBestNs > 0 ? pSet->iTokenCount / (dBestNs / 1e9) : 0.0);
+    }
+    fprintf(stderr, "Classified tokens: %d, %.1f%% of them operands\n", pSet->iTokenCount
+        , pSet->iTokenCount > 0 ? 100.0 * iOperandCount / pSet->iTokenCount : 0.0);
+    free(pszNewText);
+    free(pszTokenM);
+    free(iLengthM);
+    free(pszNewM);
+    free(iNewLengthM);
+}
+
+/******************** benchGetToken **************************************
+void benchGetToken(QuerySet *pSet, Out out)
+Purpose:
+    Splits every query into tokens with getToken.
+**************************************************************************/
+static void benchGetToken(QuerySet *pSet, Out out)
+{
+    Token szToken;
+    char *pszRemainingText;
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        pszRemainingText = getToken(pSet->pszQueryM[i], szToken, MAX_TOKEN);
+        while (pszRemainingText != NULL)
+        {
+            lCount += szToken[0];
+            pszRemainingText = getToken(pszRemainingText, szToken, MAX_TOKEN);
+        }
+    }
+    lSink += lCount;
+}
+
+/******************** benchGetTokenView **************************************
+void benchGetTokenView(QuerySet *pSet, Out out)
+Purpose:
+    Splits every query into tokens with getTokenView.
+**************************************************************************/
+static void benchGetTokenView(QuerySet *pSet, Out out)
+{
+    char *pszRemainingText;
+    char *pszToken;
+    int iTokenLength;
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        pszRemainingText = getTokenView(pSet->pszQueryM[i], &pszToken, &iTokenLength);
+        while (pszRemainingText != NULL)
+        {
+            lCount += iTokenLength;
+            pszRemainingText = getTokenView(pszRemainingText, &pszToken, &iTokenLength);
+        }
+    }
+    lSink += lCount;
+}
+
+/******************** benchCategorize **************************************
+void benchCategorize(QuerySet *pSet, Out out)
+Purpose:
+    Categorizes every token of every query.
+**************************************************************************/
+static void benchCategorize(QuerySet *pSet, Out out)
+{
+    Element element;
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iTokenCount; i++)
+    {
+        element.iSymbol = pSet->elementM[i].iSymbol;
+        categorize(&element);
+        lCount += element.iCategory;
+    }
+    lSink += lCount;
+}
+
+/******************** benchProcessOperator **************************************
+void benchProcessOperator(QuerySet *pSet, Out out)
+Purpose:
+    Runs the conversion stack algorithm on the categorized tokens.
+Notes:
+    - This is the loop of convertToPostFix without getting and
+      categorizing the tokens.
+**************************************************************************/
+static void benchProcessOperator(QuerySet *pSet, Out out)
+{
+    Stack stack;
+    Element *pElement;
+    long lCount = 0;
+    int iQuery;
+    int i;
+
+    for (iQuery = 0; iQuery < pSet->iQueryCount; iQuery++)
+    {
+        resetOut(out);
+        stack = newArenaStack(out->arena);
+        for (i = pSet->iFirstElementM[iQuery]; i < pSet->iFirstElementM[iQuery + 1]; i++)
+        {
+            pElement = &pSet->elementM[i];
+            switch (pElement->iCategory)
+            {
+                case CAT_OPERAND:
+                    addOut(out, *pElement);
+                    break;
+                case CAT_LPAREN:
+                    push(stack, *pElement);
+                    break;
+                case CAT_OPERATOR:
+                    processOperator(stack, *pElement, out);
+                    break;
+                default:
+                    processRightParen(stack, out);
+            }
+        }
+        processRemString(stack, out);
+        freeStack(stack);
+        lCount += out->iOutCount;
+    }
+    lSink += lCount;
+}
+
+/******************** benchConvertToPostFix **************************************
+void benchConvertToPostFix(QuerySet *pSet, Out out)
+Purpose:
+    Converts every query from its text.
+**************************************************************************/
+static void benchConvertToPostFix(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    long lBlocks = out->arena->lBlockCount;
+    int i;
+
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        resetOut(out);
+        lCount += convertToPostFix(pSet->pszQueryM[i], out) + out->iOutCount;
+    }
+    pSet->lConvertBlocks += out->arena->lBlockCount - lBlocks;
+    pSet->lConvertCount += pSet->iQueryCount;
+    lSink += lCount;
+}
+
+/******************** benchConvertNewOut **************************************
+void benchConvertNewOut(QuerySet *pSet, Out out)
+Purpose:
+    Converts every query from its text into a new Out.
+**************************************************************************/
+static void benchConvertNewOut(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    Out queryOut;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        queryOut = newOut();
+        lCount += convertToPostFix(pSet->pszQueryM[i], queryOut) + queryOut->iOutCount;
+        pSet->lNewOutBlocks += queryOut->arena->lBlockCount;
+        freeOut(queryOut);
+    }
+    pSet->lNewOutCount += pSet->iQueryCount;
+    lSink += lCount;
+}
+
+/******************** benchConvertCached **************************************
+void benchConvertCached(QuerySet *pSet, Out out)
+Purpose:
+    Converts every query through a query cache that starts empty.
+**************************************************************************/
+static void benchConvertCached(QuerySet *pSet, Out out)
+{
+    QueryCache cache = newQueryCache(pSet->iCacheEntries);
+    long lCount = 0;
+    long lEvictions;
+    int i;
+
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        resetOut(out);
+        lCount += convertCached(cache, pSet->pszQueryM[i], out) + out->iOutCount;
+    }
+    getCacheCounts(cache, &pSet->lCacheHits, &pSet->lCacheMisses, &lEvictions);
+    freeQueryCache(cache);
+    lSink += lCount;
+}
+
+/******************** evaluateStrings **************************************
+int evaluateStrings(QuerySet *pSet, Query query, int iCustomer, int bStackM[])
+Purpose:
+    Determines whether a customer satisfies a compiled query by comparing
+    the value strings of the query with the customer's value strings.
+Parameters:
+    I   QuerySet *pSet              queries and value strings
+    I   Query query                 compiled query
+    I   int iCustomer               subscript of the customer (0 is first)
+    I/O int bStackM[]               evaluation stack of at least
+                                    query->iMaxDepth entries
+Returns:
+    TRUE  - the customer matches
+    FALSE - the customer does not match
+**************************************************************************/
+static int evaluateStrings(QuerySet *pSet, Query query, int iCustomer, int bStackM[])
+{
+    int iTop = 0;
+    int i;
+    int j;
+    int bFound;
+    int iStart;
+    int iEnd;
+    char *pszValue;
+    Instr *pInstr;
+    TraitColumn *pColumn;
+
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        pInstr = &query->instrM[i];
+        switch (pInstr->iOp)
+        {
+            case OP_AND:
+                iTop--;
+                bStackM[iTop - 1] = bStackM[iTop - 1] && bStackM[iTop];
+                break;
+            case OP_OR:
+                iTop--;
+                bStackM[iTop - 1] = bStackM[iTop - 1] || bStackM[iTop];
+                break;
+            case OP_JUMP_FALSE:
+                if (!bStackM[iTop - 1])
+                    i = pInstr->iValue - 1;
+                break;
+            case OP_JUMP_TRUE:
+                if (bStackM[iTop - 1])
+                    i = pInstr->iValue - 1;
+                break;
+            default:
+                // comparison: find the value string among the customer's
+                bFound = FALSE;
+                iStart = iEnd = 0;
+                if (pInstr->iValue >= 0)
+                {
+                    pColumn = &pSet->customerSet->traitM[pInstr->iTrait];
+                    pszValue = pColumn->szValueM[pInstr->iValue];
+                    iStart = pColumn->iOffsetM[iCustomer];
+                    iEnd = pColumn->iOffsetM[iCustomer + 1];
+                    for (j = iStart; j < iEnd && !bFound; j++)
+                        bFound = strcmp(pSet->pszStringM[pInstr->iTrait][j], pszValue) == 0;
+                }
+                if (pInstr->iOp == OP_NOTANY)
+                    bStackM[iTop++] = !bFound;
+                else if (pInstr->iOp == OP_ONLY)
+                    bStackM[iTop++] = bFound && iEnd - iStart == 1;
+                else
+                    bStackM[iTop++] = bFound;
+        }
+    }
+    return bStackM[0];
+}
+
+/******************** benchCountStringMatches **************************************
+void benchCountStringMatches(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query by comparing value
+    strings.
+**************************************************************************/
+static void benchCountStringMatches(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int bStackM[EVAL_LOCAL_STACK];
+    int iCustomer;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->queryM[i] == NULL || pSet->queryM[i]->iMaxDepth > EVAL_LOCAL_STACK)
+            continue;
+        for (iCustomer = 0; iCustomer < pSet->customerSet->iCustomerCount; iCustomer++)
+            lCount += evaluateStrings(pSet, pSet->queryM[i], iCustomer, bStackM);
+    }
+    lSink += lCount;
+}
+
+/******************** benchCountMatchesSwitch **************************************
+void benchCountMatchesSwitch(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query with the switch
+    interpreter.
+**************************************************************************/
+static void benchCountMatchesSwitch(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->queryM[i] != NULL)
+            lCount += countMatchesSwitch(pSet->queryM[i], pSet->customerSet);
+    }
+    lSink += lCount;
+}
+
+/******************** benchCountMatches **************************************
+void benchCountMatches(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query with countMatches.
+**************************************************************************/
+static void benchCountMatches(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->queryM[i] != NULL)
+            lCount += countMatches(pSet->queryM[i], pSet->customerSet);
+    }
+    lSink += lCount;
+}
+
+/******************** benchCountOptimized **************************************
+void benchCountOptimized(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query with countMatches after
+    optimizeQuery.
+**************************************************************************/
+static void benchCountOptimized(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->optimizedQueryM[i] != NULL)
+            lCount += countMatches(pSet->optimizedQueryM[i], pSet->customerSet);
+    }
+    lSink += lCount;
+}
+
+/******************** benchCountSimplified **************************************
+void benchCountSimplified(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query with countMatches after
+    simplifyQuery.  A query simplified to true or false is counted
+    without looking at the customers.
+**************************************************************************/
+static void benchCountSimplified(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->simpleQueryM[i] == NULL)
+            continue;
+        if (pSet->iSimpleResultM[i] != SIMPLE_VARIES)
+            lCount += pSet->iSimpleResultM[i] ? pSet->customerSet->iCustomerCount : 0;
+        else
+            lCount += countMatches(pSet->simpleQueryM[i], pSet->customerSet);
+    }
+    lSink += lCount;
+}
+
+/******************** benchCountColumnScalar **************************************
+void benchCountColumnScalar(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query a block at a time with
+    the scalar kernels.
+**************************************************************************/
+static void benchCountColumnScalar(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    useScalarKernels(TRUE);
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->queryM[i] != NULL)
+            lCount += countColumnMatches(pSet->queryM[i], pSet->customerSet);
+    }
+    useScalarKernels(FALSE);
+    lSink += lCount;
+}
+
+/******************** benchCountColumnMatches **************************************
+void benchCountColumnMatches(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query a block at a time with
+    the kernels the processor supports.
+**************************************************************************/
+static void benchCountColumnMatches(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->queryM[i] != NULL)
+            lCount += countColumnMatches(pSet->queryM[i], pSet->customerSet);
+    }
+    lSink += lCount;
+}
+
+/******************** benchCountIndexMatches **************************************
+void benchCountIndexMatches(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query with the customer index.
+**************************************************************************/
+static void benchCountIndexMatches(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->queryM[i] != NULL)
+            lCount += countIndexMatches(pSet->queryM[i], pSet->customerIndex);
+    }
+    lSink += lCount;
+}
+
+/******************** benchCountDagMatches **************************************
+void benchCountDagMatches(QuerySet *pSet, Out out)
+Purpose:
+    Counts the matching customers of every query a chunk at a time,
+    evaluating the subexpressions the queries of a chunk share once.
+Notes:
+    - Exits with ERR_ALGORITHM if a query's count differs from
+      countIndexMatches.  That is checked on the first run only.
+**************************************************************************/
+static void benchCountDagMatches(QuerySet *pSet, Out out)
+{
+    static int bChecked = FALSE;
+    QueryDag dag = newQueryDag();
+    int *iRootM = malloc(CHUNK_QUERIES * sizeof(int));
+    int *iMatchM = NULL;
+    int iMatchMax = 0;
+    long lCount = 0;
+    int iFirst;
+    int i;
+
+    (void) out;
+    if (iRootM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d query roots", CHUNK_QUERIES);
+    pSet->lDagInstrCount = pSet->lDagNodeCount = 0;
+    pSet->iDagCount = pSet->iDagPerQueryCount = 0;
+    for (iFirst = 0; iFirst < pSet->iQueryCount; iFirst += CHUNK_QUERIES)
+    {
+        resetQueryDag(dag);
+        for (i = iFirst; i < iFirst + CHUNK_QUERIES && i < pSet->iQueryCount; i++)
+            iRootM[i - iFirst] = pSet->queryM[i] == NULL ? -1
+                : addDagQuery(dag, pSet->queryM[i]);
+        if (dag->iNodeCount > iMatchMax)
+        {
+            iMatchMax = dag->iNodeCount;
+            iMatchM = realloc(iMatchM, iMatchMax * sizeof(int));
+            if (iMatchM == NULL)
+                ErrExit(ERR_INPUT, "Unable to allocate %d DAG results", iMatchMax);
+        }
+        countDagMatches(dag, pSet->customerIndex, iMatchM);
+        pSet->lDagInstrCount += dag->lInstrCount;
+        pSet->lDagNodeCount += dag->iNodeCount;
+        pSet->iDagCount++;
+        pSet->iDagPerQueryCount += dag->bPerQuery;
+        for (i = iFirst; i < iFirst + CHUNK_QUERIES && i < pSet->iQueryCount; i++)
+        {
+            if (iRootM[i - iFirst] < 0)
+                continue;
+            lCount += iMatchM[iRootM[i - iFirst]];
+            if (!bChecked && iMatchM[iRootM[i - iFirst]]
+                != countIndexMatches(pSet->queryM[i], pSet->customerIndex))
+                ErrExit(ERR_ALGORITHM, "DAG count of query %d differs", i + 1);
+        }
+    }
+    bChecked = TRUE;
+    free(iRootM);
+    free(iMatchM);
+    freeQueryDag(dag);
+    lSink += lCount;
+}
+
+/******************** runUpdates **************************************
+void runUpdates(QuerySet *pSet, StandingSet set, int *piRun)
+Purpose:
+    Applies the updates of the next run to a standing set.
+**************************************************************************/
+static void runUpdates(QuerySet *pSet, StandingSet set, int *piRun)
+{
+    long lCount = 0;
+    int iFirst = *piRun * pSet->iUpdateCount;
+    int i;
+
+    for (i = iFirst; i < iFirst + pSet->iUpdateCount; i++)
+        lCount += updateStandingCustomer(set, pSet->iUpdateCustomerM[i], pSet->pszUpdateM[i]);
+    (*piRun)++;
+    lSink += lCount;
+}
+
+/******************** benchStandingUpdate **************************************
+void benchStandingUpdate(QuerySet *pSet, Out out)
+Purpose:
+    Applies updates to the standing queries, evaluating the queries the
+    index finds.
+**************************************************************************/
+static void benchStandingUpdate(QuerySet *pSet, Out out)
+{
+    (void) out;
+    runUpdates(pSet, pSet->standingSet, &pSet->iStandingRun);
+}
+
+/******************** benchStandingRerun **************************************
+void benchStandingRerun(QuerySet *pSet, Out out)
+Purpose:
+    Applies updates to the standing queries, evaluating every query.
+**************************************************************************/
+static void benchStandingRerun(QuerySet *pSet, Out out)
+{
+    (void) out;
+    runUpdates(pSet, pSet->rerunSet, &pSet->iRerunRun);
+}
+
+/******************** benchMatchIndex **************************************
+void benchMatchIndex(QuerySet *pSet, Out out)
+Purpose:
+    Matches every event against the queries with the match index.
+**************************************************************************/
+static void benchMatchIndex(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    pSet->matchIndex->bUseIndex = TRUE;
+    for (i = 0; i < pSet->iEventCount; i++)
+        lCount += matchRecord(pSet->matchIndex, pSet->pszEventM[i]);
+    lSink += lCount;
+}
+
+/******************** benchMatchScan **************************************
+void benchMatchScan(QuerySet *pSet, Out out)
+Purpose:
+    Matches the first MATCH_SCAN_EVENTS events by evaluating every query.
+**************************************************************************/
+static void benchMatchScan(QuerySet *pSet, Out out)
+{
+    long lCount = 0;
+    int i;
+
+    (void) out;
+    pSet->matchIndex->bUseIndex = FALSE;
+    for (i = 0; i < pSet->iEventCount && i < MATCH_SCAN_EVENTS; i++)
+        lCount += matchRecord(pSet->matchIndex, pSet->pszEventM[i]);
+    pSet->matchIndex->bUseIndex = TRUE;
+    lSink += lCount;
+}
+
+/******************** countEvaluators **************************************
+void countEvaluators(QuerySet *pSet, Query query, int iCountM[], int bStrings)
+Purpose:
+    Counts the matching customers of a query with each evaluator.
+Parameters:
+    I   QuerySet *pSet              customers and their index
+    I   Query query                 query compiled against the customers
+    O   int iCountM[]               count of the switch interpreter,
+                                    countMatches, countIndexMatches and
+                                    the string evaluator
+    I   int bStrings                FALSE to skip the string evaluator,
+                                    whose count is then the switch's
+Returns:
+    n/a
+**************************************************************************/
+static void countEvaluators(QuerySet *pSet, Query query, int iCountM[], int bStrings)
+{
+    int bStackM[EVAL_LOCAL_STACK];
+    int iCustomer;
+
+    iCountM[0] = countMatchesSwitch(query, pSet->customerSet);
+    iCountM[1] = countMatches(query, pSet->customerSet);
+    iCountM[2] = countIndexMatches(query, pSet->customerIndex);
+    iCountM[3] = iCountM[0];
+    if (!bStrings || query->iMaxDepth > EVAL_LOCAL_STACK)
+        return;
+    iCountM[3] = 0;
+    for (iCustomer = 0; iCustomer < pSet->customerSet->iCustomerCount; iCustomer++)
+        iCountM[3] += evaluateStrings(pSet, query, iCustomer, bStackM);
+}
+
+/******************** checkEvaluators **************************************
+void checkEvaluators(QuerySet *pSet, Out out)
+Purpose:
+    Checks that the string evaluator, the switch and threaded
+    interpreters and the customer index give the same count for every
+    generated query, and for =, NOTANY and ONLY comparisons of chosen
+    values of every trait.  countMatches must also give the same count
+    for every generated query after optimizeQuery.
+Parameters:
+    I   QuerySet *pSet              queries compiled against the customers
+    I/O Out out                     work area for the conversion
+Returns:
+    n/a
+Notes:
+    - The chosen values are the first, the last, those around
+      MASK_VALUES, which are only found through MASK_SPILL, and one no
+      customer has.  A trait no customer has is compared too.
+    - The string evaluator is too slow for every generated query, so it
+      only checks the comparisons.
+    - Exits with ERR_ALGORITHM if two evaluators differ.
+**************************************************************************/
+static void checkEvaluators(QuerySet *pSet, Out out)
+{
+    static char *pszOperatorM[] = {"=", "NOTANY", "ONLY"};
+    CustomerSet customerSet = pSet->customerSet;
+    TraitColumn *pColumn;
+    Query query = newQuery();
+    char szQuery[2 * MAX_TOKEN + 20];
+    int iValueIdM[5];
+    int iCountM[4];
+    int iComparisons = 0;
+    int iSpills = 0;            // comparisons of a value id of MASK_VALUES or more
+    int iTrait;
+    int iOperator;
+    int iValue;
+    int i;
+
+    for (i = 0; i < pSet->iQueryCount; i++)
+    {
+        if (pSet->queryM[i] == NULL)
+            continue;
+        countEvaluators(pSet, pSet->queryM[i], iCountM, FALSE);
+        if (iCountM[1] != iCountM[0] || iCountM[2] != iCountM[0])
+            ErrExit(ERR_ALGORITHM, "Query %d matches %d, %d and %d customers with the"
+                " switch, threaded and index evaluators", i + 1
+                , iCountM[0], iCountM[1], iCountM[2]);
+        iCountM[1] = countMatches(pSet->optimizedQueryM[i], pSet->customerSet);
+        if (iCountM[1] != iCountM[0])
+            ErrExit(ERR_ALGORITHM, "Query %d matches %d customers, but %d once"
+                " optimized", i + 1, iCountM[0], iCountM[1]);
+    }
+
+    // the trait count is one more, for a trait no customer has
+    for (iTrait = 0; iTrait <= customerSet->iTraitCount; iTrait++)
+    {
+        pColumn = iTrait < customerSet->iTraitCount ? &customerSet->traitM[iTrait] : NULL;
+        iValueIdM[0] = 0;
+        iValueIdM[1] = MASK_VALUES - 1;
+        iValueIdM[2] = MASK_VALUES;
+        iValueIdM[3] = MASK_VALUES + 1;
+        iValueIdM[4] = pColumn != NULL ? pColumn->iValueCount - 1 : 0;
+        for (iOperator = 0; iOperator < 3; iOperator++)
+        {
+            // the last comparison is of a value no customer has
+            for (iValue = 0; iValue <= 5; iValue++)
+            {
+                if (pColumn == NULL)
+                {
+                    if (iValue > 0)
+                        break;
+                    sprintf(szQuery, "NOSUCHTRAIT %s NOSUCHVALUE", pszOperatorM[iOperator]);
+                }
+                else if (iValue == 5)
+                    sprintf(szQuery, "%s %s NOSUCHVALUE", pColumn->szTrait
+                        , pszOperatorM[iOperator]);
+                else if (iValueIdM[iValue] < pColumn->iValueCount)
+                    sprintf(szQuery, "%s %s %s", pColumn->szTrait, pszOperatorM[iOperator]
+                        , pColumn->szValueM[iValueIdM[iValue]]);
+                else
+                    continue;
+                resetOut(out);
+                if (convertToPostFix(szQuery, out) != 0
+                    || compileQuery(out, customerSet, query) != 0)
+                    ErrExit(ERR_ALGORITHM, "Unable to compile the check query %s", szQuery);
+                countEvaluators(pSet, query, iCountM, TRUE);
+                if (iCountM[1] != iCountM[0] || iCountM[2] != iCountM[0]
+                    || iCountM[3] != iCountM[0])
+                    ErrExit(ERR_ALGORITHM, "%s matches %d, %d, %d and %d customers with the"
+                        " switch, threaded, index and string evaluators", szQuery
+                        , iCountM[0], iCountM[1], iCountM[2], iCountM[3]);
+                iComparisons++;
+                if (pColumn != NULL && iValue < 5 && iValueIdM[iValue] >= MASK_VALUES)
+                    iSpills++;
+            }
+        }
+    }
+    fprintf(stderr, "Evaluators agree: %d queries, %d comparisons, %d of them of"
+        " value ids from MASK_VALUES on\n", pSet->iQueryCount, iComparisons, iSpills);
+    freeQuery(query);
+}
+
+// what a benchmark needs besides the queries
+#define NEEDS_QUERIES   0
+#define NEEDS_CUSTOMERS 1       // -c
+#define NEEDS_UPDATES   2       // -c and -u
+#define NEEDS_EVENTS    3       // -p
+
+// the following structure lists the benchmarks in the order they are run.
+// Every benchmark is passed the Out work area; the ones that do not
+// convert ignore it.
+static struct
+{
+    char *pszName;
+    void (*pfnBench)(QuerySet *pSet, Out out);
+    int iNeeds;                 // NEEDS_QUERIES, _CUSTOMERS or _UPDATES
+} benchM[] =
+{
+    {"getToken",             benchGetToken,           NEEDS_QUERIES}
+    , {"getTokenView",       benchGetTokenView,       NEEDS_QUERIES}
+    , {"categorize",         benchCategorize,         NEEDS_QUERIES}
+    , {"processOperator",    benchProcessOperator,    NEEDS_QUERIES}
+    , {"convertToPostFix",   benchConvertToPostFix,   NEEDS_QUERIES}
+    , {"convertNewOut",      benchConvertNewOut,      NEEDS_QUERIES}
+    , {"convertCached",      benchConvertCached,      NEEDS_QUERIES}
+    , {"countStringMatches", benchCountStringMatches, NEEDS_CUSTOMERS}
+    , {"countMatchesSwitch", benchCountMatchesSwitch, NEEDS_CUSTOMERS}
+    , {"countMatches",       benchCountMatches,       NEEDS_CUSTOMERS}
+    , {"countOptimized",     benchCountOptimized,     NEEDS_CUSTOMERS}
+    , {"countSimplified",    benchCountSimplified,    NEEDS_CUSTOMERS}
+    , {"countColumnScalar",  benchCountColumnScalar,  NEEDS_CUSTOMERS}
+    , {"countColumnMatches", benchCountColumnMatches, NEEDS_CUSTOMERS}
+    , {"countIndexMatches",  benchCountIndexMatches,  NEEDS_CUSTOMERS}
+    , {"countDagMatches",    benchCountDagMatches,    NEEDS_CUSTOMERS}
+    , {"standingUpdate",     benchStandingUpdate,     NEEDS_UPDATES}
+    , {"standingRerun",      benchStandingRerun,      NEEDS_UPDATES}
+    , {"matchIndex",         benchMatchIndex,         NEEDS_EVENTS}
+    , {"matchScan",          benchMatchScan,          NEEDS_EVENTS}
+    , {NULL, NULL, NEEDS_QUERIES}   // null terminating
+};
+
+/******************** getIntArg **************************************
+int getIntArg(char *pszArg, int iMin)
+Purpose:
+    Converts a command parameter to an integer, exiting if it is less
+    than iMin.
+**************************************************************************/
+static int getIntArg(char *pszArg, int iMin)
+{
+    int iValue = atoi(pszArg);
+    if (iValue < iMin)
+        ErrExit(ERR_INPUT, "Parameter %s must be at least %d", pszArg, iMin);
+    return iValue;
+}
+
+// Main program for the benchmark
+
+int main(int argc, char *argv[])
+{
+    GenParams params = {10000, 1, 8, 3, 50, 80, 64, 0, 0, 0, 0, 0, NULL};
+    QuerySet set;
+    OutputBuffer output;
+    OutputBuffer updateOutput = NULL;
+    OutputBuffer eventOutput = NULL;
+    double dCount;              // queries (or updates) in one run
+    double dPerSec;
+    Out out = newOut();
+    struct timespec start;
+    double dNs;
+    double dBestNs;
+    double dIndexNs = 0;        // best time of countIndexMatches
+    double dDagNs = 0;          // best time of countDagMatches
+    double dMatchesNs = 0;      // best time of countMatches
+    double dOptimizedNs = 0;    // best time of countOptimized
+    int iRepeat = 5;
+    int iCacheEntries = 1024;   // -q cacheEntries
+    int iMaxThreads = 0;        // -j maxThreads
+    int iLargeThreads = 4;      // -t threads
+    int iRecordCount = 0;       // -i records
+    int iIngestMegabytes = 0;   // -f megabytes
+    char *pszDriver = NULL;     // -x driver
+    char *pszStatsDriver = NULL;    // -X statsDriver
+    int bLarge = FALSE;         // -b
+    int bColumn = FALSE;        // -k
+    int bOutput = FALSE;        // -o
+    int bSkewed = FALSE;        // -y
+    int bGenerate = FALSE;
+    int i;
+    int iRun;
+
+    // process the command line options
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-g") == 0)
+            bGenerate = TRUE;
+        else if (strcmp(argv[i], "-b") == 0)
+            bLarge = TRUE;
+        else if (strcmp(argv[i], "-k") == 0)
+            bColumn = TRUE;
+        else if (strcmp(argv[i], "-o") == 0)
+            bOutput = TRUE;
+        else if (strcmp(argv[i], "-y") == 0)
+            bSkewed = TRUE;
+        else if (i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2)
+            ErrExit(ERR_INPUT, "Unknown parameter %s", argv[i]);
+        else
+        {
+            switch (argv[i][1])
+            {
+                case 'n': params.iQueryCount = getIntArg(argv[++i], 1); break;
+                case 'r': iRepeat = getIntArg(argv[++i], 1); break;
+                case 's': params.ulSeed = strtoull(argv[++i], NULL, 10); break;
+                case 'l': params.iTerms = getIntArg(argv[++i], 1); break;
+                case 'd': params.iDepth = getIntArg(argv[++i], 0); break;
+                case 'a': params.iAndPercent = getIntArg(argv[++i], 0); break;
+                case 'e': params.iEqualPercent = getIntArg(argv[++i], 0); break;
+                case 'v': params.iVocabulary = getIntArg(argv[++i], 1); break;
+                case 'm': params.iMalformedPercent = getIntArg(argv[++i], 0); break;
+                case 'c': params.iCustomerCount = getIntArg(argv[++i], 0); break;
+                case 'u': params.iUpdateCount = getIntArg(argv[++i], 0); break;
+                case 'p': params.iEventCount = getIntArg(argv[++i], 0); break;
+                case 't': iLargeThreads = getIntArg(argv[++i], 1); break;
+                case 'z': params.iZipfDistinct = getIntArg(argv[++i], 0); break;
+                case 'q': iCacheEntries = getIntArg(argv[++i], 1); break;
+                case 'j': iMaxThreads = getIntArg(argv[++i], 0); break;
+                case 'i': iRecordCount = getIntArg(argv[++i], 0); break;
+                case 'f': iIngestMegabytes = getIntArg(argv[++i], 0); break;
+                case 'x': pszDriver = argv[++i]; break;
+                case 'X': pszStatsDriver = argv[++i]; break;
+                default:
+                    ErrExit(ERR_INPUT, "Unknown parameter %s", argv[i]);
+            }
+        }
+    }
+
+    if (bGenerate)
+    {
+        output = newOutputBuffer(stdout);
+        genQueries(output, &params);
+        flushOutput(output);
+        freeOutputBuffer(output);
+        freeOut(out);
+        return 0;
+    }
+    if (bSkewed)
+        params.dValueSumM = newZipfSums(params.iVocabulary);
+
+    output = newOutputBuffer(NULL);
+    genQueries(output, &params);
+    set.iQueryCount = params.iQueryCount;
+    buildQuerySet(output, &set);
+    set.lConvertBlocks = set.lConvertCount = 0;
+    set.lNewOutBlocks = set.lNewOutCount = 0;
+    set.iCacheEntries = iCacheEntries;
+    set.lCacheHits = set.lCacheMisses = 0;
+    set.customerSet = NULL;
+    set.customerIndex = NULL;
+    set.queryM = NULL;
+    set.standingSet = set.rerunSet = NULL;
+    set.iStandingRun = set.iRerunRun = 0;
+    if (params.iCustomerCount > 0)
+    {
+        set.customerSet = genCustomers(&params);
+        set.stats = collectStats(set.customerSet);
+        compileQuerySet(&set, out);
+        buildValueStrings(&set);
+        set.customerIndex = buildIndex(set.customerSet);
+        checkEvaluators(&set, out);
+    }
+    if (params.iCustomerCount > 0 && params.iUpdateCount > 0)
+    {
+        updateOutput = newOutputBuffer(NULL);
+        genUpdates(updateOutput, &params, &set, iRepeat);
+        set.standingSet = buildStandingSet(&set, out, TRUE);
+        set.rerunSet = buildStandingSet(&set, out, FALSE);
+    }
+    set.matchIndex = NULL;
+    if (params.iEventCount > 0)
+    {
+        eventOutput = newOutputBuffer(NULL);
+        genEvents(eventOutput, &params, &set);
+        set.matchIndex = buildMatchIndex(&set, out);
+    }
+
+    printf("# cs2123p1Bench seed=%llu queries=%d terms=%d depth=%d and=%d equal=%d"
+        " vocabulary=%d malformed=%d customers=%d updates=%d events=%d repeat=%d"
+        " distinct=%d cache=%d skewed=%d records=%d tokens=%d\n"
+        , params.ulSeed, params.iQueryCount, params.iTerms, params.iDepth
+        , params.iAndPercent, params.iEqualPercent, params.iVocabulary
+        , params.iMalformedPercent, params.iCustomerCount, params.iUpdateCount
+        , params.iEventCount, iRepeat, params.iZipfDistinct, iCacheEntries, bSkewed
+        , iRecordCount, set.iTokenCount);
+    printf("%s\t%s\t%s\n", "benchmark", "ns_per_query", "tokens_per_sec");
+    for (i = 0; benchM[i].pszName != NULL; i++)
+    {
+        if (benchM[i].iNeeds == NEEDS_CUSTOMERS && set.customerSet == NULL)
+            continue;
+        if (benchM[i].iNeeds == NEEDS_UPDATES && set.standingSet == NULL)
+            continue;
+        if (benchM[i].iNeeds == NEEDS_EVENTS && set.matchIndex == NULL)
+            continue;
+        dBestNs = 0;
+        for (iRun = 0; iRun < iRepeat; iRun++)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            benchM[i].pfnBench(&set, out);
+            dNs = elapsedNs(&start);
+            if (iRun == 0 || dNs < dBestNs)
+                dBestNs = dNs;
+        }
+        if (benchM[i].pfnBench == benchCountIndexMatches)
+            dIndexNs = dBestNs;
+        if (benchM[i].pfnBench == benchCountDagMatches)
+            dDagNs = dBestNs;
+        if (benchM[i].pfnBench == benchCountMatches)
+            dMatchesNs = dBestNs;
+        if (benchM[i].pfnBench == benchCountOptimized)
+            dOptimizedNs = dBestNs;
+        dCount = set.iQueryCount;
+        dPerSec = set.iTokenCount;
+        if (benchM[i].iNeeds == NEEDS_UPDATES)
+            dCount = dPerSec = set.iUpdateCount;
+        if (benchM[i].pfnBench == benchMatchIndex)
+            dCount = dPerSec = set.iEventCount;
+        if (benchM[i].pfnBench == benchMatchScan)
+            dCount = dPerSec = set.iEventCount < MATCH_SCAN_EVENTS
+                ? set.iEventCount : MATCH_SCAN_EVENTS;
+        printf("%s\t%.1f\t%.0f\n", benchM[i].pszName, dBestNs / dCount
+            , dBestNs > 0 ? dPerSec / (dBestNs / 1e9) : 0.0);
+    }
+    benchLegacy(&set, iRepeat, out);
+    benchClassify(&set, iRepeat);
+    if (bLarge)
+        benchLarge(&params, iLargeThreads, iRepeat, out);
+    if (bColumn && set.customerSet != NULL)
+        benchColumnFile(&set, &params, iRepeat, out);
+    if (bOutput)
+        benchOutput(&set, iRepeat, out);
+    if (iMaxThreads > 0)
+        benchThreads(&set, iMaxThreads, iRepeat);
+    if (iIngestMegabytes > 0)
+        benchIngest(&set, iIngestMegabytes, iRepeat, out);
+    if (iRecordCount > 0)
+        benchRecords(&params, iRecordCount, iRepeat, out);
+    if (pszDriver != NULL && pszStatsDriver != NULL)
+        benchStats(&set, pszDriver, pszStatsDriver, iRepeat);
+    fprintf(stderr, "Arena blocks per query: %.4f reusing one Out, %.4f with a new"
+        " Out for each query\n", (double) set.lConvertBlocks / set.lConvertCount
+        , (double) set.lNewOutBlocks / set.lNewOutCount);
+    fprintf(stderr, "Query cache: %d entries, %.1f%% of the queries hit\n"
+        , set.iCacheEntries, 100.0 * set.lCacheHits / (set.lCacheHits + set.lCacheMisses));
+    if (set.customerSet != NULL)
+        fprintf(stderr, "Optimized queries: %.1f%% of the time of countMatches saved\n"
+            , dMatchesNs > 0 ? 100.0 * (dMatchesNs - dOptimizedNs) / dMatchesNs : 0.0);
+    if (set.customerSet != NULL)
+        fprintf(stderr, "Simplified queries: %d of %d shortened or decided, %d"
+            " true or false for every customer\n", set.iSimplifiedCount
+            , set.iQueryCount, set.iConstantCount);
+    if (set.customerIndex != NULL)
+    {
+        fprintf(stderr, "Customer index: %ld bytes, %.0f with one bitmap per value\n"
+            , set.customerIndex->lBytes, plainIndexBytes(set.customerSet));
+        fprintf(stderr, "Query DAG: %ld instructions in %ld distinct nodes, %.2f per"
+            " node, %d of %d chunks counted a query at a time, %.1f%% of the time"
+            " of countIndexMatches saved\n", set.lDagInstrCount
+            , set.lDagNodeCount, set.lDagNodeCount > 0
+                ? (double) set.lDagInstrCount / set.lDagNodeCount : 0.0
+            , set.iDagPerQueryCount, set.iDagCount
+            , dIndexNs > 0 ? 100.0 * (dIndexNs - dDagNs) / dIndexNs : 0.0);
+    }
+    if (set.standingSet != NULL)
+        fprintf(stderr, "Standing queries: %d registered, %.1f evaluated per update"
+            " with the index\n", set.standingSet->iQueryCount
+            , (double) set.standingSet->lEvaluations
+                / (set.iStandingRun * set.iUpdateCount) / 2);
+
+    if (set.matchIndex != NULL)
+    {
+        fprintf(stderr, "Match index: %d queries, %d conjunctions, %d fallback queries"
+            "\n", set.matchIndex->iQueryCount, set.matchIndex->iConjCount
+            , set.matchIndex->iFallbackCount);
+        freeMatchIndex(set.matchIndex);
+        free(set.pszEventM);
+        freeOutputBuffer(eventOutput);
+    }
+    if (set.standingSet != NULL)
+    {
+        freeStandingSet(set.standingSet);
+        freeStandingSet(set.rerunSet);
+        free(set.iUpdateCustomerM);
+        free(set.pszUpdateM);
+        freeOutputBuffer(updateOutput);
+    }
+    if (set.customerSet != NULL)
+    {
+        for (i = 0; i < set.iQueryCount; i++)
+        {
+            if (set.queryM[i] != NULL)
+                freeQuery(set.queryM[i]);
+            if (set.simpleQueryM[i] != NULL)
+                freeQuery(set.simpleQueryM[i]);
+            if (set.optimizedQueryM[i] != NULL)
+                freeQuery(set.optimizedQueryM[i]);
+        }
+        free(set.queryM);
+        free(set.simpleQueryM);
+        free(set.optimizedQueryM);
+        freeStats(set.stats);
+        free(set.iSimpleResultM);
+        freeIndex(set.customerIndex);
+        freeCustomerSet(set.customerSet);
+    }
+    free(set.pszQueryM);
+    free(set.iFirstElementM);
+    free(set.elementM);
+    free(params.dValueSumM);
+    freeOutputBuffer(output);
+    freeOut(out);
+    return 0;
+}
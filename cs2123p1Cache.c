@@ -0,0 +1,415 @@
+/**********************************************************************************
+Program cs2123p1Cache.c by Timothy Hennessy
+Purpose:
+    Keeps a bounded cache of converted queries so that a query seen before
+    is not tokenized and converted again.
+Command Parameters:
+    n/a
+Input:
+    Query text as passed to convertToPostFix.
+Results:
+    convertCached fills an Out exactly as convertToPostFix would, from the
+    cache when the query has been converted before.
+Returns:
+    The return code of convertToPostFix for the query.
+Notes:
+    1. The cache key is the query text normalized so that queries which
+       convert the same way share an entry:
+           - runs of white space become one space, and leading and
+             trailing white space is removed
+           - parentheses around the whole query are removed when they
+             match each other, e.g. ( ( A = B ) ) becomes A = B
+    2. The cache is split into CACHE_SHARDS shards by the hash of the key.
+       Each shard has its own lock, hash table and LRU list, so threads
+       converting different queries seldom wait for each other.  When a
+       shard is full its least recently used entry is evicted.
+    3. The query is converted without holding a lock.  If two threads miss
+       on the same query at once, both convert it and the first one adds
+       it to the cache.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Cache.h"
+
+/******************** newQueryCache **************************************
+QueryCache newQueryCache(int iEntryMax)
+Purpose:
+    Creates an empty query cache.
+Parameters:
+    I   int iEntryMax           most queries the cache keeps
+Returns:
+    The new cache.  Use freeQueryCache to free it.
+Notes:
+    - The entries are divided evenly among the shards, so each shard
+      keeps at least one entry.
+**************************************************************************/
+QueryCache newQueryCache(int iEntryMax)
+{
+    QueryCache cache = malloc(sizeof(QueryCacheImp));
+    CacheShard *pShard;
+    int iShard;
+
+    if (cache == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate a query cache");
+    for (iShard = 0; iShard < CACHE_SHARDS; iShard++)
+    {
+        pShard = &cache->shardM[iShard];
+        pthread_mutex_init(&pShard->lock, NULL);
+        pShard->iEntryMax = (iEntryMax + CACHE_SHARDS - 1) / CACHE_SHARDS;
+        if (pShard->iEntryMax < 1)
+            pShard->iEntryMax = 1;
+        pShard->iBucketCount = CACHE_MIN_BUCKETS;
+        while (pShard->iBucketCount < pShard->iEntryMax)
+            pShard->iBucketCount *= 2;
+        pShard->bucketM = calloc(pShard->iBucketCount, sizeof(CacheEntry *));
+        if (pShard->bucketM == NULL)
+            ErrExit(ERR_INPUT, "Unable to allocate a query cache");
+        pShard->pLruFirst = NULL;
+        pShard->pLruLast = NULL;
+        pShard->iEntryCount = 0;
+        pShard->lHits = 0;
+        pShard->lMisses = 0;
+        pShard->lEvictions = 0;
+    }
+    return cache;
+}
+
+/******************** normalizeQuery **************************************
+int normalizeQuery(char *pszInfix, char *pszKey, unsigned int *puHash)
+Purpose:
+    Builds the cache key of a query.
+Parameters:
+    I   char *pszInfix          query text
+    O   char *pszKey            normalized query text.  It must have room
+                                for strlen(pszInfix) + 1 characters.
+    O   unsigned int *puHash    FNV-1a hash of the key
+Returns:
+    The length of the key.
+Notes:
+    - Matching outer parentheses are found in one pass.  After removing
+      the j leading "(" and j trailing ")" tokens, the rest of the query
+      must be balanced.  If its running depth drops to -a, the last a of
+      the leading parentheses are closed inside it, so only j - a pairs
+      are removed.
+**************************************************************************/
+static int normalizeQuery(char *pszInfix, char *pszKey, unsigned int *puHash)
+{
+    char *pszToken;
+    int iTokenLength;
+    int iLength = 0;            // length of the key
+    int iTokenCount = 0;
+    int iLeading = 0;           // number of leading "(" tokens
+    int iTrailing = 0;          // number of trailing ")" tokens
+    int iPairs;                 // outer pairs that can be removed
+    int iDepth = 0;
+    int iMinDepth = 0;
+    int iStart;                 // start of the key after removing pairs
+    int iEnd;                   // end of the key after removing pairs
+    int i;
+    unsigned int uHash = 2166136261u;
+
+    // copy the tokens separated by one space
+    while ((pszInfix = getTokenView(pszInfix, &pszToken, &iTokenLength)) != NULL)
+    {
+        if (iTokenCount > 0)
+            pszKey[iLength++] = ' ';
+        memcpy(pszKey + iLength, pszToken, iTokenLength);
+        iLength += iTokenLength;
+        if (iTokenLength == 1 && pszToken[0] == '(' && iLeading == iTokenCount)
+            iLeading++;
+        if (iTokenLength == 1 && pszToken[0] == ')')
+            iTrailing++;
+        else
+            iTrailing = 0;
+        iTokenCount++;
+    }
+    pszKey[iLength] = '\0';
+
+    // each removed parenthesis takes two characters of the key
+    iPairs = iLeading < iTrailing ? iLeading : iTrailing;
+    if (iPairs > iTokenCount / 2)
+        iPairs = iTokenCount / 2;
+    iStart = 0;
+    iEnd = iLength;
+    if (iPairs > 0)
+    {
+        // find the running depth of the tokens between the pairs
+        for (i = 2 * iPairs; i < iLength - 2 * iPairs; i += 2)
+        {
+            if (pszKey[i] == '(' && pszKey[i + 1] == ' ')
+                iDepth++;
+            else if (pszKey[i] == ')' && pszKey[i + 1] == ' ')
+            {
+                iDepth--;
+                if (iDepth < iMinDepth)
+                    iMinDepth = iDepth;
+            }
+            // skip to the space after the token
+            while (pszKey[i + 1] != ' ')
+                i++;
+        }
+        if (iDepth == 0 && iPairs + iMinDepth > 0)
+        {
+            iPairs += iMinDepth;
+            iStart = 2 * iPairs;
+            iEnd = iLength - 2 * iPairs;
+            if (iEnd < iStart)
+                iEnd = iStart;
+        }
+    }
+    if (iStart > 0)
+        memmove(pszKey, pszKey + iStart, iEnd - iStart);
+    iLength = iEnd - iStart;
+    pszKey[iLength] = '\0';
+
+    for (i = 0; i < iLength; i++)
+    {
+        uHash ^= (unsigned char) pszKey[i];
+        uHash *= 16777619u;
+    }
+    *puHash = uHash;
+    return iLength;
+}
+
+/******************** unlinkLru **************************************
+void unlinkLru(CacheShard *pShard, CacheEntry *pEntry)
+Purpose:
+    Removes an entry from its shard's LRU list.
+Parameters:
+    I/O CacheShard *pShard      shard holding the entry
+    I/O CacheEntry *pEntry      entry to remove
+Returns:
+    n/a
+**************************************************************************/
+static void unlinkLru(CacheShard *pShard, CacheEntry *pEntry)
+{
+    if (pEntry->pLruPrev != NULL)
+        pEntry->pLruPrev->pLruNext = pEntry->pLruNext;
+    else
+        pShard->pLruFirst = pEntry->pLruNext;
+    if (pEntry->pLruNext != NULL)
+        pEntry->pLruNext->pLruPrev = pEntry->pLruPrev;
+    else
+        pShard->pLruLast = pEntry->pLruPrev;
+}
+
+/******************** pushLru **************************************
+void pushLru(CacheShard *pShard, CacheEntry *pEntry)
+Purpose:
+    Makes an entry the most recently used one in its shard.
+Parameters:
+    I/O CacheShard *pShard      shard holding the entry
+    I/O CacheEntry *pEntry      entry that is not in the LRU list
+Returns:
+    n/a
+**************************************************************************/
+static void pushLru(CacheShard *pShard, CacheEntry *pEntry)
+{
+    pEntry->pLruPrev = NULL;
+    pEntry->pLruNext = pShard->pLruFirst;
+    if (pShard->pLruFirst != NULL)
+        pShard->pLruFirst->pLruPrev = pEntry;
+    else
+        pShard->pLruLast = pEntry;
+    pShard->pLruFirst = pEntry;
+}
+
+/******************** findEntry **************************************
+CacheEntry **findEntry(CacheShard *pShard, char *pszKey, int iKeyLength
+    , unsigned int uHash)
+Purpose:
+    Finds a key in a shard's hash table.
+Parameters:
+    I   CacheShard *pShard      shard to search
+    I   char *pszKey            normalized query text
+    I   int iKeyLength          length of pszKey
+    I   unsigned int uHash      hash of pszKey
+Returns:
+    The link pointing at the entry, or the NULL link ending the bucket's
+    chain if the key is not in the shard.
+Notes:
+    - The caller must hold the shard's lock.
+**************************************************************************/
+static CacheEntry **findEntry(CacheShard *pShard, char *pszKey, int iKeyLength
+    , unsigned int uHash)
+{
+    CacheEntry **ppEntry = &pShard->bucketM[uHash & (pShard->iBucketCount - 1)];
+    while (*ppEntry != NULL)
+    {
+        if ((*ppEntry)->uHash == uHash && (*ppEntry)->iKeyLength == iKeyLength
+            && memcmp((*ppEntry)->pszKey, pszKey, iKeyLength) == 0)
+            break;
+        ppEntry = &(*ppEntry)->pNext;
+    }
+    return ppEntry;
+}
+
+/******************** evictEntry **************************************
+void evictEntry(CacheShard *pShard)
+Purpose:
+    Removes and frees the least recently used entry of a shard.
+Parameters:
+    I/O CacheShard *pShard      shard that is full
+Returns:
+    n/a
+Notes:
+    - The caller must hold the shard's lock.
+**************************************************************************/
+static void evictEntry(CacheShard *pShard)
+{
+    CacheEntry *pEntry = pShard->pLruLast;
+    CacheEntry **ppEntry = findEntry(pShard, pEntry->pszKey, pEntry->iKeyLength
+        , pEntry->uHash);
+    *ppEntry = pEntry->pNext;
+    unlinkLru(pShard, pEntry);
+    free(pEntry);
+    pShard->iEntryCount--;
+    pShard->lEvictions++;
+}
+
+/******************** convertCached **************************************
+int convertCached(QueryCache cache, char *pszInfix, Out out)
+Purpose:
+    Converts a query to postfix, using the cached result if the query
+    has been converted before.
+Parameters:
+    I/O QueryCache cache        cache of converted queries
+    I   char *pszInfix          query text
+    I/O Out out                 empty out that receives the postfix
+Returns:
+    The return code of convertToPostFix for the query.
+Notes:
+    - The key is built in the out's arena.
+    - A converted query is added to the cache whatever its return code,
+      so a query with a warning also skips conversion the next time.
+**************************************************************************/
+int convertCached(QueryCache cache, char *pszInfix, Out out)
+{
+    char *pszKey = arenaAlloc(out->arena, strlen(pszInfix) + 1);
+    unsigned int uHash;
+    int iKeyLength = normalizeQuery(pszInfix, pszKey, &uHash);
+    CacheShard *pShard = &cache->shardM[uHash >> 28 & (CACHE_SHARDS - 1)];
+    CacheEntry **ppEntry;
+    CacheEntry *pEntry;
+    int rc;
+    int i;
+
+    // on a hit, copy the postfix into out
+    pthread_mutex_lock(&pShard->lock);
+    ppEntry = findEntry(pShard, pszKey, iKeyLength, uHash);
+    if (*ppEntry != NULL)
+    {
+        pEntry = *ppEntry;
+        unlinkLru(pShard, pEntry);
+        pushLru(pShard, pEntry);
+        pShard->lHits++;
+        for (i = 0; i < pEntry->iOutCount; i++)
+            addOut(out, pEntry->outM[i]);
+        rc = pEntry->rc;
+        pthread_mutex_unlock(&pShard->lock);
+        return rc;
+    }
+    pShard->lMisses++;
+    pthread_mutex_unlock(&pShard->lock);
+
+    rc = convertToPostFix(pszInfix, out);
+
+    // build the entry, with its elements and key after it
+    pEntry = malloc(sizeof(CacheEntry) + out->iOutCount * sizeof(Element)
+        + iKeyLength + 1);
+    if (pEntry == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate a query cache entry");
+    pEntry->uHash = uHash;
+    pEntry->iKeyLength = iKeyLength;
+    pEntry->rc = rc;
+    pEntry->iOutCount = out->iOutCount;
+    pEntry->outM = (Element *) (pEntry + 1);
+    pEntry->pszKey = (char *) (pEntry->outM + out->iOutCount);
+    memcpy(pEntry->outM, out->outM, out->iOutCount * sizeof(Element));
+    memcpy(pEntry->pszKey, pszKey, iKeyLength + 1);
+
+    pthread_mutex_lock(&pShard->lock);
+    ppEntry = findEntry(pShard, pszKey, iKeyLength, uHash);
+    if (*ppEntry != NULL)
+    {
+        // another thread added it while this one was converting
+        pthread_mutex_unlock(&pShard->lock);
+        free(pEntry);
+        return rc;
+    }
+    if (pShard->iEntryCount >= pShard->iEntryMax)
+    {
+        evictEntry(pShard);
+        ppEntry = findEntry(pShard, pszKey, iKeyLength, uHash);
+    }
+    pEntry->pNext = NULL;
+    *ppEntry = pEntry;
+    pushLru(pShard, pEntry);
+    pShard->iEntryCount++;
+    pthread_mutex_unlock(&pShard->lock);
+    return rc;
+}
+
+/******************** getCacheCounts **************************************
+void getCacheCounts(QueryCache cache, long *plHits, long *plMisses
+    , long *plEvictions)
+Purpose:
+    Returns the number of hits, misses and evictions of a cache.
+Parameters:
+    I   QueryCache cache        cache of converted queries
+    O   long *plHits            queries found in the cache
+    O   long *plMisses          queries that had to be converted
+    O   long *plEvictions       entries removed to make room
+Returns:
+    n/a
+**************************************************************************/
+void getCacheCounts(QueryCache cache, long *plHits, long *plMisses, long *plEvictions)
+{
+    CacheShard *pShard;
+    int iShard;
+
+    *plHits = *plMisses = *plEvictions = 0;
+    for (iShard = 0; iShard < CACHE_SHARDS; iShard++)
+    {
+        pShard = &cache->shardM[iShard];
+        pthread_mutex_lock(&pShard->lock);
+        *plHits += pShard->lHits;
+        *plMisses += pShard->lMisses;
+        *plEvictions += pShard->lEvictions;
+        pthread_mutex_unlock(&pShard->lock);
+    }
+}
+
+/******************** freeQueryCache **************************************
+void freeQueryCache(QueryCache cache)
+Purpose:
+    Frees a query cache and its entries.
+Parameters:
+    I/O QueryCache cache        cache to free
+Returns:
+    n/a
+**************************************************************************/
+void freeQueryCache(QueryCache cache)
+{
+    CacheShard *pShard;
+    CacheEntry *pEntry;
+    CacheEntry *pNext;
+    int iShard;
+
+    for (iShard = 0; iShard < CACHE_SHARDS; iShard++)
+    {
+        pShard = &cache->shardM[iShard];
+        for (pEntry = pShard->pLruFirst; pEntry != NULL; pEntry = pNext)
+        {
+            pNext = pEntry->pLruNext;
+            free(pEntry);
+        }
+        free(pShard->bucketM);
+        pthread_mutex_destroy(&pShard->lock);
+    }
+    free(cache);
+}
@@ -0,0 +1,70 @@
+/**********************************************************************
+cs2123p1Cache.h
+Purpose:
+   Defines constants:
+       sizes of the query cache
+   Defines typedef for
+       CacheEntry      (one converted query in the cache)
+       CacheShard      (independently locked part of the cache)
+       QueryCacheImp   (cache of converted queries)
+       QueryCache      (pointer to a QueryCacheImp)
+Notes:
+   - The cache maps normalized query text to the return code and
+     postfix elements of convertToPostFix.  Element symbol ids never
+     change, so a cached postfix can be copied into any Out.
+   - Include cs2123p1.h before this file.
+**********************************************************************/
+#include <pthread.h>
+
+/*** constants ***/
+#define CACHE_SHARDS 16             // Independently locked parts (power of 2)
+#define CACHE_MIN_BUCKETS 16        // Fewest hash buckets in a shard
+
+/*** typedef ***/
+
+// CacheEntry typedef is one cached query.  The entry, its key and its
+// postfix elements are one allocation.
+typedef struct CacheEntry
+{
+    struct CacheEntry *pNext;       // next entry in the same hash bucket
+    struct CacheEntry *pLruPrev;    // entry used more recently
+    struct CacheEntry *pLruNext;    // entry used less recently
+    unsigned int uHash;             // hash of the key
+    int iKeyLength;                 // length of pszKey
+    int rc;                         // return code of convertToPostFix
+    int iOutCount;                  // number of elements in outM
+    Element *outM;                  // postfix elements
+    char *pszKey;                   // normalized query text
+} CacheEntry;
+
+// CacheShard typedef is a bounded LRU list with a hash table over it.
+// Queries are assigned to a shard by their hash.
+typedef struct
+{
+    pthread_mutex_t lock;
+    CacheEntry **bucketM;           // hash chains
+    int iBucketCount;               // number of buckets (power of 2)
+    CacheEntry *pLruFirst;          // most recently used entry
+    CacheEntry *pLruLast;           // least recently used entry
+    int iEntryCount;                // number of entries in the shard
+    int iEntryMax;                  // most entries the shard keeps
+    long lHits;
+    long lMisses;
+    long lEvictions;
+} CacheShard;
+
+// QueryCacheImp typedef is a bounded cache of converted queries
+typedef struct
+{
+    CacheShard shardM[CACHE_SHARDS];
+} QueryCacheImp;
+
+// QueryCache typedef defines a pointer to a query cache
+typedef QueryCacheImp *QueryCache;
+
+/**********   prototypes ***********/
+
+QueryCache newQueryCache(int iEntryMax);
+int convertCached(QueryCache cache, char *pszInfix, Out out);
+void getCacheCounts(QueryCache cache, long *plHits, long *plMisses, long *plEvictions);
+void freeQueryCache(QueryCache cache);
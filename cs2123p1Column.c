@@ -0,0 +1,862 @@
+/**********************************************************************************
+Program cs2123p1Column.c by Timothy Hennessy
+Purpose:
+    Saves a customer trait dataset in a column file and counts the
+    customers matching compiled queries directly from the mapped file,
+    reading only the traits and blocks each query needs.
+Command Parameters:
+    n/a
+Input:
+    A column file written by writeColumnFile (see cs2123p1Column.h for its
+    layout).
+Results:
+    countColumnFileMatches gives the same count as countMatches on the
+    customer set the file was written from.
+Returns:
+    n/a
+Notes:
+    1. openColumnFile maps the file with mmap and reads the header, the
+       trait directory and the value dictionaries.  Its customer set has
+       every dictionary, so queries are compiled against it as usual,
+       but no customer's values.
+    2. A trait's columns are allocated the first time a query compares
+       it, and a block of them is unpacked the first time a query has to
+       look at its customers.  Unpacked blocks are kept for later queries.
+    3. Before looking at a block, the query is evaluated against the
+       block's summaries with three results: true for every customer of
+       the block, false for every one, or varies.  Only a block that
+       varies is unpacked and evaluated with countMatches.
+    4. lBytesRead counts the bytes of the file a query has used: the
+       header, directory and dictionaries when the file is opened, then
+       the block summaries of each trait compared and the packed values
+       of each block unpacked.  The pages the system reads around them
+       are not counted.
+    5. Like a postfix file, a column file is written in the byte order of
+       the machine writing it.  The packed values are read a byte at a
+       time, so only the fixed width records depend on it.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+#include "cs2123p1Column.h"
+
+#define COLUMN_ALIGN(l) (((l) + 7) & ~7L)
+
+// PackBuffer typedef collects the bytes of one part of a column file.
+// Bits are added below the ones already in ullBits.
+typedef struct
+{
+    unsigned char *byteM;
+    long lSize;
+    long lMax;                      // allocated size of byteM
+    unsigned long long ullBits;     // bits not yet added to byteM
+    int iBitCount;                  // number of them (less than 8 between calls)
+} PackBuffer;
+
+/******************** growArray **************************************
+void *growArray(void *pArray, long lNeeded, long *plMax, size_t iSize)
+Purpose:
+    Makes sure an array of the column file writer has room for lNeeded
+    entries.
+Parameters:
+    I/O void *pArray                the array (NULL if none yet)
+    I   long lNeeded                entries needed
+    I/O long *plMax                 allocated entries
+    I   size_t iSize                size of an entry
+Returns:
+    The array, which may have moved.
+**************************************************************************/
+static void *growArray(void *pArray, long lNeeded, long *plMax, size_t iSize)
+{
+    long lNewMax = *plMax > 0 ? *plMax : 1024;
+
+    if (lNeeded <= *plMax)
+        return pArray;
+    while (lNewMax < lNeeded)
+        lNewMax *= 2;
+    pArray = realloc(pArray, lNewMax * iSize);
+    if (pArray == NULL)
+        ErrExit(ERR_COLUMN_FILE, "Unable to allocate %ld column file bytes", lNewMax);
+    *plMax = lNewMax;
+    return pArray;
+}
+
+/******************** addBytes **************************************
+void addBytes(PackBuffer *pBuffer, void *pBytes, long lSize)
+Purpose:
+    Adds bytes to the end of a pack buffer.
+Parameters:
+    I/O PackBuffer *pBuffer         buffer to add to (no bits pending)
+    I   void *pBytes                bytes to add
+    I   long lSize                  number of bytes
+Returns:
+    n/a
+**************************************************************************/
+static void addBytes(PackBuffer *pBuffer, void *pBytes, long lSize)
+{
+    pBuffer->byteM = growArray(pBuffer->byteM, pBuffer->lSize + lSize
+        , &pBuffer->lMax, 1);
+    memcpy(pBuffer->byteM + pBuffer->lSize, pBytes, lSize);
+    pBuffer->lSize += lSize;
+}
+
+/******************** putBits **************************************
+void putBits(PackBuffer *pBuffer, unsigned int uValue, int iBits)
+Purpose:
+    Adds the low iBits bits of a value to a pack buffer.
+Parameters:
+    I/O PackBuffer *pBuffer         buffer to add to
+    I   unsigned int uValue         value (less than 1 << iBits)
+    I   int iBits                   bits to add, 0 to 31
+Returns:
+    n/a
+**************************************************************************/
+static void putBits(PackBuffer *pBuffer, unsigned int uValue, int iBits)
+{
+    unsigned char byte;
+
+    pBuffer->ullBits |= (unsigned long long) uValue << pBuffer->iBitCount;
+    pBuffer->iBitCount += iBits;
+    while (pBuffer->iBitCount >= 8)
+    {
+        byte = (unsigned char) pBuffer->ullBits;
+        addBytes(pBuffer, &byte, 1);
+        pBuffer->ullBits >>= 8;
+        pBuffer->iBitCount -= 8;
+    }
+}
+
+/******************** endBits **************************************
+void endBits(PackBuffer *pBuffer)
+Purpose:
+    Adds the bits still pending in a pack buffer, padded with zero bits
+    to a whole byte.
+Parameters:
+    I/O PackBuffer *pBuffer         buffer to finish
+Returns:
+    n/a
+**************************************************************************/
+static void endBits(PackBuffer *pBuffer)
+{
+    if (pBuffer->iBitCount > 0)
+        putBits(pBuffer, 0, 8 - pBuffer->iBitCount);
+    pBuffer->ullBits = 0;
+}
+
+/******************** getBits **************************************
+unsigned int getBits(unsigned char *pData, long lBit, int iBits)
+Purpose:
+    Gets a value packed by putBits.
+Parameters:
+    I   unsigned char *pData        start of the packed values.  At least
+                                    8 bytes follow the byte of lBit.
+    I   long lBit                   bit offset of the value
+    I   int iBits                   bits in the value, 0 to 31
+Returns:
+    The value.
+Notes:
+    - The 8 bytes are assembled a byte at a time, which compilers turn
+      into one load on a little endian machine.
+**************************************************************************/
+static inline unsigned int getBits(unsigned char *pData, long lBit, int iBits)
+{
+    unsigned char *p = pData + (lBit >> 3);
+    unsigned long long ullWord;
+
+    if (iBits == 0)
+        return 0;
+    ullWord = (unsigned long long) p[0] | (unsigned long long) p[1] << 8
+        | (unsigned long long) p[2] << 16 | (unsigned long long) p[3] << 24
+        | (unsigned long long) p[4] << 32 | (unsigned long long) p[5] << 40
+        | (unsigned long long) p[6] << 48 | (unsigned long long) p[7] << 56;
+    return (unsigned int) ((ullWord >> (lBit & 7)) & ((1ULL << iBits) - 1));
+}
+
+/******************** bitsFor **************************************
+int bitsFor(int iMax)
+Purpose:
+    Returns the number of bits needed for the values 0 through iMax.
+**************************************************************************/
+static int bitsFor(int iMax)
+{
+    int iBits = 0;
+
+    while (iBits < 31 && (iMax >> iBits) > 0)
+        iBits++;
+    return iBits;
+}
+
+/******************** packTrait **************************************
+void packTrait(CustomerSet customerSet, int iTrait, ColumnTrait *pTrait
+    , ColumnBlock blockM[], PackBuffer *pText, PackBuffer *pData)
+Purpose:
+    Builds the directory entry, dictionary, block summaries and packed
+    values of one trait.
+Parameters:
+    I   CustomerSet customerSet     customer set being written
+    I   int iTrait                  trait id
+    O   ColumnTrait *pTrait         directory entry (offsets not set)
+    O   ColumnBlock blockM[]        summary of each block.  lDataOffset
+                                    is the offset in pData.
+    O   PackBuffer *pText           value dictionary
+    O   PackBuffer *pData           packed values of every block, plus
+                                    8 zero bytes
+Returns:
+    n/a
+**************************************************************************/
+static void packTrait(CustomerSet customerSet, int iTrait, ColumnTrait *pTrait
+    , ColumnBlock blockM[], PackBuffer *pText, PackBuffer *pData)
+{
+    static char zeroM[8];
+    TraitColumn *pColumn = &customerSet->traitM[iTrait];
+    ColumnBlock *pBlock;
+    int iBlockCount = (customerSet->iCustomerCount + COLUMN_BLOCK_CUSTOMERS - 1)
+        / COLUMN_BLOCK_CUSTOMERS;
+    int iStart;
+    int iEnd;
+    int iCount;
+    int iCountBits;
+    int iIdBits;
+    int iBlock;
+    int iCustomer;
+    int i;
+
+    strcpy(pTrait->szTrait, pColumn->szTrait);
+    pTrait->iValueCount = pColumn->iValueCount;
+    pTrait->iMaxValues = pColumn->iMaxValues;
+    pTrait->iValueIdCount = pColumn->iOffsetM[customerSet->iCustomerCount];
+    for (i = 0; i < pColumn->iValueCount; i++)
+        addBytes(pText, pColumn->szValueM[i], strlen(pColumn->szValueM[i]) + 1);
+
+    for (iBlock = 0; iBlock < iBlockCount; iBlock++)
+    {
+        pBlock = &blockM[iBlock];
+        iStart = iBlock * COLUMN_BLOCK_CUSTOMERS;
+        iEnd = iStart + COLUMN_BLOCK_CUSTOMERS;
+        if (iEnd > customerSet->iCustomerCount)
+            iEnd = customerSet->iCustomerCount;
+
+        // summarize the block
+        pBlock->iFirstValueId = pColumn->iOffsetM[iStart];
+        pBlock->iValueIdCount = pColumn->iOffsetM[iEnd] - pColumn->iOffsetM[iStart];
+        pBlock->iMinCount = pColumn->iMaxValues;
+        pBlock->iMaxCount = 0;
+        pBlock->iMaxValueId = -1;
+        pBlock->ullAnyMask = 0;
+        pBlock->ullAllMask = ~0ULL;
+        for (iCustomer = iStart; iCustomer < iEnd; iCustomer++)
+        {
+            iCount = pColumn->iOffsetM[iCustomer + 1] - pColumn->iOffsetM[iCustomer];
+            if (iCount < pBlock->iMinCount)
+                pBlock->iMinCount = iCount;
+            if (iCount > pBlock->iMaxCount)
+                pBlock->iMaxCount = iCount;
+            pBlock->ullAnyMask |= pColumn->ullMaskM[iCustomer];
+            pBlock->ullAllMask &= pColumn->ullMaskM[iCustomer];
+        }
+        for (i = pColumn->iOffsetM[iStart]; i < pColumn->iOffsetM[iEnd]; i++)
+        {
+            if (pColumn->iValueIdM[i] > pBlock->iMaxValueId)
+                pBlock->iMaxValueId = pColumn->iValueIdM[i];
+        }
+
+        // pack its value counts, then its value ids
+        pBlock->lDataOffset = pData->lSize;
+        iCountBits = bitsFor(pBlock->iMaxCount - pBlock->iMinCount);
+        iIdBits = bitsFor(pBlock->iMaxValueId);
+        for (iCustomer = iStart; iCustomer < iEnd; iCustomer++)
+            putBits(pData, pColumn->iOffsetM[iCustomer + 1] - pColumn->iOffsetM[iCustomer]
+                - pBlock->iMinCount, iCountBits);
+        for (i = pColumn->iOffsetM[iStart]; i < pColumn->iOffsetM[iEnd]; i++)
+            putBits(pData, pColumn->iValueIdM[i], iIdBits);
+        endBits(pData);
+        pBlock->iDataSize = (int32_t) (pData->lSize - pBlock->lDataOffset);
+    }
+    pTrait->lDataSize = pData->lSize;
+    addBytes(pData, zeroM, sizeof(zeroM));     // getBits reads 8 bytes
+}
+
+/******************** writePart **************************************
+long writePart(FILE *pFile, void *pData, long lSize, long lOffset)
+Purpose:
+    Writes one part of a column file and pads it to 8 bytes.
+Parameters:
+    I   FILE *pFile                 file being written
+    I   void *pData                 bytes to write
+    I   long lSize                  number of bytes
+    I   long lOffset                offset in the file of pData
+Returns:
+    The offset of the next part.
+**************************************************************************/
+static long writePart(FILE *pFile, void *pData, long lSize, long lOffset)
+{
+    static char zeroM[8];
+    long lNext = COLUMN_ALIGN(lOffset + lSize);
+
+    if (lSize > 0 && fwrite(pData, 1, lSize, pFile) != (size_t) lSize)
+        ErrExit(ERR_COLUMN_FILE, "Unable to write a column file");
+    if (lNext > lOffset + lSize
+        && fwrite(zeroM, 1, lNext - lOffset - lSize, pFile) != (size_t) (lNext - lOffset - lSize))
+        ErrExit(ERR_COLUMN_FILE, "Unable to write a column file");
+    return lNext;
+}
+
+/******************** writeColumnFile **************************************
+void writeColumnFile(CustomerSet customerSet, char *pszFileName)
+Purpose:
+    Writes a customer set to a column file.
+Parameters:
+    I   CustomerSet customerSet     customers loaded with loadCustomers
+    I   char *pszFileName           name of the file to create
+Returns:
+    n/a
+Notes:
+    - Every trait is packed in memory first, so that the directory can
+      give the offset of each part.
+**************************************************************************/
+void writeColumnFile(CustomerSet customerSet, char *pszFileName)
+{
+    ColumnFileHeader header;
+    ColumnTrait *traitM;
+    ColumnBlock *blockM[MAX_TRAIT];
+    PackBuffer textM[MAX_TRAIT];
+    PackBuffer dataM[MAX_TRAIT];
+    FILE *pFile;
+    long lOffset;
+    int iBlockCount;
+    int iTrait;
+    int iBlock;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.szMagic, COLUMN_MAGIC, sizeof(header.szMagic));
+    header.iVersion = COLUMN_VERSION;
+    header.iBlockCustomers = COLUMN_BLOCK_CUSTOMERS;
+    header.iCustomerCount = customerSet->iCustomerCount;
+    header.iTraitCount = customerSet->iTraitCount;
+    iBlockCount = header.iBlockCount = (customerSet->iCustomerCount
+        + COLUMN_BLOCK_CUSTOMERS - 1) / COLUMN_BLOCK_CUSTOMERS;
+    header.lTraitOffset = COLUMN_ALIGN((long) sizeof(header));
+
+    traitM = calloc(customerSet->iTraitCount + 1, sizeof(ColumnTrait));
+    if (traitM == NULL)
+        ErrExit(ERR_COLUMN_FILE, "Unable to allocate a column file directory");
+    memset(textM, 0, sizeof(textM));
+    memset(dataM, 0, sizeof(dataM));
+
+    // pack every trait and give each part its offset
+    lOffset = COLUMN_ALIGN(header.lTraitOffset
+        + customerSet->iTraitCount * (long) sizeof(ColumnTrait));
+    for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+    {
+        blockM[iTrait] = calloc(iBlockCount + 1, sizeof(ColumnBlock));
+        if (blockM[iTrait] == NULL)
+            ErrExit(ERR_COLUMN_FILE, "Unable to allocate %d column blocks", iBlockCount);
+        packTrait(customerSet, iTrait, &traitM[iTrait], blockM[iTrait]
+            , &textM[iTrait], &dataM[iTrait]);
+        traitM[iTrait].lValueTextOffset = lOffset;
+        traitM[iTrait].lValueTextSize = textM[iTrait].lSize;
+        lOffset = COLUMN_ALIGN(lOffset + textM[iTrait].lSize);
+        traitM[iTrait].lBlockOffset = lOffset;
+        lOffset = COLUMN_ALIGN(lOffset + iBlockCount * (long) sizeof(ColumnBlock));
+        for (iBlock = 0; iBlock < iBlockCount; iBlock++)
+            blockM[iTrait][iBlock].lDataOffset += lOffset;
+        lOffset = COLUMN_ALIGN(lOffset + dataM[iTrait].lSize);
+    }
+
+    pFile = fopen(pszFileName, "wb");
+    if (pFile == NULL)
+        ErrExit(ERR_COLUMN_FILE, "Unable to create column file %s", pszFileName);
+    lOffset = writePart(pFile, &header, sizeof(header), 0);
+    lOffset = writePart(pFile, traitM
+        , customerSet->iTraitCount * sizeof(ColumnTrait), lOffset);
+    for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+    {
+        lOffset = writePart(pFile, textM[iTrait].byteM, textM[iTrait].lSize, lOffset);
+        lOffset = writePart(pFile, blockM[iTrait]
+            , iBlockCount * sizeof(ColumnBlock), lOffset);
+        lOffset = writePart(pFile, dataM[iTrait].byteM, dataM[iTrait].lSize, lOffset);
+        free(textM[iTrait].byteM);
+        free(dataM[iTrait].byteM);
+        free(blockM[iTrait]);
+    }
+    if (fclose(pFile) != 0)
+        ErrExit(ERR_COLUMN_FILE, "Unable to write column file %s", pszFileName);
+    free(traitM);
+}
+
+/******************** checkPart **************************************
+int checkPart(long lFileSize, int64_t lOffset, int64_t lCount, long lSize)
+Purpose:
+    Checks that a part of a column file is aligned and inside the file.
+Parameters:
+    I   long lFileSize              bytes in the file
+    I   int64_t lOffset             offset of the part
+    I   int64_t lCount              entries in the part
+    I   long lSize                  size of an entry
+Returns:
+    TRUE if the part is good.
+**************************************************************************/
+static int checkPart(long lFileSize, int64_t lOffset, int64_t lCount, long lSize)
+{
+    if (lOffset < (int64_t) sizeof(ColumnFileHeader) || lOffset % 8 != 0
+        || lOffset > lFileSize || lCount < 0)
+        return FALSE;
+    return lCount <= (lFileSize - lOffset) / lSize;
+}
+
+/******************** loadDictionary **************************************
+void loadDictionary(ColumnFile file, int iTrait)
+Purpose:
+    Copies a trait's entry of the directory and its value dictionary into
+    the file's customer set.
+Parameters:
+    I/O ColumnFile file             mapped file
+    I   int iTrait                  trait id
+Returns:
+    n/a
+Notes:
+    - Exits with ERR_COLUMN_FILE if the entry or dictionary is damaged.
+**************************************************************************/
+static void loadDictionary(ColumnFile file, int iTrait)
+{
+    ColumnTrait *pTrait = &file->traitM[iTrait];
+    TraitColumn *pColumn = &file->customerSet->traitM[iTrait];
+    char *pszText;
+    char *pszEnd;
+    int iLength;
+    int i;
+
+    if (memchr(pTrait->szTrait, '\0', sizeof(pTrait->szTrait)) == NULL
+        || pTrait->iValueCount < 0 || pTrait->iMaxValues < 0 || pTrait->iValueIdCount < 0
+        || !checkPart(file->lFileSize, pTrait->lValueTextOffset, pTrait->lValueTextSize, 1)
+        || !checkPart(file->lFileSize, pTrait->lBlockOffset, file->pHeader->iBlockCount
+            , sizeof(ColumnBlock)))
+        ErrExit(ERR_COLUMN_FILE, "Column file is damaged at trait %d", iTrait);
+    strcpy(pColumn->szTrait, pTrait->szTrait);
+    pColumn->iMaxValues = pTrait->iMaxValues;
+    pColumn->szValueM = malloc((pTrait->iValueCount + 1) * sizeof(Token));
+    if (pColumn->szValueM == NULL)
+        ErrExit(ERR_COLUMN_FILE, "Unable to allocate %d values of trait %s"
+            , pTrait->iValueCount, pTrait->szTrait);
+    pColumn->iValueMax = pTrait->iValueCount + 1;
+
+    pszText = file->pFile + pTrait->lValueTextOffset;
+    pszEnd = pszText + pTrait->lValueTextSize;
+    for (i = 0; i < pTrait->iValueCount; i++)
+    {
+        iLength = (int) strnlen(pszText, pszEnd - pszText);
+        if (pszText + iLength >= pszEnd || iLength > MAX_TOKEN)
+            ErrExit(ERR_COLUMN_FILE, "Column file is damaged at a value of trait %s"
+                , pTrait->szTrait);
+        memcpy(pColumn->szValueM[i], pszText, iLength + 1);
+        pszText += iLength + 1;
+    }
+    pColumn->iValueCount = pTrait->iValueCount;
+    file->blockM[iTrait] = (ColumnBlock *) (file->pFile + pTrait->lBlockOffset);
+    file->lBytesRead += sizeof(ColumnTrait) + pTrait->lValueTextSize;
+}
+
+/******************** openColumnFile **************************************
+ColumnFile openColumnFile(char *pszFileName)
+Purpose:
+    Maps a column file into memory and loads its value dictionaries.
+Parameters:
+    I   char *pszFileName           name of the file
+Returns:
+    The mapped file.  Use closeColumnFile to unmap it.
+Notes:
+    - The header and directory are checked so that a damaged or foreign
+      file is reported instead of being used.  The block summaries of a
+      trait are checked when a query first compares it.
+**************************************************************************/
+ColumnFile openColumnFile(char *pszFileName)
+{
+    ColumnFile file = calloc(1, sizeof(ColumnFileImp));
+    ColumnFileHeader *pHeader;
+    struct stat fileStat;
+    int iFd;
+    int i;
+
+    if (file == NULL)
+        ErrExit(ERR_COLUMN_FILE, "Unable to allocate a column file");
+    iFd = open(pszFileName, O_RDONLY);
+    if (iFd < 0 || fstat(iFd, &fileStat) != 0)
+        ErrExit(ERR_COLUMN_FILE, "Unable to open column file %s", pszFileName);
+    file->lFileSize = fileStat.st_size;
+    if (file->lFileSize < (long) sizeof(ColumnFileHeader))
+        ErrExit(ERR_COLUMN_FILE, "%s is not a column file", pszFileName);
+    file->pFile = mmap(NULL, file->lFileSize, PROT_READ, MAP_PRIVATE, iFd, 0);
+    close(iFd);
+    if (file->pFile == MAP_FAILED)
+        ErrExit(ERR_COLUMN_FILE, "Unable to map column file %s", pszFileName);
+
+    // check the header
+    pHeader = file->pHeader = (ColumnFileHeader *) file->pFile;
+    if (memcmp(pHeader->szMagic, COLUMN_MAGIC, sizeof(pHeader->szMagic)) != 0)
+        ErrExit(ERR_COLUMN_FILE, "%s is not a column file", pszFileName);
+    if (pHeader->iVersion != COLUMN_VERSION)
+        ErrExit(ERR_COLUMN_FILE, "%s is column file version %d, not %d"
+            , pszFileName, pHeader->iVersion, COLUMN_VERSION);
+    if (pHeader->iBlockCustomers <= 0 || pHeader->iCustomerCount < 0
+        || pHeader->iTraitCount < 0 || pHeader->iTraitCount > MAX_TRAIT
+        || pHeader->iBlockCount != (pHeader->iCustomerCount
+            + (long) pHeader->iBlockCustomers - 1) / pHeader->iBlockCustomers
+        || !checkPart(file->lFileSize, pHeader->lTraitOffset
+            , pHeader->iTraitCount, sizeof(ColumnTrait)))
+        ErrExit(ERR_COLUMN_FILE, "Column file %s is damaged", pszFileName);
+    file->traitM = (ColumnTrait *) (file->pFile + pHeader->lTraitOffset);
+    file->lBytesRead = sizeof(ColumnFileHeader);
+
+    // the customer set starts with only the dictionaries
+    file->customerSet = calloc(1, sizeof(CustomerSetImp));
+    if (file->customerSet == NULL)
+        ErrExit(ERR_COLUMN_FILE, "Unable to allocate a customer set");
+    file->customerSet->iCustomerCount = pHeader->iCustomerCount;
+    file->customerSet->iCustomerMax = pHeader->iCustomerCount + 1;
+    file->customerSet->iTraitCount = pHeader->iTraitCount;
+    for (i = 0; i < pHeader->iTraitCount; i++)
+        loadDictionary(file, i);
+    return file;
+}
+
+/******************** useTrait **************************************
+void useTrait(ColumnFile file, int iTrait)
+Purpose:
+    Allocates the columns of a trait the first time a query compares it,
+    and checks its block summaries.
+Parameters:
+    I/O ColumnFile file             mapped file
+    I   int iTrait                  trait id
+Returns:
+    n/a
+Notes:
+    - Exits with ERR_COLUMN_FILE if a block summary is damaged.
+**************************************************************************/
+static void useTrait(ColumnFile file, int iTrait)
+{
+    ColumnTrait *pTrait = &file->traitM[iTrait];
+    TraitColumn *pColumn = &file->customerSet->traitM[iTrait];
+    ColumnBlock *pBlock;
+    int iCustomerCount = file->pHeader->iCustomerCount;
+    int iBlockCount = file->pHeader->iBlockCount;
+    long lCustomers;
+    long lBits;
+    long lNextValueId = 0;
+    int iBlock;
+
+    if (file->bUnpackedM[iTrait] != NULL)
+        return;
+    for (iBlock = 0; iBlock < iBlockCount; iBlock++)
+    {
+        pBlock = &file->blockM[iTrait][iBlock];
+        lCustomers = iBlock < iBlockCount - 1 ? file->pHeader->iBlockCustomers
+            : iCustomerCount - (long) iBlock * file->pHeader->iBlockCustomers;
+        lBits = lCustomers * bitsFor(pBlock->iMaxCount - pBlock->iMinCount)
+            + (long) pBlock->iValueIdCount * bitsFor(pBlock->iMaxValueId);
+        if (pBlock->iFirstValueId != lNextValueId || pBlock->iValueIdCount < 0
+            || pBlock->iMinCount < 0 || pBlock->iMinCount > pBlock->iMaxCount
+            || pBlock->iMaxCount > pTrait->iMaxValues
+            || pBlock->iValueIdCount < lCustomers * pBlock->iMinCount
+            || pBlock->iValueIdCount > lCustomers * pBlock->iMaxCount
+            || pBlock->iMaxValueId < -1 || pBlock->iMaxValueId >= pTrait->iValueCount
+            || pBlock->iDataSize < 0 || lBits > 8L * pBlock->iDataSize
+            || pBlock->lDataOffset < pTrait->lBlockOffset
+            || pBlock->lDataOffset + pBlock->iDataSize + 8 > file->lFileSize)
+            ErrExit(ERR_COLUMN_FILE, "Column file is damaged at block %d of trait %s"
+                , iBlock, pTrait->szTrait);
+        lNextValueId += pBlock->iValueIdCount;
+    }
+    if (lNextValueId != pTrait->iValueIdCount)
+        ErrExit(ERR_COLUMN_FILE, "Column file is damaged at trait %s", pTrait->szTrait);
+    file->lBytesRead += iBlockCount * (long) sizeof(ColumnBlock);
+
+    pColumn->iOffsetM = malloc((iCustomerCount + 1) * sizeof(int));
+    pColumn->iValueIdM = malloc((pTrait->iValueIdCount + 1) * sizeof(int));
+    pColumn->ullMaskM = malloc((iCustomerCount + 1) * sizeof(unsigned long long));
+    file->bUnpackedM[iTrait] = calloc(iBlockCount + 1, sizeof(char));
+    if (pColumn->iOffsetM == NULL || pColumn->iValueIdM == NULL
+        || pColumn->ullMaskM == NULL || file->bUnpackedM[iTrait] == NULL)
+        ErrExit(ERR_COLUMN_FILE, "Unable to allocate the columns of trait %s"
+            , pTrait->szTrait);
+    pColumn->iValueIdCount = pColumn->iValueIdMax = pTrait->iValueIdCount;
+}
+
+/******************** unpackBlock **************************************
+void unpackBlock(ColumnFile file, int iTrait, int iBlock)
+Purpose:
+    Unpacks one block of a trait into the columns of the file's
+    customer set and builds the block's value masks.
+Parameters:
+    I/O ColumnFile file             mapped file
+    I   int iTrait                  trait id (useTrait was called)
+    I   int iBlock                  block number (0 is the first)
+Returns:
+    n/a
+**************************************************************************/
+static void unpackBlock(ColumnFile file, int iTrait, int iBlock)
+{
+    ColumnBlock *pBlock = &file->blockM[iTrait][iBlock];
+    TraitColumn *pColumn = &file->customerSet->traitM[iTrait];
+    unsigned char *pData = (unsigned char *) file->pFile + pBlock->lDataOffset;
+    int iStart = iBlock * file->pHeader->iBlockCustomers;
+    int iEnd = iStart + file->pHeader->iBlockCustomers;
+    int iCountBits = bitsFor(pBlock->iMaxCount - pBlock->iMinCount);
+    int iIdBits = bitsFor(pBlock->iMaxValueId);
+    unsigned long long ullMask;
+    int iCustomer;
+    int iValue;
+    long lBit = 0;
+    int i;
+
+    if (iEnd > file->pHeader->iCustomerCount)
+        iEnd = file->pHeader->iCustomerCount;
+    pColumn->iOffsetM[iStart] = pBlock->iFirstValueId;
+    for (iCustomer = iStart; iCustomer < iEnd; iCustomer++)
+    {
+        pColumn->iOffsetM[iCustomer + 1] = pColumn->iOffsetM[iCustomer]
+            + pBlock->iMinCount + getBits(pData, lBit, iCountBits);
+        lBit += iCountBits;
+    }
+    if (pColumn->iOffsetM[iEnd] != pBlock->iFirstValueId + pBlock->iValueIdCount)
+        ErrExit(ERR_COLUMN_FILE, "Column file is damaged at block %d of trait %s"
+            , iBlock, pColumn->szTrait);
+    for (i = pBlock->iFirstValueId; i < pColumn->iOffsetM[iEnd]; i++)
+    {
+        iValue = getBits(pData, lBit, iIdBits);
+        if (iValue > pBlock->iMaxValueId)
+            ErrExit(ERR_COLUMN_FILE, "Column file is damaged at block %d of trait %s"
+                , iBlock, pColumn->szTrait);
+        pColumn->iValueIdM[i] = iValue;
+        lBit += iIdBits;
+    }
+    for (iCustomer = iStart; iCustomer < iEnd; iCustomer++)
+    {
+        ullMask = 0;
+        for (i = pColumn->iOffsetM[iCustomer]; i < pColumn->iOffsetM[iCustomer + 1]; i++)
+        {
+            if (pColumn->iValueIdM[i] < MASK_VALUES)
+                ullMask |= 1ULL << pColumn->iValueIdM[i];
+            else
+                ullMask |= MASK_SPILL;
+        }
+        pColumn->ullMaskM[iCustomer] = ullMask;
+    }
+    file->bUnpackedM[iTrait][iBlock] = TRUE;
+    file->lBytesRead += pBlock->iDataSize;
+}
+
+/******************** decideComparison **************************************
+int decideComparison(ColumnFile file, Instr *pInstr, int iBlock)
+Purpose:
+    Determines from a block's summary whether a comparison is true for
+    every customer of the block, false for every one, or varies.
+Parameters:
+    I   ColumnFile file             mapped file
+    I   Instr *pInstr               comparison (useTrait was called for
+                                    its trait)
+    I   int iBlock                  block number (0 is the first)
+Returns:
+    TRUE, FALSE or SIMPLE_VARIES.
+Notes:
+    - A value id of at least MASK_VALUES is only known to be missing,
+      when no customer of the block spills or it is above iMaxValueId.
+**************************************************************************/
+static int decideComparison(ColumnFile file, Instr *pInstr, int iBlock)
+{
+    ColumnBlock *pBlock;
+    int bNone;                  // no customer has the value
+    int bAll;                   // every customer has the value
+
+    if (pInstr->iTrait < 0 || pInstr->iValue < 0)
+        return pInstr->iOp == OP_NOTANY;
+    pBlock = &file->blockM[pInstr->iTrait][iBlock];
+    if (pInstr->iValue < MASK_VALUES)
+    {
+        bNone = ((pBlock->ullAnyMask >> pInstr->iValue) & 1) == 0;
+        bAll = ((pBlock->ullAllMask >> pInstr->iValue) & 1) != 0;
+    }
+    else
+    {
+        bNone = (pBlock->ullAnyMask & MASK_SPILL) == 0
+            || pInstr->iValue > pBlock->iMaxValueId;
+        bAll = FALSE;
+    }
+    switch (pInstr->iOp)
+    {
+        case OP_NOTANY:
+            return bNone ? TRUE : bAll ? FALSE : SIMPLE_VARIES;
+        case OP_ONLY:
+            if (bNone || pBlock->iMinCount > 1)
+                return FALSE;
+            return bAll && pBlock->iMaxCount == 1 ? TRUE : SIMPLE_VARIES;
+        default:
+            return bNone ? FALSE : bAll ? TRUE : SIMPLE_VARIES;
+    }
+}
+
+/******************** decideBlock **************************************
+int decideBlock(ColumnFile file, Query query, int iBlock, int iStackM[])
+Purpose:
+    Evaluates a compiled query against the summaries of one block.
+Parameters:
+    I   ColumnFile file             mapped file
+    I   Query query                 compiled query
+    I   int iBlock                  block number (0 is the first)
+    I/O int iStackM[]               evaluation stack of at least
+                                    query->iMaxDepth entries
+Returns:
+    TRUE if every customer of the block matches, FALSE if none does, and
+    SIMPLE_VARIES otherwise.
+Notes:
+    - Jumps are not taken.  Without them a query gives the same result.
+**************************************************************************/
+static int decideBlock(ColumnFile file, Query query, int iBlock, int iStackM[])
+{
+    int iTop = 0;
+    int iLeft;
+    int iRight;
+    int i;
+    Instr *pInstr;
+
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        pInstr = &query->instrM[i];
+        switch (pInstr->iOp)
+        {
+            case OP_AND:
+                iTop--;
+                iLeft = iStackM[iTop - 1];
+                iRight = iStackM[iTop];
+                if (iLeft == FALSE || iRight == FALSE)
+                    iStackM[iTop - 1] = FALSE;
+                else if (iLeft != TRUE || iRight != TRUE)
+                    iStackM[iTop - 1] = SIMPLE_VARIES;
+                break;
+            case OP_OR:
+                iTop--;
+                iLeft = iStackM[iTop - 1];
+                iRight = iStackM[iTop];
+                if (iLeft == TRUE || iRight == TRUE)
+                    iStackM[iTop - 1] = TRUE;
+                else if (iLeft != FALSE || iRight != FALSE)
+                    iStackM[iTop - 1] = SIMPLE_VARIES;
+                break;
+            case OP_JUMP_FALSE:
+            case OP_JUMP_TRUE:
+                break;
+            default:
+                iStackM[iTop++] = decideComparison(file, pInstr, iBlock);
+        }
+    }
+    return iStackM[0];
+}
+
+/******************** countColumnFileMatches **************************************
+int countColumnFileMatches(ColumnFile file, Query query)
+Purpose:
+    Counts the customers of a column file that satisfy a compiled query.
+Parameters:
+    I/O ColumnFile file             mapped file
+    I   Query query                 query compiled against file->customerSet
+Returns:
+    Number of matching customers.
+Notes:
+    - Each block is first decided from its summaries (see note 3 above).
+      The customers of a block that varies are counted by countMatches
+      on a customer set that is a view of the block: its columns point
+      at the block's part of the file's columns.
+    - Only the traits the query compares are unpacked, so the view's
+      other columns are never used.
+**************************************************************************/
+int countColumnFileMatches(ColumnFile file, Query query)
+{
+    CustomerSetImp view;        // the customers of one block
+    CustomerSet customerSet = file->customerSet;
+    int bUsedM[MAX_TRAIT];      // TRUE if the query compares the trait
+    int iLocalM[EVAL_LOCAL_STACK];
+    int *iStackM = iLocalM;
+    int iBlockCustomers = file->pHeader->iBlockCustomers;
+    int iStart;
+    int iResult;
+    int iCount = 0;
+    int iBlock;
+    int iTrait;
+    int i;
+    Instr *pInstr;
+
+    memset(bUsedM, 0, sizeof(bUsedM));
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        pInstr = &query->instrM[i];
+        if (pInstr->iOp <= OP_ONLY && pInstr->iTrait >= 0 && pInstr->iValue >= 0)
+        {
+            bUsedM[pInstr->iTrait] = TRUE;
+            useTrait(file, pInstr->iTrait);
+        }
+    }
+    if (query->iMaxDepth > EVAL_LOCAL_STACK)
+    {
+        iStackM = malloc(query->iMaxDepth * sizeof(int));
+        if (iStackM == NULL)
+            ErrExit(ERR_COLUMN_FILE, "Unable to allocate an evaluation stack");
+    }
+
+    view = *customerSet;
+    for (iBlock = 0; iBlock < file->pHeader->iBlockCount; iBlock++)
+    {
+        iStart = iBlock * iBlockCustomers;
+        view.iCustomerCount = customerSet->iCustomerCount - iStart;
+        if (view.iCustomerCount > iBlockCustomers)
+            view.iCustomerCount = iBlockCustomers;
+        iResult = decideBlock(file, query, iBlock, iStackM);
+        if (iResult != SIMPLE_VARIES)
+        {
+            file->lBlocksSkipped++;
+            if (iResult)
+                iCount += view.iCustomerCount;
+            continue;
+        }
+        for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+        {
+            if (!bUsedM[iTrait])
+                continue;
+            if (!file->bUnpackedM[iTrait][iBlock])
+                unpackBlock(file, iTrait, iBlock);
+            view.traitM[iTrait].iOffsetM = customerSet->traitM[iTrait].iOffsetM + iStart;
+            view.traitM[iTrait].ullMaskM = customerSet->traitM[iTrait].ullMaskM + iStart;
+        }
+        iCount += countMatches(query, &view);
+        file->lBlocksEvaluated++;
+    }
+    if (iStackM != iLocalM)
+        free(iStackM);
+    return iCount;
+}
+
+/******************** closeColumnFile **************************************
+void closeColumnFile(ColumnFile file)
+Purpose:
+    Unmaps a column file and frees its customer set.
+Parameters:
+    I/O ColumnFile file             file to close
+Returns:
+    n/a
+**************************************************************************/
+void closeColumnFile(ColumnFile file)
+{
+    int i;
+
+    for (i = 0; i < MAX_TRAIT; i++)
+        free(file->bUnpackedM[i]);
+    freeCustomerSet(file->customerSet);
+    munmap(file->pFile, file->lFileSize);
+    free(file);
+}
@@ -0,0 +1,119 @@
+/**********************************************************************
+cs2123p1Column.h
+Purpose:
+   Defines constants:
+       error constant for column files
+       magic number and version of the column file format
+       customers per block
+   Defines typedef for
+       ColumnFileHeader    (start of a column file)
+       ColumnTrait         (one entry in the file's trait directory)
+       ColumnBlock         (summary and location of one block of a trait)
+       ColumnFileImp       (column file mapped into memory)
+       ColumnFile          (pointer to a ColumnFileImp)
+Notes:
+   - A column file holds a customer trait dataset by trait, so that a
+     query only reads the traits it compares.  Its parts are, each
+     starting on an 8 byte boundary:
+         ColumnFileHeader
+         ColumnTrait      traitM[iTraitCount]
+         and for each trait:
+             char         valueTextM[]  (the value dictionary, each value
+                                         zero terminated, in value id order)
+             ColumnBlock  blockM[iBlockCount]
+             unsigned char dataM[]      (packed values of every block,
+                                         followed by 8 zero bytes)
+   - Every block has COLUMN_BLOCK_CUSTOMERS customers, except the last.
+     Its data is the number of values of each customer minus iMinCount,
+     in just enough bits for iMaxCount - iMinCount, then its value ids in
+     just enough bits for iMaxValueId.  Bits are packed from the low bit
+     of each byte up.
+   - ullAnyMask and ullAllMask are the OR and the AND of the value masks
+     (see cs2123p1Eval.h) of the block's customers.  With iMinCount and
+     iMaxCount they decide many comparisons for a whole block.
+   - The integers are written in the byte order of the machine writing
+     the file.  A file whose header does not match the reading program
+     is rejected.
+   - Include cs2123p1.h and cs2123p1Eval.h before this file.
+**********************************************************************/
+#include <stdint.h>
+
+/*** constants ***/
+#define ERR_COLUMN_FILE    911      // unable to read or write a column file
+
+#define COLUMN_MAGIC "CS2123CF"     // first 8 bytes of a column file
+#define COLUMN_VERSION 1            // changed whenever the format changes
+#define COLUMN_BLOCK_CUSTOMERS 4096 // customers in each block of a trait
+
+/*** typedef ***/
+
+// ColumnFileHeader typedef is the start of a column file.  The offsets
+// are from the start of the file.
+typedef struct
+{
+    char szMagic[8];                // COLUMN_MAGIC (not zero terminated)
+    int32_t iVersion;               // COLUMN_VERSION
+    int32_t iBlockCustomers;        // COLUMN_BLOCK_CUSTOMERS of the writer
+    int32_t iCustomerCount;
+    int32_t iTraitCount;            // entries in traitM
+    int32_t iBlockCount;            // blocks of every trait
+    int32_t iPad;                   // always 0
+    int64_t lTraitOffset;           // offset of traitM
+} ColumnFileHeader;
+
+// ColumnTrait typedef is one entry in the trait directory
+typedef struct
+{
+    char szTrait[MAX_TOKEN + 1];    // zero terminated trait type
+    char szPad[8 - (MAX_TOKEN + 1) % 8];    // always 0
+    int32_t iValueCount;            // values in the dictionary
+    int32_t iMaxValues;             // most values any one customer has
+    int32_t iValueIdCount;          // value ids of every customer
+    int32_t iPad;                   // always 0
+    int64_t lValueTextOffset;       // offset of valueTextM
+    int64_t lValueTextSize;         // bytes in valueTextM
+    int64_t lBlockOffset;           // offset of blockM
+    int64_t lDataSize;              // bytes in dataM, without the 8 zero bytes
+} ColumnTrait;
+
+// ColumnBlock typedef summarizes one block of a trait and locates its data
+typedef struct
+{
+    int64_t lDataOffset;            // offset of the block's packed values
+    int32_t iDataSize;              // bytes of packed values
+    int32_t iFirstValueId;          // value ids of the earlier blocks
+    int32_t iValueIdCount;          // value ids of the block's customers
+    int32_t iMinCount;              // fewest values a customer has
+    int32_t iMaxCount;              // most values a customer has
+    int32_t iMaxValueId;            // highest value id, -1 if none
+    uint64_t ullAnyMask;            // OR of the customers' value masks
+    uint64_t ullAllMask;            // AND of the customers' value masks
+} ColumnBlock;
+
+// ColumnFileImp typedef is a column file mapped into memory.  Its
+// customer set has every dictionary; a trait's columns are allocated
+// when a query first compares it, and a block is unpacked into them
+// when a query first needs its customers.
+typedef struct
+{
+    char *pFile;                    // start of the mapped file
+    long lFileSize;                 // bytes mapped
+    ColumnFileHeader *pHeader;
+    ColumnTrait *traitM;
+    ColumnBlock *blockM[MAX_TRAIT]; // blocks of each trait
+    CustomerSet customerSet;        // dictionaries and unpacked blocks
+    char *bUnpackedM[MAX_TRAIT];    // TRUE for each unpacked block of a trait
+    long lBytesRead;                // bytes of the file used so far
+    long lBlocksSkipped;            // blocks decided by their summaries
+    long lBlocksEvaluated;          // blocks whose customers were evaluated
+} ColumnFileImp;
+
+// ColumnFile typedef defines a pointer to a mapped column file
+typedef ColumnFileImp *ColumnFile;
+
+/**********   prototypes ***********/
+
+void writeColumnFile(CustomerSet customerSet, char *pszFileName);
+ColumnFile openColumnFile(char *pszFileName);
+int countColumnFileMatches(ColumnFile file, Query query);
+void closeColumnFile(ColumnFile file);
@@ -2,11 +2,53 @@
 cs2123p1Driver.c by Larry Clark
 Purpose:
     This program reads queries and converts them from infix to postfix. 
+    If a customer file is given, each query is also evaluated against
+    the customers.
 Command Parameters:
-    n/a
+    p1 [-f format] [-t threads] [-c entries] [-s statsFile] [-b] [-S format]
+       [-w postfixFile | -r postfixFile] [-u updateFile] [-m recordFile]
+       [-K columnFile] [-k columnFile | customerFile]
+        -f format    - output format: text (the default), postfix or json
+        -t threads   - number of threads converting queries (default 1).
+                       A single very large query is also converted on
+                       this many threads (see cs2123p1Parallel.c).
+        -c entries   - cache up to this many converted queries (default 0,
+                       no cache).  The cache counts are written to stderr.
+        -s statsFile - value statistics used to optimize queries.  They are
+                       read from the file if it exists; otherwise they are
+                       collected from the customer file and written to it.
+        -b           - batch mode: evaluate the subexpressions shared by
+                       the queries of each chunk once (needs customerFile,
+                       ignores -t).  The sharing factor, and the chunks
+                       sharing too little that were evaluated a query at
+                       a time, are written to stderr.
+        -S format    - write conversion statistics (see cs2123p1Stats.c) to
+                       stderr as text or json at exit and on SIGUSR1.  Only
+                       in programs compiled with -DCS2123P1_STATS.
+        -w postfixFile - also save the converted queries in a postfix file
+                       (see cs2123p1Store.c).  Ignores -t and -b.
+        -r postfixFile - take the queries from a postfix file instead of
+                       converting stdin.  Ignores -t, -c and -b.
+        -u updateFile - standing query mode (needs customerFile): the
+                       queries are registered as standing queries and the
+                       customer updates in updateFile are applied in order
+                       (see cs2123p1Standing.c).  Ignores the other options.
+        -m recordFile - match mode: each record of recordFile (in the
+                       customer file format) is matched against all of the
+                       queries with the match index (see cs2123p1Match.c).
+                       Ignores the other options and customerFile.
+        -K columnFile - also save the customers of customerFile in a
+                       column file (see cs2123p1Column.c).
+        -k columnFile - take the customers from a column file instead of a
+                       customer file.  Only the traits and blocks a query
+                       needs are read; the bytes read and the blocks
+                       skipped are written to stderr.  Ignores -t, -s
+                       and -b, and cannot be used with -u.
+        customerFile - optional customer trait dataset (see cs2123p1Eval.c)
 Input:
     The standard input file stream contains queries (one per input text line).
-    Tokens in the query will be separated by one space.
+    Tokens in the query will be separated by white space.  Lines may be of
+    any length.
     Some sample data:
         SMOKING = N AND GENDER = F
         SMOKING = N AND ( EXERCISE = HIKE OR EXERCISE = BIKE )
@@ -16,16 +58,46 @@ Input:
         ( ( ( BOOK ONLY SCIFI ) ) )
 Results:
     For each query, print the query and its corresponding prefix expression.
+    With a customer file, also print the number of matching customers,
+    counted with the bitmap index built by cs2123p1Index.c.  Queries are
+    simplified by cs2123p1Simplify.c and optimized by cs2123p1Optimize.c
+    before they are evaluated.  A query that simplifies to true or false
+    is counted without the index.  With -k, queries are simplified and
+    counted by cs2123p1Column.c.
+    The postfix format prints one tab separated line per query:
+        query number, return code, postfix[, matching customers]
+    The json format prints one JSON object per query.
+    Output is collected in a large buffer and written a block at a time.
+    With more than one thread the output is the same as with one.
+    The query cache (cs2123p1Cache.c) does not change the output.
+    The output of -r postfixFile is the same as the output of the run that
+    wrote it with -w.
+    With -u, each line of updateFile is a customer number (1 is the first
+    customer in customerFile) followed by TRAIT=VALUE fields, for example
+        17 SMOKING=N EXERCISE=SWIM
+    For every standing query an update makes the customer enter or leave,
+    one tab separated line is printed:
+        query number, customer number, enter or leave
+    The output with -k columnFile is the same as with the customerFile
+    it was written from.
+    With -m, one line is printed for each record: the record number (1 is
+    the first), a tab and the numbers of the matching queries in
+    ascending order, separated by spaces.
 Returns:
     0 - normal
     901 - stack usage error (e.g., popping an empty stack)
-    902 - Out overflow
+    902 - unable to allocate Out
     903 - algorithm error (see message for details)
 Notes:
-    1. This program uses an array to implement the stack.  It has a maximum of
-       MAX_STACK_ELEM elements. 
-    2. This program uses an Out array for the resulting postfix expression.
-       It has a maximum of MAX_OUT_ITEM elements. 
+    1. The stack, Out, symbol table and buffering functions are in
+       cs2123p1Lib.c.  The stack and Out arrays grow as needed.
+    2. Compile with:
+           gcc -pthread -o p1 cs2123p1Driver.c cs2123p1Lib.c cs2123p1.c cs2123p1Eval.c \
+               cs2123p1Index.c cs2123p1Cache.c cs2123p1Optimize.c cs2123p1Batch.c \
+               cs2123p1Stats.c cs2123p1Store.c cs2123p1Standing.c \
+               cs2123p1Match.c cs2123p1Parallel.c cs2123p1Simplify.c \
+               cs2123p1Column.c
+       Add -DCS2123P1_STATS for the -S option.
 *******************************************************************************/
 // If compiling using visual studio, tell the compiler not to give its warnings
 // about the safety of scanf and printf
@@ -33,371 +105,1087 @@ Notes:
 
 #include <stdio.h>
 #include <string.h>
-#include <stdarg.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+#include "cs2123p1Cache.h"
+#include "cs2123p1Stats.h"
+#include "cs2123p1Store.h"
+#include "cs2123p1Column.h"
 
-// the following structure is used by the categorize function to categorize 
-// tokens
-static struct
-{
-    char szSymbol[MAX_TOKEN + 1];
-    int iCategory;
-    int iPrecedence;
-} symbolDefM[] =
-{
-    "(",        CAT_LPAREN,   0
-    , ")",      CAT_RPAREN,   0
-    , "=",      CAT_OPERATOR, 2
-    , "NOTANY", CAT_OPERATOR, 2
-    , "ONLY",   CAT_OPERATOR, 2
-    , "AND",    CAT_OPERATOR, 1
-    , "OR",     CAT_OPERATOR, 1
-    , "", 0, 0					// null terminating
-};
-
-// Stack implementation using arrays.  You are not required to document these.
-/************************* push ***************************************
-void push(Stack stack, Element value)
+// options set from the command line by main
+static int iFormat = FORMAT_TEXT;               // FORMAT_TEXT, _POSTFIX or _JSON
+static CustomerSet customerSet = NULL;          // optional customer data
+static CustomerIndex customerIndex = NULL;      // bitmap index of customerSet
+static QueryStats queryStats = NULL;            // value statistics of customerSet
+static QueryCache queryCache = NULL;            // optional cache of converted queries
+static int bBatch = FALSE;                      // TRUE to share work across queries
+static long lBatchInstrCount = 0;               // instructions in batched queries
+static long lBatchNodeCount = 0;                // distinct nodes evaluated for them
+static int iBatchCount = 0;                     // chunks evaluated in batch mode
+static int iBatchPerQueryCount = 0;             // those sharing too little, counted
+                                                // a query at a time
+static int iStatsFormat = 0;                    // -S format, 0 for no statistics
+static PostfixWriter postfixWriter = NULL;      // saves the queries for -w
+static int iLargeThreads = 1;                   // threads converting one large query
+static ColumnFile columnFile = NULL;            // -k customers (customerSet is its set)
+
+/******************** formatResult **************************************
+void formatResult(OutputBuffer output, Out out, int iQuery, char *pszLine
+    , int bNewline, int rc, int iMatches)
 Purpose:
-   This function places an object into an array.  It is designed
-   to operate like a stack call.  The object is pushed onto the
-   top of the stack.
+    Formats the result of one query in the selected output format.
 Parameters:
-   I/O Stack stack             A pointer to a stackImp structure
-   I   Element value           A structure with data to be stacked
+    O   OutputBuffer output     where the results are formatted
+    I   Out out                 postfix expression of the query
+    I   int iQuery              query number (1 is the first)
+    I   char *pszLine           zero terminated query text
+    I   int bNewline            TRUE if the query line ended with a newline
+    I   int rc                  return code of convertToPostFix
+    I   int iMatches            matching customers, -1 if the query
+                                cannot be evaluated
 Returns:
-   Nothing is returned functionally.  A new element is added into
-   an array (which we will call a stack).
+    n/a
 Notes:
-   This function takes a pointer to a stackImp structure which
-   as a member has an array of Element structures.  First, it 
-   ensures that the call will not overflow the stack (i.e., number
-   of elements in stack->element[] does not exceed allowed).  
-   Program aborts if stack is full and cannot take additional
-   elements (i.e., prevent stack overflow).  If stack is not full
-   a new element is pushed on a stack and stack counter (array count)
-   is incremented.
-**********************************************************************/
-void push(Stack stack, Element value)
+    - FORMAT_TEXT output is the same as printing the query header with
+      printf and calling printOut.
+    - FORMAT_POSTFIX output is the query number, return code and postfix
+      separated by tabs, plus the matching customer count when there is
+      customer data.  The postfix is empty if the conversion failed.
+    - FORMAT_JSON output is one object per query with the fields query,
+      text, rc, postfix and (with customer data) matches.  matches is -1
+      if the query cannot be evaluated.
+**************************************************************************/
+static void formatResult(OutputBuffer output, Out out, int iQuery, char *pszLine
+    , int bNewline, int rc, int iMatches)
 {
-    if (stack->iCount >= MAX_STACK_ELEM)
-        ErrExit(ERR_STACK_USAGE
-        , "Attempt to PUSH more than %d values on the array stack"
-        , MAX_STACK_ELEM);
-    else
+    int i;
+
+    switch (iFormat)
     {
-        stack->stackElementM[stack->iCount] = value;
-        stack->iCount++;
+        case FORMAT_POSTFIX:
+            outputInt(output, iQuery);
+            outputText(output, "\t", 1);
+            outputInt(output, rc);
+            outputText(output, "\t", 1);
+            if (rc == 0)
+                formatOut(output, out, FORMAT_POSTFIX);
+            if (customerSet != NULL)
+            {
+                outputText(output, "\t", 1);
+                outputInt(output, iMatches);
+            }
+            outputText(output, "\n", 1);
+            break;
+        case FORMAT_JSON:
+            outputString(output, "{\"query\":");
+            outputInt(output, iQuery);
+            outputString(output, ",\"text\":");
+            outputJsonString(output, pszLine, (int) strlen(pszLine));
+            outputString(output, ",\"rc\":");
+            outputInt(output, rc);
+            outputString(output, ",\"postfix\":[");
+            for (i = 0; rc == 0 && i < out->iOutCount; i++)
+            {
+                if (i > 0)
+                    outputText(output, ",", 1);
+                outputJsonString(output, getSymbolText(out->outM[i].iSymbol)
+                    , getSymbolLength(out->outM[i].iSymbol));
+            }
+            outputText(output, "]", 1);
+            if (customerSet != NULL)
+            {
+                outputString(output, ",\"matches\":");
+                outputInt(output, iMatches);
+            }
+            outputString(output, "}\n");
+            break;
+        default:
+            outputString(output, "Query # ");
+            outputInt(output, iQuery);
+            outputString(output, ": ");
+            outputString(output, pszLine);
+            if (bNewline)
+                outputText(output, "\n", 1);
+            switch (rc)
+            {
+                case 0:
+                    formatOut(output, out, FORMAT_TEXT);
+                    if (customerSet == NULL)
+                        break;
+                    if (iMatches < 0)
+                        outputString(output, "\tWarning: query cannot be evaluated\n");
+                    else
+                    {
+                        outputString(output, "\tMatching customers: ");
+                        outputInt(output, iMatches);
+                        outputText(output, "\n", 1);
+                    }
+                    break;
+                case WARN_MISSING_LPAREN:
+                    outputString(output, "\tWarning: missing left parenthesis\n");
+                    break;
+                case WARN_MISSING_RPAREN:
+                    outputString(output, "\tWarning: missing right parenthesis\n");
+                    break;
+                default:
+                    outputString(output, "\t warning = ");
+                    outputInt(output, rc);
+                    outputText(output, "\n", 1);
+            }
     }
 }
-/********************************* pop *******************************
-Element pop(Stack stack)
+
+/******************** convertQuery **************************************
+int convertQuery(Out out, char *pszLine)
 Purpose:
-   Function simulates the stack operation pop which removes the top
-   object from a stack.  In this case an array is used to represent
-   the stack.
+    Converts one query to postfix, using the query cache if there is one.
 Parameters:
-   I/O Stack stack          A pointer to a stackImp structure
+    O   Out out                 receives the postfix expression
+    I   char *pszLine           zero terminated query text
 Returns:
-   The top element structure on the stack is returned.
+    The return code of convertToPostFix.
 Notes:
-   First, the function calls isEmpty(stack) is called to determine
-   if the stack is empty.  This prevents a stack condition known as
-   underflow.  If an underflow or empty stack is encountered, the 
-   program terminates.  If an underflow condition is not possible,
-   the program decrements iCount (count of array) and returns the
-   top element on the stack.  The function push() increments iCount
-   after adding a new element to the stack which means that iCount
-   is actually pointing to an empty array element.  This is the 
-   reason it is decremented first.
-*********************************************************************/
-Element pop(Stack stack)
+    - The conversion is timed by the caller: processQuery, or
+      convertTimedQuery.
+**************************************************************************/
+static int convertQuery(Out out, char *pszLine)
 {
-    if (isEmpty(stack))
-        ErrExit(ERR_STACK_USAGE
-        , "Attempt to POP an empty array stack");
+    int rc;
+
+    resetOut(out);   // reset out to empty
+    if (queryCache != NULL)
+        rc = convertCached(queryCache, pszLine, out);
+    else if (iLargeThreads > 1)
+        rc = convertToPostFixParallel(pszLine, out, iLargeThreads);
     else
-    {
-        stack->iCount--;
-        return stack->stackElementM[stack->iCount];
-    }
+        rc = convertToPostFix(pszLine, out);
+    STATS_QUERY_DONE(rc, out->iOutCount);
+    return rc;
 }
-/****************************** topElement ******************************
-Element topElement(Stack stack)
+
+#ifdef CS2123P1_STATS
+/******************** convertsDirectly **************************************
+int convertsDirectly(char *pszLine)
 Purpose:
-   Function returns the top object (element) on the stack.
+    Determines whether convertQuery converts a query with convertToPostFix
+    itself, so the phases of its conversion can be sampled.
 Parameters:
-   I Stack stack            A pointer to a stackImp structure
+    I   char *pszLine           zero terminated query text
 Returns:
-   Functionally, it returns the top element from the stack.
-Notes:
-   First, the function isEmpty(stack) is called to ensure the stack 
-   is not empty.  If isEmpty returns FALSE the top element of the 
-   stack is returned.  The variable iCount always points to an
-   empty array element.  When it is decremented it points to the top
-   of the stack.  In the case of this function, the top element is 
-   returned without it being removed from the stack.  This is achieved
-   by subtracting one from iCount ensuring it is not permanently 
-   decremented.
-************************************************************************/ 
-Element topElement(Stack stack)
+    TRUE if it does, FALSE if the query cache or the threads of
+    convertToPostFixParallel convert it.
+**************************************************************************/
+static int convertsDirectly(char *pszLine)
 {
-    if (isEmpty(stack))
-        ErrExit(ERR_STACK_USAGE
-        , "Attempt to examine topElement of an empty array stack");
-    else
-        return stack->stackElementM[stack->iCount-1];    // return the top
+    return queryCache == NULL
+        && (iLargeThreads <= 1 || strlen(pszLine) < PARALLEL_MIN_TEXT);
 }
-/****************************** isEmpty(Stack stack) ******************************
-int isEmpty(Stack stack)
+#endif
+
+/******************** convertTimedQuery **************************************
+int convertTimedQuery(Out out, char *pszLine)
 Purpose:
-   Function determines if a given stack is empty.
+    convertQuery, counting the conversion in PHASE_CONVERT.
 Parameters:
-   Stack stack             A pointer to a stackImp structure
+    O   Out out                 receives the postfix expression
+    I   char *pszLine           zero terminated query text
 Returns:
-   An integer value is returned corresponding to TRUE or FALSE.  Any non-zero
-   integer is considered TRUE in C.
-Notes:
-   If stack is empty an integer value corresponding to TRUE is returned else FALSE
-   is returned.  If the array counter iCount is less than or equal to zero, TRUE
-   is returned indicating the stack is empty otherwise FALSE is returned and the
-   stack is not empty.
-**********************************************************************************/
-int isEmpty(Stack stack)
+    The return code of convertToPostFix.
+**************************************************************************/
+static int convertTimedQuery(Out out, char *pszLine)
 {
-    return stack->iCount <= 0;
+    int rc;
+    STATS_DECLARE(ullTicks);
+
+    STATS_MARK_START();
+    STATS_MARKED(ullTicks);
+    rc = convertQuery(out, pszLine);
+    STATS_MARK(PHASE_CONVERT);
+    STATS_SAMPLE_PHASES(convertsDirectly(pszLine), pszLine, ullTicks);
+    return rc;
 }
-Stack newStack()
+
+/******************** countQuery **************************************
+int countQuery(Query query, Arena arena)
+Purpose:
+    Simplifies and optimizes a compiled query and counts the customers
+    matching it.
+Parameters:
+    I/O Query query             query from compileQuery
+    I/O Arena arena             arena for the work areas
+Returns:
+    The number of matching customers.
+Notes:
+    - The customers of a column file are counted from the file without
+      optimizing, since there are no statistics for it.
+**************************************************************************/
+static int countQuery(Query query, Arena arena)
 {
-    Stack stack = (Stack) malloc(sizeof(StackImp));
-    stack->iCount = 0;
-    return stack;
+    int iResult = simplifyQuery(query, customerSet, arena);
+
+    if (iResult != SIMPLE_VARIES)
+        return iResult ? customerSet->iCustomerCount : 0;
+    if (columnFile != NULL)
+        return countColumnFileMatches(columnFile, query);
+    optimizeQuery(query, queryStats, arena);
+    return countIndexMatches(query, customerIndex);
 }
-void freeStack(Stack stack)
+
+/******************** processQuery **************************************
+void processQuery(OutputBuffer output, Out out, Query query, int iQuery
+    , char *pszLine, int bNewline)
+Purpose:
+    Converts one query to postfix, evaluates it if customer data was
+    given, and formats the result in the selected output format.
+Parameters:
+    O   OutputBuffer output     where the results are formatted
+    I/O Out out                 work area for the postfix expression
+    I/O Query query             work area for the compiled query
+    I   int iQuery              query number (1 is the first)
+    I   char *pszLine           zero terminated query text
+    I   int bNewline            TRUE if the query line ended with a newline
+Returns:
+    n/a
+Notes:
+    - The caller starts the query with STATS_MARK_START or STATS_MARK, so
+      the end of one phase is the start of the next.
+**************************************************************************/
+static void processQuery(OutputBuffer output, Out out, Query query, int iQuery
+    , char *pszLine, int bNewline)
 {
-    free (stack);
+    int rc;
+    int iMatches = -1;
+    STATS_DECLARE(ullQueryTicks);
+
+    STATS_MARKED(ullQueryTicks);
+    rc = convertQuery(out, pszLine);
+    STATS_MARK(PHASE_CONVERT);
+    STATS_SAMPLE_PHASES(convertsDirectly(pszLine), pszLine, ullQueryTicks);
+    if (postfixWriter != NULL)
+    {
+        addPostfixQuery(postfixWriter, out, rc, pszLine, bNewline);
+        STATS_MARK_START();
+    }
+    if (rc == 0 && customerSet != NULL && compileQuery(out, customerSet, query) == 0)
+    {
+        iMatches = countQuery(query, out->arena);
+        STATS_MARK(PHASE_EVALUATE);
+    }
+    formatResult(output, out, iQuery, pszLine, bNewline, rc, iMatches);
+    STATS_MARK(PHASE_FORMAT);
+    STATS_MARK_TOTAL(PHASE_QUERY, ullQueryTicks);
+    STATS_POLL();
 }
 
+/******************** processStoredQueries **************************************
+void processStoredQueries(OutputBuffer output, Out out, Query query
+    , PostfixFile file)
+Purpose:
+    Evaluates and formats every query of a postfix file, as processQuery
+    does for the queries it converts.
+Parameters:
+    O   OutputBuffer output     where the results are formatted
+    I/O Out out                 supplies the arena used for work areas
+    I/O Query query             work area for the compiled query
+    I   PostfixFile file        queries saved with -w
+Returns:
+    n/a
+Notes:
+    - The postfix of each query is used where it is in the mapped file.
+**************************************************************************/
+static void processStoredQueries(OutputBuffer output, Out out, Query query
+    , PostfixFile file)
+{
+    OutImp view;                // postfix of one query, in the file
+    char *pszLine;
+    int bNewline;
+    int rc;
+    int iMatches;
+    int i;
 
-// Main program for the driver
+    for (i = 0; i < file->pHeader->iQueryCount; i++)
+    {
+        resetOut(out);
+        view.arena = out->arena;
+        rc = getPostfixQuery(file, i, &view, &pszLine, &bNewline);
+        iMatches = -1;
+        if (rc == 0 && customerSet != NULL && compileQuery(&view, customerSet, query) == 0)
+            iMatches = countQuery(query, view.arena);
+        formatResult(output, &view, i + 1, pszLine, bNewline, rc, iMatches);
+    }
+}
 
-int main(int argc, char *argv[])
+/******************** processUpdates **************************************
+void processUpdates(LineReader reader, OutputBuffer output, FILE *pUpdateFile)
+Purpose:
+    Registers the queries as standing queries, then applies each customer
+    update and prints the standing queries the customer enters or leaves.
+Parameters:
+    I/O LineReader reader       input reader (the queries)
+    O   OutputBuffer output     where the events are formatted
+    I   FILE *pUpdateFile       customer updates, one per line
+Returns:
+    n/a
+Notes:
+    - Queries that do not convert or compile are numbered but not
+      registered.  The counts of registered queries and of queries
+      evaluated by the updates are written to stderr.
+**************************************************************************/
+static void processUpdates(LineReader reader, OutputBuffer output, FILE *pUpdateFile)
 {
-    Out out = malloc(sizeof(OutImp));
-    char szInputBuffer[100];    // entire input line
-    int rc;
-    int icount = 1;
-    
-    // read text lines containing queries until EOF
-	// in this case fgets will copy over up to 99 chars from
-	// stdin stream and store them into szInputBuffer
-    while (fgets(szInputBuffer, 100, stdin) != NULL)
+    StandingSet set = newStandingSet(customerSet);
+    LineReader updateReader = newLineReader(pUpdateFile);
+    Out out = newOut();
+    Query query = newQuery();
+    int *iLineM = NULL;         // query number of each standing query
+    int iLineMax = 0;
+    int iStanding;
+    int iQuery = 1;
+    int iUpdate = 0;
+    int iCustomer;
+    int iLineLength;
+    int bNewline;
+    char *pszLine;
+    char *pszFields;
+    StandingEvent *pEvent;
+    int i;
+
+    while ((pszLine = readLine(reader, &iLineLength, &bNewline)) != NULL)
     {
-        printf("Query # %d: %s", icount, szInputBuffer);
-        out->iOutCount = 0;   // reset out to empty
-        rc = convertToPostFix(szInputBuffer, out);
-        switch (rc)
+        iStanding = -1;
+        if (convertTimedQuery(out, pszLine) == 0)
+            iStanding = addStandingQuery(set, out, query);
+        if (iStanding >= iLineMax)
         {
-            case 0:
-                printOut(out);
-                break;
-            case WARN_MISSING_LPAREN:
-                printf("\tWarning: missing left parenthesis\n");
-                break;
-            case WARN_MISSING_RPAREN:
-                printf("\tWarning: missing right parenthesis\n");
-                break;
-            default:
-                printf("\t warning = %d\n", rc);
+            iLineMax = iLineMax > 0 ? iLineMax * 2 : 256;
+            iLineM = realloc(iLineM, iLineMax * sizeof(int));
+            if (iLineM == NULL)
+                ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d standing queries", iLineMax);
         }
-        icount++;
+        if (iStanding >= 0)
+            iLineM[iStanding] = iQuery;
+        iQuery++;
     }
-    free(out);
-    printf("\n");
+
+    while ((pszLine = readLine(updateReader, &iLineLength, &bNewline)) != NULL)
+    {
+        iUpdate++;
+        iCustomer = (int) strtol(pszLine, &pszFields, 10);
+        if (pszFields == pszLine)
+            ErrExit(ERR_CUSTOMER_DATA, "Update %d does not start with a customer number"
+                , iUpdate);
+        updateStandingCustomer(set, iCustomer - 1, pszFields);
+        for (i = 0; i < set->iEventCount; i++)
+        {
+            pEvent = &set->eventM[i];
+            outputInt(output, iLineM[pEvent->iQuery]);
+            outputText(output, "\t", 1);
+            outputInt(output, pEvent->iCustomer + 1);
+            outputString(output, pEvent->bEnter ? "\tenter\n" : "\tleave\n");
+        }
+    }
+    fprintf(stderr, "Standing queries: %d registered, %d updates, %ld queries evaluated\n"
+        , set->iQueryCount, iUpdate, set->lEvaluations);
+
+    free(iLineM);
+    freeQuery(query);
+    freeOut(out);
+    freeLineReader(updateReader);
+    freeStandingSet(set);
 }
 
-/******************** addOut **************************************
-void addOut(Out out, Element element)
+/******************** compareInt **************************************
+int compareInt(const void *pLeft, const void *pRight)
 Purpose:
-    Adds an element to out.  
+    qsort comparison of two ints.
+**************************************************************************/
+static int compareInt(const void *pLeft, const void *pRight)
+{
+    int iLeft = *(const int *) pLeft;
+    int iRight = *(const int *) pRight;
+    return (iLeft > iRight) - (iLeft < iRight);
+}
+
+/******************** processRecords **************************************
+void processRecords(LineReader reader, OutputBuffer output, FILE *pRecordFile)
+Purpose:
+    Registers the queries with a match index, then prints the queries
+    each record matches.
 Parameters:
-    I/O Out out                 Stores the postfix expression 
-    I Element element           Element structure to be added to out. 
+    I/O LineReader reader       input reader (the queries)
+    O   OutputBuffer output     where the matches are formatted
+    I   FILE *pRecordFile       records, one per line
 Returns:
-    n/a 
+    n/a
 Notes:
-    - Since out uses an array, addOut does a boundary check for overflow. 
+    - Queries that do not convert or compile are numbered but never
+      match.  The counts of registered queries, conjunctions and
+      postings scanned are written to stderr.
+**************************************************************************/
+static void processRecords(LineReader reader, OutputBuffer output, FILE *pRecordFile)
+{
+    MatchIndex index = newMatchIndex();
+    LineReader recordReader = newLineReader(pRecordFile);
+    Out out = newOut();
+    Query query = newQuery();
+    int *iLineM = NULL;         // query number of each registered query
+    int iLineMax = 0;
+    int iMatch;
+    int iQuery = 1;
+    int iRecord = 0;
+    int iLineLength;
+    int bNewline;
+    char *pszLine;
+    int i;
+
+    while ((pszLine = readLine(reader, &iLineLength, &bNewline)) != NULL)
+    {
+        iMatch = -1;
+        if (convertTimedQuery(out, pszLine) == 0)
+            iMatch = addMatchQuery(index, out, query);
+        if (iMatch >= iLineMax)
+        {
+            iLineMax = iLineMax > 0 ? iLineMax * 2 : 256;
+            iLineM = realloc(iLineM, iLineMax * sizeof(int));
+            if (iLineM == NULL)
+                ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d match queries", iLineMax);
+        }
+        if (iMatch >= 0)
+            iLineM[iMatch] = iQuery;
+        iQuery++;
+    }
+
+    while ((pszLine = readLine(recordReader, &iLineLength, &bNewline)) != NULL)
+    {
+        iRecord++;
+        matchRecord(index, pszLine);
+        for (i = 0; i < index->iMatchCount; i++)
+            index->iMatchM[i] = iLineM[index->iMatchM[i]];
+        qsort(index->iMatchM, index->iMatchCount, sizeof(int), compareInt);
+        outputInt(output, iRecord);
+        outputText(output, "\t", 1);
+        for (i = 0; i < index->iMatchCount; i++)
+        {
+            if (i > 0)
+                outputText(output, " ", 1);
+            outputInt(output, index->iMatchM[i]);
+        }
+        outputText(output, "\n", 1);
+    }
+    fprintf(stderr, "Match index: %d queries, %d conjunctions, %d fallback queries"
+        ", %ld postings scanned for %d records\n", index->iQueryCount, index->iConjCount
+        , index->iFallbackCount, index->lPostings, iRecord);
+
+    free(iLineM);
+    freeQuery(query);
+    freeOut(out);
+    freeLineReader(recordReader);
+    freeMatchIndex(index);
+}
+
+// QueryChunk typedef holds a group of consecutive queries that one
+// thread converts
+typedef struct
+{
+    int iFirstQuery;            // query number of the first line
+    int iLineCount;             // number of lines in the chunk
+    int *iLineStartM;           // offset of each line in pszText
+    char *bNewlineM;            // TRUE if the line ended with a newline
+    char *pszText;              // the lines, each zero terminated
+    int iTextLength;            // bytes used in pszText
+    int iTextMax;               // allocated size of pszText
+    OutputBuffer output;        // the formatted results of the chunk
+    int bDone;                  // TRUE when the chunk has been converted
+} QueryChunk;
+
+// pool is the state shared by the main thread and the converting threads.
+// Chunks are used in order as a ring; chunk n is in chunkM[n % iChunkCount].
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t workReady;   // signaled when a chunk is filled or input ends
+    pthread_cond_t chunkDone;   // signaled when a chunk is converted
+    QueryChunk *chunkM;
+    int iChunkCount;            // number of chunks in the ring
+    int iFilled;                // number of chunks filled by the main thread
+    int iTaken;                 // number of chunks taken by a converting thread
+    int bFinished;              // TRUE when all of the input has been read
+} pool;
+
+/******************** initChunk **************************************
+void initChunk(QueryChunk *pChunk)
+Purpose:
+    Allocates the arrays and output buffer of an empty chunk.
+Parameters:
+    O   QueryChunk *pChunk      chunk to initialize
+Returns:
+    n/a
+**************************************************************************/
+static void initChunk(QueryChunk *pChunk)
+{
+    pChunk->iLineStartM = malloc(CHUNK_QUERIES * sizeof(int));
+    pChunk->bNewlineM = malloc(CHUNK_QUERIES);
+    pChunk->iTextMax = CHUNK_TEXT_SIZE;
+    pChunk->pszText = malloc(pChunk->iTextMax);
+    pChunk->output = newOutputBuffer(NULL);
+    if (pChunk->iLineStartM == NULL || pChunk->bNewlineM == NULL
+        || pChunk->pszText == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate query chunks");
+}
+
+/******************** freeChunk **************************************
+void freeChunk(QueryChunk *pChunk)
+Purpose:
+    Frees the arrays and output buffer of a chunk.
+Parameters:
+    I/O QueryChunk *pChunk      chunk to free
+Returns:
+    n/a
 **************************************************************************/
-void addOut(Out out, Element element)
+static void freeChunk(QueryChunk *pChunk)
 {
-    if (out->iOutCount >= MAX_OUT_ITEM)
-        ErrExit(ERR_OUT_OVERFLOW
-        , "Overflow in the out array");
-    out->outM[out->iOutCount++] = element;
+    free(pChunk->iLineStartM);
+    free(pChunk->bNewlineM);
+    free(pChunk->pszText);
+    freeOutputBuffer(pChunk->output);
 }
 
-/******************** printOut **************************************
-void printOut(Out out)
+/******************** fillChunk **************************************
+int fillChunk(LineReader reader, QueryChunk *pChunk, int iFirstQuery)
 Purpose:
-    prints the contents of the out array to stdout 
+    Reads the next group of query lines into a chunk.
 Parameters:
-    I Out out                 The postfx expression  
+    I/O LineReader reader       input reader
+    O   QueryChunk *pChunk      chunk to fill
+    I   int iFirstQuery         query number of the first line
 Returns:
-    n/a 
+    Number of lines read (0 at end of file).
 Notes:
-    - Prints 6 tokens from out per line
+    - A chunk holds at most CHUNK_QUERIES lines.  It stops early once it
+      has CHUNK_TEXT_SIZE bytes of text, but a single long line is
+      always taken whole.
 **************************************************************************/
-void printOut(Out out)
+static int fillChunk(LineReader reader, QueryChunk *pChunk, int iFirstQuery)
 {
-    int i;
-    printf("\t");
-    // loop through each element in the out array
-    for (i = 0; i < out->iOutCount; i++)
+    char *pszLine;
+    int iLineLength;
+    int bNewline;
+    STATS_DECLARE(ullTicks);
+
+    pChunk->iFirstQuery = iFirstQuery;
+    pChunk->iLineCount = 0;
+    pChunk->iTextLength = 0;
+    pChunk->bDone = FALSE;
+    STATS_START(ullTicks);
+    while (pChunk->iLineCount < CHUNK_QUERIES && pChunk->iTextLength < CHUNK_TEXT_SIZE
+        && (pszLine = readLine(reader, &iLineLength, &bNewline)) != NULL)
     {
-        printf("%s ", out->outM[i].szToken);
-        if ((i + 1) % 6 == 0)
-            printf("\n\t");
+        STATS_STOP(PHASE_READ, ullTicks);
+        if (pChunk->iTextLength + iLineLength + 1 > pChunk->iTextMax)
+        {
+            while (pChunk->iTextLength + iLineLength + 1 > pChunk->iTextMax)
+                pChunk->iTextMax *= 2;
+            pChunk->pszText = realloc(pChunk->pszText, pChunk->iTextMax);
+            if (pChunk->pszText == NULL)
+                ErrExit(ERR_INPUT, "Unable to grow a query chunk to %d bytes"
+                , pChunk->iTextMax);
+        }
+        memcpy(pChunk->pszText + pChunk->iTextLength, pszLine, iLineLength + 1);
+        pChunk->iLineStartM[pChunk->iLineCount] = pChunk->iTextLength;
+        pChunk->bNewlineM[pChunk->iLineCount] = (char) bNewline;
+        pChunk->iLineCount++;
+        pChunk->iTextLength += iLineLength + 1;
+        STATS_START(ullTicks);
     }
-    printf("\n");
+    return pChunk->iLineCount;
 }
 
-/******************** categorize **************************************
-void categorize(Element *pElement)
+/******************** convertChunks **************************************
+void *convertChunks(void *pArg)
 Purpose:
-    Categorizes a token providing its precedence (0 is low, higher 
-    integers are a higher precedence) and category (operator, operand,
-    left paren, right paren).  Since the category is an integer, it can
-    be used in a switch statement.
+    Thread routine that takes filled chunks from the pool and converts
+    their queries until all of the input has been converted.
 Parameters:
-    I/O Element *pElement       pointer to an element structure which
-                                will be modified by this function
+    I   void *pArg              not used
 Returns:
-    n/a 
+    NULL
 Notes:
-    - Uses the symbolDefM array to help categorize tokens 
+    - Threads take the next filled chunk as soon as they finish one, so
+      a thread that gets quick queries simply converts more chunks.
+    - Each thread has its own Out and Query, and processQuery formats into the
+      chunk's own output buffer, so nothing else is shared.
 **************************************************************************/
-void categorize(Element *pElement)
+static void *convertChunks(void *pArg)
 {
+    Out out = newOut();
+    Query query = newQuery();
+    QueryChunk *pChunk;
     int i;
-    // loop through the symbolDefM array until an empty symbol value is found
-    // marking the end of the symbolDefM array
-    for (i = 0; symbolDefM[i].szSymbol[0] != '\0'; i++) 
+
+    (void) pArg;
+    pthread_mutex_lock(&pool.lock);
+    while (TRUE)
     {
-        // does the element's token match the symbol in the symbolDefM array?
-        if (strcmp(pElement->szToken, symbolDefM[i].szSymbol) == 0)
-        {   // matched, so use its precedence and category
-            pElement->iPrecedence = symbolDefM[i].iPrecedence;
-            pElement->iCategory = symbolDefM[i].iCategory;
-            return;
-        }
+        while (pool.iTaken == pool.iFilled && !pool.bFinished)
+            pthread_cond_wait(&pool.workReady, &pool.lock);
+        if (pool.iTaken == pool.iFilled)
+            break;                      // finished and nothing left
+        pChunk = &pool.chunkM[pool.iTaken % pool.iChunkCount];
+        pool.iTaken++;
+        pthread_mutex_unlock(&pool.lock);
+
+        STATS_MARK_START();
+        for (i = 0; i < pChunk->iLineCount; i++)
+            processQuery(pChunk->output, out, query, pChunk->iFirstQuery + i
+                , pChunk->pszText + pChunk->iLineStartM[i], pChunk->bNewlineM[i]);
+
+        pthread_mutex_lock(&pool.lock);
+        pChunk->bDone = TRUE;
+        pthread_cond_broadcast(&pool.chunkDone);
     }
-    // must be an operand
-    pElement->iPrecedence = 0;
-    pElement->iCategory = CAT_OPERAND;
+    pthread_mutex_unlock(&pool.lock);
+    freeOut(out);
+    freeQuery(query);
+    return NULL;
+}
+
+/******************** writeChunk **************************************
+void writeChunk(OutputBuffer output, int iChunk)
+Purpose:
+    Waits for a chunk to be converted and adds its results to the output.
+Parameters:
+    I/O OutputBuffer output     program output
+    I   int iChunk              chunk number
+Returns:
+    n/a
+**************************************************************************/
+static void writeChunk(OutputBuffer output, int iChunk)
+{
+    QueryChunk *pChunk = &pool.chunkM[iChunk % pool.iChunkCount];
+
+    pthread_mutex_lock(&pool.lock);
+    while (!pChunk->bDone)
+        pthread_cond_wait(&pool.chunkDone, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    outputText(output, pChunk->output->pszBuffer, pChunk->output->iLength);
+    pChunk->output->iLength = 0;
 }
 
-/******************** ErrExit **************************************
-  void ErrExit(int iexitRC, char szFmt[], ... )
+/******************** convertParallel **************************************
+void convertParallel(LineReader reader, OutputBuffer output, int iThreads)
 Purpose:
-    Prints an error message defined by the printf-like szFmt and the
-    corresponding arguments to that function.  The number of 
-    arguments after szFmt varies dependent on the format codes in
-    szFmt.  
-    It also exits the program with the specified exit return code.
+    Converts every query in the input using several threads, writing the
+    results in the original query order.
 Parameters:
-    I   int iexitRC             Exit return code for the program
-    I   char szFmt[]            This contains the message to be printed
-                                and format codes (just like printf) for 
-                                values that we want to print.
-    I   ...                     A variable-number of additional arguments
-                                which correspond to what is needed
-                                by the format codes in szFmt. 
+    I/O LineReader reader       input reader
+    I/O OutputBuffer output     program output
+    I   int iThreads            number of converting threads
 Returns:
-    Returns a program exit return code:  the value of iexitRC.
+    n/a
 Notes:
-    - Prints "ERROR: " followed by the formatted error message specified 
-      in szFmt. 
-    - Prints the file path and file name of the program having the error.
-      This is the file that contains this routine.
-    - Requires including <stdarg.h>
+    - The main thread reads the input into a ring of chunks while the
+      converting threads work on them.  When the ring is full, the main
+      thread writes the oldest chunk (waiting for it if needed), which
+      also frees that chunk for new input.
+    - Query numbers are assigned when a chunk is filled, so they are the
+      same as when converting serially.
 **************************************************************************/
-void ErrExit(int iexitRC, char szFmt[], ... )
+static void convertParallel(LineReader reader, OutputBuffer output, int iThreads)
 {
-    va_list args;               // This is the standard C variable argument list type
-    va_start(args, szFmt);      // This tells the compiler where the variable arguments
-                                // begins.  They begin after szFmt.
-    printf("ERROR: ");
-    vprintf(szFmt, args);       // vprintf receives a printf format string and  a
-                                // va_list argument
-    va_end(args);               // let the C environment know we are finished with the
-                                // va_list argument
-    printf("\n\tEncountered in file %s\n", __FILE__);  // this 2nd arg is filled in by
-                                // the pre-compiler
-    exit(iexitRC);
+    pthread_t *threadM = malloc(iThreads * sizeof(pthread_t));
+    QueryChunk *pChunk;
+    int iWritten = 0;               // number of chunks written to output
+    int iQuery = 1;                 // query number of the next line
+    int i;
+
+    pool.iChunkCount = iThreads * CHUNKS_PER_THREAD;
+    pool.chunkM = calloc(pool.iChunkCount, sizeof(QueryChunk));
+    if (threadM == NULL || pool.chunkM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d threads", iThreads);
+    for (i = 0; i < pool.iChunkCount; i++)
+        initChunk(&pool.chunkM[i]);
+    pool.iFilled = 0;
+    pool.iTaken = 0;
+    pool.bFinished = FALSE;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.workReady, NULL);
+    pthread_cond_init(&pool.chunkDone, NULL);
+    for (i = 0; i < iThreads; i++)
+    {
+        if (pthread_create(&threadM[i], NULL, convertChunks, NULL) != 0)
+            ErrExit(ERR_INPUT, "Unable to create thread %d", i + 1);
+    }
+
+    while (TRUE)
+    {
+        // when every chunk is in use, write the oldest to free it
+        if (pool.iFilled - iWritten == pool.iChunkCount)
+            writeChunk(output, iWritten++);
+        pChunk = &pool.chunkM[pool.iFilled % pool.iChunkCount];
+        if (fillChunk(reader, pChunk, iQuery) == 0)
+            break;
+        iQuery += pChunk->iLineCount;
+        pthread_mutex_lock(&pool.lock);
+        pool.iFilled++;
+        pthread_cond_signal(&pool.workReady);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    pthread_mutex_lock(&pool.lock);
+    pool.bFinished = TRUE;
+    pthread_cond_broadcast(&pool.workReady);
+    pthread_mutex_unlock(&pool.lock);
+    while (iWritten < pool.iFilled)
+        writeChunk(output, iWritten++);
+
+    for (i = 0; i < iThreads; i++)
+        pthread_join(threadM[i], NULL);
+    for (i = 0; i < pool.iChunkCount; i++)
+        freeChunk(&pool.chunkM[i]);
+    free(pool.chunkM);
+    free(threadM);
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.workReady);
+    pthread_cond_destroy(&pool.chunkDone);
 }
-/******************** getToken **************************************
-char * getToken (char *pszInputTxt, char szToken[], int iTokenSize)
+
+/******************** convertBatch **************************************
+void convertBatch(LineReader reader, OutputBuffer output)
 Purpose:
-    Examines the input text to return the next token.  It also
-    returns the position in the text after that token.  This function
-    does not skip over white space, but it assumes the input uses 
-    spaces to separate tokens.
+    Converts and evaluates the queries a chunk at a time, evaluating the
+    subexpressions the queries of a chunk have in common only once.
 Parameters:
-    I   char *pszInputTxt       input buffer to be parsed
-    O   char szToken[]          Returned token.
-    I   int iTokenSize          The size of the token variable.  This is used
-                                to prevent overwriting memory.  The size
-                                should be the memory size minus 1 (for
-                                the zero byte).
+    I/O LineReader reader       input reader
+    I/O OutputBuffer output     program output
 Returns:
-    Functionally:
-        Pointer to the next character following the delimiter after the token.
-        NULL - no token found.
-    szToken parm - the returned token.  If not found, it will be an
-        empty string.
+    n/a
 Notes:
-    - If the token is larger than the szToken parm, we return a truncated value.
-    - If a token isn't found, szToken is set to an empty string
-    - This function does not skip over white space occurring prior to the token.
+    - Requires customer data.
+    - Every query of a chunk is converted and compiled into the chunk's
+      QueryDag (see cs2123p1Batch.c).  The postfix of each query is kept
+      in an arena until the DAG has been evaluated and the results are
+      formatted.
+    - The number of instructions and of distinct DAG nodes are added to
+      lBatchInstrCount and lBatchNodeCount.  The chunks are counted in
+      iBatchCount, and those countDagMatches counted a query at a time
+      in iBatchPerQueryCount.
 **************************************************************************/
-char * getToken(char *pszInputTxt, char szToken[], int iTokenSize)
+static void convertBatch(LineReader reader, OutputBuffer output)
 {
-    int iDelimPos;                      // found position of delim
-    int iCopy;                          // number of characters to copy
-    char szDelims[20] = " \n\r";        // delimiters
-    szToken[0] = '\0';
-
-    // check for NULL pointer 
-    if (pszInputTxt == NULL)
-        ErrExit(ERR_ALGORITHM
-        , "getToken passed a NULL pointer");
-
-    // Check for no token if at zero byte
-    if (*pszInputTxt == '\0')
-        return NULL;
-
-    // get the position of the first delim
-    iDelimPos = strcspn(pszInputTxt, szDelims);
-
-    // if the delim position is at the first character, return no token.
-    if (iDelimPos == 0)
-        return NULL;
-
-    // see if we have more characters than target token, if so, trunc
-    if (iDelimPos > iTokenSize)
-        iCopy = iTokenSize;             // truncated size
-    else
-        iCopy = iDelimPos;
+    QueryChunk chunk;
+    QueryDag dag = newQueryDag();
+    Arena arena = newArena(ARENA_BLOCK_SIZE);
+    Out out = newOut();
+    Query query = newQuery();
+    OutImp resultOut;           // postfix of one query, kept in arena
+    OutImp *resultM;
+    int *rcM;
+    int *iRootM;
+    int *iMatchM = NULL;
+    int iMatchMax = 0;
+    int iQuery = 1;
+    int i;
+    STATS_DECLARE(ullTicks);
+
+    initChunk(&chunk);
+    while (fillChunk(reader, &chunk, iQuery) > 0)
+    {
+        resetArena(arena);
+        resetQueryDag(dag);
+        resultM = arenaAlloc(arena, chunk.iLineCount * sizeof(OutImp));
+        rcM = arenaAlloc(arena, chunk.iLineCount * sizeof(int));
+        iRootM = arenaAlloc(arena, chunk.iLineCount * sizeof(int));
+        for (i = 0; i < chunk.iLineCount; i++)
+        {
+            rcM[i] = convertTimedQuery(out, chunk.pszText + chunk.iLineStartM[i]);
+            iRootM[i] = -1;
+            if (rcM[i] == 0 && compileQuery(out, customerSet, query) == 0)
+            {
+                simplifyQuery(query, customerSet, out->arena);
+                iRootM[i] = addDagQuery(dag, query);
+            }
+            resultM[i].iOutCount = resultM[i].iOutMax = out->iOutCount;
+            resultM[i].outM = arenaAlloc(arena, out->iOutCount * sizeof(Element));
+            resultM[i].arena = NULL;
+            memcpy(resultM[i].outM, out->outM, out->iOutCount * sizeof(Element));
+        }
+
+        if (dag->iNodeCount > iMatchMax)
+        {
+            iMatchMax = dag->iNodeCount;
+            iMatchM = realloc(iMatchM, iMatchMax * sizeof(int));
+            if (iMatchM == NULL)
+                ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate batch results");
+        }
+        STATS_START(ullTicks);
+        countDagMatches(dag, customerIndex, iMatchM);
+        STATS_STOP(PHASE_EVALUATE, ullTicks);
+        lBatchInstrCount += dag->lInstrCount;
+        lBatchNodeCount += dag->iNodeCount;
+        iBatchCount++;
+        iBatchPerQueryCount += dag->bPerQuery;
+
+        for (i = 0; i < chunk.iLineCount; i++)
+        {
+            resultOut = resultM[i];
+            formatResult(output, &resultOut, iQuery + i
+                , chunk.pszText + chunk.iLineStartM[i], chunk.bNewlineM[i], rcM[i]
+                , iRootM[i] < 0 ? -1 : iMatchM[iRootM[i]]);
+        }
+        iQuery += chunk.iLineCount;
+        STATS_POLL();
+    }
+    freeChunk(&chunk);
+    free(iMatchM);
+    freeQueryDag(dag);
+    freeArena(arena);
+    freeOut(out);
+    freeQuery(query);
+}
+
+// Main program for the driver
 
-    // copy the token into the target token variable
-    memcpy(szToken, pszInputTxt, iCopy);
-    szToken[iCopy] = '\0';              // null terminate
+int main(int argc, char *argv[])
+{
+    Out out = newOut();
+    Query query = newQuery();
+    LineReader reader = newLineReader(stdin);
+    OutputBuffer output = newOutputBuffer(stdout);
+    char *pszLine;              // entire input line
+    int iLineLength;
+    int bNewline;
+    int icount = 1;
+    int iThreads = 1;           // number of converting threads
+    int iCacheEntries;
+    long lHits;
+    long lMisses;
+    long lEvictions;
+    int i;
+    FILE *pCustomerFile;
+    FILE *pStatsFile;
+    char *pszStatsFile = NULL;
+    char *pszCustomerFile = NULL;
+    char *pszWriteFile = NULL;  // -w postfix file
+    char *pszReadFile = NULL;   // -r postfix file
+    char *pszColumnWriteFile = NULL;    // -K column file
+    char *pszColumnFile = NULL; // -k column file
+    PostfixFile postfixFile = NULL;
+    FILE *pUpdateFile = NULL;   // -u customer updates
+    FILE *pRecordFile = NULL;   // -m records to match
 
-    // advance the position
-    pszInputTxt += iDelimPos;
-    if (*pszInputTxt == '\0')
-        return pszInputTxt;
+    // process the command line options
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "text") == 0)
+                iFormat = FORMAT_TEXT;
+            else if (strcmp(argv[i], "postfix") == 0)
+                iFormat = FORMAT_POSTFIX;
+            else if (strcmp(argv[i], "json") == 0)
+                iFormat = FORMAT_JSON;
+            else
+                ErrExit(ERR_INPUT, "Unknown output format %s", argv[i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            iThreads = atoi(argv[++i]);
+            if (iThreads < 1)
+                ErrExit(ERR_INPUT, "The number of threads must be at least 1");
+            iLargeThreads = iThreads;
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            iCacheEntries = atoi(argv[++i]);
+            if (iCacheEntries < 0)
+                ErrExit(ERR_INPUT, "The number of cache entries cannot be negative");
+            if (iCacheEntries > 0 && queryCache == NULL)
+                queryCache = newQueryCache(iCacheEntries);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            pszStatsFile = argv[++i];
+        else if (strcmp(argv[i], "-b") == 0)
+            bBatch = TRUE;
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "text") == 0)
+                iStatsFormat = FORMAT_TEXT;
+            else if (strcmp(argv[i], "json") == 0)
+                iStatsFormat = FORMAT_JSON;
+            else
+                ErrExit(ERR_INPUT, "Unknown statistics format %s", argv[i]);
+#ifdef CS2123P1_STATS
+            statsInit(iStatsFormat);
+#else
+            ErrExit(ERR_INPUT, "-S needs a program compiled with -DCS2123P1_STATS");
+#endif
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            pszWriteFile = argv[++i];
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            pszReadFile = argv[++i];
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+        {
+            i++;
+            pUpdateFile = fopen(argv[i], "r");
+            if (pUpdateFile == NULL)
+                ErrExit(ERR_INPUT, "Unable to open update file %s", argv[i]);
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            i++;
+            pRecordFile = fopen(argv[i], "r");
+            if (pRecordFile == NULL)
+                ErrExit(ERR_INPUT, "Unable to open record file %s", argv[i]);
+        }
+        else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc)
+            pszColumnWriteFile = argv[++i];
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+            pszColumnFile = argv[++i];
+        else
+            pszCustomerFile = argv[i];
+    }
+    if (pszWriteFile != NULL && pszReadFile != NULL)
+        ErrExit(ERR_INPUT, "-w and -r cannot be used together");
+    if (pUpdateFile != NULL && pszCustomerFile == NULL)
+        ErrExit(ERR_INPUT, "-u needs a customer file");
+    if (pUpdateFile != NULL && pRecordFile != NULL)
+        ErrExit(ERR_INPUT, "-u and -m cannot be used together");
+    if (pszColumnFile != NULL && pszCustomerFile != NULL)
+        ErrExit(ERR_INPUT, "-k cannot be used with a customer file");
+    if (pszColumnWriteFile != NULL && pszCustomerFile == NULL)
+        ErrExit(ERR_INPUT, "-K needs a customer file");
+    if (pRecordFile != NULL)
+        pszCustomerFile = NULL;
+    if (pUpdateFile != NULL || pRecordFile != NULL)
+        pszWriteFile = pszReadFile = NULL;
+    if (pszWriteFile != NULL)
+        postfixWriter = newPostfixWriter();
+
+    // map the postfix file before anything else interns symbols, so that
+    // its queries can be used in place
+    if (pszReadFile != NULL)
+        postfixFile = openPostfixFile(pszReadFile);
+
+    // load the optional customer file
+    if (pszCustomerFile != NULL)
+    {
+        pCustomerFile = fopen(pszCustomerFile, "r");
+        if (pCustomerFile == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to open customer file %s", pszCustomerFile);
+        customerSet = loadCustomers(pCustomerFile);
+        fclose(pCustomerFile);
+        customerIndex = buildIndex(customerSet);
+        if (pszColumnWriteFile != NULL)
+            writeColumnFile(customerSet, pszColumnWriteFile);
+    }
+    else if (pszColumnFile != NULL && pRecordFile == NULL)
+    {
+        columnFile = openColumnFile(pszColumnFile);
+        customerSet = columnFile->customerSet;
+        bBatch = FALSE;
+        iThreads = 1;
+    }
+
+    // get the statistics for the query optimizer
+    if (customerSet != NULL && columnFile == NULL)
+    {
+        pStatsFile = pszStatsFile == NULL ? NULL : fopen(pszStatsFile, "r");
+        if (pStatsFile != NULL)
+        {
+            queryStats = loadStats(pStatsFile, customerSet);
+            fclose(pStatsFile);
+        }
+        else
+        {
+            queryStats = collectStats(customerSet);
+            if (pszStatsFile != NULL)
+            {
+                pStatsFile = fopen(pszStatsFile, "w");
+                if (pStatsFile == NULL)
+                    ErrExit(ERR_CUSTOMER_DATA, "Unable to write statistics file %s"
+                        , pszStatsFile);
+                saveStats(queryStats, customerSet, pStatsFile);
+                fclose(pStatsFile);
+            }
+        }
+    }
+    
+    // read text lines containing queries until EOF
+    // readLine returns each line in place in the reader's buffer, with no
+    // limit on its length
+    if (pRecordFile != NULL)
+    {
+        processRecords(reader, output, pRecordFile);
+        fclose(pRecordFile);
+    }
+    else if (pUpdateFile != NULL)
+    {
+        processUpdates(reader, output, pUpdateFile);
+        fclose(pUpdateFile);
+    }
+    else if (postfixFile != NULL)
+        processStoredQueries(output, out, query, postfixFile);
+    else if (bBatch && customerSet != NULL && postfixWriter == NULL)
+    {
+        convertBatch(reader, output);
+        fprintf(stderr, "Batch: %ld instructions, %ld distinct nodes, sharing factor %.2f"
+            ", %d of %d chunks evaluated a query at a time\n"
+            , lBatchInstrCount, lBatchNodeCount
+            , lBatchNodeCount > 0 ? (double) lBatchInstrCount / lBatchNodeCount : 1.0
+            , iBatchPerQueryCount, iBatchCount);
+    }
+    else if (iThreads > 1 && postfixWriter == NULL)
+        convertParallel(reader, output, iThreads);
     else
-        return pszInputTxt + 1;
-}
\ No newline at end of file
+    {
+        STATS_MARK_START();
+        while ((pszLine = readLine(reader, &iLineLength, &bNewline)) != NULL)
+        {
+            STATS_MARK(PHASE_READ);
+            processQuery(output, out, query, icount, pszLine, bNewline);
+            icount++;
+        }
+    }
+    if (iFormat == FORMAT_TEXT && pUpdateFile == NULL && pRecordFile == NULL)
+        outputText(output, "\n", 1);
+    flushOutput(output);
+    if (postfixWriter != NULL)
+    {
+        writePostfixFile(postfixWriter, pszWriteFile);
+        freePostfixWriter(postfixWriter);
+    }
+    if (postfixFile != NULL)
+        closePostfixFile(postfixFile);
+    freeOut(out);
+    freeQuery(query);
+    freeLineReader(reader);
+    freeOutputBuffer(output);
+    if (columnFile != NULL)
+    {
+        fprintf(stderr, "Column file: %ld bytes read, %ld blocks skipped, %ld evaluated\n"
+            , columnFile->lBytesRead, columnFile->lBlocksSkipped
+            , columnFile->lBlocksEvaluated);
+        closeColumnFile(columnFile);
+    }
+    else if (customerSet != NULL)
+    {
+        freeStats(queryStats);
+        freeIndex(customerIndex);
+        freeCustomerSet(customerSet);
+    }
+    if (queryCache != NULL)
+    {
+        getCacheCounts(queryCache, &lHits, &lMisses, &lEvictions);
+        fprintf(stderr, "Query cache: %ld hits, %ld misses, %ld evictions\n"
+            , lHits, lMisses, lEvictions);
+        freeQueryCache(queryCache);
+    }
+#ifdef CS2123P1_STATS
+    if (iStatsFormat != 0)
+        statsDump(stderr);
+#endif
+}
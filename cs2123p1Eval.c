@@ -0,0 +1,955 @@
+/**********************************************************************************
+Program cs2123p1Eval.c by Timothy Hennessy
+Purpose:
+    Loads a customer trait dataset and evaluates postfix queries produced by
+    convertToPostFix against it.
+Command Parameters:
+    n/a
+Input:
+    The customer file contains one customer per input text line.  Each
+    customer is a list of TRAIT=VALUE fields separated by white space.  A
+    multi-valued trait is repeated once per value.
+    Some sample data:
+        SMOKING=N GENDER=F EXERCISE=HIKE EXERCISE=BIKE BOOK=SCIFI
+        SMOKING=Y GENDER=M EXERCISE=YOGA BOOK=MYSTERY
+Results:
+    compileQuery turns the Out of a query into a list of typed instructions.
+    Each operand pair is resolved once to a trait id and value id, so
+    evaluateQuery only compares integers for each customer.
+Returns:
+    0   - query compiled
+    803 - WARN_INVALID_QUERY; the postfix is not a valid boolean expression
+Notes:
+    1. Trait values are stored by trait column.  For every trait there is
+       a dictionary of its values and, for every customer, the list of
+       that customer's value ids.
+    2. An operand naming a trait or value that never occurs in the
+       customer set is compiled to an id of -1.  It never matches with
+       = or ONLY, and always matches with NOTANY.
+    3. Each customer also has a 64 bit value mask per trait.  A value id
+       below MASK_VALUES is its bit, so = and NOTANY test one bit and
+       ONLY compares the whole mask.  Higher value ids set MASK_SPILL and
+       are searched for in the customer's value ids.
+    4. Compiled queries are run by a direct threaded interpreter where
+       the compiler supports computed goto, and by a switch loop
+       elsewhere.  countMatches counts a conjunction of = comparisons
+       without an interpreter.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+
+// GCC and clang can jump to a label stored in a variable, which
+// evaluateThreaded uses for its dispatch
+#if defined(__GNUC__)
+#define HAVE_COMPUTED_GOTO 1
+#endif
+
+/******************** growArray **************************************
+void *growArray(void *pArray, int *piMax, int iNeeded, size_t iElemSize)
+Purpose:
+    Makes sure a dynamically allocated array has room for iNeeded
+    elements, doubling its size when it does not.
+Parameters:
+    I   void *pArray            array to grow (may be NULL)
+    I/O int *piMax              allocated number of elements
+    I   int iNeeded             number of elements required
+    I   size_t iElemSize        size of one element
+Returns:
+    Pointer to the (possibly moved) array.
+Notes:
+    - Exits with ERR_CUSTOMER_DATA if memory cannot be allocated.
+**************************************************************************/
+static void *growArray(void *pArray, int *piMax, int iNeeded, size_t iElemSize)
+{
+    int iNewMax;
+    if (iNeeded <= *piMax)
+        return pArray;
+    iNewMax = *piMax > 0 ? *piMax * 2 : 16;
+    while (iNewMax < iNeeded)
+        iNewMax *= 2;
+    pArray = realloc(pArray, iNewMax * iElemSize);
+    if (pArray == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate %d customer data entries", iNewMax);
+    *piMax = iNewMax;
+    return pArray;
+}
+
+/******************** addCustomer **************************************
+void addCustomer(CustomerSet customerSet)
+Purpose:
+    Starts a new customer with no trait values.
+Parameters:
+    I/O CustomerSet customerSet     customer set to add to
+Returns:
+    n/a
+Notes:
+    - Every trait column gets an empty value list for the customer.
+    - The offset arrays of all columns share the size iCustomerMax.
+**************************************************************************/
+static void addCustomer(CustomerSet customerSet)
+{
+    int iCustomer = customerSet->iCustomerCount;
+    int iNewMax;
+    int i;
+    TraitColumn *pColumn;
+
+    if (iCustomer + 2 > customerSet->iCustomerMax)
+    {
+        iNewMax = customerSet->iCustomerMax > 0 ? customerSet->iCustomerMax * 2 : 1024;
+        for (i = 0; i < customerSet->iTraitCount; i++)
+        {
+            pColumn = &customerSet->traitM[i];
+            pColumn->iOffsetM = realloc(pColumn->iOffsetM, iNewMax * sizeof(int));
+            if (pColumn->iOffsetM == NULL)
+                ErrExit(ERR_CUSTOMER_DATA
+                , "Unable to allocate offsets for %d customers", iNewMax);
+        }
+        customerSet->iCustomerMax = iNewMax;
+    }
+    for (i = 0; i < customerSet->iTraitCount; i++)
+    {
+        pColumn = &customerSet->traitM[i];
+        pColumn->iOffsetM[iCustomer + 1] = pColumn->iOffsetM[iCustomer];
+    }
+    customerSet->iCustomerCount++;
+}
+
+/******************** addTrait **************************************
+int addTrait(CustomerSet customerSet, char szTrait[])
+Purpose:
+    Adds a new trait column.  Customers already loaded have no values
+    for it.
+Parameters:
+    I/O CustomerSet customerSet     customer set to add to
+    I   char szTrait[]              trait type
+Returns:
+    The trait id of the new column.
+Notes:
+    - Exits with ERR_CUSTOMER_DATA if there are more than MAX_TRAIT traits.
+**************************************************************************/
+static int addTrait(CustomerSet customerSet, char szTrait[])
+{
+    TraitColumn *pColumn;
+
+    if (customerSet->iTraitCount >= MAX_TRAIT)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "More than %d trait types in the customer data", MAX_TRAIT);
+    pColumn = &customerSet->traitM[customerSet->iTraitCount];
+    memset(pColumn, 0, sizeof(TraitColumn));
+    strcpy(pColumn->szTrait, szTrait);
+    pColumn->iOffsetM = calloc(customerSet->iCustomerMax, sizeof(int));
+    if (pColumn->iOffsetM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate offsets for trait %s", szTrait);
+    return customerSet->iTraitCount++;
+}
+
+/******************** addTraitValue **************************************
+void addTraitValue(CustomerSet customerSet, char *pszField, int iLength)
+Purpose:
+    Adds one TRAIT=VALUE field to the last customer in the set.
+Parameters:
+    I/O CustomerSet customerSet     customer set to add to
+    I   char *pszField              field in the form TRAIT=VALUE (not
+                                    zero terminated)
+    I   int iLength                 length of the field
+Returns:
+    n/a
+Notes:
+    - New traits and new values are added to the dictionaries.
+    - A value repeated for the same customer is only stored once.
+    - Exits with ERR_CUSTOMER_DATA if the trait or the value is longer
+      than MAX_TOKEN.
+**************************************************************************/
+static void addTraitValue(CustomerSet customerSet, char *pszField, int iLength)
+{
+    char szField[2 * MAX_TOKEN + 2];        // zero terminated TRAIT=VALUE
+    char *pszValue;
+    int iCustomer = customerSet->iCustomerCount - 1;
+    int iTrait;
+    int iValue;
+    int i;
+    TraitColumn *pColumn;
+
+    pszValue = memchr(pszField, '=', iLength);
+    if (pszValue == NULL || pszValue == pszField || pszValue == pszField + iLength - 1)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Customer %d has a malformed field '%.*s'", iCustomer + 1, iLength, pszField);
+    if (pszValue - pszField > MAX_TOKEN || pszField + iLength - pszValue - 1 > MAX_TOKEN)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Customer %d has a trait or value longer than %d characters in '%.*s'"
+        , iCustomer + 1, MAX_TOKEN, iLength, pszField);
+    memcpy(szField, pszField, iLength);
+    szField[iLength] = '\0';
+    pszValue = szField + (pszValue - pszField);
+    *pszValue = '\0';
+    pszValue++;
+
+    iTrait = findTrait(customerSet, szField);
+    if (iTrait < 0)
+        iTrait = addTrait(customerSet, szField);
+    pColumn = &customerSet->traitM[iTrait];
+
+    iValue = findTraitValue(customerSet, iTrait, pszValue);
+    if (iValue < 0)
+    {
+        pColumn->szValueM = growArray(pColumn->szValueM, &pColumn->iValueMax
+            , pColumn->iValueCount + 1, sizeof(Token));
+        strcpy(pColumn->szValueM[pColumn->iValueCount], pszValue);
+        iValue = pColumn->iValueCount++;
+    }
+
+    // ignore a value the customer already has
+    for (i = pColumn->iOffsetM[iCustomer]; i < pColumn->iOffsetM[iCustomer + 1]; i++)
+    {
+        if (pColumn->iValueIdM[i] == iValue)
+            return;
+    }
+    pColumn->iValueIdM = growArray(pColumn->iValueIdM, &pColumn->iValueIdMax
+        , pColumn->iValueIdCount + 1, sizeof(int));
+    pColumn->iValueIdM[pColumn->iValueIdCount++] = iValue;
+    pColumn->iOffsetM[iCustomer + 1] = pColumn->iValueIdCount;
+}
+
+/******************** buildValueMasks **************************************
+void buildValueMasks(CustomerSet customerSet)
+Purpose:
+    Sets the value mask of every customer for every trait from the
+    customers' value ids, and the most values a customer has per trait.
+Parameters:
+    I/O CustomerSet customerSet     customer set with all customers loaded
+Returns:
+    n/a
+Notes:
+    - A trait with more than MASK_VALUES values only spills for the
+      customers having one of the later values.
+**************************************************************************/
+static void buildValueMasks(CustomerSet customerSet)
+{
+    int iTrait;
+    int iCustomer;
+    int i;
+    unsigned long long ullMask;
+    TraitColumn *pColumn;
+
+    for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+    {
+        pColumn = &customerSet->traitM[iTrait];
+        pColumn->ullMaskM = malloc((customerSet->iCustomerCount + 1)
+            * sizeof(unsigned long long));
+        if (pColumn->ullMaskM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA
+            , "Unable to allocate value masks for trait %s", pColumn->szTrait);
+        pColumn->iMaxValues = 0;
+        for (iCustomer = 0; iCustomer < customerSet->iCustomerCount; iCustomer++)
+        {
+            if (pColumn->iOffsetM[iCustomer + 1] - pColumn->iOffsetM[iCustomer]
+                > pColumn->iMaxValues)
+                pColumn->iMaxValues = pColumn->iOffsetM[iCustomer + 1]
+                    - pColumn->iOffsetM[iCustomer];
+            ullMask = 0;
+            for (i = pColumn->iOffsetM[iCustomer]; i < pColumn->iOffsetM[iCustomer + 1]; i++)
+            {
+                if (pColumn->iValueIdM[i] < MASK_VALUES)
+                    ullMask |= 1ULL << pColumn->iValueIdM[i];
+                else
+                    ullMask |= MASK_SPILL;
+            }
+            pColumn->ullMaskM[iCustomer] = ullMask;
+        }
+    }
+}
+
+/******************** loadCustomers **************************************
+CustomerSet loadCustomers(FILE *pFile)
+Purpose:
+    Reads the customer trait dataset from a file.
+Parameters:
+    I   FILE *pFile             customer file opened for reading
+Returns:
+    A dynamically allocated customer set.  Use freeCustomerSet to free it.
+Notes:
+    - Each line that is not empty or all white space is one customer.
+      Lines are read with readLine, so they may have any length.
+    - Fields are separated by any white space, as getTokenView finds them.
+    - The value masks are built once every customer is read.
+**************************************************************************/
+CustomerSet loadCustomers(FILE *pFile)
+{
+    CustomerSet customerSet = calloc(1, sizeof(CustomerSetImp));
+    LineReader reader;
+    char *pszLine;                          // entire customer line
+    char *pszField;                         // one TRAIT=VALUE field
+    char *pszRemainingText;
+    int iLength;
+    int bNewline;
+
+    if (customerSet == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate a customer set");
+
+    reader = newLineReader(pFile);
+    while ((pszLine = readLine(reader, &iLength, &bNewline)) != NULL)
+    {
+        pszRemainingText = getTokenView(pszLine, &pszField, &iLength);
+        if (pszRemainingText == NULL)
+            continue;                       // empty line
+        addCustomer(customerSet);
+        while (pszRemainingText != NULL)
+        {
+            addTraitValue(customerSet, pszField, iLength);
+            pszRemainingText = getTokenView(pszRemainingText, &pszField, &iLength);
+        }
+    }
+    freeLineReader(reader);
+    buildValueMasks(customerSet);
+    return customerSet;
+}
+
+/******************** freeCustomerSet **************************************
+void freeCustomerSet(CustomerSet customerSet)
+Purpose:
+    Frees a customer set and all of its trait columns.
+Parameters:
+    I/O CustomerSet customerSet     customer set to free
+Returns:
+    n/a
+**************************************************************************/
+void freeCustomerSet(CustomerSet customerSet)
+{
+    int i;
+    for (i = 0; i < customerSet->iTraitCount; i++)
+    {
+        free(customerSet->traitM[i].szValueM);
+        free(customerSet->traitM[i].iOffsetM);
+        free(customerSet->traitM[i].iValueIdM);
+        free(customerSet->traitM[i].ullMaskM);
+    }
+    free(customerSet);
+}
+
+/******************** findTrait **************************************
+int findTrait(CustomerSet customerSet, char szTrait[])
+Purpose:
+    Finds the trait id of a trait type.
+Parameters:
+    I   CustomerSet customerSet     customer set to search
+    I   char szTrait[]              trait type
+Returns:
+    The trait id, or -1 if no customer has the trait.
+**************************************************************************/
+int findTrait(CustomerSet customerSet, char szTrait[])
+{
+    int i;
+    for (i = 0; i < customerSet->iTraitCount; i++)
+    {
+        if (strcmp(customerSet->traitM[i].szTrait, szTrait) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/******************** findTraitValue **************************************
+int findTraitValue(CustomerSet customerSet, int iTrait, char szValue[])
+Purpose:
+    Finds the value id of a value in a trait's dictionary.
+Parameters:
+    I   CustomerSet customerSet     customer set to search
+    I   int iTrait                  trait id
+    I   char szValue[]              trait value
+Returns:
+    The value id, or -1 if no customer has the value for the trait.
+**************************************************************************/
+int findTraitValue(CustomerSet customerSet, int iTrait, char szValue[])
+{
+    TraitColumn *pColumn = &customerSet->traitM[iTrait];
+    int i;
+    for (i = 0; i < pColumn->iValueCount; i++)
+    {
+        if (strcmp(pColumn->szValueM[i], szValue) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/******************** newQuery **************************************
+Query newQuery()
+Purpose:
+    Creates an empty compiled query.
+Parameters:
+    n/a
+Returns:
+    The new query.  Use freeQuery to free it.
+**************************************************************************/
+Query newQuery()
+{
+    Query query = calloc(1, sizeof(QueryImp));
+    if (query == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a query");
+    return query;
+}
+
+/******************** freeQuery **************************************
+void freeQuery(Query query)
+Purpose:
+    Frees a compiled query.
+Parameters:
+    I/O Query query             query to free
+Returns:
+    n/a
+**************************************************************************/
+void freeQuery(Query query)
+{
+    free(query->instrM);
+    free(query);
+}
+
+/******************** compileQuery **************************************
+int compileQuery(Out out, CustomerSet customerSet, Query query)
+Purpose:
+    Translates the postfix expression in out into typed instructions,
+    resolving every trait and value to its id in the customer set.
+Parameters:
+    I/O Out out                     postfix expression from convertToPostFix.
+                                    Its arena is used for work areas.
+    I   CustomerSet customerSet     customer set the query will run against,
+                                    or NULL to compile the trait and value
+                                    of each comparison to their symbol ids
+                                    (used by standing queries)
+    O   Query query                 compiled query
+Returns:
+    0   - query compiled
+    803 - WARN_INVALID_QUERY
+Notes:
+    - Simulates evaluation with a stack of entries that are either a
+      pending operand or a boolean result.  Comparisons (=, NOTANY, ONLY)
+      need a trait and a value operand; AND and OR need two booleans.
+      The expression must leave exactly one boolean.
+    - The deepest boolean stack is saved in iMaxDepth for evaluateQuery.
+    - Operators are told apart by their SYMBOL_ ids, with no text compare.
+**************************************************************************/
+int compileQuery(Out out, CustomerSet customerSet, Query query)
+{
+    int *bBooleanM;                     // TRUE if the stack entry is a result
+    int *iOperandM;                     // outM subscript of an operand entry
+    int iTop = 0;                       // number of stack entries
+    int i;
+    int bComparison;                    // TRUE if the operands are a trait and a value
+    Instr instr;
+    Element element;
+
+    if (out->iOutCount > query->iInstrMax)
+    {
+        query->instrM = growArray(query->instrM, &query->iInstrMax
+            , out->iOutCount, sizeof(Instr));
+    }
+    bBooleanM = arenaAlloc(out->arena, (out->iOutCount + 1) * sizeof(int));
+    iOperandM = arenaAlloc(out->arena, (out->iOutCount + 1) * sizeof(int));
+    query->iInstrCount = 0;
+    query->iMaxDepth = 1;
+    for (i = 0; i < out->iOutCount; i++)
+    {
+        element = out->outM[i];
+        if (element.iCategory == CAT_OPERAND)
+        {
+            bBooleanM[iTop] = FALSE;
+            iOperandM[iTop] = i;
+            iTop++;
+            continue;
+        }
+        if (element.iCategory != CAT_OPERATOR || iTop < 2)
+            return WARN_INVALID_QUERY;
+
+        switch (element.iSymbol)
+        {
+            case SYMBOL_EQUAL:
+                instr.iOp = OP_EQUAL;
+                break;
+            case SYMBOL_NOTANY:
+                instr.iOp = OP_NOTANY;
+                break;
+            case SYMBOL_ONLY:
+                instr.iOp = OP_ONLY;
+                break;
+            case SYMBOL_AND:
+                instr.iOp = OP_AND;
+                break;
+            case SYMBOL_OR:
+                instr.iOp = OP_OR;
+                break;
+            default:
+                return WARN_INVALID_QUERY;
+        }
+        bComparison = instr.iOp != OP_AND && instr.iOp != OP_OR;
+
+        iTop -= 2;
+        instr.iTrait = -1;
+        instr.iValue = -1;
+        if (bComparison)
+        {
+            if (bBooleanM[iTop] || bBooleanM[iTop + 1])
+                return WARN_INVALID_QUERY;
+            if (customerSet == NULL)
+            {
+                instr.iTrait = out->outM[iOperandM[iTop]].iSymbol;
+                instr.iValue = out->outM[iOperandM[iTop + 1]].iSymbol;
+            }
+            else
+            {
+                instr.iTrait = findTrait(customerSet
+                , getSymbolText(out->outM[iOperandM[iTop]].iSymbol));
+                if (instr.iTrait >= 0)
+                    instr.iValue = findTraitValue(customerSet, instr.iTrait
+                        , getSymbolText(out->outM[iOperandM[iTop + 1]].iSymbol));
+            }
+        }
+        else if (!bBooleanM[iTop] || !bBooleanM[iTop + 1])
+            return WARN_INVALID_QUERY;
+
+        query->instrM[query->iInstrCount++] = instr;
+        bBooleanM[iTop] = TRUE;
+        iTop++;
+        // every entry below a new boolean is a boolean too
+        if (iTop > query->iMaxDepth)
+            query->iMaxDepth = iTop;
+    }
+    if (iTop != 1 || !bBooleanM[0])
+        return WARN_INVALID_QUERY;
+    return 0;
+}
+
+/******************** findValue **************************************
+int findValue(TraitColumn *pColumn, int iCustomer, int iValue, int *piCount)
+Purpose:
+    Determines whether a customer has a value for a trait.
+Parameters:
+    I   TraitColumn *pColumn        column of the trait
+    I   int iCustomer               subscript of the customer (0 is first)
+    I   int iValue                  value id (must be at least 0)
+    O   int *piCount                number of values the customer has
+Returns:
+    TRUE if the customer has the value.
+**************************************************************************/
+static inline int findValue(TraitColumn *pColumn, int iCustomer, int iValue
+    , int *piCount)
+{
+    int *pStart = pColumn->iValueIdM + pColumn->iOffsetM[iCustomer];
+    int *pEnd = pColumn->iValueIdM + pColumn->iOffsetM[iCustomer + 1];
+    int *p;
+
+    *piCount = (int) (pEnd - pStart);
+    for (p = pStart; p < pEnd; p++)
+    {
+        if (*p == iValue)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/******************** hasValue **************************************
+int hasValue(TraitColumn *pColumn, int iCustomer, int iValue)
+Purpose:
+    Determines whether a customer has a value for a trait using the
+    customer's value mask.
+Parameters:
+    I   TraitColumn *pColumn        column of the trait
+    I   int iCustomer               subscript of the customer (0 is first)
+    I   int iValue                  value id (must be at least 0)
+Returns:
+    TRUE if the customer has the value.
+Notes:
+    - Only a value id of at least MASK_VALUES, for a customer whose mask
+      has MASK_SPILL, searches the value ids.
+**************************************************************************/
+static inline int hasValue(TraitColumn *pColumn, int iCustomer, int iValue)
+{
+    unsigned long long ullMask = pColumn->ullMaskM[iCustomer];
+    int iCount;
+
+    if (iValue < MASK_VALUES)
+        return (int) (ullMask >> iValue) & 1;
+    return (ullMask & MASK_SPILL) != 0
+        && findValue(pColumn, iCustomer, iValue, &iCount);
+}
+
+/******************** hasOnlyValue **************************************
+int hasOnlyValue(TraitColumn *pColumn, int iCustomer, int iValue)
+Purpose:
+    Determines whether a value is a customer's only value for a trait
+    using the customer's value mask.
+Parameters:
+    I   TraitColumn *pColumn        column of the trait
+    I   int iCustomer               subscript of the customer (0 is first)
+    I   int iValue                  value id (must be at least 0)
+Returns:
+    TRUE if the value is the customer's only value for the trait.
+**************************************************************************/
+static inline int hasOnlyValue(TraitColumn *pColumn, int iCustomer, int iValue)
+{
+    unsigned long long ullMask = pColumn->ullMaskM[iCustomer];
+    int iCount;
+
+    if (iValue < MASK_VALUES)
+        return ullMask == 1ULL << iValue;
+    return ullMask == MASK_SPILL
+        && findValue(pColumn, iCustomer, iValue, &iCount) && iCount == 1;
+}
+
+/******************** evaluateWithStack **************************************
+int evaluateWithStack(Query query, CustomerSet customerSet, int iCustomer
+    , int bStackM[])
+Purpose:
+    Determines whether a customer satisfies a compiled query.
+Parameters:
+    I   Query query                 compiled query
+    I   CustomerSet customerSet     customer set
+    I   int iCustomer               subscript of the customer (0 is first)
+    I/O int bStackM[]               evaluation stack of at least
+                                    query->iMaxDepth entries
+Returns:
+    TRUE  - the customer matches
+    FALSE - the customer does not match
+Notes:
+    - ONLY is true when the value is the customer's only value for the trait.
+    - A jump added by optimizeQuery skips the rest of an AND or OR once
+      its result is known.
+    - This is the plain switch interpreter.  It is used by
+      countMatchesSwitch and by compilers without computed goto.
+**************************************************************************/
+static int evaluateWithStack(Query query, CustomerSet customerSet, int iCustomer
+    , int bStackM[])
+{
+    int iTop = 0;
+    int i;
+    Instr *pInstr;
+    TraitColumn *pColumn;
+
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        pInstr = &query->instrM[i];
+        switch (pInstr->iOp)
+        {
+            case OP_AND:
+                iTop--;
+                bStackM[iTop - 1] = bStackM[iTop - 1] && bStackM[iTop];
+                break;
+            case OP_OR:
+                iTop--;
+                bStackM[iTop - 1] = bStackM[iTop - 1] || bStackM[iTop];
+                break;
+            case OP_JUMP_FALSE:
+                if (!bStackM[iTop - 1])
+                    i = pInstr->iValue - 1;
+                break;
+            case OP_JUMP_TRUE:
+                if (bStackM[iTop - 1])
+                    i = pInstr->iValue - 1;
+                break;
+            default:
+                // comparison: test the customer's value mask
+                pColumn = &customerSet->traitM[pInstr->iTrait];
+                if (pInstr->iValue < 0)
+                    bStackM[iTop++] = pInstr->iOp == OP_NOTANY;
+                else if (pInstr->iOp == OP_NOTANY)
+                    bStackM[iTop++] = !hasValue(pColumn, iCustomer, pInstr->iValue);
+                else if (pInstr->iOp == OP_ONLY)
+                    bStackM[iTop++] = hasOnlyValue(pColumn, iCustomer, pInstr->iValue);
+                else
+                    bStackM[iTop++] = hasValue(pColumn, iCustomer, pInstr->iValue);
+        }
+    }
+    return bStackM[0];
+}
+
+#ifdef HAVE_COMPUTED_GOTO
+/******************** evaluateThreaded **************************************
+int evaluateThreaded(Query query, CustomerSet customerSet, int iCustomer
+    , int bStackM[])
+Purpose:
+    Determines whether a customer satisfies a compiled query, as
+    evaluateWithStack does, with a direct threaded interpreter.
+Parameters:
+    I   Query query                 compiled query
+    I   CustomerSet customerSet     customer set
+    I   int iCustomer               subscript of the customer (0 is first)
+    I/O int bStackM[]               evaluation stack of at least
+                                    query->iMaxDepth entries
+Returns:
+    TRUE  - the customer matches
+    FALSE - the customer does not match
+Notes:
+    - Each instruction ends by jumping straight to the code of the next
+      one through labelM (GCC's labels as values), so there is no switch
+      and one indirect branch per instruction site for the branch
+      predictor to learn.
+    - The top of the stack is kept in bTop.  A comparison pushes the old
+      top to bStackM; AND and OR pop one entry into bTop.
+**************************************************************************/
+static int evaluateThreaded(Query query, CustomerSet customerSet, int iCustomer
+    , int bStackM[])
+{
+    static void *labelM[] =
+    {
+        &&opInvalid, &&opEqual, &&opNotAny, &&opOnly, &&opAnd, &&opOr
+        , &&opJumpFalse, &&opJumpTrue
+    };
+    Instr *instrM = query->instrM;
+    Instr *pInstr = instrM;
+    Instr *pEnd = instrM + query->iInstrCount;
+    int *pTop = bStackM;        // next free entry below the top
+    int bTop = FALSE;           // top of the stack
+
+// go to the code of the instruction at pInstr, or return at the end
+#define DISPATCH() \
+    do { if (pInstr == pEnd) return bTop; goto *labelM[pInstr->iOp]; } while (0)
+
+    DISPATCH();
+opEqual:
+    *pTop++ = bTop;
+    bTop = pInstr->iValue >= 0
+        && hasValue(&customerSet->traitM[pInstr->iTrait], iCustomer, pInstr->iValue);
+    pInstr++;
+    DISPATCH();
+opNotAny:
+    *pTop++ = bTop;
+    bTop = pInstr->iValue < 0
+        || !hasValue(&customerSet->traitM[pInstr->iTrait], iCustomer, pInstr->iValue);
+    pInstr++;
+    DISPATCH();
+opOnly:
+    *pTop++ = bTop;
+    bTop = pInstr->iValue >= 0
+        && hasOnlyValue(&customerSet->traitM[pInstr->iTrait], iCustomer, pInstr->iValue);
+    pInstr++;
+    DISPATCH();
+opAnd:
+    bTop = *--pTop && bTop;
+    pInstr++;
+    DISPATCH();
+opOr:
+    bTop = *--pTop || bTop;
+    pInstr++;
+    DISPATCH();
+opJumpFalse:
+    pInstr = bTop ? pInstr + 1 : instrM + pInstr->iValue;
+    DISPATCH();
+opJumpTrue:
+    pInstr = bTop ? instrM + pInstr->iValue : pInstr + 1;
+    DISPATCH();
+opInvalid:
+    ErrExit(ERR_ALGORITHM, "Invalid operation %d in a compiled query", pInstr->iOp);
+    return FALSE;
+#undef DISPATCH
+}
+#define evaluateFast evaluateThreaded
+#else
+#define evaluateFast evaluateWithStack
+#endif
+
+/******************** getEqualTerms **************************************
+int getEqualTerms(Query query, Instr *termM[], int iTermMax)
+Purpose:
+    Determines whether a query is a conjunction of = comparisons, such as
+    SMOKING = N AND GENDER = F, and if so gets its comparisons.
+Parameters:
+    I   Query query                 compiled query
+    O   Instr *termM[]              the = comparisons, in query order
+    I   int iTermMax                most comparisons returned
+Returns:
+    The number of comparisons, or -1 if the query is not a conjunction
+    of at most iTermMax = comparisons.
+Notes:
+    - A query whose only operations are =, AND and the jumps optimizeQuery
+      adds to an AND is true exactly when all of its comparisons are.
+**************************************************************************/
+static int getEqualTerms(Query query, Instr *termM[], int iTermMax)
+{
+    int iTermCount = 0;
+    int i;
+
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        switch (query->instrM[i].iOp)
+        {
+            case OP_EQUAL:
+                if (iTermCount == iTermMax)
+                    return -1;
+                termM[iTermCount++] = &query->instrM[i];
+                break;
+            case OP_AND:
+            case OP_JUMP_FALSE:
+                break;
+            default:
+                return -1;
+        }
+    }
+    return iTermCount;
+}
+
+/******************** countEqualMatches **************************************
+int countEqualMatches(CustomerSet customerSet, Instr *termM[], int iTermCount)
+Purpose:
+    Counts the customers having every value of a conjunction of =
+    comparisons.
+Parameters:
+    I   CustomerSet customerSet     customer set
+    I   Instr *termM[]              the = comparisons
+    I   int iTermCount              number of comparisons (at least 1)
+Returns:
+    Number of matching customers.
+Notes:
+    - A single comparison only scans its trait's value masks.  Otherwise the
+      comparisons are tried in order and a customer is dropped at the
+      first one it fails.
+**************************************************************************/
+static int countEqualMatches(CustomerSet customerSet, Instr *termM[], int iTermCount)
+{
+    TraitColumn *pColumn;
+    int iCustomer;
+    int iMatches = 0;
+    int i;
+
+    for (i = 0; i < iTermCount; i++)
+    {
+        if (termM[i]->iValue < 0)
+            return 0;           // a value no customer has
+    }
+    if (iTermCount == 1)
+    {
+        pColumn = &customerSet->traitM[termM[0]->iTrait];
+        for (iCustomer = 0; iCustomer < customerSet->iCustomerCount; iCustomer++)
+            iMatches += hasValue(pColumn, iCustomer, termM[0]->iValue);
+        return iMatches;
+    }
+    for (iCustomer = 0; iCustomer < customerSet->iCustomerCount; iCustomer++)
+    {
+        for (i = 0; i < iTermCount; i++)
+        {
+            if (!hasValue(&customerSet->traitM[termM[i]->iTrait], iCustomer
+                , termM[i]->iValue))
+                break;
+        }
+        if (i == iTermCount)
+            iMatches++;
+    }
+    return iMatches;
+}
+
+/******************** evaluateQuery **************************************
+int evaluateQuery(Query query, CustomerSet customerSet, int iCustomer)
+Purpose:
+    Determines whether a customer satisfies a compiled query.
+Parameters:
+    I   Query query                 compiled query
+    I   CustomerSet customerSet     customer set
+    I   int iCustomer               subscript of the customer (0 is first)
+Returns:
+    TRUE  - the customer matches
+    FALSE - the customer does not match
+Notes:
+    - Uses an array of booleans as the evaluation stack.  It is on the
+      C stack unless the query needs more than EVAL_LOCAL_STACK entries.
+**************************************************************************/
+int evaluateQuery(Query query, CustomerSet customerSet, int iCustomer)
+{
+    int bLocalM[EVAL_LOCAL_STACK];
+    int *bStackM = bLocalM;
+    int bResult;
+
+    if (query->iMaxDepth > EVAL_LOCAL_STACK)
+    {
+        bStackM = malloc(query->iMaxDepth * sizeof(int));
+        if (bStackM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate an evaluation stack");
+    }
+    bResult = evaluateFast(query, customerSet, iCustomer, bStackM);
+    if (bStackM != bLocalM)
+        free(bStackM);
+    return bResult;
+}
+
+/******************** countMatches **************************************
+int countMatches(Query query, CustomerSet customerSet)
+Purpose:
+    Counts the customers that satisfy a compiled query.
+Parameters:
+    I   Query query                 compiled query
+    I   CustomerSet customerSet     customer set
+Returns:
+    Number of matching customers.
+Notes:
+    - A conjunction of = comparisons (the most common query) is counted
+      by countEqualMatches without an interpreter.
+    - One evaluation stack is used for every customer.
+**************************************************************************/
+int countMatches(Query query, CustomerSet customerSet)
+{
+    Instr *termM[EVAL_LOCAL_STACK];
+    int bLocalM[EVAL_LOCAL_STACK];
+    int *bStackM = bLocalM;
+    int iCustomer;
+    int iCount = 0;
+    int iTermCount;
+
+    iTermCount = getEqualTerms(query, termM, EVAL_LOCAL_STACK);
+    if (iTermCount > 0)
+        return countEqualMatches(customerSet, termM, iTermCount);
+
+    if (query->iMaxDepth > EVAL_LOCAL_STACK)
+    {
+        bStackM = malloc(query->iMaxDepth * sizeof(int));
+        if (bStackM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate an evaluation stack");
+    }
+    for (iCustomer = 0; iCustomer < customerSet->iCustomerCount; iCustomer++)
+    {
+        if (evaluateFast(query, customerSet, iCustomer, bStackM))
+            iCount++;
+    }
+    if (bStackM != bLocalM)
+        free(bStackM);
+    return iCount;
+}
+
+/******************** countMatchesSwitch **************************************
+int countMatchesSwitch(Query query, CustomerSet customerSet)
+Purpose:
+    Counts the customers that satisfy a compiled query with the plain
+    switch interpreter.
+Parameters:
+    I   Query query                 compiled query
+    I   CustomerSet customerSet     customer set
+Returns:
+    Number of matching customers.
+Notes:
+    - Gives the same count as countMatches.  The benchmark compares the
+      two.
+**************************************************************************/
+int countMatchesSwitch(Query query, CustomerSet customerSet)
+{
+    int bLocalM[EVAL_LOCAL_STACK];
+    int *bStackM = bLocalM;
+    int iCustomer;
+    int iCount = 0;
+
+    if (query->iMaxDepth > EVAL_LOCAL_STACK)
+    {
+        bStackM = malloc(query->iMaxDepth * sizeof(int));
+        if (bStackM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate an evaluation stack");
+    }
+    for (iCustomer = 0; iCustomer < customerSet->iCustomerCount; iCustomer++)
+    {
+        if (evaluateWithStack(query, customerSet, iCustomer, bStackM))
+            iCount++;
+    }
+    if (bStackM != bLocalM)
+        free(bStackM);
+    return iCount;
+}
@@ -0,0 +1,412 @@
+/**********************************************************************
+cs2123p1Eval.h
+Purpose:
+   Defines constants:
+       max constants for customer data
+       evaluation operation codes
+   Defines typedef for
+       TraitColumn     (dictionary and values of one trait type)
+       CustomerSetImp  (customer trait dataset)
+       CustomerSet     (pointer to a CustomerSetImp)
+       Instr           (one typed postfix instruction)
+       QueryImp        (compiled query)
+       Query           (pointer to a QueryImp)
+       BitWord         (one word of a bitmap)
+       IndexContainer  (customers of one index block having a value)
+       TraitIndex      (containers of one trait type)
+       CustomerIndexImp (bitmap index over a customer set)
+       CustomerIndex   (pointer to a CustomerIndexImp)
+       TraitStats      (customer counts of one trait's values)
+       QueryStatsImp   (selectivity statistics of a customer set)
+       QueryStats      (pointer to a QueryStatsImp)
+       DagNode         (one distinct subexpression of a batch of queries)
+       QueryDagImp     (subexpressions shared by a batch of queries)
+       QueryDag        (pointer to a QueryDagImp)
+       StandingQuery   (one registered standing query)
+       CustomerRecord  (one customer's traits as symbol ids)
+       StandingEvent   (a customer entering or leaving a query's results)
+       StandingSetImp  (standing queries and the customers they watch)
+       StandingSet     (pointer to a StandingSetImp)
+       MatchPosting    (one conjunction comparing a key)
+       MatchConj       (one conjunction of a query in the match index)
+       MatchIndexImp   (index of queries to match records against)
+       MatchIndex      (pointer to a MatchIndexImp)
+Notes:
+   - A query is compiled once from the Out produced by convertToPostFix.
+     Each operand is resolved to a trait id and value id so that
+     evaluating a customer does no string work.
+   - Include cs2123p1.h before this file.
+**********************************************************************/
+/*** constants ***/
+// Maximum constants for customer data
+#define MAX_TRAIT 32            // Maximum number of trait types in a customer set
+#define MASK_VALUES 63          // Value ids kept in a customer's value mask
+#define MASK_SPILL (1ULL << MASK_VALUES)    // Mask bit for the value ids above those
+#define INDEX_BLOCK_WORDS 1024  // Bitmap words evaluated at a time by the index
+#define INDEX_ARRAY_MAX 4096    // Most customers of a value's block kept as a list
+#define COLUMN_BLOCK_WORDS 16   // Bitmap words evaluated at a time from the columns
+#define EVAL_LOCAL_STACK 64     // Deepest evaluation stack kept on the C stack
+#define DAG_HASH_SIZE 1024      // Initial size of a DAG's node hash table (power of 2)
+#define DAG_MIN_SHARING 125     // Fewest instructions per 100 DAG nodes worth sharing
+#define STANDING_HASH_SIZE 1024 // Initial size of a standing set's key hash table (power of 2)
+#define MATCH_HASH_SIZE 1024    // Initial size of a match index's key hash table (power of 2)
+#define MATCH_MAX_CONJUNCTIONS 64   // Most conjunctions a query is split into
+#define MATCH_REJECTED (-1000000000)    // iHitCount of a conjunction a NOTANY rejected
+
+// Error constants (program exit values)
+#define ERR_CUSTOMER_DATA  904
+
+// Warning constants.  Warnings do not cause the program to exit.
+#define WARN_INVALID_QUERY  803
+
+// evaluation operation codes
+#define OP_EQUAL  1             // trait has the value
+#define OP_NOTANY 2             // trait does not have the value
+#define OP_ONLY   3             // the value is the trait's only value
+#define OP_AND    4
+#define OP_OR     5
+#define OP_JUMP_FALSE 6         // jump if the top of the stack is false
+#define OP_JUMP_TRUE  7         // jump if the top of the stack is true
+
+// simplifyQuery result of a query that is not true or false for everyone
+#define SIMPLE_VARIES (-1)
+
+/*** typedef ***/
+
+// TraitColumn typedef holds the value dictionary for one trait type and
+// the value ids of every customer for that trait.  The value ids for
+// customer c are iValueIdM[iOffsetM[c]] through iValueIdM[iOffsetM[c+1]-1].
+// ullMaskM[c] has bit v set for each value id v < MASK_VALUES of customer
+// c, and MASK_SPILL set if the customer has a higher value id; those are
+// only in iValueIdM.  iMaxValues is 1 for a single-valued trait.
+typedef struct
+{
+    Token szTrait;              // trait type (e.g., EXERCISE)
+    int iValueCount;            // number of distinct values in szValueM
+    int iValueMax;              // allocated size of szValueM
+    Token *szValueM;            // value dictionary; the subscript is the value id
+    int *iOffsetM;              // per customer start offset into iValueIdM
+    int iValueIdCount;          // number of entries in iValueIdM
+    int iValueIdMax;            // allocated size of iValueIdM
+    int *iValueIdM;             // value ids of all customers
+    unsigned long long *ullMaskM;   // value mask of each customer
+    int iMaxValues;             // most values any one customer has
+} TraitColumn;
+
+// CustomerSetImp typedef stores the customer trait dataset by trait column
+typedef struct
+{
+    int iCustomerCount;         // number of customers loaded
+    int iCustomerMax;           // allocated number of offsets per column
+    int iTraitCount;            // number of trait columns
+    TraitColumn traitM[MAX_TRAIT];
+} CustomerSetImp;
+
+// CustomerSet typedef defines a pointer to a customer set
+typedef CustomerSetImp *CustomerSet;
+
+// Instr typedef is one postfix instruction.  Comparisons use the trait
+// and value ids; AND and OR use only iOp.  An id of -1 means the trait
+// or value does not occur in the customer set.  Jumps, added by
+// optimizeQuery, leave the stack as it is and use iValue as the
+// subscript of the instruction to jump to.
+typedef struct
+{
+    int iOp;
+    int iTrait;
+    int iValue;
+} Instr;
+
+// QueryImp typedef holds a compiled query.  instrM grows as needed and
+// keeps its size when the query is reused.
+typedef struct
+{
+    int iInstrCount;
+    int iInstrMax;              // allocated size of instrM
+    int iMaxDepth;              // deepest evaluation stack the query needs
+    Instr *instrM;
+} QueryImp;
+
+// Query typedef defines a pointer to a compiled query
+typedef QueryImp *Query;
+
+// BitWord typedef is one word of a bitmap.  Bit b of word w is customer
+// w * BITS_PER_WORD + b.
+typedef unsigned long long BitWord;
+#define BITS_PER_WORD 64
+
+// IndexContainer typedef is the customers of one block having a value.
+// Up to INDEX_ARRAY_MAX customers are a sorted list of their bit numbers
+// in the block; more are a bitmap of INDEX_BLOCK_WORDS words.
+typedef struct
+{
+    int iCount;                 // customers in the block having the value
+    int iStart;                 // subscript of the list in bitNumberM, or of
+                                // the bitmap in valueBitsM
+} IndexContainer;
+
+// TraitIndex typedef holds the containers for one trait type
+typedef struct
+{
+    int iValueCount;            // number of values
+    IndexContainer *containerM; // iBlockCount containers per value id
+    unsigned short *bitNumberM; // lists of the sparse containers
+    BitWord *valueBitsM;        // bitmaps of the dense containers
+    BitWord *multiBitsM;        // customers with two or more values for the trait
+} TraitIndex;
+
+// CustomerIndexImp typedef is an inverted index from (trait, value) to
+// the bitmap of customers having that value
+typedef struct
+{
+    int iCustomerCount;         // number of customers indexed
+    int iWordCount;             // number of words in each bitmap
+    int iBlockCount;            // blocks of INDEX_BLOCK_WORDS words
+    int iTraitCount;            // number of trait indexes
+    long lBytes;                // memory of the containers and bitmaps
+    BitWord *allBitsM;          // bitmap of every customer
+    TraitIndex traitM[MAX_TRAIT];
+} CustomerIndexImp;
+
+// CustomerIndex typedef defines a pointer to a customer index
+typedef CustomerIndexImp *CustomerIndex;
+
+// TraitStats typedef holds, for each value id of a trait, the number of
+// customers having the value and the number whose only value it is
+typedef struct
+{
+    int iValueCount;            // number of entries in each array
+    int *iCountM;               // customers having the value
+    int *iOnlyCountM;           // customers having no other value for the trait
+} TraitStats;
+
+// QueryStatsImp typedef holds the value counts used to estimate how
+// selective each comparison of a query is
+typedef struct
+{
+    int iCustomerCount;
+    int iTraitCount;
+    TraitStats traitM[MAX_TRAIT];
+} QueryStatsImp;
+
+// QueryStats typedef defines a pointer to query statistics
+typedef QueryStatsImp *QueryStats;
+
+// DagNode typedef is a comparison or an AND or OR of two earlier nodes.
+// The operands of AND and OR are kept in ascending order so that
+// A AND B and B AND A are the same node.
+typedef struct
+{
+    Instr instr;                // the operation (jumps are not used)
+    int iLeft;                  // first operand of AND and OR, else -1
+    int iRight;                 // second operand of AND and OR, else -1
+    int bRoot;                  // TRUE if a query's result is this node
+} DagNode;
+
+// QueryDagImp typedef holds the distinct subexpressions of a batch of
+// queries.  Every node comes after its operands in nodeM.
+typedef struct
+{
+    int iNodeCount;
+    int iNodeMax;               // allocated size of nodeM
+    DagNode *nodeM;
+    int iHashSize;              // number of slots in iHashM (power of 2)
+    int *iHashM;                // node subscripts by hash, -1 if empty
+    long lInstrCount;           // instructions added, before sharing
+    int iStackMax;              // allocated size of iStackM
+    int *iStackM;               // work area of addDagQuery
+    int bPerQuery;              // TRUE if countDagMatches counted the batch
+                                // a query at a time
+} QueryDagImp;
+
+// QueryDag typedef defines a pointer to a query DAG
+typedef QueryDagImp *QueryDag;
+
+// StandingQuery typedef is one registered query.  Its instructions are
+// in the standing set's instrM, compiled with a NULL customer set so
+// that the trait and value of a comparison are symbol ids.
+typedef struct
+{
+    int iFirstInstr;            // subscript in instrM of the first instruction
+    int iInstrCount;
+    int iMaxDepth;              // deepest evaluation stack the query needs
+} StandingQuery;
+
+// CustomerRecord typedef holds one customer's trait values as pairs of
+// symbol ids: iPairM[2 * i] is a trait and iPairM[2 * i + 1] its value
+typedef struct
+{
+    int iPairCount;
+    int iPairMax;               // allocated pairs in iPairM
+    int *iPairM;
+} CustomerRecord;
+
+// StandingEvent typedef reports a change in a query's results
+typedef struct
+{
+    int iQuery;                 // standing query id (0 is the first)
+    int iCustomer;              // subscript of the customer (0 is first)
+    int bEnter;                 // TRUE if the customer now matches
+} StandingEvent;
+
+// StandingSetImp typedef holds standing queries and the customer records
+// they are evaluated against.  Every comparison's (trait, value) key is
+// in a hash table whose slots head a list of the queries using the key.
+typedef struct
+{
+    int iQueryCount;
+    int iQueryMax;              // allocated size of queryM
+    StandingQuery *queryM;
+    int iInstrCount;
+    int iInstrMax;              // allocated size of instrM
+    Instr *instrM;              // instructions of every query
+    int iCustomerCount;
+    CustomerRecord *recordM;
+    CustomerRecord update;      // fields of the current update (value -1 clears)
+    int iHashSize;              // number of slots (power of 2)
+    int iKeyCount;              // slots in use
+    int *iKeyTraitM;            // trait symbol of each slot
+    int *iKeyValueM;            // value symbol of each slot
+    int *iFirstRefM;            // first ref of each slot, -1 if the slot is empty
+    int iRefCount;
+    int iRefMax;                // allocated size of iRefQueryM and iRefNextM
+    int *iRefQueryM;            // query of each ref
+    int *iRefNextM;             // next ref with the same key, -1 at the end
+    int *iMarkM;                // update that last marked each query
+    int iMark;                  // number of the current update
+    int iAffectedCount;
+    int *iAffectedM;            // queries the current update may change
+    int *bBeforeM;              // their results before the update
+    int iEventCount;
+    int iEventMax;              // allocated size of eventM
+    StandingEvent *eventM;      // events of the last update
+    int iStackMax;              // allocated size of bStackM
+    int *bStackM;               // evaluation stack
+    int bUseIndex;              // FALSE evaluates every query on an update
+    long lEvaluations;          // queries evaluated by updates
+} StandingSetImp;
+
+// StandingSet typedef defines a pointer to a standing set
+typedef StandingSetImp *StandingSet;
+
+// MatchPosting typedef is one conjunction on the posting list of a
+// (trait, value) key
+typedef struct
+{
+    int iConj;                  // conjunction id
+    int iOp;                    // OP_EQUAL, OP_NOTANY or OP_ONLY
+} MatchPosting;
+
+// MatchConj typedef is one conjunction.  Its counters are together so
+// that a hit touches one cache line.
+typedef struct
+{
+    int iQuery;                 // query the conjunction is part of
+    int iPositiveCount;         // its = and ONLY comparisons
+    int iHitMark;               // match that last hit or rejected it
+    int iHitCount;              // hits in that match, MATCH_REJECTED if rejected
+} MatchConj;
+
+// MatchIndexImp typedef indexes queries by the conjunctions of their
+// disjunctive normal form.  A conjunction matches a record when all of
+// its iPositiveCount = and ONLY comparisons hit and no NOTANY does.
+typedef struct
+{
+    int iQueryCount;
+    int iQueryMax;              // allocated size of queryM and iQueryMarkM
+    StandingQuery *queryM;      // every query, for the fallback and the scan
+    int iInstrCount;
+    int iInstrMax;              // allocated size of instrM
+    Instr *instrM;
+    int iConjCount;
+    int iConjMax;               // allocated size of conjM and iTouchedM
+    MatchConj *conjM;
+    int iZeroCount;
+    int iZeroMax;               // allocated size of iZeroM
+    int *iZeroM;                // conjunctions with only NOTANY comparisons
+    int iFallbackCount;
+    int iFallbackMax;           // allocated size of iFallbackM
+    int *iFallbackM;            // queries with too many conjunctions
+    int iHashSize;              // number of slots (power of 2)
+    int iKeyCount;              // slots in use
+    int *iKeyTraitM;            // trait symbol of each slot
+    int *iKeyValueM;            // value symbol of each slot
+    int *iFirstPostM;           // first posting of each slot, -1 if empty
+    int iPostCount;
+    int iPostMax;               // allocated size of postM and iPostNextM
+    MatchPosting *postM;        // postings in the order they were added
+    int *iPostNextM;            // next posting of the same key, -1 at the end
+    int bPacked;                // TRUE if packM is up to date
+    int *iPackStartM;           // first packed posting of each slot (plus one)
+    MatchPosting *packM;        // postings grouped by slot
+    CustomerRecord record;      // the record being matched
+    int *iTraitCountM;          // values the record has for each pair's trait
+    int iTraitCountMax;         // allocated size of iTraitCountM
+    int iMark;                  // number of the current match
+    int iTouchedCount;
+    int *iTouchedM;             // conjunctions hit by the current match
+    int *iQueryMarkM;           // match that last matched each query
+    int iMatchCount;
+    int *iMatchM;               // queries matching the record
+    int iStackMax;              // allocated size of bStackM
+    int *bStackM;               // evaluation stack
+    int bUseIndex;              // FALSE evaluates every query on a match
+    long lPostings;             // postings scanned by matches
+} MatchIndexImp;
+
+// MatchIndex typedef defines a pointer to a match index
+typedef MatchIndexImp *MatchIndex;
+
+/**********   prototypes ***********/
+
+// Customer set functions
+CustomerSet loadCustomers(FILE *pFile);
+void freeCustomerSet(CustomerSet customerSet);
+int findTrait(CustomerSet customerSet, char szTrait[]);
+int findTraitValue(CustomerSet customerSet, int iTrait, char szValue[]);
+
+// Query evaluation functions
+Query newQuery();
+void freeQuery(Query query);
+int compileQuery(Out out, CustomerSet customerSet, Query query);
+int evaluateQuery(Query query, CustomerSet customerSet, int iCustomer);
+int countMatches(Query query, CustomerSet customerSet);
+int countMatchesSwitch(Query query, CustomerSet customerSet);
+
+// Bitmap index functions
+CustomerIndex buildIndex(CustomerSet customerSet);
+void freeIndex(CustomerIndex index);
+int countIndexMatches(Query query, CustomerIndex index);
+void countDagMatches(QueryDag dag, CustomerIndex index, int iMatchM[]);
+int countColumnMatches(Query query, CustomerSet customerSet);
+void useScalarKernels(int bScalar);
+
+// Query optimizer functions
+QueryStats collectStats(CustomerSet customerSet);
+void saveStats(QueryStats stats, CustomerSet customerSet, FILE *pFile);
+QueryStats loadStats(FILE *pFile, CustomerSet customerSet);
+void freeStats(QueryStats stats);
+void optimizeQuery(Query query, QueryStats stats, Arena arena);
+
+// Query simplification functions
+int simplifyQuery(Query query, CustomerSet customerSet, Arena arena);
+
+// Batch functions
+QueryDag newQueryDag();
+int addDagQuery(QueryDag dag, Query query);
+void resetQueryDag(QueryDag dag);
+void freeQueryDag(QueryDag dag);
+
+// Standing query functions
+StandingSet newStandingSet(CustomerSet customerSet);
+int addStandingQuery(StandingSet set, Out out, Query query);
+int updateStandingCustomer(StandingSet set, int iCustomer, char *pszFields);
+void freeStandingSet(StandingSet set);
+int evaluateRecord(Instr *instrM, int iInstrCount, CustomerRecord *pRecord
+    , int *bStackM);
+
+// Match index functions
+MatchIndex newMatchIndex();
+int addMatchQuery(MatchIndex index, Out out, Query query);
+int matchRecord(MatchIndex index, char *pszFields);
+void freeMatchIndex(MatchIndex index);
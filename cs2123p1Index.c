@@ -0,0 +1,1106 @@
+/**********************************************************************************
+Program cs2123p1Index.c by Timothy Hennessy
+Purpose:
+    Builds a bitmap inverted index over a customer set and evaluates
+    compiled queries with bitmap algebra instead of checking each customer.
+Command Parameters:
+    n/a
+Input:
+    A CustomerSet loaded by loadCustomers and a Query built by compileQuery.
+Results:
+    For every (trait, value) pair there is a set of the customers having
+    that value.  A query is evaluated a block of bitmap words at a time,
+    the value's set giving its bitmap for the block:
+        =       copy of the value's bitmap
+        NOTANY  every customer minus the value's bitmap
+        ONLY    the value's bitmap minus the customers with other values
+                for the trait
+        AND     bitmap intersection
+        OR      bitmap union
+Returns:
+    n/a
+Notes:
+    1. A value's set is kept per block of INDEX_BLOCK_WORDS words (65536
+       customers), as in roaring bitmaps.  A block with at most
+       INDEX_ARRAY_MAX of the value's customers is a sorted list of their
+       bit numbers, two bytes each; a fuller block is a bitmap, which is
+       then no larger.  An empty block takes no memory.  So a trait with
+       hundreds of values takes about two bytes per customer value rather
+       than one bit per customer for every value.
+    2. The customers with other values for a trait are the customers with
+       two or more values, since those with the value and no other value
+       are exactly the ONLY matches.  That bitmap is kept per trait.
+    3. On x86 compilers supporting it, AVX2 versions of the bitmap kernels
+       are used when the processor has AVX2.  Otherwise the scalar kernels
+       are used.  useScalarKernels makes the scalar kernels be used anyway,
+       to measure what AVX2 saves.
+    4. countColumnMatches evaluates a query a block of COLUMN_BLOCK_WORDS
+       words (1024 customers) at a time straight from the columns of the
+       customer set, with no index.  A comparison's block is made by
+       comparing the block's value ids to the value, eight at a time with
+       AVX2, and setting the bit of each customer having a hit.  The
+       operators then work on whole blocks, as with the index.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#endif
+
+// BitKernel typedef is a bitmap operation pDst = pDst op pSrc
+typedef void (*BitKernel)(BitWord *pDst, const BitWord *pSrc, int iWordCount);
+
+// EqualKernel typedef sets bit i of pHits (which starts as zeros) for
+// every piValueId[i] equal to iValue
+typedef void (*EqualKernel)(BitWord *pHits, const int *piValueId, int iCount
+    , int iValue);
+
+// MultiKernel typedef sets bit c of pMulti (which starts as zeros) for
+// every customer c with two or more values: piOffset[c + 1] - piOffset[c] > 1
+typedef void (*MultiKernel)(BitWord *pMulti, const int *piOffset, int iCount);
+
+static void andScalar(BitWord *pDst, const BitWord *pSrc, int iWordCount)
+{
+    int i;
+    for (i = 0; i < iWordCount; i++)
+        pDst[i] &= pSrc[i];
+}
+static void orScalar(BitWord *pDst, const BitWord *pSrc, int iWordCount)
+{
+    int i;
+    for (i = 0; i < iWordCount; i++)
+        pDst[i] |= pSrc[i];
+}
+static void andNotScalar(BitWord *pDst, const BitWord *pSrc, int iWordCount)
+{
+    int i;
+    for (i = 0; i < iWordCount; i++)
+        pDst[i] &= ~pSrc[i];
+}
+static void equalScalar(BitWord *pHits, const int *piValueId, int iCount, int iValue)
+{
+    int i;
+    for (i = 0; i < iCount; i++)
+    {
+        if (piValueId[i] == iValue)
+            pHits[i / BITS_PER_WORD] |= 1ULL << (i % BITS_PER_WORD);
+    }
+}
+static void multiScalar(BitWord *pMulti, const int *piOffset, int iCount)
+{
+    int i;
+    for (i = 0; i < iCount; i++)
+    {
+        if (piOffset[i + 1] - piOffset[i] > 1)
+            pMulti[i / BITS_PER_WORD] |= 1ULL << (i % BITS_PER_WORD);
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+__attribute__((target("avx2")))
+static void andAvx2(BitWord *pDst, const BitWord *pSrc, int iWordCount)
+{
+    int i;
+    __m256i a;
+    __m256i b;
+    for (i = 0; i + 4 <= iWordCount; i += 4)
+    {
+        a = _mm256_loadu_si256((const __m256i *) (pDst + i));
+        b = _mm256_loadu_si256((const __m256i *) (pSrc + i));
+        _mm256_storeu_si256((__m256i *) (pDst + i), _mm256_and_si256(a, b));
+    }
+    andScalar(pDst + i, pSrc + i, iWordCount - i);
+}
+__attribute__((target("avx2")))
+static void orAvx2(BitWord *pDst, const BitWord *pSrc, int iWordCount)
+{
+    int i;
+    __m256i a;
+    __m256i b;
+    for (i = 0; i + 4 <= iWordCount; i += 4)
+    {
+        a = _mm256_loadu_si256((const __m256i *) (pDst + i));
+        b = _mm256_loadu_si256((const __m256i *) (pSrc + i));
+        _mm256_storeu_si256((__m256i *) (pDst + i), _mm256_or_si256(a, b));
+    }
+    orScalar(pDst + i, pSrc + i, iWordCount - i);
+}
+__attribute__((target("avx2")))
+static void andNotAvx2(BitWord *pDst, const BitWord *pSrc, int iWordCount)
+{
+    int i;
+    __m256i a;
+    __m256i b;
+    for (i = 0; i + 4 <= iWordCount; i += 4)
+    {
+        a = _mm256_loadu_si256((const __m256i *) (pDst + i));
+        b = _mm256_loadu_si256((const __m256i *) (pSrc + i));
+        // _mm256_andnot_si256 computes ~b & a
+        _mm256_storeu_si256((__m256i *) (pDst + i), _mm256_andnot_si256(b, a));
+    }
+    andNotScalar(pDst + i, pSrc + i, iWordCount - i);
+}
+// 8 ints per compare; 8 divides BITS_PER_WORD, so the 8 bits of a
+// compare are in one word
+__attribute__((target("avx2")))
+static void equalAvx2(BitWord *pHits, const int *piValueId, int iCount, int iValue)
+{
+    int i;
+    __m256i value = _mm256_set1_epi32(iValue);
+    __m256i ids;
+    BitWord mask;
+    for (i = 0; i + 8 <= iCount; i += 8)
+    {
+        ids = _mm256_loadu_si256((const __m256i *) (piValueId + i));
+        mask = (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(ids, value)));
+        pHits[i / BITS_PER_WORD] |= mask << (i % BITS_PER_WORD);
+    }
+    for (; i < iCount; i++)
+    {
+        if (piValueId[i] == iValue)
+            pHits[i / BITS_PER_WORD] |= 1ULL << (i % BITS_PER_WORD);
+    }
+}
+__attribute__((target("avx2")))
+static void multiAvx2(BitWord *pMulti, const int *piOffset, int iCount)
+{
+    int i;
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i count;
+    BitWord mask;
+    for (i = 0; i + 8 <= iCount; i += 8)
+    {
+        count = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (piOffset + i + 1))
+            , _mm256_loadu_si256((const __m256i *) (piOffset + i)));
+        mask = (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(count, one)));
+        pMulti[i / BITS_PER_WORD] |= mask << (i % BITS_PER_WORD);
+    }
+    for (; i < iCount; i++)
+    {
+        if (piOffset[i + 1] - piOffset[i] > 1)
+            pMulti[i / BITS_PER_WORD] |= 1ULL << (i % BITS_PER_WORD);
+    }
+}
+#endif
+
+// bitmap kernels in use; selectBitKernels switches them to AVX2
+static BitKernel pfnAnd = andScalar;
+static BitKernel pfnOr = orScalar;
+static BitKernel pfnAndNot = andNotScalar;
+static EqualKernel pfnEqual = equalScalar;
+static MultiKernel pfnMulti = multiScalar;
+static int bScalarKernels = FALSE;      // TRUE after useScalarKernels(TRUE)
+
+/******************** selectBitKernels **************************************
+void selectBitKernels()
+Purpose:
+    Chooses the AVX2 bitmap kernels if the processor supports them and
+    useScalarKernels has not asked for the scalar ones.
+Parameters:
+    n/a
+Returns:
+    n/a
+**************************************************************************/
+static void selectBitKernels()
+{
+    pfnAnd = andScalar;
+    pfnOr = orScalar;
+    pfnAndNot = andNotScalar;
+    pfnEqual = equalScalar;
+    pfnMulti = multiScalar;
+#ifdef HAVE_AVX2_KERNELS
+    if (!bScalarKernels && __builtin_cpu_supports("avx2"))
+    {
+        pfnAnd = andAvx2;
+        pfnOr = orAvx2;
+        pfnAndNot = andNotAvx2;
+        pfnEqual = equalAvx2;
+        pfnMulti = multiAvx2;
+    }
+#endif
+}
+
+/******************** useScalarKernels **************************************
+void useScalarKernels(int bScalar)
+Purpose:
+    Makes the bitmap and column kernels scalar even when the processor
+    has AVX2, or goes back to choosing them by the processor.
+Parameters:
+    I   int bScalar                 TRUE for the scalar kernels
+Returns:
+    n/a
+Notes:
+    - Used by the benchmark to compare the kernels.  The choice applies
+      from the next buildIndex or countColumnMatches.
+**************************************************************************/
+void useScalarKernels(int bScalar)
+{
+    bScalarKernels = bScalar;
+}
+
+/******************** countBits **************************************
+int countBits(const BitWord *pBits, int iWordCount)
+Purpose:
+    Counts the one bits in a bitmap.
+Parameters:
+    I   const BitWord *pBits        bitmap
+    I   int iWordCount              number of words in the bitmap
+Returns:
+    Number of one bits.
+**************************************************************************/
+static int countBits(const BitWord *pBits, int iWordCount)
+{
+    int i;
+    int iCount = 0;
+#ifdef __GNUC__
+    for (i = 0; i < iWordCount; i++)
+        iCount += __builtin_popcountll(pBits[i]);
+#else
+    BitWord word;
+    for (i = 0; i < iWordCount; i++)
+    {
+        word = pBits[i];
+        word = word - ((word >> 1) & 0x5555555555555555ULL);
+        word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+        word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        iCount += (int) ((word * 0x0101010101010101ULL) >> 56);
+    }
+#endif
+    return iCount;
+}
+
+/******************** allocBits **************************************
+BitWord *allocBits(int iWordCount)
+Purpose:
+    Allocates a bitmap with every bit zero.
+Parameters:
+    I   int iWordCount              number of words
+Returns:
+    The bitmap.
+Notes:
+    - Exits with ERR_CUSTOMER_DATA if memory cannot be allocated.
+**************************************************************************/
+static BitWord *allocBits(int iWordCount)
+{
+    BitWord *pBits = calloc(iWordCount > 0 ? iWordCount : 1, sizeof(BitWord));
+    if (pBits == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate a bitmap of %d words", iWordCount);
+    return pBits;
+}
+
+/******************** buildTraitIndex **************************************
+void buildTraitIndex(CustomerIndex index, TraitIndex *pTrait, TraitColumn *pColumn)
+Purpose:
+    Builds the containers of every value of one trait.
+Parameters:
+    I/O CustomerIndex index         index being built.  Its lBytes is
+                                    increased by the trait's memory.
+    O   TraitIndex *pTrait          trait index to build
+    I   TraitColumn *pColumn        the trait's column of the customer set
+Returns:
+    n/a
+Notes:
+    - The containers are counted first, so each list and bitmap is put
+      in its place in one array of each kind.  The customers are visited
+      in order, so every list is sorted.
+**************************************************************************/
+static void buildTraitIndex(CustomerIndex index, TraitIndex *pTrait, TraitColumn *pColumn)
+{
+    IndexContainer *pContainer;
+    long lContainerCount = (long) pColumn->iValueCount * index->iBlockCount;
+    long lContainer;
+    int iNumberCount = 0;               // entries of bitNumberM
+    int iBitmapCount = 0;               // bitmaps of valueBitsM
+    int iCustomer;
+    int iBlock;
+    int i;
+
+    pTrait->iValueCount = pColumn->iValueCount;
+    pTrait->containerM = calloc(lContainerCount + 1, sizeof(IndexContainer));
+    if (pTrait->containerM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate %ld index containers", lContainerCount);
+    pTrait->multiBitsM = allocBits(index->iWordCount);
+
+    // count the customers of each container
+    for (iCustomer = 0; iCustomer < index->iCustomerCount; iCustomer++)
+    {
+        iBlock = iCustomer / (INDEX_BLOCK_WORDS * BITS_PER_WORD);
+        for (i = pColumn->iOffsetM[iCustomer]; i < pColumn->iOffsetM[iCustomer + 1]; i++)
+            pTrait->containerM[(long) pColumn->iValueIdM[i] * index->iBlockCount + iBlock].iCount++;
+        if (pColumn->iOffsetM[iCustomer + 1] - pColumn->iOffsetM[iCustomer] > 1)
+            pTrait->multiBitsM[iCustomer / BITS_PER_WORD] |= 1ULL << (iCustomer % BITS_PER_WORD);
+    }
+
+    // place the lists and bitmaps
+    for (lContainer = 0; lContainer < lContainerCount; lContainer++)
+    {
+        pContainer = &pTrait->containerM[lContainer];
+        if (pContainer->iCount > INDEX_ARRAY_MAX)
+            pContainer->iStart = iBitmapCount++;
+        else
+        {
+            pContainer->iStart = iNumberCount;
+            iNumberCount += pContainer->iCount;
+        }
+    }
+    pTrait->bitNumberM = malloc((iNumberCount + 1) * sizeof(unsigned short));
+    if (pTrait->bitNumberM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate %d index list entries", iNumberCount);
+    pTrait->valueBitsM = allocBits(iBitmapCount * INDEX_BLOCK_WORDS);
+    index->lBytes += (lContainerCount + 1) * sizeof(IndexContainer)
+        + (iNumberCount + 1) * sizeof(unsigned short)
+        + ((long) iBitmapCount * INDEX_BLOCK_WORDS + index->iWordCount) * sizeof(BitWord);
+
+    // fill them.  iCount is counted again as the customers are added.
+    for (lContainer = 0; lContainer < lContainerCount; lContainer++)
+    {
+        pContainer = &pTrait->containerM[lContainer];
+        if (pContainer->iCount <= INDEX_ARRAY_MAX)
+            pContainer->iCount = 0;
+    }
+    for (iCustomer = 0; iCustomer < index->iCustomerCount; iCustomer++)
+    {
+        iBlock = iCustomer / (INDEX_BLOCK_WORDS * BITS_PER_WORD);
+        for (i = pColumn->iOffsetM[iCustomer]; i < pColumn->iOffsetM[iCustomer + 1]; i++)
+        {
+            pContainer = &pTrait->containerM[(long) pColumn->iValueIdM[i] * index->iBlockCount
+                + iBlock];
+            if (pContainer->iCount > INDEX_ARRAY_MAX)
+                pTrait->valueBitsM[(size_t) pContainer->iStart * INDEX_BLOCK_WORDS
+                    + (iCustomer / BITS_PER_WORD) % INDEX_BLOCK_WORDS]
+                    |= 1ULL << (iCustomer % BITS_PER_WORD);
+            else
+                pTrait->bitNumberM[pContainer->iStart + pContainer->iCount++]
+                    = (unsigned short) (iCustomer % (INDEX_BLOCK_WORDS * BITS_PER_WORD));
+        }
+    }
+}
+
+/******************** buildIndex **************************************
+CustomerIndex buildIndex(CustomerSet customerSet)
+Purpose:
+    Builds the (trait, value) containers for every customer in the set.
+Parameters:
+    I   CustomerSet customerSet     customer set to index
+Returns:
+    A dynamically allocated index.  Use freeIndex to free it.
+Notes:
+    - Trait ids and value ids are the same as in the customer set, so
+      a query compiled against the set can be evaluated with the index.
+    - A bit number in a list is below INDEX_BLOCK_WORDS * BITS_PER_WORD,
+      which must fit in an unsigned short.
+**************************************************************************/
+CustomerIndex buildIndex(CustomerSet customerSet)
+{
+    CustomerIndex index = calloc(1, sizeof(CustomerIndexImp));
+    int iWordCount;
+    int iCustomer;
+    int iTrait;
+
+    if (index == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate a customer index");
+    selectBitKernels();
+
+    iWordCount = (customerSet->iCustomerCount + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    index->iCustomerCount = customerSet->iCustomerCount;
+    index->iWordCount = iWordCount;
+    index->iBlockCount = (iWordCount + INDEX_BLOCK_WORDS - 1) / INDEX_BLOCK_WORDS;
+    index->iTraitCount = customerSet->iTraitCount;
+    index->allBitsM = allocBits(iWordCount);
+    index->lBytes = (long) iWordCount * sizeof(BitWord);
+    for (iCustomer = 0; iCustomer < customerSet->iCustomerCount; iCustomer++)
+        index->allBitsM[iCustomer / BITS_PER_WORD] |= 1ULL << (iCustomer % BITS_PER_WORD);
+
+    for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+        buildTraitIndex(index, &index->traitM[iTrait], &customerSet->traitM[iTrait]);
+    return index;
+}
+
+/******************** freeIndex **************************************
+void freeIndex(CustomerIndex index)
+Purpose:
+    Frees a customer index and all of its containers.
+Parameters:
+    I/O CustomerIndex index         index to free
+Returns:
+    n/a
+**************************************************************************/
+void freeIndex(CustomerIndex index)
+{
+    int i;
+    for (i = 0; i < index->iTraitCount; i++)
+    {
+        free(index->traitM[i].containerM);
+        free(index->traitM[i].bitNumberM);
+        free(index->traitM[i].valueBitsM);
+        free(index->traitM[i].multiBitsM);
+    }
+    free(index->allBitsM);
+    free(index);
+}
+
+/******************** isBlockEmpty **************************************
+int isBlockEmpty(const BitWord *pBits, int iWordCount)
+Purpose:
+    Determines whether a block of a bitmap has no customers.
+Parameters:
+    I   const BitWord *pBits        block of bitmap words
+    I   int iWordCount              number of words in the block
+Returns:
+    TRUE if every bit is zero, FALSE otherwise.
+**************************************************************************/
+static int isBlockEmpty(const BitWord *pBits, int iWordCount)
+{
+    int i;
+    for (i = 0; i < iWordCount; i++)
+    {
+        if (pBits[i] != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/******************** isBlockFull **************************************
+int isBlockFull(const BitWord *pBits, const BitWord *pAllBits, int iWordCount)
+Purpose:
+    Determines whether a block of a bitmap has every customer.
+Parameters:
+    I   const BitWord *pBits        block of bitmap words
+    I   const BitWord *pAllBits     same block of the bitmap of every customer
+    I   int iWordCount              number of words in the block
+Returns:
+    TRUE if the blocks are equal, FALSE otherwise.
+**************************************************************************/
+static int isBlockFull(const BitWord *pBits, const BitWord *pAllBits, int iWordCount)
+{
+    int i;
+    for (i = 0; i < iWordCount; i++)
+    {
+        if (pBits[i] != pAllBits[i])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/******************** compareBlock **************************************
+void compareBlock(BitWord *pDst, Instr *pInstr, CustomerIndex index
+    , int iWordStart, int iWords)
+Purpose:
+    Evaluates a comparison for one block of customers.
+Parameters:
+    O   BitWord *pDst               block receiving the customers matching
+                                    the comparison
+    I   Instr *pInstr               comparison instruction
+    I   CustomerIndex index         customer index
+    I   int iWordStart              first bitmap word of the block (a
+                                    multiple of INDEX_BLOCK_WORDS)
+    I   int iWords                  number of words in the block
+Returns:
+    n/a
+Notes:
+    - A list container sets or clears only its customers' bits, so a
+      sparse value costs little more than the block's memset or memcpy.
+**************************************************************************/
+static void compareBlock(BitWord *pDst, Instr *pInstr, CustomerIndex index
+    , int iWordStart, int iWords)
+{
+    TraitIndex *pTrait = NULL;
+    IndexContainer *pContainer = NULL;
+    const BitWord *pValueBits = NULL;   // bitmap of a dense container
+    const unsigned short *piBitNumber;  // list of a sparse container
+    const BitWord *pMultiBits;
+    int iBit;
+    int i;
+
+    if (pInstr->iValue >= 0)
+    {
+        pTrait = &index->traitM[pInstr->iTrait];
+        pContainer = &pTrait->containerM[(long) pInstr->iValue * index->iBlockCount
+            + iWordStart / INDEX_BLOCK_WORDS];
+        if (pContainer->iCount == 0)
+            pContainer = NULL;
+        else if (pContainer->iCount > INDEX_ARRAY_MAX)
+            pValueBits = pTrait->valueBitsM + (size_t) pContainer->iStart * INDEX_BLOCK_WORDS;
+    }
+    switch (pInstr->iOp)
+    {
+        case OP_NOTANY:
+            memcpy(pDst, index->allBitsM + iWordStart, iWords * sizeof(BitWord));
+            if (pValueBits != NULL)
+                pfnAndNot(pDst, pValueBits, iWords);
+            else if (pContainer != NULL)
+            {
+                piBitNumber = pTrait->bitNumberM + pContainer->iStart;
+                for (i = 0; i < pContainer->iCount; i++)
+                    pDst[piBitNumber[i] / BITS_PER_WORD] &= ~(1ULL << (piBitNumber[i] % BITS_PER_WORD));
+            }
+            break;
+        case OP_ONLY:
+            if (pValueBits != NULL)
+            {
+                memcpy(pDst, pValueBits, iWords * sizeof(BitWord));
+                pfnAndNot(pDst, pTrait->multiBitsM + iWordStart, iWords);
+                break;
+            }
+            memset(pDst, 0, iWords * sizeof(BitWord));
+            if (pContainer != NULL)
+            {
+                piBitNumber = pTrait->bitNumberM + pContainer->iStart;
+                pMultiBits = pTrait->multiBitsM + iWordStart;
+                for (i = 0; i < pContainer->iCount; i++)
+                {
+                    iBit = piBitNumber[i];
+                    if ((pMultiBits[iBit / BITS_PER_WORD] & (1ULL << (iBit % BITS_PER_WORD))) == 0)
+                        pDst[iBit / BITS_PER_WORD] |= 1ULL << (iBit % BITS_PER_WORD);
+                }
+            }
+            break;
+        default:
+            if (pValueBits != NULL)
+            {
+                memcpy(pDst, pValueBits, iWords * sizeof(BitWord));
+                break;
+            }
+            memset(pDst, 0, iWords * sizeof(BitWord));
+            if (pContainer != NULL)
+            {
+                piBitNumber = pTrait->bitNumberM + pContainer->iStart;
+                for (i = 0; i < pContainer->iCount; i++)
+                    pDst[piBitNumber[i] / BITS_PER_WORD] |= 1ULL << (piBitNumber[i] % BITS_PER_WORD);
+            }
+    }
+}
+
+/******************** countIndexMatches **************************************
+int countIndexMatches(Query query, CustomerIndex index)
+Purpose:
+    Counts the customers that satisfy a compiled query using the
+    bitmap index.
+Parameters:
+    I   Query query                 compiled query
+    I   CustomerIndex index         index of the customer set the query
+                                    was compiled against
+Returns:
+    Number of matching customers.
+Notes:
+    - The bitmaps are processed INDEX_BLOCK_WORDS words at a time so the
+      evaluation stack stays small and in cache.
+    - The evaluation stack has query->iMaxDepth blocks.
+    - A jump added by optimizeQuery is taken when the top block is all
+      false (JUMP_FALSE) or all true (JUMP_TRUE), skipping the bitmap
+      work for the rest of the AND or OR in that block.
+**************************************************************************/
+int countIndexMatches(Query query, CustomerIndex index)
+{
+    BitWord *stackM;                    // evaluation stack of bitmap blocks
+    BitWord *pTop;
+    Instr *pInstr;
+    int iTop;
+    int iWordStart;
+    int iWords;
+    int iCount = 0;
+    int i;
+
+    stackM = malloc((size_t) query->iMaxDepth * INDEX_BLOCK_WORDS * sizeof(BitWord));
+    if (stackM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate the index evaluation stack");
+
+    for (iWordStart = 0; iWordStart < index->iWordCount; iWordStart += INDEX_BLOCK_WORDS)
+    {
+        iWords = index->iWordCount - iWordStart;
+        if (iWords > INDEX_BLOCK_WORDS)
+            iWords = INDEX_BLOCK_WORDS;
+        iTop = 0;
+        for (i = 0; i < query->iInstrCount; i++)
+        {
+            pInstr = &query->instrM[i];
+            if (pInstr->iOp == OP_JUMP_FALSE || pInstr->iOp == OP_JUMP_TRUE)
+            {
+                pTop = stackM + (size_t) (iTop - 1) * INDEX_BLOCK_WORDS;
+                if (pInstr->iOp == OP_JUMP_FALSE ? isBlockEmpty(pTop, iWords)
+                    : isBlockFull(pTop, index->allBitsM + iWordStart, iWords))
+                    i = pInstr->iValue - 1;
+                continue;
+            }
+            if (pInstr->iOp == OP_AND || pInstr->iOp == OP_OR)
+            {
+                iTop--;
+                pTop = stackM + (size_t) iTop * INDEX_BLOCK_WORDS;
+                if (pInstr->iOp == OP_AND)
+                    pfnAnd(pTop - INDEX_BLOCK_WORDS, pTop, iWords);
+                else
+                    pfnOr(pTop - INDEX_BLOCK_WORDS, pTop, iWords);
+                continue;
+            }
+
+            // comparison: push a new block
+            pTop = stackM + (size_t) iTop * INDEX_BLOCK_WORDS;
+            iTop++;
+            compareBlock(pTop, pInstr, index, iWordStart, iWords);
+        }
+        iCount += countBits(stackM, iWords);
+    }
+    free(stackM);
+    return iCount;
+}
+
+/******************** setCustomerBits **************************************
+void setCustomerBits(BitWord *pDst, const BitWord *pHits, const int *piOffset
+    , int iCustomers)
+Purpose:
+    Sets the bit of every customer of a block having at least one hit
+    among its values.
+Parameters:
+    O   BitWord *pDst               block of customer bits (starts as zeros)
+    I   const BitWord *pHits        bit i is set if value i of the block hit
+    I   const int *piOffset         the column's iOffsetM for the block's
+                                    first customer
+    I   int iCustomers              customers in the block
+Returns:
+    n/a
+Notes:
+    - The values of the block are in customer order, so one pass over the
+      hits moves a customer cursor forward.  Hits are usually few, and
+      words without a hit are skipped.
+**************************************************************************/
+static void setCustomerBits(BitWord *pDst, const BitWord *pHits, const int *piOffset
+    , int iCustomers)
+{
+    int iEntries = piOffset[iCustomers] - piOffset[0];
+    int iCustomer = 0;
+    int iEntry;
+    int iWord;
+    BitWord word;
+
+    for (iWord = 0; iWord * BITS_PER_WORD < iEntries; iWord++)
+    {
+        for (word = pHits[iWord]; word != 0; word &= word - 1)
+        {
+#ifdef __GNUC__
+            iEntry = iWord * BITS_PER_WORD + __builtin_ctzll(word);
+#else
+            for (iEntry = iWord * BITS_PER_WORD; !(word & (1ULL << (iEntry % BITS_PER_WORD)))
+                ; iEntry++)
+                ;
+#endif
+            while (piOffset[iCustomer + 1] - piOffset[0] <= iEntry)
+                iCustomer++;
+            pDst[iCustomer / BITS_PER_WORD] |= 1ULL << (iCustomer % BITS_PER_WORD);
+        }
+    }
+}
+
+/******************** compareColumnBlock **************************************
+void compareColumnBlock(BitWord *pDst, Instr *pInstr, CustomerSet customerSet
+    , int iFirst, int iCustomers, const BitWord *pAllBits, BitWord *pWork)
+Purpose:
+    Evaluates a comparison for one block of customers from the columns
+    of the customer set.
+Parameters:
+    O   BitWord *pDst               block receiving the customers matching
+                                    the comparison
+    I   Instr *pInstr               comparison instruction
+    I   CustomerSet customerSet     customer set the query was compiled against
+    I   int iFirst                  first customer of the block
+    I   int iCustomers              customers in the block
+    I   const BitWord *pAllBits     block with a bit for each of its customers
+    I/O BitWord *pWork              work area with a bit for each value of
+                                    the block, and COLUMN_BLOCK_WORDS more
+Returns:
+    n/a
+**************************************************************************/
+static void compareColumnBlock(BitWord *pDst, Instr *pInstr, CustomerSet customerSet
+    , int iFirst, int iCustomers, const BitWord *pAllBits, BitWord *pWork)
+{
+    int iWords = (iCustomers + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    TraitColumn *pColumn;
+    const int *piOffset;
+    int iEntries;
+    int iHitWords;
+    BitWord *pMulti;
+
+    memset(pDst, 0, iWords * sizeof(BitWord));
+    if (pInstr->iValue >= 0)
+    {
+        pColumn = &customerSet->traitM[pInstr->iTrait];
+        piOffset = pColumn->iOffsetM + iFirst;
+        iEntries = piOffset[iCustomers] - piOffset[0];
+        iHitWords = (iEntries + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        memset(pWork, 0, iHitWords * sizeof(BitWord));
+        pfnEqual(pWork, pColumn->iValueIdM + piOffset[0], iEntries, pInstr->iValue);
+        setCustomerBits(pDst, pWork, piOffset, iCustomers);
+        if (pInstr->iOp == OP_ONLY)
+        {
+            pMulti = pWork + iHitWords;
+            memset(pMulti, 0, iWords * sizeof(BitWord));
+            pfnMulti(pMulti, piOffset, iCustomers);
+            pfnAndNot(pDst, pMulti, iWords);
+        }
+    }
+    if (pInstr->iOp == OP_NOTANY)
+    {
+        // every customer minus those with the value
+        memcpy(pWork, pDst, iWords * sizeof(BitWord));
+        memcpy(pDst, pAllBits, iWords * sizeof(BitWord));
+        pfnAndNot(pDst, pWork, iWords);
+    }
+}
+
+/******************** countColumnMatches **************************************
+int countColumnMatches(Query query, CustomerSet customerSet)
+Purpose:
+    Counts the customers that satisfy a compiled query, evaluating it a
+    block of customers at a time from the columns of the customer set.
+Parameters:
+    I   Query query                 compiled query
+    I   CustomerSet customerSet     customer set the query was compiled against
+Returns:
+    Number of matching customers.
+Notes:
+    - Needs no index.  Each instruction is done for a whole block of
+      COLUMN_BLOCK_WORDS words before the next one, so there is one
+      dispatch per instruction and block instead of per customer.
+    - Jumps added by optimizeQuery are taken as in countIndexMatches.
+**************************************************************************/
+int countColumnMatches(Query query, CustomerSet customerSet)
+{
+    BitWord *stackM;                    // evaluation stack of blocks
+    BitWord *workM = NULL;              // hits of a block's values
+    BitWord allBitsM[COLUMN_BLOCK_WORDS];
+    BitWord *pTop;
+    Instr *pInstr;
+    int iWorkMax = 0;
+    int iEntries;
+    int iFirst;
+    int iCustomers;
+    int iWords;
+    int iTop;
+    int iCount = 0;
+    int iTrait;
+    int i;
+
+    selectBitKernels();
+    stackM = malloc((size_t) query->iMaxDepth * COLUMN_BLOCK_WORDS * sizeof(BitWord));
+    if (stackM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate the column evaluation stack");
+
+    for (iFirst = 0; iFirst < customerSet->iCustomerCount
+        ; iFirst += COLUMN_BLOCK_WORDS * BITS_PER_WORD)
+    {
+        iCustomers = customerSet->iCustomerCount - iFirst;
+        if (iCustomers > COLUMN_BLOCK_WORDS * BITS_PER_WORD)
+            iCustomers = COLUMN_BLOCK_WORDS * BITS_PER_WORD;
+        iWords = (iCustomers + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        for (i = 0; i < iWords; i++)
+            allBitsM[i] = ~0ULL;
+        if (iCustomers % BITS_PER_WORD != 0)
+            allBitsM[iWords - 1] = (1ULL << (iCustomers % BITS_PER_WORD)) - 1;
+
+        // room for a bit per value of the block in any column
+        for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+        {
+            iEntries = customerSet->traitM[iTrait].iOffsetM[iFirst + iCustomers]
+                - customerSet->traitM[iTrait].iOffsetM[iFirst];
+            if ((iEntries + BITS_PER_WORD - 1) / BITS_PER_WORD + COLUMN_BLOCK_WORDS > iWorkMax)
+            {
+                iWorkMax = (iEntries + BITS_PER_WORD - 1) / BITS_PER_WORD + COLUMN_BLOCK_WORDS;
+                free(workM);
+                workM = malloc(iWorkMax * sizeof(BitWord));
+                if (workM == NULL)
+                    ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d hit words", iWorkMax);
+            }
+        }
+
+        iTop = 0;
+        for (i = 0; i < query->iInstrCount; i++)
+        {
+            pInstr = &query->instrM[i];
+            if (pInstr->iOp == OP_JUMP_FALSE || pInstr->iOp == OP_JUMP_TRUE)
+            {
+                pTop = stackM + (size_t) (iTop - 1) * COLUMN_BLOCK_WORDS;
+                if (pInstr->iOp == OP_JUMP_FALSE ? isBlockEmpty(pTop, iWords)
+                    : isBlockFull(pTop, allBitsM, iWords))
+                    i = pInstr->iValue - 1;
+                continue;
+            }
+            if (pInstr->iOp == OP_AND || pInstr->iOp == OP_OR)
+            {
+                iTop--;
+                pTop = stackM + (size_t) iTop * COLUMN_BLOCK_WORDS;
+                if (pInstr->iOp == OP_AND)
+                    pfnAnd(pTop - COLUMN_BLOCK_WORDS, pTop, iWords);
+                else
+                    pfnOr(pTop - COLUMN_BLOCK_WORDS, pTop, iWords);
+                continue;
+            }
+
+            // comparison: push a new block
+            pTop = stackM + (size_t) iTop * COLUMN_BLOCK_WORDS;
+            iTop++;
+            compareColumnBlock(pTop, pInstr, customerSet, iFirst, iCustomers, allBitsM
+                , workM);
+        }
+        iCount += countBits(stackM, iWords);
+    }
+    free(workM);
+    free(stackM);
+    return iCount;
+}
+
+/******************** countDagQueries **************************************
+void countDagQueries(QueryDag dag, CustomerIndex index, int iMatchM[])
+Purpose:
+    Counts the customers matching every query of a batch one query at a
+    time, as countIndexMatches does, for countDagMatches.
+Parameters:
+    I   QueryDag dag                DAG built by addDagQuery
+    I   CustomerIndex index         index of the customer set the queries
+                                    were compiled against
+    O   int iMatchM[]               as for countDagMatches
+Returns:
+    n/a
+Notes:
+    - The nodes of each root are listed in postfix order, as its query was
+      compiled, and evaluated on a stack of blocks that is worked on in
+      place.  A node shared by two roots is listed, and evaluated, for
+      each of them.
+    - Each root is evaluated on every block before the next root, as
+      countIndexMatches evaluates a query.  Taking every root on one block
+      at a time was 10% slower.
+**************************************************************************/
+static void countDagQueries(QueryDag dag, CustomerIndex index, int iMatchM[])
+{
+    int *iOrderM;                       // nodes of each root in postfix order
+    int *iRootStartM;                   // start of each root's nodes in iOrderM
+    int *iRootM;                        // the roots
+    int *iWorkM;                        // nodes to list; ~i lists node i itself
+    int iOrderCount = 0;
+    int iRootCount = 0;
+    int iWork;
+    int iDepth;
+    int iMaxDepth = 1;
+    BitWord *stackM;                    // evaluation stack of bitmap blocks
+    BitWord *pTop;
+    DagNode *pNode;
+    int iNode;
+    int iTop;
+    int iWordStart;
+    int iWords;
+    int i;
+    int k;
+
+    iOrderM = malloc((dag->lInstrCount + 1) * sizeof(int));
+    iWorkM = malloc((2 * dag->lInstrCount + 1) * sizeof(int));
+    iRootStartM = malloc((dag->iNodeCount + 1) * sizeof(int));
+    iRootM = malloc((dag->iNodeCount + 1) * sizeof(int));
+    if (iOrderM == NULL || iWorkM == NULL || iRootStartM == NULL || iRootM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate the DAG evaluation plan");
+
+    // list the nodes of each root without recursion, since a long AND or
+    // OR is as deep as it is long
+    for (i = 0; i < dag->iNodeCount; i++)
+    {
+        iMatchM[i] = 0;
+        if (!dag->nodeM[i].bRoot)
+            continue;
+        iRootM[iRootCount] = i;
+        iRootStartM[iRootCount++] = iOrderCount;
+        iWork = 0;
+        iDepth = 0;
+        iWorkM[iWork++] = i;
+        while (iWork > 0)
+        {
+            iNode = iWorkM[--iWork];
+            if (iNode >= 0 && dag->nodeM[iNode].iLeft >= 0)
+            {
+                iWorkM[iWork++] = ~iNode;
+                iWorkM[iWork++] = dag->nodeM[iNode].iRight;
+                iWorkM[iWork++] = dag->nodeM[iNode].iLeft;
+                continue;
+            }
+            if (iNode >= 0)
+            {
+                iDepth++;
+                if (iDepth > iMaxDepth)
+                    iMaxDepth = iDepth;
+            }
+            else
+            {
+                iNode = ~iNode;
+                iDepth--;
+            }
+            iOrderM[iOrderCount++] = iNode;
+        }
+    }
+    iRootStartM[iRootCount] = iOrderCount;
+    free(iWorkM);
+
+    stackM = malloc((size_t) iMaxDepth * INDEX_BLOCK_WORDS * sizeof(BitWord));
+    if (stackM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate the index evaluation stack");
+    for (i = 0; i < iRootCount; i++)
+    {
+        for (iWordStart = 0; iWordStart < index->iWordCount; iWordStart += INDEX_BLOCK_WORDS)
+        {
+            iWords = index->iWordCount - iWordStart;
+            if (iWords > INDEX_BLOCK_WORDS)
+                iWords = INDEX_BLOCK_WORDS;
+            iTop = 0;
+            for (k = iRootStartM[i]; k < iRootStartM[i + 1]; k++)
+            {
+                pNode = &dag->nodeM[iOrderM[k]];
+                if (pNode->iLeft < 0)
+                {
+                    // comparison: push a new block
+                    compareBlock(stackM + (size_t) iTop * INDEX_BLOCK_WORDS, &pNode->instr
+                        , index, iWordStart, iWords);
+                    iTop++;
+                    continue;
+                }
+                iTop--;
+                pTop = stackM + (size_t) iTop * INDEX_BLOCK_WORDS;
+                if (pNode->instr.iOp == OP_AND)
+                    pfnAnd(pTop - INDEX_BLOCK_WORDS, pTop, iWords);
+                else
+                    pfnOr(pTop - INDEX_BLOCK_WORDS, pTop, iWords);
+            }
+            iMatchM[iRootM[i]] += countBits(stackM, iWords);
+        }
+    }
+    free(stackM);
+    free(iOrderM);
+    free(iRootStartM);
+    free(iRootM);
+}
+
+/******************** countDagMatches **************************************
+void countDagMatches(QueryDag dag, CustomerIndex index, int iMatchM[])
+Purpose:
+    Counts the customers matching every query of a batch, evaluating
+    each node of the batch's DAG once.
+Parameters:
+    I   QueryDag dag                DAG built by addDagQuery
+    I   CustomerIndex index         index of the customer set the queries
+                                    were compiled against
+    O   int iMatchM[]               for each root node, the number of
+                                    matching customers.  It must have
+                                    dag->iNodeCount entries; entries of
+                                    other nodes are set to 0.
+Returns:
+    n/a
+Notes:
+    - Each node's block is kept only until its last use.  Blocks are
+      assigned to nodes once, before evaluation.  An AND or OR takes the
+      block of an operand used for the last time and works in place, as
+      countIndexMatches does on its stack; only an AND or OR of two
+      operands used again copies one of them.  Other nodes take a free
+      block.  A root is counted as soon as it is evaluated.
+    - A batch with fewer than DAG_MIN_SHARING instructions per 100 nodes
+      has almost nothing to share, and is counted one query at a time by
+      countDagQueries instead, which needs only the blocks of the deepest
+      query.  dag->bPerQuery is set then.
+**************************************************************************/
+void countDagMatches(QueryDag dag, CustomerIndex index, int iMatchM[])
+{
+    int *iLastUseM;                     // last node using each node
+    int *iBlockM;                       // block of each node
+    int *iFreeM;                        // stack of free blocks
+    int iFreeCount = 0;
+    int iBlockCount = 0;
+    BitWord *blockM;
+    BitWord *pDst;
+    BitWord *pLeft;
+    BitWord *pRight;
+    DagNode *pNode;
+    int iWordStart;
+    int iWords;
+    int i;
+
+    dag->bPerQuery = dag->lInstrCount * 100 < (long) DAG_MIN_SHARING * dag->iNodeCount;
+    if (dag->bPerQuery)
+    {
+        countDagQueries(dag, index, iMatchM);
+        return;
+    }
+    iLastUseM = malloc((dag->iNodeCount + 1) * sizeof(int));
+    iBlockM = malloc((dag->iNodeCount + 1) * sizeof(int));
+    iFreeM = malloc((dag->iNodeCount + 1) * sizeof(int));
+    if (iLastUseM == NULL || iBlockM == NULL || iFreeM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate the DAG evaluation plan");
+
+    // assign the blocks
+    for (i = 0; i < dag->iNodeCount; i++)
+    {
+        iLastUseM[i] = i;
+        pNode = &dag->nodeM[i];
+        if (pNode->iLeft >= 0)
+            iLastUseM[pNode->iLeft] = iLastUseM[pNode->iRight] = i;
+    }
+    for (i = 0; i < dag->iNodeCount; i++)
+    {
+        pNode = &dag->nodeM[i];
+        iBlockM[i] = -1;
+        if (pNode->iLeft >= 0)
+        {
+            if (iLastUseM[pNode->iLeft] == i)
+                iBlockM[i] = iBlockM[pNode->iLeft];
+            else if (iLastUseM[pNode->iRight] == i)
+                iBlockM[i] = iBlockM[pNode->iRight];
+            if (iLastUseM[pNode->iRight] == i && iBlockM[pNode->iRight] != iBlockM[i])
+                iFreeM[iFreeCount++] = iBlockM[pNode->iRight];
+        }
+        if (iBlockM[i] < 0)
+            iBlockM[i] = iFreeCount > 0 ? iFreeM[--iFreeCount] : iBlockCount++;
+        if (iLastUseM[i] == i)
+            iFreeM[iFreeCount++] = iBlockM[i];
+        iMatchM[i] = 0;
+    }
+
+    blockM = malloc((size_t) (iBlockCount + 1) * INDEX_BLOCK_WORDS * sizeof(BitWord));
+    if (blockM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d DAG blocks", iBlockCount);
+    for (iWordStart = 0; iWordStart < index->iWordCount; iWordStart += INDEX_BLOCK_WORDS)
+    {
+        iWords = index->iWordCount - iWordStart;
+        if (iWords > INDEX_BLOCK_WORDS)
+            iWords = INDEX_BLOCK_WORDS;
+        for (i = 0; i < dag->iNodeCount; i++)
+        {
+            pNode = &dag->nodeM[i];
+            pDst = blockM + (size_t) iBlockM[i] * INDEX_BLOCK_WORDS;
+            if (pNode->iLeft < 0)
+                compareBlock(pDst, &pNode->instr, index, iWordStart, iWords);
+            else
+            {
+                pLeft = blockM + (size_t) iBlockM[pNode->iLeft] * INDEX_BLOCK_WORDS;
+                pRight = blockM + (size_t) iBlockM[pNode->iRight] * INDEX_BLOCK_WORDS;
+                if (pDst == pRight)
+                    pRight = pLeft;     // in place in the right operand
+                else if (pDst != pLeft)
+                    memcpy(pDst, pLeft, iWords * sizeof(BitWord));
+                if (pNode->instr.iOp == OP_AND)
+                    pfnAnd(pDst, pRight, iWords);
+                else
+                    pfnOr(pDst, pRight, iWords);
+            }
+            if (pNode->bRoot)
+                iMatchM[i] += countBits(pDst, iWords);
+        }
+    }
+    free(blockM);
+    free(iLastUseM);
+    free(iBlockM);
+    free(iFreeM);
+}
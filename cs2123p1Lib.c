@@ -0,0 +1,1579 @@
+/******************************************************************************
+cs2123p1Lib.c by Larry Clark
+Purpose:
+    Support functions shared by the driver (cs2123p1Driver.c) and the
+    benchmark (cs2123p1Bench.c):
+        the stack, out and arena functions
+        the symbol table used by categorize
+        the block line reader and the output buffer
+        ErrExit, tryConvertToPostFix, trapErrors, getToken and getTokenView
+Notes:
+    1. This file uses an array to implement the stack.  It starts with
+       MAX_STACK_ELEM elements and grows as needed.
+    2. The Out array for the resulting postfix expression starts with
+       MAX_OUT_ITEM elements and grows as needed.  The Out and the stack
+       used to convert a query come from an arena that is reset for each
+       query.
+    3. The symbol table may be used by several threads at once.
+    4. tryConvertToPostFix sets an error trap for its thread, so an error
+       during the conversion is returned instead of ending the program.
+       This lets a long-running program, such as cs2123p1Server.c, use
+       the conversion as a library.
+*******************************************************************************/
+// If compiling using visual studio, tell the compiler not to give its warnings
+// about the safety of scanf and printf
+#define _CRT_SECURE_NO_WARNINGS 1
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include "cs2123p1.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#include <stdint.h>
+#define HAVE_SSE2_SCAN 1
+#endif
+
+// the following structure is used by the categorize function to categorize 
+// tokens.  The symbol table starts with these entries in this order, so
+// their symbol ids are the SYMBOL_ constants in cs2123p1.h.
+static struct
+{
+    char szSymbol[MAX_TOKEN + 1];
+    int iCategory;
+    int iPrecedence;
+} symbolDefM[] =
+{
+    "(",        CAT_LPAREN,   0
+    , ")",      CAT_RPAREN,   0
+    , "=",      CAT_OPERATOR, 2
+    , "NOTANY", CAT_OPERATOR, 2
+    , "ONLY",   CAT_OPERATOR, 2
+    , "AND",    CAT_OPERATOR, 1
+    , "OR",     CAT_OPERATOR, 1
+    , "", 0, 0					// null terminating
+};
+
+// symbolDefSlotM maps the length and first character of a token to the
+// only symbolDefM entry that could match it (-1 if none).  It is built
+// from symbolDefM by buildSymbolDefSlots, so adding an operator to
+// symbolDefM is all that is needed.
+#define SYMBOL_DEF_SLOTS 256
+#define SYMBOL_DEF_SLOT(iLength, cFirst) \
+    ((((iLength) << 5) ^ (unsigned char) (cFirst)) & (SYMBOL_DEF_SLOTS - 1))
+static int symbolDefSlotM[SYMBOL_DEF_SLOTS];
+static int bSymbolDefSlotsBuilt = FALSE;
+
+// loads and stores of symbol table entries shared between threads
+#ifdef __GNUC__
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+#define LOAD_ACQUIRE(p) (*(p))
+#define STORE_RELEASE(p, v) (*(p) = (v))
+#endif
+
+// SymbolHash typedef is an open addressing hash table of symbol ids.  An
+// empty slot has -1.  A table that has been replaced by a larger one is
+// kept on the pRetired list since other threads may still be reading it.
+typedef struct SymbolHash
+{
+    int iSize;                          // number of slots (power of 2)
+    int *iSlotM;
+    struct SymbolHash *pRetired;        // previous (smaller) table
+} SymbolHash;
+
+// the symbol table used by internSymbol.  Symbols are kept in blocks of
+// SYMBOL_BLOCK_SIZE that never move, so a symbol can be read without a
+// lock once its id is in the hash table.  Adding a symbol is done while
+// holding symbolLock.
+#define SYMBOL_BLOCK_SIZE 4096
+#define MAX_SYMBOL_BLOCKS 16384
+#define SYMBOL(iSymbol) \
+    (&symbolBlockM[(iSymbol) / SYMBOL_BLOCK_SIZE][(iSymbol) % SYMBOL_BLOCK_SIZE])
+static Symbol *symbolBlockM[MAX_SYMBOL_BLOCKS];
+static int iSymbolCount = 0;            // number of symbols
+static SymbolHash *pSymbolHash = NULL;  // current hash table
+static pthread_mutex_t symbolLock = PTHREAD_MUTEX_INITIALIZER;
+
+// ErrorTrap typedef is where ErrExit returns to, instead of exiting, in
+// the thread that set it
+typedef struct ErrorTrap
+{
+    jmp_buf jumpBuffer;
+    char *pszError;                     // receives the error message
+    int iErrorSize;                     // size of pszError
+    int rc;                             // iexitRC passed to ErrExit
+    struct ErrorTrap *pPrev;            // trap set before this one
+} ErrorTrap;
+static __thread ErrorTrap *pErrorTrap = NULL;
+
+static Element *growElements(Element *elementM, int iCount, int *piMax, Arena arena);
+static void addArenaBlock(Arena arena, size_t iSize);
+
+// Stack implementation using arrays.  You are not required to document these.
+/************************* push ***************************************
+void push(Stack stack, Element value)
+Purpose:
+   This function places an object into an array.  It is designed
+   to operate like a stack call.  The object is pushed onto the
+   top of the stack.
+Parameters:
+   I/O Stack stack             A pointer to a stackImp structure
+   I   Element value           A structure with data to be stacked
+Returns:
+   Nothing is returned functionally.  A new element is added into
+   an array (which we will call a stack).
+Notes:
+   This function takes a pointer to a stackImp structure which
+   as a member has an array of Element structures.  First, it 
+   ensures that the array has room for the new element (i.e., number
+   of elements in stack->element[] does not exceed its size).  
+   If the array is full, growElements doubles its size.  Then the
+   new element is pushed on a stack and stack counter (array count)
+   is incremented.
+**********************************************************************/
+void push(Stack stack, Element value)
+{
+    if (stack->iCount >= stack->iMax)
+        stack->stackElementM = growElements(stack->stackElementM, stack->iCount
+            , &stack->iMax, stack->arena);
+    stack->stackElementM[stack->iCount] = value;
+    stack->iCount++;
+}
+/********************************* pop *******************************
+Element pop(Stack stack)
+Purpose:
+   Function simulates the stack operation pop which removes the top
+   object from a stack.  In this case an array is used to represent
+   the stack.
+Parameters:
+   I/O Stack stack          A pointer to a stackImp structure
+Returns:
+   The top element structure on the stack is returned.
+Notes:
+   First, the function calls isEmpty(stack) is called to determine
+   if the stack is empty.  This prevents a stack condition known as
+   underflow.  If an underflow or empty stack is encountered, the 
+   program terminates.  If an underflow condition is not possible,
+   the program decrements iCount (count of array) and returns the
+   top element on the stack.  The function push() increments iCount
+   after adding a new element to the stack which means that iCount
+   is actually pointing to an empty array element.  This is the 
+   reason it is decremented first.
+*********************************************************************/
+Element pop(Stack stack)
+{
+    if (isEmpty(stack))
+        ErrExit(ERR_STACK_USAGE
+        , "Attempt to POP an empty array stack");
+    else
+    {
+        stack->iCount--;
+        return stack->stackElementM[stack->iCount];
+    }
+}
+/****************************** topElement ******************************
+Element topElement(Stack stack)
+Purpose:
+   Function returns the top object (element) on the stack.
+Parameters:
+   I Stack stack            A pointer to a stackImp structure
+Returns:
+   Functionally, it returns the top element from the stack.
+Notes:
+   First, the function isEmpty(stack) is called to ensure the stack 
+   is not empty.  If isEmpty returns FALSE the top element of the 
+   stack is returned.  The variable iCount always points to an
+   empty array element.  When it is decremented it points to the top
+   of the stack.  In the case of this function, the top element is 
+   returned without it being removed from the stack.  This is achieved
+   by subtracting one from iCount ensuring it is not permanently 
+   decremented.
+************************************************************************/ 
+Element topElement(Stack stack)
+{
+    if (isEmpty(stack))
+        ErrExit(ERR_STACK_USAGE
+        , "Attempt to examine topElement of an empty array stack");
+    else
+        return stack->stackElementM[stack->iCount-1];    // return the top
+}
+/****************************** isEmpty(Stack stack) ******************************
+int isEmpty(Stack stack)
+Purpose:
+   Function determines if a given stack is empty.
+Parameters:
+   Stack stack             A pointer to a stackImp structure
+Returns:
+   An integer value is returned corresponding to TRUE or FALSE.  Any non-zero
+   integer is considered TRUE in C.
+Notes:
+   If stack is empty an integer value corresponding to TRUE is returned else FALSE
+   is returned.  If the array counter iCount is less than or equal to zero, TRUE
+   is returned indicating the stack is empty otherwise FALSE is returned and the
+   stack is not empty.
+**********************************************************************************/
+int isEmpty(Stack stack)
+{
+    return stack->iCount <= 0;
+}
+Stack newStack()
+{
+    return newArenaStack(NULL);
+}
+/**************************** newArenaStack ****************************
+Stack newArenaStack(Arena arena)
+Purpose:
+   Creates an empty stack whose memory comes from an arena.
+Parameters:
+   I/O Arena arena          arena to allocate from.  If NULL, the stack
+                            is allocated with malloc.
+Returns:
+   The new stack.
+Notes:
+   A stack in an arena is given back when the arena is reset, so
+   freeStack does nothing for it.
+************************************************************************/
+Stack newArenaStack(Arena arena)
+{
+    Stack stack;
+    if (arena != NULL)
+    {
+        stack = (Stack) arenaAlloc(arena, sizeof(StackImp));
+        stack->stackElementM = (Element *) arenaAlloc(arena, MAX_STACK_ELEM * sizeof(Element));
+    }
+    else
+    {
+        stack = (Stack) malloc(sizeof(StackImp));
+        if (stack != NULL)
+            stack->stackElementM = (Element *) malloc(MAX_STACK_ELEM * sizeof(Element));
+        if (stack == NULL || stack->stackElementM == NULL)
+            ErrExit(ERR_STACK_USAGE, "Unable to allocate a stack");
+    }
+    stack->iCount = 0;
+    stack->iMax = MAX_STACK_ELEM;
+    stack->arena = arena;
+    return stack;
+}
+void freeStack(Stack stack)
+{
+    if (stack->arena != NULL)
+        return;
+    free (stack->stackElementM);
+    free (stack);
+}
+/**************************** growElements ****************************
+Element *growElements(Element *elementM, int iCount, int *piMax, Arena arena)
+Purpose:
+   Doubles the size of an array of elements used by a stack or out.
+Parameters:
+   I   Element *elementM    the full array
+   I   int iCount           number of elements in use
+   I/O int *piMax           allocated size of the array
+   I/O Arena arena          arena the array came from (NULL if malloc)
+Returns:
+   The new array holding the same elements.
+Notes:
+   In an arena the old array is not reused until the arena is reset.
+************************************************************************/
+static Element *growElements(Element *elementM, int iCount, int *piMax, Arena arena)
+{
+    Element *newElementM;
+    int iNewMax = *piMax * 2;
+
+    if (arena != NULL)
+    {
+        newElementM = (Element *) arenaAlloc(arena, iNewMax * sizeof(Element));
+        memcpy(newElementM, elementM, iCount * sizeof(Element));
+    }
+    else
+    {
+        newElementM = (Element *) realloc(elementM, iNewMax * sizeof(Element));
+        if (newElementM == NULL)
+            ErrExit(ERR_STACK_USAGE
+            , "Unable to grow an array to %d elements", iNewMax);
+    }
+    *piMax = iNewMax;
+    return newElementM;
+}
+
+/******************** newArena **************************************
+Arena newArena(size_t iSize)
+Purpose:
+    Creates an arena with one block of memory.
+Parameters:
+    I   size_t iSize            size of the first block
+Returns:
+    The new arena.  Use freeArena to free it.
+**************************************************************************/
+Arena newArena(size_t iSize)
+{
+    Arena arena = (Arena) malloc(sizeof(ArenaImp));
+    if (arena == NULL)
+        ErrExit(ERR_ARENA, "Unable to allocate an arena");
+    arena->pBlock = NULL;
+    arena->iTotalSize = 0;
+    arena->lBlockCount = 0;
+    addArenaBlock(arena, iSize);
+    return arena;
+}
+
+/******************** addArenaBlock **************************************
+void addArenaBlock(Arena arena, size_t iSize)
+Purpose:
+    Adds a new current block to an arena.
+Parameters:
+    I/O Arena arena             arena
+    I   size_t iSize            bytes of memory in the block
+Returns:
+    n/a
+Notes:
+    - The block header is rounded up to ARENA_ALIGN bytes so the memory
+      after it is aligned for any type.
+**************************************************************************/
+#define ARENA_ALIGN 16
+#define ARENA_HEADER_SIZE \
+    ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+static void addArenaBlock(Arena arena, size_t iSize)
+{
+    ArenaBlock *pBlock = (ArenaBlock *) malloc(ARENA_HEADER_SIZE + iSize);
+    if (pBlock == NULL)
+        ErrExit(ERR_ARENA, "Unable to allocate an arena block of %lu bytes"
+        , (unsigned long) iSize);
+    pBlock->pPrev = arena->pBlock;
+    pBlock->iSize = iSize;
+    pBlock->iUsed = 0;
+    arena->pBlock = pBlock;
+    arena->iTotalSize += iSize;
+    arena->lBlockCount++;
+}
+
+/******************** arenaAlloc **************************************
+void *arenaAlloc(Arena arena, size_t iSize)
+Purpose:
+    Hands out memory from an arena.
+Parameters:
+    I/O Arena arena             arena
+    I   size_t iSize            bytes needed
+Returns:
+    Pointer to the memory, aligned for any type.
+Notes:
+    - When the current block is full, a new block at least twice as big
+      is added.  The memory is only given back by resetArena.
+**************************************************************************/
+void *arenaAlloc(Arena arena, size_t iSize)
+{
+    ArenaBlock *pBlock = arena->pBlock;
+    void *pMemory;
+
+    iSize = (iSize + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (pBlock->iUsed + iSize > pBlock->iSize)
+    {
+        addArenaBlock(arena, iSize > pBlock->iSize * 2 ? iSize : pBlock->iSize * 2);
+        pBlock = arena->pBlock;
+    }
+    pMemory = (char *) pBlock + ARENA_HEADER_SIZE + pBlock->iUsed;
+    pBlock->iUsed += iSize;
+    return pMemory;
+}
+
+/******************** resetArena **************************************
+void resetArena(Arena arena)
+Purpose:
+    Gives back all of the memory handed out by an arena.
+Parameters:
+    I/O Arena arena             arena
+Returns:
+    n/a
+Notes:
+    - If the arena needed more than one block, they are replaced by one
+      block as big as all of them, so once an arena has grown to what
+      the work needs, resetting and reusing it does no allocation.
+**************************************************************************/
+void resetArena(Arena arena)
+{
+    ArenaBlock *pBlock = arena->pBlock;
+    ArenaBlock *pPrev;
+    size_t iTotalSize = arena->iTotalSize;
+
+    if (pBlock->pPrev == NULL)
+    {
+        pBlock->iUsed = 0;
+        return;
+    }
+    while (pBlock != NULL)
+    {
+        pPrev = pBlock->pPrev;
+        free(pBlock);
+        pBlock = pPrev;
+    }
+    arena->pBlock = NULL;
+    arena->iTotalSize = 0;
+    addArenaBlock(arena, iTotalSize);
+}
+
+/******************** freeArena **************************************
+void freeArena(Arena arena)
+Purpose:
+    Frees an arena and all of its blocks.
+Parameters:
+    I/O Arena arena             arena to free
+Returns:
+    n/a
+**************************************************************************/
+void freeArena(Arena arena)
+{
+    ArenaBlock *pBlock = arena->pBlock;
+    ArenaBlock *pPrev;
+    while (pBlock != NULL)
+    {
+        pPrev = pBlock->pPrev;
+        free(pBlock);
+        pBlock = pPrev;
+    }
+    free(arena);
+}
+
+/******************** newLineReader **************************************
+LineReader newLineReader(FILE *pFile)
+Purpose:
+    Creates a line reader for a file.
+Parameters:
+    I   FILE *pFile             file opened for reading
+Returns:
+    A dynamically allocated line reader.  Use freeLineReader to free it.
+**************************************************************************/
+LineReader newLineReader(FILE *pFile)
+{
+    LineReader reader = malloc(sizeof(LineReaderImp));
+    if (reader == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate a line reader");
+    reader->pFile = pFile;
+    reader->iBufferSize = INPUT_BLOCK_SIZE + 1;
+    reader->pszBuffer = malloc(reader->iBufferSize);
+    if (reader->pszBuffer == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate a %d byte input buffer", reader->iBufferSize);
+    reader->iStart = 0;
+    reader->iEnd = 0;
+    reader->bEof = FALSE;
+    return reader;
+}
+
+/******************** readLine **************************************
+char *readLine(LineReader reader, int *piLength, int *pbNewline)
+Purpose:
+    Returns the next line of the file.
+Parameters:
+    I/O LineReader reader       line reader
+    O   int *piLength           length of the line, not counting the newline
+    O   int *pbNewline          TRUE if the line ended with a newline
+Returns:
+    Functionally:
+        Pointer to the zero terminated line inside the reader's buffer.
+        It is valid until the next call to readLine.
+        NULL - end of file.
+Notes:
+    - The file is read INPUT_BLOCK_SIZE bytes at a time and lines are
+      found with memchr, so there is no copy or read call per line.
+    - A line longer than the buffer makes the buffer grow, so lines of
+      any length are returned whole.
+    - The newline is replaced by a zero byte.
+**************************************************************************/
+char *readLine(LineReader reader, int *piLength, int *pbNewline)
+{
+    char *pszLine;
+    char *pszNewline;
+    int iRead;
+    int iSearch = reader->iStart;       // where to look for the next newline
+
+    while (TRUE)
+    {
+        pszNewline = memchr(reader->pszBuffer + iSearch, '\n', reader->iEnd - iSearch);
+        if (pszNewline != NULL)
+        {
+            pszLine = reader->pszBuffer + reader->iStart;
+            *pszNewline = '\0';
+            *piLength = (int) (pszNewline - pszLine);
+            *pbNewline = TRUE;
+            reader->iStart += *piLength + 1;
+            return pszLine;
+        }
+        if (reader->bEof)
+        {
+            // the last line has no newline
+            if (reader->iStart >= reader->iEnd)
+                return NULL;
+            pszLine = reader->pszBuffer + reader->iStart;
+            reader->pszBuffer[reader->iEnd] = '\0';
+            *piLength = reader->iEnd - reader->iStart;
+            *pbNewline = FALSE;
+            reader->iStart = reader->iEnd;
+            return pszLine;
+        }
+
+        // move the partial line to the front and read another block,
+        // growing the buffer if the partial line fills it
+        memmove(reader->pszBuffer, reader->pszBuffer + reader->iStart
+            , reader->iEnd - reader->iStart);
+        reader->iEnd -= reader->iStart;
+        reader->iStart = 0;
+        iSearch = reader->iEnd;
+        if (reader->iBufferSize - 1 - reader->iEnd < INPUT_BLOCK_SIZE / 2)
+        {
+            reader->iBufferSize = reader->iBufferSize * 2 - 1;
+            reader->pszBuffer = realloc(reader->pszBuffer, reader->iBufferSize);
+            if (reader->pszBuffer == NULL)
+                ErrExit(ERR_INPUT, "Unable to grow the input buffer to %d bytes"
+                , reader->iBufferSize);
+        }
+        // one byte is kept free for the zero byte after the last line
+        iRead = (int) fread(reader->pszBuffer + reader->iEnd, 1
+            , reader->iBufferSize - 1 - reader->iEnd, reader->pFile);
+        if (iRead <= 0)
+            reader->bEof = TRUE;
+        reader->iEnd += iRead > 0 ? iRead : 0;
+    }
+}
+
+/******************** freeLineReader **************************************
+void freeLineReader(LineReader reader)
+Purpose:
+    Frees a line reader.  The file is not closed.
+Parameters:
+    I/O LineReader reader       line reader to free
+Returns:
+    n/a
+**************************************************************************/
+void freeLineReader(LineReader reader)
+{
+    free(reader->pszBuffer);
+    free(reader);
+}
+
+/******************** newOutputBuffer **************************************
+OutputBuffer newOutputBuffer(FILE *pFile)
+Purpose:
+    Creates an output buffer that writes to a file.
+Parameters:
+    I   FILE *pFile             file opened for writing.  If NULL, the
+                                buffer only collects output in memory and
+                                grows as needed.
+Returns:
+    A dynamically allocated output buffer.  Use freeOutputBuffer to free it.
+**************************************************************************/
+OutputBuffer newOutputBuffer(FILE *pFile)
+{
+    OutputBuffer output = malloc(sizeof(OutputBufferImp));
+    if (output == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate an output buffer");
+    output->pFile = pFile;
+    output->iBufferSize = pFile != NULL ? OUTPUT_BUFFER_SIZE : OUTPUT_BUFFER_SIZE / 16;
+    output->pszBuffer = malloc(output->iBufferSize);
+    if (output->pszBuffer == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate a %d byte output buffer", output->iBufferSize);
+    output->iLength = 0;
+    return output;
+}
+
+/******************** outputText **************************************
+void outputText(OutputBuffer output, char *pszText, int iLength)
+Purpose:
+    Adds text to an output buffer, writing the buffer when it is full.
+Parameters:
+    I/O OutputBuffer output     output buffer
+    I   char *pszText           text (need not be zero terminated)
+    I   int iLength             number of characters to add
+Returns:
+    n/a
+Notes:
+    - Text larger than the whole buffer is written directly.
+    - A buffer with no file grows instead of being written.
+**************************************************************************/
+void outputText(OutputBuffer output, char *pszText, int iLength)
+{
+    if (output->iLength + iLength > output->iBufferSize && output->pFile == NULL)
+    {
+        while (output->iLength + iLength > output->iBufferSize)
+            output->iBufferSize *= 2;
+        output->pszBuffer = realloc(output->pszBuffer, output->iBufferSize);
+        if (output->pszBuffer == NULL)
+            ErrExit(ERR_INPUT, "Unable to grow an output buffer to %d bytes"
+            , output->iBufferSize);
+    }
+    if (output->iLength + iLength > output->iBufferSize)
+    {
+        flushOutput(output);
+        if (iLength > output->iBufferSize)
+        {
+            fwrite(pszText, 1, iLength, output->pFile);
+            return;
+        }
+    }
+    memcpy(output->pszBuffer + output->iLength, pszText, iLength);
+    output->iLength += iLength;
+}
+
+/******************** outputString **************************************
+void outputString(OutputBuffer output, char *pszText)
+Purpose:
+    Adds a zero terminated string to an output buffer.
+Parameters:
+    I/O OutputBuffer output     output buffer
+    I   char *pszText           zero terminated text
+Returns:
+    n/a
+**************************************************************************/
+void outputString(OutputBuffer output, char *pszText)
+{
+    outputText(output, pszText, (int) strlen(pszText));
+}
+
+/******************** outputInt **************************************
+void outputInt(OutputBuffer output, int iValue)
+Purpose:
+    Adds the decimal text of an integer to an output buffer.
+Parameters:
+    I/O OutputBuffer output     output buffer
+    I   int iValue              value to format
+Returns:
+    n/a
+**************************************************************************/
+void outputInt(OutputBuffer output, int iValue)
+{
+    char szDigits[12];
+    int iPos = sizeof(szDigits);
+    unsigned int uValue = iValue < 0 ? 0u - (unsigned int) iValue : (unsigned int) iValue;
+
+    // build the digits from the right
+    do
+    {
+        szDigits[--iPos] = (char) ('0' + uValue % 10);
+        uValue /= 10;
+    } while (uValue != 0);
+    if (iValue < 0)
+        szDigits[--iPos] = '-';
+    outputText(output, szDigits + iPos, sizeof(szDigits) - iPos);
+}
+
+/******************** outputJsonString **************************************
+void outputJsonString(OutputBuffer output, char *pszText, int iLength)
+Purpose:
+    Adds text to an output buffer as a quoted JSON string.
+Parameters:
+    I/O OutputBuffer output     output buffer
+    I   char *pszText           text (need not be zero terminated)
+    I   int iLength             number of characters in the text
+Returns:
+    n/a
+Notes:
+    - Quotes, backslashes and control characters are escaped.
+**************************************************************************/
+void outputJsonString(OutputBuffer output, char *pszText, int iLength)
+{
+    static char szHex[] = "0123456789abcdef";
+    char szEscape[6] = {'\\', 'u', '0', '0', '0', '0'};
+    int iStart = 0;         // start of the characters not yet added
+    int i;
+    unsigned char c;
+
+    outputText(output, "\"", 1);
+    for (i = 0; i < iLength; i++)
+    {
+        c = (unsigned char) pszText[i];
+        if (c >= ' ' && c != '"' && c != '\\')
+            continue;
+        outputText(output, pszText + iStart, i - iStart);
+        iStart = i + 1;
+        if (c == '"' || c == '\\')
+        {
+            szEscape[1] = (char) c;
+            outputText(output, szEscape, 2);
+        }
+        else
+        {
+            szEscape[1] = 'u';
+            szEscape[4] = szHex[c >> 4];
+            szEscape[5] = szHex[c & 15];
+            outputText(output, szEscape, 6);
+        }
+    }
+    outputText(output, pszText + iStart, iLength - iStart);
+    outputText(output, "\"", 1);
+}
+
+/******************** formatOut **************************************
+void formatOut(OutputBuffer output, Out out, int iFormat)
+Purpose:
+    Formats the contents of the out array into an output buffer.
+Parameters:
+    I/O OutputBuffer output     output buffer
+    I   Out out                 The postfix expression
+    I   int iFormat             FORMAT_TEXT or FORMAT_POSTFIX
+Returns:
+    n/a
+Notes:
+    - FORMAT_TEXT is the printOut format: a tab, then 6 tokens per line
+      each followed by a space.
+    - FORMAT_POSTFIX is the tokens separated by one space on one line,
+      with no newline.
+**************************************************************************/
+void formatOut(OutputBuffer output, Out out, int iFormat)
+{
+    int i;
+    int iSymbol;
+
+    if (iFormat == FORMAT_POSTFIX)
+    {
+        for (i = 0; i < out->iOutCount; i++)
+        {
+            iSymbol = out->outM[i].iSymbol;
+            if (i > 0)
+                outputText(output, " ", 1);
+            outputText(output, getSymbolText(iSymbol), getSymbolLength(iSymbol));
+        }
+        return;
+    }
+    outputText(output, "\t", 1);
+    // loop through each element in the out array
+    for (i = 0; i < out->iOutCount; i++)
+    {
+        iSymbol = out->outM[i].iSymbol;
+        outputText(output, getSymbolText(iSymbol), getSymbolLength(iSymbol));
+        outputText(output, " ", 1);
+        if ((i + 1) % 6 == 0)
+            outputText(output, "\n\t", 2);
+    }
+    outputText(output, "\n", 1);
+}
+
+/******************** flushOutput **************************************
+void flushOutput(OutputBuffer output)
+Purpose:
+    Writes everything in an output buffer to its file.
+Parameters:
+    I/O OutputBuffer output     output buffer
+Returns:
+    n/a
+Notes:
+    - Does nothing for a buffer with no file.
+**************************************************************************/
+void flushOutput(OutputBuffer output)
+{
+    if (output->pFile == NULL)
+        return;
+    if (output->iLength > 0)
+        fwrite(output->pszBuffer, 1, output->iLength, output->pFile);
+    output->iLength = 0;
+    fflush(output->pFile);
+}
+
+/******************** freeOutputBuffer **************************************
+void freeOutputBuffer(OutputBuffer output)
+Purpose:
+    Frees an output buffer.  Anything not yet flushed is lost.
+Parameters:
+    I/O OutputBuffer output     output buffer to free
+Returns:
+    n/a
+**************************************************************************/
+void freeOutputBuffer(OutputBuffer output)
+{
+    free(output->pszBuffer);
+    free(output);
+}
+
+/******************** addOut **************************************
+void addOut(Out out, Element element)
+Purpose:
+    Adds an element to out.  
+Parameters:
+    I/O Out out                 Stores the postfix expression 
+    I Element element           Element structure to be added to out. 
+Returns:
+    n/a 
+Notes:
+    - Since out uses an array, addOut checks that it has room and 
+      doubles its size (in out's arena) when it is full. 
+**************************************************************************/
+void addOut(Out out, Element element)
+{
+    if (out->iOutCount >= out->iOutMax)
+        out->outM = growElements(out->outM, out->iOutCount, &out->iOutMax, out->arena);
+    out->outM[out->iOutCount++] = element;
+}
+
+/******************** newOut **************************************
+Out newOut()
+Purpose:
+    Creates an empty out with its own arena.
+Parameters:
+    n/a
+Returns:
+    The new out.  Use freeOut to free it.
+Notes:
+    - convertToPostFix allocates its stack from the out's arena, so
+      an out reused with resetOut converts without calling malloc once
+      the arena is big enough for the longest query.
+**************************************************************************/
+Out newOut()
+{
+    Out out = (Out) malloc(sizeof(OutImp));
+    if (out == NULL)
+        ErrExit(ERR_OUT_OVERFLOW, "Unable to allocate out");
+    out->arena = newArena(ARENA_BLOCK_SIZE);
+    out->iOutMax = MAX_OUT_ITEM;
+    resetOut(out);
+    return out;
+}
+
+/******************** resetOut **************************************
+void resetOut(Out out)
+Purpose:
+    Empties out and its arena so it can be used for the next query.
+Parameters:
+    I/O Out out                 out to reset
+Returns:
+    n/a
+Notes:
+    - outM keeps the size it grew to, so a long query is not followed
+      by growing the array again.
+**************************************************************************/
+void resetOut(Out out)
+{
+    resetArena(out->arena);
+    out->outM = (Element *) arenaAlloc(out->arena, out->iOutMax * sizeof(Element));
+    out->iOutCount = 0;
+}
+
+/******************** freeOut **************************************
+void freeOut(Out out)
+Purpose:
+    Frees an out and its arena.
+Parameters:
+    I/O Out out                 out to free
+Returns:
+    n/a
+**************************************************************************/
+void freeOut(Out out)
+{
+    freeArena(out->arena);
+    free(out);
+}
+
+/******************** printOut **************************************
+void printOut(Out out)
+Purpose:
+    prints the contents of the out array to stdout 
+Parameters:
+    I Out out                 The postfx expression  
+Returns:
+    n/a 
+Notes:
+    - Prints 6 tokens from out per line
+**************************************************************************/
+void printOut(Out out)
+{
+    int i;
+    printf("\t");
+    // loop through each element in the out array
+    for (i = 0; i < out->iOutCount; i++)
+    {
+        printf("%s ", getSymbolText(out->outM[i].iSymbol));
+        if ((i + 1) % 6 == 0)
+            printf("\n\t");
+    }
+    printf("\n");
+}
+
+/******************** categorize **************************************
+void categorize(Element *pElement)
+Purpose:
+    Categorizes a token providing its precedence (0 is low, higher 
+    integers are a higher precedence) and category (operator, operand,
+    left paren, right paren).  Since the category is an integer, it can
+    be used in a switch statement.
+Parameters:
+    I/O Element *pElement       pointer to an element structure which
+                                will be modified by this function.  Its
+                                iSymbol must be set by internSymbol.
+Returns:
+    n/a 
+Notes:
+    - The category and precedence were found with the symbolDefM array
+      when the symbol was interned (see lookupSymbolDef), so this is only
+      a table lookup.
+**************************************************************************/
+void categorize(Element *pElement)
+{
+    pElement->iPrecedence = SYMBOL(pElement->iSymbol)->iPrecedence;
+    pElement->iCategory = SYMBOL(pElement->iSymbol)->iCategory;
+}
+
+/******************** buildSymbolDefSlots **************************************
+void buildSymbolDefSlots()
+Purpose:
+    Builds symbolDefSlotM from the symbolDefM array.
+Parameters:
+    n/a
+Returns:
+    n/a 
+Notes:
+    - Two symbolDefM entries with the same slot would need more than one
+      compare to tell apart, so that is reported as an algorithm error.
+**************************************************************************/
+static void buildSymbolDefSlots()
+{
+    int i;
+    int iSlot;
+
+    for (i = 0; i < SYMBOL_DEF_SLOTS; i++)
+        symbolDefSlotM[i] = -1;
+    for (i = 0; symbolDefM[i].szSymbol[0] != '\0'; i++)
+    {
+        iSlot = SYMBOL_DEF_SLOT(strlen(symbolDefM[i].szSymbol), symbolDefM[i].szSymbol[0]);
+        if (symbolDefSlotM[iSlot] >= 0)
+            ErrExit(ERR_ALGORITHM
+            , "symbolDefM entries '%s' and '%s' have the same slot"
+            , symbolDefM[symbolDefSlotM[iSlot]].szSymbol, symbolDefM[i].szSymbol);
+        symbolDefSlotM[iSlot] = i;
+    }
+    bSymbolDefSlotsBuilt = TRUE;
+}
+
+/******************** lookupSymbolDef **************************************
+void lookupSymbolDef(Symbol *pSymbol)
+Purpose:
+    Sets the category and precedence of a new symbol from the symbolDefM
+    array.
+Parameters:
+    I/O Symbol *pSymbol         symbol whose pszText and iLength are set
+Returns:
+    n/a 
+Notes:
+    - The token's length and first character select the one symbolDefM
+      entry it could be, so at most one strcmp is done.
+    - A symbol not in symbolDefM is an operand.
+**************************************************************************/
+static void lookupSymbolDef(Symbol *pSymbol)
+{
+    int iDef;
+
+    if (!bSymbolDefSlotsBuilt)
+        buildSymbolDefSlots();
+    iDef = symbolDefSlotM[SYMBOL_DEF_SLOT(pSymbol->iLength, pSymbol->pszText[0])];
+    // does the symbol's text match the symbol in the symbolDefM array?
+    if (iDef >= 0 && strcmp(pSymbol->pszText, symbolDefM[iDef].szSymbol) == 0)
+    {   // matched, so use its precedence and category
+        pSymbol->iPrecedence = symbolDefM[iDef].iPrecedence;
+        pSymbol->iCategory = symbolDefM[iDef].iCategory;
+        return;
+    }
+    // must be an operand
+    pSymbol->iPrecedence = 0;
+    pSymbol->iCategory = CAT_OPERAND;
+}
+
+/******************** hashText **************************************
+unsigned int hashText(char *pszText, int iLength)
+Purpose:
+    Computes the FNV-1a hash of a token's text.
+Parameters:
+    I   char *pszText           token text (need not be zero terminated)
+    I   int iLength             number of characters in the token
+Returns:
+    The hash value.
+**************************************************************************/
+static unsigned int hashText(char *pszText, int iLength)
+{
+    unsigned int uHash = 2166136261u;
+    int i;
+    for (i = 0; i < iLength; i++)
+    {
+        uHash ^= (unsigned char) pszText[i];
+        uHash *= 16777619u;
+    }
+    return uHash;
+}
+
+/******************** growSymbolHash **************************************
+int growSymbolHash()
+Purpose:
+    Replaces the symbol hash table with one twice the size (or creates
+    it) holding every symbol.
+Parameters:
+    n/a
+Returns:
+    TRUE  - the table was replaced
+    FALSE - unable to allocate the new table; the old one is unchanged
+Notes:
+    - The caller must hold symbolLock.
+    - The hash table uses open addressing with linear probing.
+    - The new table is filled before it is published, so a thread
+      searching without the lock sees either the old or the new table.
+**************************************************************************/
+static int growSymbolHash()
+{
+    SymbolHash *pHash = malloc(sizeof(SymbolHash));
+    Symbol *pSymbol;
+    int iSlot;
+    int i;
+
+    if (pHash == NULL)
+        return FALSE;
+    pHash->iSize = pSymbolHash != NULL ? pSymbolHash->iSize * 2 : SYMBOL_HASH_SIZE;
+    pHash->iSlotM = malloc(pHash->iSize * sizeof(int));
+    if (pHash->iSlotM == NULL)
+    {
+        free(pHash);
+        return FALSE;
+    }
+    memset(pHash->iSlotM, -1, pHash->iSize * sizeof(int));
+    pHash->pRetired = pSymbolHash;
+    for (i = 0; i < iSymbolCount; i++)
+    {
+        pSymbol = SYMBOL(i);
+        iSlot = hashText(pSymbol->pszText, pSymbol->iLength) & (pHash->iSize - 1);
+        while (pHash->iSlotM[iSlot] >= 0)
+            iSlot = (iSlot + 1) & (pHash->iSize - 1);
+        pHash->iSlotM[iSlot] = i;
+    }
+    STORE_RELEASE(&pSymbolHash, pHash);
+    return TRUE;
+}
+
+/******************** findSymbol **************************************
+int findSymbol(SymbolHash *pHash, char *pszText, int iLength
+    , unsigned int uHash, int *piSlot)
+Purpose:
+    Searches a symbol hash table for a token.
+Parameters:
+    I   SymbolHash *pHash       hash table to search
+    I   char *pszText           token text (need not be zero terminated)
+    I   int iLength             number of characters in the token
+    I   unsigned int uHash      hashText of the token
+    O   int *piSlot             the slot holding the symbol, or the empty
+                                slot where it would be added
+Returns:
+    The symbol id, or -1 if the token is not in the table.
+**************************************************************************/
+static int findSymbol(SymbolHash *pHash, char *pszText, int iLength
+    , unsigned int uHash, int *piSlot)
+{
+    Symbol *pSymbol;
+    int iSlot = uHash & (pHash->iSize - 1);
+    int iSymbol;
+
+    while ((iSymbol = LOAD_ACQUIRE(&pHash->iSlotM[iSlot])) >= 0)
+    {
+        pSymbol = SYMBOL(iSymbol);
+        if (pSymbol->iLength == iLength && memcmp(pSymbol->pszText, pszText, iLength) == 0)
+            break;
+        iSlot = (iSlot + 1) & (pHash->iSize - 1);
+    }
+    *piSlot = iSlot;
+    return iSymbol;
+}
+
+/******************** addSymbol **************************************
+int addSymbol(char *pszText, int iLength, unsigned int uHash)
+Purpose:
+    Returns the symbol id of a token, adding the token to the symbol
+    table if it is not there.
+Parameters:
+    I   char *pszText           token text (need not be zero terminated)
+    I   int iLength             number of characters in the token
+    I   unsigned int uHash      hashText of the token
+Returns:
+    The symbol id.
+Notes:
+    - The caller must hold symbolLock.  It is released before an error
+      is reported, since ErrExit returns to tryConvertToPostFix when it
+      has set an error trap.
+    - A new symbol is categorized once with the symbolDefM array.
+    - The table keeps the hash table at most half full.
+**************************************************************************/
+static int addSymbol(char *pszText, int iLength, unsigned int uHash)
+{
+    Symbol *pSymbol;
+    int iSymbol;
+    int iSlot;
+
+    if (pSymbolHash == NULL && !growSymbolHash())
+    {
+        pthread_mutex_unlock(&symbolLock);
+        ErrExit(ERR_SYMBOL_TABLE, "Unable to allocate a symbol hash table");
+    }
+    iSymbol = findSymbol(pSymbolHash, pszText, iLength, uHash, &iSlot);
+    if (iSymbol >= 0)
+        return iSymbol;
+
+    // not found, so add a new symbol
+    iSymbol = iSymbolCount;
+    if (iSymbol % SYMBOL_BLOCK_SIZE == 0)
+    {
+        if (iSymbol / SYMBOL_BLOCK_SIZE >= MAX_SYMBOL_BLOCKS)
+        {
+            pthread_mutex_unlock(&symbolLock);
+            ErrExit(ERR_SYMBOL_TABLE
+            , "More than %d symbols", MAX_SYMBOL_BLOCKS * SYMBOL_BLOCK_SIZE);
+        }
+        symbolBlockM[iSymbol / SYMBOL_BLOCK_SIZE] = malloc(SYMBOL_BLOCK_SIZE * sizeof(Symbol));
+        if (symbolBlockM[iSymbol / SYMBOL_BLOCK_SIZE] == NULL)
+        {
+            pthread_mutex_unlock(&symbolLock);
+            ErrExit(ERR_SYMBOL_TABLE
+            , "Unable to allocate %d symbols", SYMBOL_BLOCK_SIZE);
+        }
+    }
+    pSymbol = SYMBOL(iSymbol);
+    pSymbol->pszText = malloc(iLength + 1);
+    if (pSymbol->pszText == NULL)
+    {
+        pthread_mutex_unlock(&symbolLock);
+        ErrExit(ERR_SYMBOL_TABLE
+        , "Unable to allocate symbol text");
+    }
+    memcpy(pSymbol->pszText, pszText, iLength);
+    pSymbol->pszText[iLength] = '\0';
+    pSymbol->iLength = iLength;
+    lookupSymbolDef(pSymbol);
+    iSymbolCount++;
+    // publish the symbol only after it is filled in
+    STORE_RELEASE(&pSymbolHash->iSlotM[iSlot], iSymbol);
+
+    if (iSymbolCount * 2 > pSymbolHash->iSize && !growSymbolHash())
+    {
+        pthread_mutex_unlock(&symbolLock);
+        ErrExit(ERR_SYMBOL_TABLE
+        , "Unable to allocate a symbol hash table of %d entries", pSymbolHash->iSize * 2);
+    }
+    return iSymbol;
+}
+
+/******************** internSymbol **************************************
+int internSymbol(char *pszText, int iLength)
+Purpose:
+    Returns the symbol id of a token, adding the token to the symbol
+    table if it has not been seen before.
+Parameters:
+    I   char *pszText           token text (need not be zero terminated)
+    I   int iLength             number of characters in the token
+Returns:
+    The symbol id.  The same text always gets the same id.
+Notes:
+    - The first call adds the symbolDefM entries in order, so the
+      parentheses and operators have the SYMBOL_ ids of cs2123p1.h.
+    - Safe to call from several threads.  Finding an existing symbol
+      takes no lock; adding one is done while holding symbolLock, after
+      searching again in case another thread just added it.
+**************************************************************************/
+int internSymbol(char *pszText, int iLength)
+{
+    SymbolHash *pHash = LOAD_ACQUIRE(&pSymbolHash);
+    unsigned int uHash = hashText(pszText, iLength);
+    int iSymbol;
+    int iSlot;
+    int i;
+
+    // look for the token in the hash table
+    if (pHash != NULL)
+    {
+        iSymbol = findSymbol(pHash, pszText, iLength, uHash, &iSlot);
+        if (iSymbol >= 0)
+            return iSymbol;
+    }
+
+    pthread_mutex_lock(&symbolLock);
+    if (pSymbolHash == NULL)
+    {
+        for (i = 0; symbolDefM[i].szSymbol[0] != '\0'; i++)
+        {
+            if (addSymbol(symbolDefM[i].szSymbol, (int) strlen(symbolDefM[i].szSymbol)
+                , hashText(symbolDefM[i].szSymbol, (int) strlen(symbolDefM[i].szSymbol))) != i)
+            {
+                pthread_mutex_unlock(&symbolLock);
+                ErrExit(ERR_ALGORITHM, "symbolDefM entry '%s' is not symbol %d"
+                , symbolDefM[i].szSymbol, i);
+            }
+        }
+    }
+    iSymbol = addSymbol(pszText, iLength, uHash);
+    pthread_mutex_unlock(&symbolLock);
+    return iSymbol;
+}
+
+/******************** getSymbolText **************************************
+char *getSymbolText(int iSymbol)
+Purpose:
+    Returns the token text of a symbol.
+Parameters:
+    I   int iSymbol             symbol id from internSymbol
+Returns:
+    The zero terminated token text.
+**************************************************************************/
+char *getSymbolText(int iSymbol)
+{
+    return SYMBOL(iSymbol)->pszText;
+}
+
+/******************** getSymbolLength **************************************
+int getSymbolLength(int iSymbol)
+Purpose:
+    Returns the length of the token text of a symbol.
+Parameters:
+    I   int iSymbol             symbol id from internSymbol
+Returns:
+    The number of characters in the token text.
+**************************************************************************/
+int getSymbolLength(int iSymbol)
+{
+    return SYMBOL(iSymbol)->iLength;
+}
+
+/******************** getSymbolCount **************************************
+int getSymbolCount()
+Purpose:
+    Returns the number of symbols in the symbol table.
+Parameters:
+    n/a
+Returns:
+    The number of symbols, including the symbolDefM entries once the
+    first token has been interned.
+**************************************************************************/
+int getSymbolCount()
+{
+    int iCount;
+    pthread_mutex_lock(&symbolLock);
+    iCount = iSymbolCount;
+    pthread_mutex_unlock(&symbolLock);
+    return iCount;
+}
+
+/******************** clearSymbols **************************************
+void clearSymbols()
+Purpose:
+    Frees every symbol and the hash tables, so a long running program
+    can bound the memory of the symbols it has seen.
+Parameters:
+    n/a
+Returns:
+    n/a
+Notes:
+    - The caller must make sure no other thread is using the symbol
+      table, and that no symbol id is used after the call: Elements,
+      Queries and anything else holding an id must be reset first.
+    - The next internSymbol adds the symbolDefM entries again, so they
+      keep their SYMBOL_ ids.
+**************************************************************************/
+void clearSymbols()
+{
+    SymbolHash *pHash;
+    SymbolHash *pRetired;
+    int i;
+
+    pthread_mutex_lock(&symbolLock);
+    for (i = 0; i < iSymbolCount; i++)
+        free(SYMBOL(i)->pszText);
+    for (i = 0; i < MAX_SYMBOL_BLOCKS && symbolBlockM[i] != NULL; i++)
+    {
+        free(symbolBlockM[i]);
+        symbolBlockM[i] = NULL;
+    }
+    for (pHash = pSymbolHash; pHash != NULL; pHash = pRetired)
+    {
+        pRetired = pHash->pRetired;
+        free(pHash->iSlotM);
+        free(pHash);
+    }
+    iSymbolCount = 0;
+    pSymbolHash = NULL;
+    pthread_mutex_unlock(&symbolLock);
+}
+
+/******************** ErrExit **************************************
+  void ErrExit(int iexitRC, char szFmt[], ... )
+Purpose:
+    Prints an error message defined by the printf-like szFmt and the
+    corresponding arguments to that function.  The number of 
+    arguments after szFmt varies dependent on the format codes in
+    szFmt.  
+    It also exits the program with the specified exit return code.
+Parameters:
+    I   int iexitRC             Exit return code for the program
+    I   char szFmt[]            This contains the message to be printed
+                                and format codes (just like printf) for 
+                                values that we want to print.
+    I   ...                     A variable-number of additional arguments
+                                which correspond to what is needed
+                                by the format codes in szFmt. 
+Returns:
+    Returns a program exit return code:  the value of iexitRC.
+Notes:
+    - Prints "ERROR: " followed by the formatted error message specified 
+      in szFmt. 
+    - Prints the file path and file name of the program having the error.
+      This is the file that contains this routine.
+    - Requires including <stdarg.h>
+    - If the thread is in tryConvertToPostFix or trapErrors, nothing is
+      printed.  The message is returned to it with iexitRC instead of
+      exiting.
+**************************************************************************/
+void ErrExit(int iexitRC, char szFmt[], ... )
+{
+    va_list args;               // This is the standard C variable argument list type
+    va_start(args, szFmt);      // This tells the compiler where the variable arguments
+                                // begins.  They begin after szFmt.
+    if (pErrorTrap != NULL)
+    {
+        vsnprintf(pErrorTrap->pszError, pErrorTrap->iErrorSize, szFmt, args);
+        va_end(args);
+        pErrorTrap->rc = iexitRC;
+        longjmp(pErrorTrap->jumpBuffer, 1);
+    }
+    printf("ERROR: ");
+    vprintf(szFmt, args);       // vprintf receives a printf format string and  a
+                                // va_list argument
+    va_end(args);               // let the C environment know we are finished with the
+                                // va_list argument
+    printf("\n\tEncountered in file %s\n", __FILE__);  // this 2nd arg is filled in by
+                                // the pre-compiler
+    exit(iexitRC);
+}
+
+/******************** tryConvertToPostFix **************************************
+int tryConvertToPostFix(char *pszInfix, Out out, char szError[], int iErrorSize)
+Purpose:
+    Converts a query to postfix as convertToPostFix does, returning an
+    error instead of ending the program.
+Parameters:
+    I   char *pszInfix          zero terminated query text
+    O   Out out                 receives the postfix.  It is reset first.
+    O   char szError[]          message of an error (set only when the
+                                return code is an ERR_ constant)
+    I   int iErrorSize          size of szError
+Returns:
+    0   - conversion to postfix was successful
+    801 - WARN_MISSING_RPAREN
+    802 - WARN_MISSING_LPAREN
+    9xx - the ERR_ constant passed to ErrExit, such as ERR_ARENA when
+          memory runs out or ERR_SYMBOL_TABLE when the symbol table is
+          full
+Notes:
+    - Safe to call from several threads, each with its own out.
+    - After an error out holds part of the postfix.  The next call
+      resets it.
+**************************************************************************/
+int tryConvertToPostFix(char *pszInfix, Out out, char szError[], int iErrorSize)
+{
+    ErrorTrap trap;
+    int rc;
+
+    trap.pszError = szError;
+    trap.iErrorSize = iErrorSize;
+    trap.rc = 0;
+    trap.pPrev = pErrorTrap;
+    if (setjmp(trap.jumpBuffer) != 0)
+    {
+        pErrorTrap = trap.pPrev;
+        return trap.rc;
+    }
+    pErrorTrap = &trap;
+    resetOut(out);
+    rc = convertToPostFix(pszInfix, out);
+    pErrorTrap = trap.pPrev;
+    return rc;
+}
+
+/******************** trapErrors **************************************
+int trapErrors(void (*pfnWork)(void *), void *pArg, char szError[], int iErrorSize)
+Purpose:
+    Calls a function, returning an error it reports with ErrExit instead
+    of ending the program.
+Parameters:
+    I   void (*pfnWork)(void *) function to call
+    I/O void *pArg              its argument
+    O   char szError[]          message of an error (set only when the
+                                return code is not 0)
+    I   int iErrorSize          size of szError
+Returns:
+    0   - the function returned
+    9xx - the ERR_ constant it passed to ErrExit
+Notes:
+    - The trap is only for the calling thread.  A thread started by
+      pfnWork must set its own, for instance by running its work with
+      trapErrors too (see cs2123p1Parallel.c).
+    - Locks held by pfnWork when it calls ErrExit stay held, so it must
+      release them first, as internSymbol does.
+**************************************************************************/
+int trapErrors(void (*pfnWork)(void *), void *pArg, char szError[], int iErrorSize)
+{
+    ErrorTrap trap;
+
+    trap.pszError = szError;
+    trap.iErrorSize = iErrorSize;
+    trap.rc = 0;
+    trap.pPrev = pErrorTrap;
+    if (setjmp(trap.jumpBuffer) != 0)
+    {
+        pErrorTrap = trap.pPrev;
+        return trap.rc;
+    }
+    pErrorTrap = &trap;
+    pfnWork(pArg);
+    pErrorTrap = trap.pPrev;
+    return 0;
+}
+/******************** getToken **************************************
+char * getToken (char *pszInputTxt, char szToken[], int iTokenSize)
+Purpose:
+    Examines the input text to return the next token.  It also
+    returns the position in the text after that token.  This function
+    does not skip over white space, but it assumes the input uses 
+    spaces to separate tokens.
+Parameters:
+    I   char *pszInputTxt       input buffer to be parsed
+    O   char szToken[]          Returned token.
+    I   int iTokenSize          The size of the token variable.  This is used
+                                to prevent overwriting memory.  The size
+                                should be the memory size minus 1 (for
+                                the zero byte).
+Returns:
+    Functionally:
+        Pointer to the next character following the delimiter after the token.
+        NULL - no token found.
+    szToken parm - the returned token.  If not found, it will be an
+        empty string.
+Notes:
+    - If the token is larger than the szToken parm, we return a truncated value.
+    - If a token isn't found, szToken is set to an empty string
+    - This function does not skip over white space occurring prior to the token.
+**************************************************************************/
+char * getToken(char *pszInputTxt, char szToken[], int iTokenSize)
+{
+    int iDelimPos;                      // found position of delim
+    int iCopy;                          // number of characters to copy
+    char szDelims[20] = " \n\r";        // delimiters
+    szToken[0] = '\0';
+
+    // check for NULL pointer 
+    if (pszInputTxt == NULL)
+        ErrExit(ERR_ALGORITHM
+        , "getToken passed a NULL pointer");
+
+    // Check for no token if at zero byte
+    if (*pszInputTxt == '\0')
+        return NULL;
+
+    // get the position of the first delim
+    iDelimPos = strcspn(pszInputTxt, szDelims);
+
+    // if the delim position is at the first character, return no token.
+    if (iDelimPos == 0)
+        return NULL;
+
+    // see if we have more characters than target token, if so, trunc
+    if (iDelimPos > iTokenSize)
+        iCopy = iTokenSize;             // truncated size
+    else
+        iCopy = iDelimPos;
+
+    // copy the token into the target token variable
+    memcpy(szToken, pszInputTxt, iCopy);
+    szToken[iCopy] = '\0';              // null terminate
+
+    // advance the position
+    pszInputTxt += iDelimPos;
+    if (*pszInputTxt == '\0')
+        return pszInputTxt;
+    else
+        return pszInputTxt + 1;
+}
+
+/******************** findDelim **************************************
+char *findDelim(char *pszText)
+Purpose:
+    Finds the first white space character or zero byte in the text.
+Parameters:
+    I   char *pszText           text to scan
+Returns:
+    Pointer to the first character at or below a space (this includes
+    the zero byte at the end of the text).
+Notes:
+    - With SSE2, 16 bytes are compared at a time.  The loads are aligned
+      to 16 bytes so they never cross into a page past the end of the text.
+**************************************************************************/
+static char *findDelim(char *pszText)
+{
+#ifdef HAVE_SSE2_SCAN
+    int iMisalign = (int) ((uintptr_t) pszText & 15);
+    const __m128i *pBlock = (const __m128i *) (pszText - iMisalign);
+    __m128i space = _mm_set1_epi8(' ');
+    __m128i bytes;
+    unsigned int uMask;
+
+    // a byte is a delimiter when max(byte, ' ') is ' '
+    bytes = _mm_load_si128(pBlock);
+    uMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bytes, space), space));
+    uMask >>= iMisalign;                // ignore bytes before pszText
+    if (uMask != 0)
+        return pszText + __builtin_ctz(uMask);
+    for (pBlock++; ; pBlock++)
+    {
+        bytes = _mm_load_si128(pBlock);
+        uMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bytes, space), space));
+        if (uMask != 0)
+            return (char *) pBlock + __builtin_ctz(uMask);
+    }
+#else
+    while ((unsigned char) *pszText > ' ')
+        pszText++;
+    return pszText;
+#endif
+}
+
+/******************** getTokenView **************************************
+char * getTokenView(char *pszInputTxt, char **ppszToken, int *piLength)
+Purpose:
+    Examines the input text to find the next token without copying it.
+    It also returns the position in the text after that token.
+Parameters:
+    I   char *pszInputTxt       input buffer to be parsed
+    O   char **ppszToken        Returned pointer to the first character of
+                                the token inside pszInputTxt
+    O   int *piLength           Returned length of the token
+Returns:
+    Functionally:
+        Pointer to the character following the token.
+        NULL - no token found.
+Notes:
+    - Skips any run of white space (spaces, tabs, line ends, or any other
+      character at or below a space) before the token.
+    - The token is not zero terminated and is never truncated.
+**************************************************************************/
+char * getTokenView(char *pszInputTxt, char **ppszToken, int *piLength)
+{
+    char *pszEnd;
+
+    // check for NULL pointer 
+    if (pszInputTxt == NULL)
+        ErrExit(ERR_ALGORITHM
+        , "getTokenView passed a NULL pointer");
+
+    // skip white space before the token
+    while (*pszInputTxt != '\0' && (unsigned char) *pszInputTxt <= ' ')
+        pszInputTxt++;
+
+    // Check for no token if at zero byte
+    if (*pszInputTxt == '\0')
+        return NULL;
+
+    pszEnd = findDelim(pszInputTxt);
+    *ppszToken = pszInputTxt;
+    *piLength = (int) (pszEnd - pszInputTxt);
+    return pszEnd;
+}
@@ -0,0 +1,666 @@
+/**********************************************************************************
+Program cs2123p1Match.c by Timothy Hennessy
+Purpose:
+    Matches records, such as incoming customer events, against many
+    registered queries at once.  Instead of evaluating every query, the
+    queries are indexed so that a record only looks at the queries that
+    compare one of its own (trait, value) pairs.
+Command Parameters:
+    n/a
+Input:
+    Queries as converted by convertToPostFix, and records in the customer
+    file format:
+        TRAIT=VALUE [TRAIT=VALUE ...]
+Results:
+    matchRecord returns the ids of the queries the record satisfies.
+Returns:
+    n/a
+Notes:
+    1. Each query is rewritten in disjunctive normal form, an OR of
+       conjunctions of comparisons.  A query matches when one of its
+       conjunctions does.  A query that would need more than
+       MATCH_MAX_CONJUNCTIONS conjunctions is evaluated on every record
+       instead (a fallback query).
+    2. The index is a counting conjunction index.  Every comparison of a
+       conjunction is a posting on the list of its (trait, value) key.
+       For each pair of the record the postings of its key are scanned:
+           =       counts a hit
+           ONLY    counts a hit if the record has one value for the trait
+           NOTANY  rejects the conjunction
+       A conjunction matches when its hits equal its number of = and ONLY
+       comparisons and it was not rejected.  A rejected conjunction's hit
+       count is set to MATCH_REJECTED, so that it stays negative.  Conjunctions with only
+       NOTANY comparisons cannot be hit, so they are kept on a list of
+       their own and match unless rejected.
+    3. The work for a record is the length of the posting lists of its
+       keys, not the number of queries.
+    4. Traits and values are symbol ids (see internSymbol), so a record
+       may have traits and values no query uses.
+    5. Before the first match after queries were added, the posting
+       lists are packed into one array, grouped by key.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+
+// Dnf typedef is a query, or part of one, in disjunctive normal form
+// while it is being built.  Conjunction i is the comparisons
+// litM[iStartM[i]] to litM[iStartM[i + 1] - 1].
+typedef struct
+{
+    int iConjCount;
+    int *iStartM;               // first comparison of each conjunction (plus one)
+    Instr *litM;                // comparisons
+} Dnf;
+
+/******************** growArray **************************************
+void *growArray(void *pArray, int *piMax, int iNeeded, size_t iElemSize)
+Purpose:
+    Makes sure a dynamically allocated array has room for iNeeded
+    elements, doubling its size when it does not.
+Parameters:
+    I   void *pArray            array to grow (may be NULL)
+    I/O int *piMax              allocated number of elements
+    I   int iNeeded             number of elements required
+    I   size_t iElemSize        size of one element
+Returns:
+    Pointer to the (possibly moved) array.
+**************************************************************************/
+static void *growArray(void *pArray, int *piMax, int iNeeded, size_t iElemSize)
+{
+    int iNewMax;
+    if (iNeeded <= *piMax)
+        return pArray;
+    iNewMax = *piMax > 0 ? *piMax * 2 : 16;
+    while (iNewMax < iNeeded)
+        iNewMax *= 2;
+    pArray = realloc(pArray, iNewMax * iElemSize);
+    if (pArray == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate %d match index entries", iNewMax);
+    *piMax = iNewMax;
+    return pArray;
+}
+
+/******************** newMatchIndex **************************************
+MatchIndex newMatchIndex()
+Purpose:
+    Creates an empty match index.
+Parameters:
+    n/a
+Returns:
+    The new match index.  Use freeMatchIndex to free it.
+**************************************************************************/
+MatchIndex newMatchIndex()
+{
+    MatchIndex index = calloc(1, sizeof(MatchIndexImp));
+
+    if (index == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a match index");
+    index->iHashSize = MATCH_HASH_SIZE;
+    index->iKeyTraitM = malloc(index->iHashSize * sizeof(int));
+    index->iKeyValueM = malloc(index->iHashSize * sizeof(int));
+    index->iFirstPostM = malloc(index->iHashSize * sizeof(int));
+    if (index->iKeyTraitM == NULL || index->iKeyValueM == NULL || index->iFirstPostM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a match index");
+    memset(index->iFirstPostM, -1, index->iHashSize * sizeof(int));
+    index->bUseIndex = TRUE;
+    return index;
+}
+
+/******************** findKey **************************************
+int findKey(MatchIndex index, int iTrait, int iValue)
+Purpose:
+    Finds the slot of a (trait, value) key in the index.
+Parameters:
+    I   MatchIndex index            match index
+    I   int iTrait                  trait symbol
+    I   int iValue                  value symbol
+Returns:
+    The slot holding the key, or the empty slot where it would be added.
+Notes:
+    - The hash table uses open addressing with linear probing.
+**************************************************************************/
+static int findKey(MatchIndex index, int iTrait, int iValue)
+{
+    unsigned int uHash = 2166136261u;
+    int iSlot;
+
+    uHash = (uHash ^ (unsigned int) iTrait) * 16777619u;
+    uHash = (uHash ^ (unsigned int) iValue) * 16777619u;
+    iSlot = uHash & (index->iHashSize - 1);
+    while (index->iFirstPostM[iSlot] >= 0
+        && (index->iKeyTraitM[iSlot] != iTrait || index->iKeyValueM[iSlot] != iValue))
+        iSlot = (iSlot + 1) & (index->iHashSize - 1);
+    return iSlot;
+}
+
+/******************** growKeyHash **************************************
+void growKeyHash(MatchIndex index)
+Purpose:
+    Doubles the size of the index's hash table.
+Parameters:
+    I/O MatchIndex index            index whose table is half full
+Returns:
+    n/a
+**************************************************************************/
+static void growKeyHash(MatchIndex index)
+{
+    int *iOldTraitM = index->iKeyTraitM;
+    int *iOldValueM = index->iKeyValueM;
+    int *iOldFirstM = index->iFirstPostM;
+    int iOldSize = index->iHashSize;
+    int iSlot;
+    int i;
+
+    index->iHashSize *= 2;
+    index->iKeyTraitM = malloc(index->iHashSize * sizeof(int));
+    index->iKeyValueM = malloc(index->iHashSize * sizeof(int));
+    index->iFirstPostM = malloc(index->iHashSize * sizeof(int));
+    if (index->iKeyTraitM == NULL || index->iKeyValueM == NULL || index->iFirstPostM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to grow a match index");
+    memset(index->iFirstPostM, -1, index->iHashSize * sizeof(int));
+    for (i = 0; i < iOldSize; i++)
+    {
+        if (iOldFirstM[i] < 0)
+            continue;
+        iSlot = findKey(index, iOldTraitM[i], iOldValueM[i]);
+        index->iKeyTraitM[iSlot] = iOldTraitM[i];
+        index->iKeyValueM[iSlot] = iOldValueM[i];
+        index->iFirstPostM[iSlot] = iOldFirstM[i];
+    }
+    free(iOldTraitM);
+    free(iOldValueM);
+    free(iOldFirstM);
+}
+
+/******************** addPosting **************************************
+void addPosting(MatchIndex index, int iConj, Instr *pLit)
+Purpose:
+    Adds a conjunction to the posting list of a comparison's key.
+Parameters:
+    I/O MatchIndex index            match index
+    I   int iConj                   conjunction id
+    I   Instr *pLit                 comparison of the conjunction
+Returns:
+    n/a
+**************************************************************************/
+static void addPosting(MatchIndex index, int iConj, Instr *pLit)
+{
+    int iSlot = findKey(index, pLit->iTrait, pLit->iValue);
+
+    index->postM = growArray(index->postM, &index->iPostMax, index->iPostCount + 1
+        , sizeof(MatchPosting));
+    index->iPostNextM = realloc(index->iPostNextM, index->iPostMax * sizeof(int));
+    if (index->iPostNextM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d postings", index->iPostMax);
+    if (index->iFirstPostM[iSlot] < 0)
+    {
+        index->iKeyTraitM[iSlot] = pLit->iTrait;
+        index->iKeyValueM[iSlot] = pLit->iValue;
+        index->iKeyCount++;
+    }
+    index->postM[index->iPostCount].iConj = iConj;
+    index->postM[index->iPostCount].iOp = pLit->iOp;
+    index->iPostNextM[index->iPostCount] = index->iFirstPostM[iSlot];
+    index->iFirstPostM[iSlot] = index->iPostCount++;
+    if (2 * index->iKeyCount > index->iHashSize)
+        growKeyHash(index);
+}
+
+/******************** addConjunction **************************************
+void addConjunction(MatchIndex index, int iQuery, Instr *litM, int iLitCount)
+Purpose:
+    Adds one conjunction of a query to the index.
+Parameters:
+    I/O MatchIndex index            match index
+    I   int iQuery                  query id
+    I   Instr *litM                 comparisons of the conjunction
+    I   int iLitCount               number of comparisons
+Returns:
+    n/a
+Notes:
+    - A comparison that is in the conjunction twice is posted once.
+**************************************************************************/
+static void addConjunction(MatchIndex index, int iQuery, Instr *litM, int iLitCount)
+{
+    int iConj = index->iConjCount;
+    int iConjMax = index->iConjMax;
+    int iPositive = 0;
+    int i;
+    int j;
+
+    index->conjM = growArray(index->conjM, &index->iConjMax, iConj + 1, sizeof(MatchConj));
+    if (index->iConjMax != iConjMax)
+    {
+        index->iTouchedM = realloc(index->iTouchedM, index->iConjMax * sizeof(int));
+        if (index->iTouchedM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d conjunctions", index->iConjMax);
+    }
+    index->conjM[iConj].iQuery = iQuery;
+    index->conjM[iConj].iHitMark = 0;
+    index->iConjCount++;
+
+    for (i = 0; i < iLitCount; i++)
+    {
+        for (j = 0; j < i; j++)
+        {
+            if (litM[j].iOp == litM[i].iOp && litM[j].iTrait == litM[i].iTrait
+                && litM[j].iValue == litM[i].iValue)
+                break;
+        }
+        if (j < i)
+            continue;           // already posted
+        if (litM[i].iOp != OP_NOTANY)
+            iPositive++;
+        addPosting(index, iConj, &litM[i]);
+    }
+    index->conjM[iConj].iPositiveCount = iPositive;
+    if (iPositive == 0)
+    {
+        index->iZeroM = growArray(index->iZeroM, &index->iZeroMax, index->iZeroCount + 1
+            , sizeof(int));
+        index->iZeroM[index->iZeroCount++] = iConj;
+    }
+}
+
+/******************** buildDnf **************************************
+int buildDnf(Query query, Arena arena, Dnf *pDnf)
+Purpose:
+    Rewrites a compiled query in disjunctive normal form.
+Parameters:
+    I   Query query                 query compiled with a NULL customer set
+    I/O Arena arena                 memory for the work areas and the result
+    O   Dnf *pDnf                   the query's conjunctions
+Returns:
+    TRUE if the query has at most MATCH_MAX_CONJUNCTIONS conjunctions.
+Notes:
+    - The instructions are evaluated on a stack of Dnfs.  A comparison
+      is one conjunction of one comparison, OR appends the conjunctions
+      of its operands, and AND joins each conjunction of one operand to
+      each conjunction of the other.
+**************************************************************************/
+static int buildDnf(Query query, Arena arena, Dnf *pDnf)
+{
+    Dnf *dnfM = arenaAlloc(arena, (query->iMaxDepth + 1) * sizeof(Dnf));
+    Dnf *pLeft;
+    Dnf *pRight;
+    Dnf result;
+    Instr *pInstr;
+    int iTop = 0;
+    int iLeftLength;
+    int iRightLength;
+    int iLit;
+    int i;
+    int j;
+
+    for (pInstr = query->instrM; pInstr < query->instrM + query->iInstrCount; pInstr++)
+    {
+        if (pInstr->iOp != OP_AND && pInstr->iOp != OP_OR)
+        {
+            result.iConjCount = 1;
+            result.iStartM = arenaAlloc(arena, 2 * sizeof(int));
+            result.litM = arenaAlloc(arena, sizeof(Instr));
+            result.iStartM[0] = 0;
+            result.iStartM[1] = 1;
+            result.litM[0] = *pInstr;
+            dnfM[iTop++] = result;
+            continue;
+        }
+        pLeft = &dnfM[iTop - 2];
+        pRight = &dnfM[iTop - 1];
+        iLeftLength = pLeft->iStartM[pLeft->iConjCount];
+        iRightLength = pRight->iStartM[pRight->iConjCount];
+        if (pInstr->iOp == OP_OR)
+        {
+            result.iConjCount = pLeft->iConjCount + pRight->iConjCount;
+            if (result.iConjCount > MATCH_MAX_CONJUNCTIONS)
+                return FALSE;
+            result.iStartM = arenaAlloc(arena, (result.iConjCount + 1) * sizeof(int));
+            result.litM = arenaAlloc(arena, (iLeftLength + iRightLength) * sizeof(Instr));
+            memcpy(result.litM, pLeft->litM, iLeftLength * sizeof(Instr));
+            memcpy(result.litM + iLeftLength, pRight->litM, iRightLength * sizeof(Instr));
+            memcpy(result.iStartM, pLeft->iStartM, pLeft->iConjCount * sizeof(int));
+            for (i = 0; i <= pRight->iConjCount; i++)
+                result.iStartM[pLeft->iConjCount + i] = iLeftLength + pRight->iStartM[i];
+        }
+        else
+        {
+            result.iConjCount = pLeft->iConjCount * pRight->iConjCount;
+            if (result.iConjCount > MATCH_MAX_CONJUNCTIONS)
+                return FALSE;
+            result.iStartM = arenaAlloc(arena, (result.iConjCount + 1) * sizeof(int));
+            result.litM = arenaAlloc(arena, (iLeftLength * pRight->iConjCount
+                + iRightLength * pLeft->iConjCount) * sizeof(Instr));
+            iLit = 0;
+            for (i = 0; i < pLeft->iConjCount; i++)
+            {
+                for (j = 0; j < pRight->iConjCount; j++)
+                {
+                    result.iStartM[i * pRight->iConjCount + j] = iLit;
+                    memcpy(result.litM + iLit, pLeft->litM + pLeft->iStartM[i]
+                        , (pLeft->iStartM[i + 1] - pLeft->iStartM[i]) * sizeof(Instr));
+                    iLit += pLeft->iStartM[i + 1] - pLeft->iStartM[i];
+                    memcpy(result.litM + iLit, pRight->litM + pRight->iStartM[j]
+                        , (pRight->iStartM[j + 1] - pRight->iStartM[j]) * sizeof(Instr));
+                    iLit += pRight->iStartM[j + 1] - pRight->iStartM[j];
+                }
+            }
+            result.iStartM[result.iConjCount] = iLit;
+        }
+        iTop--;
+        dnfM[iTop - 1] = result;
+    }
+    *pDnf = dnfM[0];
+    return TRUE;
+}
+
+/******************** addMatchQuery **************************************
+int addMatchQuery(MatchIndex index, Out out, Query query)
+Purpose:
+    Registers a converted query with the match index.
+Parameters:
+    I/O MatchIndex index            match index to add to
+    I/O Out out                     postfix expression from convertToPostFix.
+                                    Its arena is used for work areas.
+    I/O Query query                 work area for compileQuery
+Returns:
+    The query id (0 is the first), or -1 if the postfix is not a valid
+    query (compileQuery returns WARN_INVALID_QUERY).
+**************************************************************************/
+int addMatchQuery(MatchIndex index, Out out, Query query)
+{
+    StandingQuery *pQuery;
+    int iQuery = index->iQueryCount;
+    int iQueryMax = index->iQueryMax;
+    Dnf dnf;
+    int i;
+
+    if (compileQuery(out, NULL, query) != 0)
+        return -1;
+
+    index->queryM = growArray(index->queryM, &index->iQueryMax, iQuery + 1
+        , sizeof(StandingQuery));
+    if (index->iQueryMax != iQueryMax)
+    {
+        index->iQueryMarkM = realloc(index->iQueryMarkM, index->iQueryMax * sizeof(int));
+        index->iMatchM = realloc(index->iMatchM, index->iQueryMax * sizeof(int));
+        if (index->iQueryMarkM == NULL || index->iMatchM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d match queries"
+                , index->iQueryMax);
+    }
+    index->instrM = growArray(index->instrM, &index->iInstrMax
+        , index->iInstrCount + query->iInstrCount, sizeof(Instr));
+    index->bStackM = growArray(index->bStackM, &index->iStackMax, query->iMaxDepth
+        , sizeof(int));
+
+    pQuery = &index->queryM[iQuery];
+    pQuery->iFirstInstr = index->iInstrCount;
+    pQuery->iInstrCount = query->iInstrCount;
+    pQuery->iMaxDepth = query->iMaxDepth;
+    memcpy(index->instrM + index->iInstrCount, query->instrM
+        , query->iInstrCount * sizeof(Instr));
+    index->iInstrCount += query->iInstrCount;
+    index->iQueryMarkM[iQuery] = 0;
+    index->iQueryCount++;
+    index->bPacked = FALSE;
+
+    if (!buildDnf(query, out->arena, &dnf))
+    {
+        index->iFallbackM = growArray(index->iFallbackM, &index->iFallbackMax
+            , index->iFallbackCount + 1, sizeof(int));
+        index->iFallbackM[index->iFallbackCount++] = iQuery;
+        return iQuery;
+    }
+    for (i = 0; i < dnf.iConjCount; i++)
+        addConjunction(index, iQuery, dnf.litM + dnf.iStartM[i]
+            , dnf.iStartM[i + 1] - dnf.iStartM[i]);
+    return iQuery;
+}
+
+/******************** packPostings **************************************
+void packPostings(MatchIndex index)
+Purpose:
+    Copies the posting lists into packM so that the postings of a key
+    are next to each other.
+Parameters:
+    I/O MatchIndex index            match index
+Returns:
+    n/a
+Notes:
+    - The postings of slot s are packM[iPackStartM[s]] to
+      packM[iPackStartM[s + 1] - 1].
+**************************************************************************/
+static void packPostings(MatchIndex index)
+{
+    int iSlot;
+    int iPost;
+    int iNext = 0;
+
+    free(index->iPackStartM);
+    free(index->packM);
+    index->iPackStartM = malloc((index->iHashSize + 1) * sizeof(int));
+    index->packM = malloc((index->iPostCount + 1) * sizeof(MatchPosting));
+    if (index->iPackStartM == NULL || index->packM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to pack %d postings", index->iPostCount);
+    for (iSlot = 0; iSlot < index->iHashSize; iSlot++)
+    {
+        index->iPackStartM[iSlot] = iNext;
+        for (iPost = index->iFirstPostM[iSlot]; iPost >= 0; iPost = index->iPostNextM[iPost])
+            index->packM[iNext++] = index->postM[iPost];
+    }
+    index->iPackStartM[index->iHashSize] = iNext;
+    index->bPacked = TRUE;
+}
+
+/******************** parseRecord **************************************
+void parseRecord(MatchIndex index, char *pszFields)
+Purpose:
+    Parses a record into index->record and counts the values of each
+    pair's trait.
+Parameters:
+    I/O MatchIndex index            match index
+    I   char *pszFields             TRAIT=VALUE fields separated by white space
+Returns:
+    n/a
+Notes:
+    - A pair given twice is kept once.
+**************************************************************************/
+static void parseRecord(MatchIndex index, char *pszFields)
+{
+    CustomerRecord *pRecord = &index->record;
+    char *pszRemainingText;
+    char *pszToken;
+    char *pszEqual;
+    int iTokenLength;
+    int iTraitLength;
+    int iTrait;
+    int iValue;
+    int i;
+    int j;
+
+    pRecord->iPairCount = 0;
+    pszRemainingText = getTokenView(pszFields, &pszToken, &iTokenLength);
+    while (pszRemainingText != NULL)
+    {
+        pszEqual = memchr(pszToken, '=', iTokenLength);
+        if (pszEqual == NULL || pszEqual == pszToken || pszEqual == pszToken + iTokenLength - 1)
+            ErrExit(ERR_CUSTOMER_DATA, "Record has a malformed field '%.*s'"
+                , iTokenLength, pszToken);
+        iTraitLength = (int) (pszEqual - pszToken);
+        iTrait = internSymbol(pszToken, iTraitLength);
+        iValue = internSymbol(pszEqual + 1, iTokenLength - iTraitLength - 1);
+        for (i = 0; i < pRecord->iPairCount; i++)
+        {
+            if (pRecord->iPairM[2 * i] == iTrait && pRecord->iPairM[2 * i + 1] == iValue)
+                break;
+        }
+        if (i == pRecord->iPairCount)
+        {
+            pRecord->iPairM = growArray(pRecord->iPairM, &pRecord->iPairMax
+                , pRecord->iPairCount + 1, 2 * sizeof(int));
+            pRecord->iPairM[2 * i] = iTrait;
+            pRecord->iPairM[2 * i + 1] = iValue;
+            pRecord->iPairCount++;
+        }
+        pszRemainingText = getTokenView(pszRemainingText, &pszToken, &iTokenLength);
+    }
+
+    index->iTraitCountM = growArray(index->iTraitCountM, &index->iTraitCountMax
+        , pRecord->iPairCount, sizeof(int));
+    for (i = 0; i < pRecord->iPairCount; i++)
+    {
+        index->iTraitCountM[i] = 0;
+        for (j = 0; j < pRecord->iPairCount; j++)
+        {
+            if (pRecord->iPairM[2 * j] == pRecord->iPairM[2 * i])
+                index->iTraitCountM[i]++;
+        }
+    }
+}
+
+/******************** addMatch **************************************
+void addMatch(MatchIndex index, int iQuery)
+Purpose:
+    Adds a query to the matches of the current record, once.
+**************************************************************************/
+static void addMatch(MatchIndex index, int iQuery)
+{
+    if (index->iQueryMarkM[iQuery] == index->iMark)
+        return;
+    index->iQueryMarkM[iQuery] = index->iMark;
+    index->iMatchM[index->iMatchCount++] = iQuery;
+}
+
+/******************** matchRecord **************************************
+int matchRecord(MatchIndex index, char *pszFields)
+Purpose:
+    Finds the registered queries a record satisfies.
+Parameters:
+    I/O MatchIndex index            match index
+    I   char *pszFields             TRAIT=VALUE fields separated by white
+                                    space, as in the customer file
+Returns:
+    The number of matching queries.  Their ids are in index->iMatchM,
+    in no particular order, until the next match.
+Notes:
+    - With index->bUseIndex FALSE every query is evaluated, which gives
+      the same matches; it is used to measure what the index saves.
+**************************************************************************/
+int matchRecord(MatchIndex index, char *pszFields)
+{
+    CustomerRecord *pRecord = &index->record;
+    StandingQuery *pQuery;
+    MatchPosting *pPost;
+    MatchPosting *pEnd;
+    MatchConj *pConj;
+    int iSlot;
+    int i;
+
+    if (!index->bPacked)
+        packPostings(index);
+    parseRecord(index, pszFields);
+    index->iMark++;
+    index->iMatchCount = 0;
+
+    if (!index->bUseIndex)
+    {
+        for (i = 0; i < index->iQueryCount; i++)
+        {
+            pQuery = &index->queryM[i];
+            if (evaluateRecord(index->instrM + pQuery->iFirstInstr, pQuery->iInstrCount
+                , pRecord, index->bStackM))
+                addMatch(index, i);
+        }
+        return index->iMatchCount;
+    }
+
+    // count the hits of the conjunctions on the record's keys
+    index->iTouchedCount = 0;
+    for (i = 0; i < pRecord->iPairCount; i++)
+    {
+        iSlot = findKey(index, pRecord->iPairM[2 * i], pRecord->iPairM[2 * i + 1]);
+        if (index->iFirstPostM[iSlot] < 0)
+            continue;
+        pPost = index->packM + index->iPackStartM[iSlot];
+        pEnd = index->packM + index->iPackStartM[iSlot + 1];
+        index->lPostings += pEnd - pPost;
+        for (; pPost < pEnd; pPost++)
+        {
+            if (pPost->iOp == OP_ONLY && index->iTraitCountM[i] != 1)
+                continue;
+            pConj = &index->conjM[pPost->iConj];
+            if (pConj->iHitMark != index->iMark)
+            {
+                // first posting of the conjunction for this record; a
+                // conjunction rejected now need not be looked at again
+                pConj->iHitMark = index->iMark;
+                pConj->iHitCount = 0;
+                if (pPost->iOp != OP_NOTANY)
+                    index->iTouchedM[index->iTouchedCount++] = pPost->iConj;
+            }
+            if (pPost->iOp == OP_NOTANY)
+                pConj->iHitCount = MATCH_REJECTED;
+            else
+                pConj->iHitCount++;
+        }
+    }
+
+    for (i = 0; i < index->iTouchedCount; i++)
+    {
+        pConj = &index->conjM[index->iTouchedM[i]];
+        if (pConj->iHitCount == pConj->iPositiveCount)
+            addMatch(index, pConj->iQuery);
+    }
+    for (i = 0; i < index->iZeroCount; i++)
+    {
+        pConj = &index->conjM[index->iZeroM[i]];
+        if (pConj->iHitMark != index->iMark)
+            addMatch(index, pConj->iQuery);
+    }
+    for (i = 0; i < index->iFallbackCount; i++)
+    {
+        pQuery = &index->queryM[index->iFallbackM[i]];
+        if (index->iQueryMarkM[index->iFallbackM[i]] != index->iMark
+            && evaluateRecord(index->instrM + pQuery->iFirstInstr, pQuery->iInstrCount
+                , pRecord, index->bStackM))
+            addMatch(index, index->iFallbackM[i]);
+    }
+    return index->iMatchCount;
+}
+
+/******************** freeMatchIndex **************************************
+void freeMatchIndex(MatchIndex index)
+Purpose:
+    Frees a match index.
+Parameters:
+    I/O MatchIndex index            index to free
+Returns:
+    n/a
+**************************************************************************/
+void freeMatchIndex(MatchIndex index)
+{
+    free(index->queryM);
+    free(index->instrM);
+    free(index->conjM);
+    free(index->iZeroM);
+    free(index->iFallbackM);
+    free(index->iKeyTraitM);
+    free(index->iKeyValueM);
+    free(index->iFirstPostM);
+    free(index->postM);
+    free(index->iPostNextM);
+    free(index->iPackStartM);
+    free(index->packM);
+    free(index->record.iPairM);
+    free(index->iTraitCountM);
+    free(index->iTouchedM);
+    free(index->iQueryMarkM);
+    free(index->iMatchM);
+    free(index->bStackM);
+    free(index);
+}
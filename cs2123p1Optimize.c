@@ -0,0 +1,505 @@
+/**********************************************************************************
+Program cs2123p1Optimize.c by Timothy Hennessy
+Purpose:
+    Reorders the operands of AND and OR in a compiled query so the
+    operand most likely to decide the result is evaluated first, and adds
+    jumps that skip the rest once the result is known.
+Command Parameters:
+    n/a
+Input:
+    A Query built by compileQuery and QueryStats for the same customer set.
+    Statistics files contain one line with the customer count followed by
+    one line per trait value:
+        CUSTOMERS 200000
+        SMOKING N 100127 100127
+        EXERCISE HIKE 41872 12010
+    The numbers on a value line are the customers having the value and
+    the customers whose only value for the trait it is.
+Results:
+    The query's instructions are replaced by an equivalent list.  For
+    A AND B AND C it is:
+        A  JUMP_FALSE L  B  AND  JUMP_FALSE L  C  AND  L:
+    and OR is the same with JUMP_TRUE.
+Returns:
+    n/a
+Notes:
+    1. The fraction of customers for which a comparison is true is
+       estimated from the statistics:
+           =       count / customers
+           NOTANY  1 - count / customers
+           ONLY    only count / customers
+       AND multiplies the fractions of its operands, and OR combines them
+       as 1 - (1 - p1) * (1 - p2).  Operands are assumed independent.
+    2. Nested operators of the same kind are merged first, so
+       A AND ( B AND C ) is reordered as one list of three operands.
+       AND operands are sorted from least to most often true and OR
+       operands from most to least often true.
+    3. Jumps do not pop the stack, so the instructions give the same
+       result whether or not a jump is taken.  evaluateQuery jumps per
+       customer; countIndexMatches jumps per block of bitmap words.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+
+// Operand typedef is one operand of a merged AND or OR
+typedef struct
+{
+    double dTrue;               // estimated fraction of customers it is true for
+    int iNode;                  // instruction subscript of the operand's root
+} Operand;
+
+// OptimizeState typedef holds the work areas of optimizeQuery.  Nodes
+// are the subscripts of the compiled (unoptimized) instructions.
+typedef struct
+{
+    Instr *instrM;              // copy of the compiled instructions
+    int *iLeftM;                // left operand of an AND or OR node
+    int *iRightM;               // right operand of an AND or OR node
+    double *dTrueM;             // estimated fraction true of each node
+    int *iPendingM;             // nodes waiting to be merged
+    Operand *operandM;          // operands found while merging
+    Instr *newInstrM;           // optimized instructions
+    int iNewCount;              // number of entries in newInstrM
+    int iDepth;                 // evaluation stack depth after newInstrM
+    int iMaxDepth;              // deepest evaluation stack
+    Arena arena;
+} OptimizeState;
+
+/******************** newStats **************************************
+QueryStats newStats(CustomerSet customerSet)
+Purpose:
+    Creates statistics with zero counts for every value of a customer set.
+Parameters:
+    I   CustomerSet customerSet     customer set the counts are for
+Returns:
+    The new statistics.  Use freeStats to free them.
+**************************************************************************/
+static QueryStats newStats(CustomerSet customerSet)
+{
+    QueryStats stats = calloc(1, sizeof(QueryStatsImp));
+    TraitStats *pTrait;
+    int i;
+
+    if (stats == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate query statistics");
+    stats->iTraitCount = customerSet->iTraitCount;
+    for (i = 0; i < customerSet->iTraitCount; i++)
+    {
+        pTrait = &stats->traitM[i];
+        pTrait->iValueCount = customerSet->traitM[i].iValueCount;
+        pTrait->iCountM = calloc(pTrait->iValueCount + 1, sizeof(int));
+        pTrait->iOnlyCountM = calloc(pTrait->iValueCount + 1, sizeof(int));
+        if (pTrait->iCountM == NULL || pTrait->iOnlyCountM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate query statistics");
+    }
+    return stats;
+}
+
+/******************** collectStats **************************************
+QueryStats collectStats(CustomerSet customerSet)
+Purpose:
+    Counts the customers having each trait value, in one pass over the
+    customer set.
+Parameters:
+    I   CustomerSet customerSet     customer set to count
+Returns:
+    The statistics.  Use freeStats to free them.
+**************************************************************************/
+QueryStats collectStats(CustomerSet customerSet)
+{
+    QueryStats stats = newStats(customerSet);
+    TraitColumn *pColumn;
+    TraitStats *pTrait;
+    int iTrait;
+    int iCustomer;
+    int iStart;
+    int iEnd;
+    int i;
+
+    stats->iCustomerCount = customerSet->iCustomerCount;
+    for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+    {
+        pColumn = &customerSet->traitM[iTrait];
+        pTrait = &stats->traitM[iTrait];
+        for (iCustomer = 0; iCustomer < customerSet->iCustomerCount; iCustomer++)
+        {
+            iStart = pColumn->iOffsetM[iCustomer];
+            iEnd = pColumn->iOffsetM[iCustomer + 1];
+            for (i = iStart; i < iEnd; i++)
+                pTrait->iCountM[pColumn->iValueIdM[i]]++;
+            if (iEnd - iStart == 1)
+                pTrait->iOnlyCountM[pColumn->iValueIdM[iStart]]++;
+        }
+    }
+    return stats;
+}
+
+/******************** saveStats **************************************
+void saveStats(QueryStats stats, CustomerSet customerSet, FILE *pFile)
+Purpose:
+    Writes statistics to a file (see the format above).
+Parameters:
+    I   QueryStats stats            statistics to write
+    I   CustomerSet customerSet     customer set the statistics are for.
+                                    It gives the trait and value names.
+    I   FILE *pFile                 file opened for writing
+Returns:
+    n/a
+**************************************************************************/
+void saveStats(QueryStats stats, CustomerSet customerSet, FILE *pFile)
+{
+    TraitStats *pTrait;
+    int iTrait;
+    int iValue;
+
+    fprintf(pFile, "CUSTOMERS %d\n", stats->iCustomerCount);
+    for (iTrait = 0; iTrait < stats->iTraitCount; iTrait++)
+    {
+        pTrait = &stats->traitM[iTrait];
+        for (iValue = 0; iValue < pTrait->iValueCount; iValue++)
+        {
+            fprintf(pFile, "%s %s %d %d\n", customerSet->traitM[iTrait].szTrait
+                , customerSet->traitM[iTrait].szValueM[iValue]
+                , pTrait->iCountM[iValue], pTrait->iOnlyCountM[iValue]);
+        }
+    }
+}
+
+/******************** nextField **************************************
+char *nextField(char *pszText, char **ppszField)
+Purpose:
+    Finds the next white space separated field of a line and zero
+    terminates it in place.
+Parameters:
+    I/O char *pszText               rest of the line
+    O   char **ppszField            Returned zero terminated field
+Returns:
+    Functionally:
+        Pointer to the text after the field.
+        NULL - no field found.
+**************************************************************************/
+static char *nextField(char *pszText, char **ppszField)
+{
+    char *pszEnd;
+    int iLength;
+
+    pszEnd = getTokenView(pszText, ppszField, &iLength);
+    if (pszEnd == NULL)
+        return NULL;
+    if (*pszEnd != '\0')
+        *pszEnd++ = '\0';
+    return pszEnd;
+}
+
+/******************** loadStats **************************************
+QueryStats loadStats(FILE *pFile, CustomerSet customerSet)
+Purpose:
+    Reads statistics written by saveStats.
+Parameters:
+    I   FILE *pFile                 file opened for reading
+    I   CustomerSet customerSet     customer set the queries are compiled
+                                    against.  Names in the file are
+                                    mapped to its trait and value ids.
+Returns:
+    The statistics.  Use freeStats to free them.
+Notes:
+    - Values that are not in the customer set are ignored, and values
+      missing from the file have zero counts.
+    - Lines are read with readLine, so they may have any length, and
+      fields are separated by any white space.
+    - Exits with ERR_CUSTOMER_DATA if the file is malformed.
+**************************************************************************/
+QueryStats loadStats(FILE *pFile, CustomerSet customerSet)
+{
+    QueryStats stats = newStats(customerSet);
+    LineReader reader = newLineReader(pFile);
+    char *pszLine;                          // entire statistics line
+    char *pszTrait;
+    char *pszValue;
+    char *pszCount;
+    char *pszOnlyCount;
+    char *pszRemainingText;
+    int iLength;
+    int bNewline;
+    int iTrait;
+    int iValue;
+
+    if ((pszLine = readLine(reader, &iLength, &bNewline)) == NULL
+        || (pszRemainingText = nextField(pszLine, &pszTrait)) == NULL
+        || strcmp(pszTrait, "CUSTOMERS") != 0
+        || nextField(pszRemainingText, &pszCount) == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Statistics file does not start with CUSTOMERS");
+    stats->iCustomerCount = atoi(pszCount);
+
+    while ((pszLine = readLine(reader, &iLength, &bNewline)) != NULL)
+    {
+        pszRemainingText = nextField(pszLine, &pszTrait);
+        if (pszRemainingText == NULL)
+            continue;                       // empty line
+        pszRemainingText = nextField(pszRemainingText, &pszValue);
+        if (pszRemainingText != NULL)
+            pszRemainingText = nextField(pszRemainingText, &pszCount);
+        if (pszRemainingText == NULL
+            || nextField(pszRemainingText, &pszOnlyCount) == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Malformed statistics for %s", pszTrait);
+        iTrait = findTrait(customerSet, pszTrait);
+        if (iTrait < 0)
+            continue;
+        iValue = findTraitValue(customerSet, iTrait, pszValue);
+        if (iValue < 0)
+            continue;
+        stats->traitM[iTrait].iCountM[iValue] = atoi(pszCount);
+        stats->traitM[iTrait].iOnlyCountM[iValue] = atoi(pszOnlyCount);
+    }
+    freeLineReader(reader);
+    return stats;
+}
+
+/******************** freeStats **************************************
+void freeStats(QueryStats stats)
+Purpose:
+    Frees query statistics.
+Parameters:
+    I/O QueryStats stats            statistics to free
+Returns:
+    n/a
+**************************************************************************/
+void freeStats(QueryStats stats)
+{
+    int i;
+    for (i = 0; i < stats->iTraitCount; i++)
+    {
+        free(stats->traitM[i].iCountM);
+        free(stats->traitM[i].iOnlyCountM);
+    }
+    free(stats);
+}
+
+/******************** estimateTrue **************************************
+double estimateTrue(Instr *pInstr, QueryStats stats)
+Purpose:
+    Estimates the fraction of customers for which a comparison is true.
+Parameters:
+    I   Instr *pInstr               comparison instruction
+    I   QueryStats stats            statistics of the customer set
+Returns:
+    The estimated fraction, from 0 to 1.
+**************************************************************************/
+static double estimateTrue(Instr *pInstr, QueryStats stats)
+{
+    double dCount = 0;
+    TraitStats *pTrait;
+
+    if (stats->iCustomerCount <= 0)
+        return 0.5;
+    if (pInstr->iValue >= 0 && pInstr->iTrait < stats->iTraitCount)
+    {
+        pTrait = &stats->traitM[pInstr->iTrait];
+        if (pInstr->iValue < pTrait->iValueCount)
+        {
+            if (pInstr->iOp == OP_ONLY)
+                dCount = pTrait->iOnlyCountM[pInstr->iValue];
+            else
+                dCount = pTrait->iCountM[pInstr->iValue];
+        }
+    }
+    if (pInstr->iOp == OP_NOTANY)
+        return 1.0 - dCount / stats->iCustomerCount;
+    return dCount / stats->iCustomerCount;
+}
+
+/******************** compareOperands **************************************
+int compareOperands(const void *pLeft, const void *pRight)
+Purpose:
+    qsort comparison putting operands in ascending order of dTrue.
+    Ties keep the order of the query.
+**************************************************************************/
+static int compareOperands(const void *pLeft, const void *pRight)
+{
+    const Operand *pA = pLeft;
+    const Operand *pB = pRight;
+    if (pA->dTrue != pB->dTrue)
+        return pA->dTrue < pB->dTrue ? -1 : 1;
+    return pA->iNode - pB->iNode;
+}
+
+/******************** addInstr **************************************
+int addInstr(OptimizeState *pState, Instr instr)
+Purpose:
+    Appends an instruction to the optimized list and tracks the depth of
+    the evaluation stack.
+Parameters:
+    I/O OptimizeState *pState       optimizer work areas
+    I   Instr instr                 instruction to append
+Returns:
+    The subscript of the new instruction.
+**************************************************************************/
+static int addInstr(OptimizeState *pState, Instr instr)
+{
+    if (instr.iOp == OP_AND || instr.iOp == OP_OR)
+        pState->iDepth--;
+    else if (instr.iOp != OP_JUMP_FALSE && instr.iOp != OP_JUMP_TRUE)
+        pState->iDepth++;
+    if (pState->iDepth > pState->iMaxDepth)
+        pState->iMaxDepth = pState->iDepth;
+    pState->newInstrM[pState->iNewCount] = instr;
+    return pState->iNewCount++;
+}
+
+/******************** emitNode **************************************
+void emitNode(OptimizeState *pState, int iNode)
+Purpose:
+    Appends the optimized instructions of a node and its operands.
+Parameters:
+    I/O OptimizeState *pState       optimizer work areas
+    I   int iNode                   node to emit
+Returns:
+    n/a
+Notes:
+    - The operands of a chain of the same operator are gathered with
+      iPendingM as an explicit stack, so a long chain does not recurse.
+      Recursion only happens where AND and OR alternate.
+**************************************************************************/
+static void emitNode(OptimizeState *pState, int iNode)
+{
+    Instr instr = pState->instrM[iNode];
+    Instr jump;
+    Operand *operandM;
+    int *iJumpM;
+    int iOperandCount = 0;
+    int iPending = 0;
+    int iChild;
+    int i;
+
+    if (instr.iOp != OP_AND && instr.iOp != OP_OR)
+    {
+        addInstr(pState, instr);
+        return;
+    }
+
+    // gather the operands of the chain, left to right
+    pState->iPendingM[iPending++] = iNode;
+    while (iPending > 0)
+    {
+        iChild = pState->iPendingM[--iPending];
+        if (pState->instrM[iChild].iOp == instr.iOp)
+        {
+            pState->iPendingM[iPending++] = pState->iRightM[iChild];
+            pState->iPendingM[iPending++] = pState->iLeftM[iChild];
+            continue;
+        }
+        pState->operandM[iOperandCount].iNode = iChild;
+        pState->operandM[iOperandCount].dTrue = pState->dTrueM[iChild];
+        iOperandCount++;
+    }
+    operandM = arenaAlloc(pState->arena, iOperandCount * sizeof(Operand));
+    iJumpM = arenaAlloc(pState->arena, iOperandCount * sizeof(int));
+    memcpy(operandM, pState->operandM, iOperandCount * sizeof(Operand));
+
+    // AND wants the least often true operand first, OR the most often
+    if (instr.iOp == OP_OR)
+    {
+        for (i = 0; i < iOperandCount; i++)
+            operandM[i].dTrue = -operandM[i].dTrue;
+    }
+    qsort(operandM, iOperandCount, sizeof(Operand), compareOperands);
+
+    jump.iOp = instr.iOp == OP_AND ? OP_JUMP_FALSE : OP_JUMP_TRUE;
+    jump.iTrait = -1;
+    jump.iValue = -1;
+    emitNode(pState, operandM[0].iNode);
+    for (i = 1; i < iOperandCount; i++)
+    {
+        iJumpM[i] = addInstr(pState, jump);
+        emitNode(pState, operandM[i].iNode);
+        addInstr(pState, instr);
+    }
+    for (i = 1; i < iOperandCount; i++)
+        pState->newInstrM[iJumpM[i]].iValue = pState->iNewCount;
+}
+
+/******************** optimizeQuery **************************************
+void optimizeQuery(Query query, QueryStats stats, Arena arena)
+Purpose:
+    Reorders the operands of AND and OR and adds short circuit jumps.
+Parameters:
+    I/O Query query                 query from compileQuery
+    I   QueryStats stats            statistics of the customer set the
+                                    query was compiled against
+    I/O Arena arena                 arena for the work areas
+Returns:
+    n/a
+Notes:
+    - The query must not already be optimized.
+    - The result is the same for every customer; only the order of
+      evaluation changes.
+**************************************************************************/
+void optimizeQuery(Query query, QueryStats stats, Arena arena)
+{
+    OptimizeState state;
+    int iCount = query->iInstrCount;
+    int *iStackM;
+    int iTop = 0;
+    int iNewMax;
+    int i;
+    double dLeft;
+    double dRight;
+
+    if (iCount < 3)
+        return;                             // a single comparison
+
+    state.arena = arena;
+    state.instrM = arenaAlloc(arena, iCount * sizeof(Instr));
+    state.iLeftM = arenaAlloc(arena, iCount * sizeof(int));
+    state.iRightM = arenaAlloc(arena, iCount * sizeof(int));
+    state.dTrueM = arenaAlloc(arena, iCount * sizeof(double));
+    state.iPendingM = arenaAlloc(arena, (iCount + 1) * sizeof(int));
+    state.operandM = arenaAlloc(arena, iCount * sizeof(Operand));
+    iStackM = arenaAlloc(arena, iCount * sizeof(int));
+    memcpy(state.instrM, query->instrM, iCount * sizeof(Instr));
+
+    // build the expression tree and estimate each node
+    for (i = 0; i < iCount; i++)
+    {
+        state.iLeftM[i] = state.iRightM[i] = -1;
+        switch (state.instrM[i].iOp)
+        {
+            case OP_AND:
+            case OP_OR:
+                state.iRightM[i] = iStackM[--iTop];
+                state.iLeftM[i] = iStackM[--iTop];
+                dLeft = state.dTrueM[state.iLeftM[i]];
+                dRight = state.dTrueM[state.iRightM[i]];
+                if (state.instrM[i].iOp == OP_AND)
+                    state.dTrueM[i] = dLeft * dRight;
+                else
+                    state.dTrueM[i] = 1.0 - (1.0 - dLeft) * (1.0 - dRight);
+                break;
+            default:
+                state.dTrueM[i] = estimateTrue(&state.instrM[i], stats);
+        }
+        iStackM[iTop++] = i;
+    }
+
+    // each AND or OR gets at most one jump
+    if (2 * iCount > query->iInstrMax)
+    {
+        iNewMax = 2 * iCount;
+        query->instrM = realloc(query->instrM, iNewMax * sizeof(Instr));
+        if (query->instrM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d instructions", iNewMax);
+        query->iInstrMax = iNewMax;
+    }
+    state.newInstrM = query->instrM;
+    state.iNewCount = 0;
+    state.iDepth = 0;
+    state.iMaxDepth = 0;
+    emitNode(&state, iCount - 1);
+    query->iInstrCount = state.iNewCount;
+    query->iMaxDepth = state.iMaxDepth;
+}
@@ -0,0 +1,777 @@
+/**********************************************************************************
+Program cs2123p1Parallel.c by Timothy Hennessy
+Purpose:
+    Converts one very large query from infix to postfix on several
+    threads.  The result is the same as convertToPostFix's.
+Command Parameters:
+    n/a
+Input:
+    A query, as for convertToPostFix, usually machine built with tens of
+    thousands of terms or more, such as long OR lists inside nested
+    parentheses.
+Results:
+    The postfix of the query is added to out.
+Returns:
+    0   - conversion to postfix was successful
+    801 - WARN_MISSING_RPAREN
+    802 - WARN_MISSING_LPAREN
+Notes:
+    1. The work is done in phases, each on every thread:
+           - the text is cut into one chunk per thread at white space, and
+             each chunk is tokenized.  Its parentheses are matched within
+             the chunk, and the sum and lowest prefix sum of its
+             parenthesis depth changes are kept.
+           - a prefix sum of the chunks' depth sums gives the depth at the
+             start of each chunk.  The query is missing a left parenthesis
+             if the depth ever goes below 0 and a right one if it does not
+             end at 0, just as convertToPostFix finds.  The tokens are then
+             copied into one array and the parentheses left unmatched in
+             their chunks are matched across the chunks.
+           - the tokens are converted as independent units (see 2).
+           - the units' postfix is stitched together in order.
+    2. The conversion of a parenthesized group does not depend on what is
+       outside it: its left parenthesis stops operators inside it from
+       popping the stack below, and its right parenthesis pops the stack
+       back down.  So a large group is converted as a unit of its own and
+       stands in its enclosing unit's postfix as a placeholder.  A long
+       run of tokens is also cut before each AND or OR at its own depth,
+       since an operator of the lowest precedence pops everything down to
+       the enclosing parenthesis; each piece is converted as though it
+       were a whole query.
+    3. A malformed query, or one too short to gain from threads, is
+       converted by convertToPostFix, so out holds exactly what it leaves.
+    4. Each worker thread runs its phase with trapErrors.  The first
+       error is kept in the job, the other threads stop at their next
+       unit, and once they have all finished the calling thread frees the
+       job and reports the error with ErrExit.  So the error ends the
+       program, or is returned to an error trap set by the caller, just
+       as one on the calling thread is.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "cs2123p1.h"
+
+#define PARALLEL_MIN_UNIT 2048      // fewest tokens in a unit of its own
+#define PARALLEL_UNITS_PER_THREAD 8 // units aimed for on each thread
+#define CAT_UNIT 0                  // category of a placeholder for a unit
+#define PARALLEL_ERROR_SIZE 200     // longest error message kept from a thread
+
+// TokenChunk typedef is the part of the query tokenized by one thread.
+// Its subscripts are from the start of the chunk until the tokens are
+// copied into the job's arrays.
+typedef struct
+{
+    char *pszStart;             // first character of the chunk
+    char *pszEnd;               // character after the chunk (white space or zero byte)
+    Element *elementM;
+    int *iMatchM;               // matching parenthesis of each token (-1 if none)
+    int iCount;                 // tokens in the chunk
+    int iMax;                   // allocated size of elementM and iMatchM
+    int *iOpenM;                // left parentheses not matched in the chunk
+    int iOpenCount;
+    int iOpenMax;
+    int *iCloseM;               // right parentheses not matched in the chunk
+    int iCloseCount;
+    int iCloseMax;
+    int iDepthSum;              // depth change over the chunk
+    int iMinDepth;              // lowest depth reached, from 0 at the start
+    int iFirstToken;            // subscript of the chunk's first token in the job
+} TokenChunk;
+
+// ParallelUnit typedef is a run of tokens converted on its own.  The
+// pieces of one cut run are chained by iNext.
+typedef struct
+{
+    int iStart;                 // first token
+    int iEnd;                   // token after the last one
+    int iNext;                  // next piece of the run (-1 if last)
+    int iPlaceholderCount;      // placeholders in out
+    OutImp out;                 // postfix, with placeholders for large groups
+} ParallelUnit;
+
+// ParallelJob typedef holds everything shared by the threads converting
+// one query
+typedef struct
+{
+    int iThreads;
+    TokenChunk *chunkM;         // one chunk per thread
+    Element *elementM;          // every token of the query
+    int *iMatchM;               // matching parenthesis of each token (-1 if none)
+    int iTokenCount;
+    int iUnitMin;               // fewest tokens in a unit of its own
+    Arena *arenaM;              // memory of each thread, plus one for the caller
+    ParallelUnit **unitM;       // units, converted in the order they are added
+    int iUnitCount;
+    int iUnitMax;               // allocated size of unitM
+    int iNextUnit;              // next unit to convert
+    int iBusy;                  // threads converting a unit
+    int rc;                     // first error of a thread, 0 if none
+    char szError[PARALLEL_ERROR_SIZE];  // its message
+    pthread_mutex_t lock;       // protects the unit and error fields above
+    pthread_cond_t unitReady;   // a unit was added or the last one finished
+} ParallelJob;
+
+// ParallelArg typedef is the argument of a thread of a phase
+typedef struct
+{
+    ParallelJob *pJob;
+    int iThread;
+    void (*pfnPhase)(void *);   // phase function run by the thread
+    int bBusy;                  // TRUE while the thread converts a unit
+} ParallelArg;
+
+static void freeJob(ParallelJob *pJob);
+
+/******************** growArray **************************************
+void *growArray(void *pArray, int *piMax, int iNeeded, size_t iEntrySize)
+Purpose:
+    Makes sure a dynamically allocated array has room for iNeeded entries.
+Parameters:
+    I/O void *pArray            array (may be NULL)
+    I/O int *piMax              allocated number of entries
+    I   int iNeeded             number of entries needed
+    I   size_t iEntrySize       size of one entry
+Returns:
+    The possibly moved array.
+**************************************************************************/
+static void *growArray(void *pArray, int *piMax, int iNeeded, size_t iEntrySize)
+{
+    int iNewMax;
+    if (iNeeded <= *piMax)
+        return pArray;
+    iNewMax = *piMax > 0 ? *piMax * 2 : 64;
+    while (iNewMax < iNeeded)
+        iNewMax *= 2;
+    pArray = realloc(pArray, iNewMax * iEntrySize);
+    if (pArray == NULL)
+        ErrExit(ERR_ALGORITHM, "Unable to allocate %d parallel conversion entries", iNewMax);
+    *piMax = iNewMax;
+    return pArray;
+}
+
+/******************** runTrappedPhase **************************************
+void *runTrappedPhase(void *pArg)
+Purpose:
+    Runs the phase of a thread with an error trap, keeping the first
+    error of the job.
+Parameters:
+    I   void *pArg              ParallelArg of the thread
+Returns:
+    NULL
+Notes:
+    - A thread that fails while converting a unit is no longer busy, so
+      threads waiting for more units are woken to see the error.
+**************************************************************************/
+static void *runTrappedPhase(void *pArg)
+{
+    ParallelArg *pParallelArg = (ParallelArg *) pArg;
+    ParallelJob *pJob = pParallelArg->pJob;
+    char szError[PARALLEL_ERROR_SIZE];
+    int rc;
+
+    rc = trapErrors(pParallelArg->pfnPhase, pArg, szError, sizeof(szError));
+    if (rc == 0)
+        return NULL;
+    pthread_mutex_lock(&pJob->lock);
+    if (pJob->rc == 0)
+    {
+        pJob->rc = rc;
+        strcpy(pJob->szError, szError);
+    }
+    if (pParallelArg->bBusy)
+        pJob->iBusy--;
+    pthread_cond_broadcast(&pJob->unitReady);
+    pthread_mutex_unlock(&pJob->lock);
+    return NULL;
+}
+
+/******************** runPhase **************************************
+void runPhase(ParallelJob *pJob, void (*pfnPhase)(void *))
+Purpose:
+    Runs a phase of the conversion on every thread and waits for them.
+Parameters:
+    I/O ParallelJob *pJob       the conversion
+    I   void (*pfnPhase)(void *)    phase function, passed a ParallelArg
+Returns:
+    n/a
+Notes:
+    - If a thread failed, the job is freed and its error is reported
+      with ErrExit on the calling thread.
+**************************************************************************/
+static void runPhase(ParallelJob *pJob, void (*pfnPhase)(void *))
+{
+    pthread_t *threadM = malloc(pJob->iThreads * sizeof(pthread_t));
+    ParallelArg *argM = malloc(pJob->iThreads * sizeof(ParallelArg));
+    char szError[PARALLEL_ERROR_SIZE];
+    int rc;
+    int i;
+
+    if (threadM == NULL || argM == NULL)
+        ErrExit(ERR_ALGORITHM, "Unable to allocate %d threads", pJob->iThreads);
+    for (i = 0; i < pJob->iThreads; i++)
+    {
+        argM[i].pJob = pJob;
+        argM[i].iThread = i;
+        argM[i].pfnPhase = pfnPhase;
+        argM[i].bBusy = FALSE;
+        if (pthread_create(&threadM[i], NULL, runTrappedPhase, &argM[i]) != 0)
+            ErrExit(ERR_ALGORITHM, "Unable to start a conversion thread");
+    }
+    for (i = 0; i < pJob->iThreads; i++)
+        pthread_join(threadM[i], NULL);
+    free(threadM);
+    free(argM);
+    if (pJob->rc != 0)
+    {
+        rc = pJob->rc;
+        strcpy(szError, pJob->szError);
+        freeJob(pJob);
+        ErrExit(rc, "%s", szError);
+    }
+}
+
+/******************** tokenizeChunk **************************************
+void tokenizeChunk(void *pArg)
+Purpose:
+    Tokenizes one chunk of the query and matches its parentheses.
+Parameters:
+    I   void *pArg              ParallelArg of the thread
+Returns:
+    n/a
+Notes:
+    - A right parenthesis with no left one before it in the chunk is
+      kept on iCloseM, and the left ones still open at the end on iOpenM.
+**************************************************************************/
+static void tokenizeChunk(void *pArg)
+{
+    ParallelArg *pParallelArg = (ParallelArg *) pArg;
+    TokenChunk *pChunk = &pParallelArg->pJob->chunkM[pParallelArg->iThread];
+    char *pszRemainingText = pChunk->pszStart;
+    char *pszToken;
+    int iTokenLength;
+    int iDepth = 0;
+    int i;
+    Element element;
+
+    while ((pszRemainingText = getTokenView(pszRemainingText, &pszToken, &iTokenLength)) != NULL
+        && pszToken < pChunk->pszEnd)
+    {
+        element.iSymbol = internSymbol(pszToken, iTokenLength);
+        categorize(&element);
+        if (pChunk->iCount == pChunk->iMax)
+        {
+            pChunk->elementM = growArray(pChunk->elementM, &pChunk->iMax, pChunk->iCount + 1
+                , sizeof(Element));
+            pChunk->iMatchM = realloc(pChunk->iMatchM, pChunk->iMax * sizeof(int));
+            if (pChunk->iMatchM == NULL)
+                ErrExit(ERR_ALGORITHM, "Unable to allocate %d parenthesis matches"
+                , pChunk->iMax);
+        }
+        i = pChunk->iCount++;
+        pChunk->elementM[i] = element;
+        pChunk->iMatchM[i] = -1;
+        if (element.iCategory == CAT_LPAREN)
+        {
+            pChunk->iOpenM = growArray(pChunk->iOpenM, &pChunk->iOpenMax
+                , pChunk->iOpenCount + 1, sizeof(int));
+            pChunk->iOpenM[pChunk->iOpenCount++] = i;
+            iDepth++;
+        }
+        else if (element.iCategory == CAT_RPAREN)
+        {
+            if (pChunk->iOpenCount > 0)
+            {
+                pChunk->iOpenCount--;
+                pChunk->iMatchM[i] = pChunk->iOpenM[pChunk->iOpenCount];
+                pChunk->iMatchM[pChunk->iOpenM[pChunk->iOpenCount]] = i;
+            }
+            else
+            {
+                pChunk->iCloseM = growArray(pChunk->iCloseM, &pChunk->iCloseMax
+                    , pChunk->iCloseCount + 1, sizeof(int));
+                pChunk->iCloseM[pChunk->iCloseCount++] = i;
+            }
+            iDepth--;
+            if (iDepth < pChunk->iMinDepth)
+                pChunk->iMinDepth = iDepth;
+        }
+    }
+    pChunk->iDepthSum = iDepth;
+}
+
+/******************** copyChunk **************************************
+void copyChunk(void *pArg)
+Purpose:
+    Copies the tokens and parenthesis matches of one chunk into the
+    job's arrays.
+Parameters:
+    I   void *pArg              ParallelArg of the thread
+Returns:
+    n/a
+**************************************************************************/
+static void copyChunk(void *pArg)
+{
+    ParallelArg *pParallelArg = (ParallelArg *) pArg;
+    ParallelJob *pJob = pParallelArg->pJob;
+    TokenChunk *pChunk = &pJob->chunkM[pParallelArg->iThread];
+    int iFirst = pChunk->iFirstToken;
+    int i;
+
+    if (pChunk->iCount > 0)
+        memcpy(pJob->elementM + iFirst, pChunk->elementM, pChunk->iCount * sizeof(Element));
+    for (i = 0; i < pChunk->iCount; i++)
+        pJob->iMatchM[iFirst + i] = pChunk->iMatchM[i] >= 0 ? pChunk->iMatchM[i] + iFirst : -1;
+}
+
+/******************** addUnits **************************************
+int addUnits(ParallelJob *pJob, int iStart, int iEnd, Arena arena)
+Purpose:
+    Adds the units converting a run of tokens whose parentheses are
+    balanced.
+Parameters:
+    I/O ParallelJob *pJob       the conversion
+    I   int iStart              first token of the run
+    I   int iEnd                token after the last one
+    I/O Arena arena             memory of the calling thread
+Returns:
+    The unit of the first piece of the run.
+Notes:
+    - A run longer than iUnitMin is cut before an AND or OR at the run's
+      own depth once a piece has iUnitMin tokens.  The groups inside the
+      run are skipped with iMatchM, so only the run's own tokens are
+      looked at.
+**************************************************************************/
+static int addUnits(ParallelJob *pJob, int iStart, int iEnd, Arena arena)
+{
+    ParallelUnit *pUnitM;       // the units of the pieces
+    ParallelUnit **unitM;
+    int *iCutM = NULL;          // first token of each piece after the first
+    int iCutCount = 0;
+    int iCutMax = 0;
+    int iPieceStart = iStart;
+    int iFirstUnit;
+    int iNewMax;
+    int i;
+
+    if (iEnd - iStart > pJob->iUnitMin)
+    {
+        for (i = iStart; i < iEnd; i++)
+        {
+            if (pJob->elementM[i].iCategory == CAT_LPAREN)
+                i = pJob->iMatchM[i];
+            else if (pJob->elementM[i].iCategory == CAT_OPERATOR
+                && pJob->elementM[i].iPrecedence == 1
+                && i - iPieceStart >= pJob->iUnitMin)
+            {
+                iCutM = growArray(iCutM, &iCutMax, iCutCount + 1, sizeof(int));
+                iCutM[iCutCount++] = i;
+                iPieceStart = i;
+            }
+        }
+    }
+
+    // the units are allocated before taking the lock, since an error
+    // while holding it would leave it locked (see note 4)
+    pUnitM = arenaAlloc(arena, (iCutCount + 1) * sizeof(ParallelUnit));
+    for (i = 0; i <= iCutCount; i++)
+    {
+        pUnitM[i].iStart = i == 0 ? iStart : iCutM[i - 1];
+        pUnitM[i].iEnd = i == iCutCount ? iEnd : iCutM[i];
+    }
+
+    pthread_mutex_lock(&pJob->lock);
+    if (pJob->iUnitCount + iCutCount + 1 > pJob->iUnitMax)
+    {
+        iNewMax = pJob->iUnitMax * 2 + iCutCount + 1;
+        unitM = realloc(pJob->unitM, iNewMax * sizeof(ParallelUnit *));
+        if (unitM == NULL)
+        {
+            pthread_mutex_unlock(&pJob->lock);
+            ErrExit(ERR_ALGORITHM, "Unable to allocate %d parallel conversion units", iNewMax);
+        }
+        pJob->unitM = unitM;
+        pJob->iUnitMax = iNewMax;
+    }
+    iFirstUnit = pJob->iUnitCount;
+    for (i = 0; i <= iCutCount; i++)
+    {
+        pUnitM[i].iNext = i == iCutCount ? -1 : pJob->iUnitCount + 1;
+        pJob->unitM[pJob->iUnitCount++] = &pUnitM[i];
+    }
+    pthread_cond_broadcast(&pJob->unitReady);
+    pthread_mutex_unlock(&pJob->lock);
+    free(iCutM);
+    return iFirstUnit;
+}
+
+/******************** convertUnit **************************************
+void convertUnit(ParallelJob *pJob, ParallelUnit *pUnit, Arena arena)
+Purpose:
+    Converts the tokens of a unit to postfix, as convertToPostFix would
+    convert them as a whole query.
+Parameters:
+    I/O ParallelJob *pJob       the conversion
+    I/O ParallelUnit *pUnit     unit to convert
+    I/O Arena arena             memory of the calling thread
+Returns:
+    n/a
+Notes:
+    - A group of more than iUnitMin tokens is added as units of its own
+      and a placeholder for them is added to the postfix.
+**************************************************************************/
+static void convertUnit(ParallelJob *pJob, ParallelUnit *pUnit, Arena arena)
+{
+    Out out = &pUnit->out;
+    Stack stack = newArenaStack(arena);
+    Element element;
+    Element placeholder;
+    int i;
+
+    out->arena = arena;
+    out->iOutMax = MAX_OUT_ITEM;
+    out->outM = arenaAlloc(arena, out->iOutMax * sizeof(Element));
+    out->iOutCount = 0;
+    pUnit->iPlaceholderCount = 0;
+    placeholder.iCategory = CAT_UNIT;
+    placeholder.iPrecedence = 0;
+    for (i = pUnit->iStart; i < pUnit->iEnd; i++)
+    {
+        element = pJob->elementM[i];
+        switch (element.iCategory)
+        {
+            case CAT_OPERAND:
+                addOut(out, element);
+                break;
+            case CAT_LPAREN:
+                if (pJob->iMatchM[i] - i > pJob->iUnitMin)
+                {
+                    placeholder.iSymbol = addUnits(pJob, i + 1, pJob->iMatchM[i], arena);
+                    addOut(out, placeholder);
+                    pUnit->iPlaceholderCount++;
+                    i = pJob->iMatchM[i];
+                }
+                else
+                    push(stack, element);
+                break;
+            case CAT_OPERATOR:
+                processOperator(stack, element, out);
+                break;
+            case CAT_RPAREN:
+                processRightParen(stack, out);
+                break;
+        }
+    }
+    processRemString(stack, out);
+}
+
+/******************** convertUnits **************************************
+void convertUnits(void *pArg)
+Purpose:
+    Converts units until every unit has been converted.
+Parameters:
+    I   void *pArg              ParallelArg of the thread
+Returns:
+    n/a
+Notes:
+    - A thread with no unit to convert waits while other threads may
+      still add units.
+    - The threads stop once one has failed (see note 4).
+**************************************************************************/
+static void convertUnits(void *pArg)
+{
+    ParallelArg *pParallelArg = (ParallelArg *) pArg;
+    ParallelJob *pJob = pParallelArg->pJob;
+    ParallelUnit *pUnit;
+
+    pthread_mutex_lock(&pJob->lock);
+    while (TRUE)
+    {
+        while (pJob->iNextUnit == pJob->iUnitCount && pJob->iBusy > 0 && pJob->rc == 0)
+            pthread_cond_wait(&pJob->unitReady, &pJob->lock);
+        if (pJob->iNextUnit == pJob->iUnitCount || pJob->rc != 0)
+            break;
+        pUnit = pJob->unitM[pJob->iNextUnit++];
+        pJob->iBusy++;
+        pParallelArg->bBusy = TRUE;
+        pthread_mutex_unlock(&pJob->lock);
+        convertUnit(pJob, pUnit, pJob->arenaM[pParallelArg->iThread]);
+        pthread_mutex_lock(&pJob->lock);
+        pJob->iBusy--;
+        pParallelArg->bBusy = FALSE;
+        if (pJob->iBusy == 0 && pJob->iNextUnit == pJob->iUnitCount)
+            pthread_cond_broadcast(&pJob->unitReady);
+    }
+    pthread_mutex_unlock(&pJob->lock);
+}
+
+/******************** stitchUnits **************************************
+void stitchUnits(ParallelJob *pJob, Out out)
+Purpose:
+    Adds the postfix of every unit to out in query order.
+Parameters:
+    I   ParallelJob *pJob       the converted query
+    I/O Out out                 receives the postfix
+Returns:
+    n/a
+Notes:
+    - Unit 0 is the first piece of the whole query.  A placeholder is
+      replaced by the postfix of the pieces of its group.  The units
+      being stitched are kept on iUnitM and iPosM instead of the C stack,
+      since groups may nest very deeply.
+    - outM is made big enough for the whole postfix first, so each run
+      of a unit's postfix between placeholders is copied with memcpy.
+**************************************************************************/
+static void stitchUnits(ParallelJob *pJob, Out out)
+{
+    int *iUnitM = NULL;         // unit being stitched at each nesting level
+    int *iPosM = NULL;          // next postfix entry of that unit
+    int iMax = 0;
+    int iPosMax = 0;
+    int iTop = 0;
+    int iTotal = out->iOutCount;
+    int iRunEnd;
+    int i;
+    ParallelUnit *pUnit;
+    Element *newOutM;
+    Element element;
+
+    for (i = 0; i < pJob->iUnitCount; i++)
+        iTotal += pJob->unitM[i]->out.iOutCount - pJob->unitM[i]->iPlaceholderCount;
+    if (iTotal > out->iOutMax)
+    {
+        newOutM = arenaAlloc(out->arena, iTotal * sizeof(Element));
+        memcpy(newOutM, out->outM, out->iOutCount * sizeof(Element));
+        out->outM = newOutM;
+        out->iOutMax = iTotal;
+    }
+
+    iUnitM = growArray(iUnitM, &iMax, 1, sizeof(int));
+    iPosM = growArray(iPosM, &iPosMax, 1, sizeof(int));
+    iUnitM[0] = 0;
+    iPosM[0] = 0;
+    while (iTop >= 0)
+    {
+        pUnit = pJob->unitM[iUnitM[iTop]];
+        if (iPosM[iTop] == pUnit->out.iOutCount)
+        {
+            // go on with the next piece of the run, if any
+            if (pUnit->iNext >= 0)
+            {
+                iUnitM[iTop] = pUnit->iNext;
+                iPosM[iTop] = 0;
+            }
+            else
+                iTop--;
+            continue;
+        }
+        // copy up to the next placeholder
+        iRunEnd = iPosM[iTop];
+        while (iRunEnd < pUnit->out.iOutCount
+            && pUnit->out.outM[iRunEnd].iCategory != CAT_UNIT)
+            iRunEnd++;
+        memcpy(out->outM + out->iOutCount, pUnit->out.outM + iPosM[iTop]
+            , (iRunEnd - iPosM[iTop]) * sizeof(Element));
+        out->iOutCount += iRunEnd - iPosM[iTop];
+        iPosM[iTop] = iRunEnd;
+        if (iRunEnd == pUnit->out.iOutCount)
+            continue;
+        element = pUnit->out.outM[iPosM[iTop]++];
+        iTop++;
+        iUnitM = growArray(iUnitM, &iMax, iTop + 1, sizeof(int));
+        iPosM = growArray(iPosM, &iPosMax, iTop + 1, sizeof(int));
+        iUnitM[iTop] = element.iSymbol;
+        iPosM[iTop] = 0;
+    }
+    free(iUnitM);
+    free(iPosM);
+}
+
+/******************** checkDepth **************************************
+int checkDepth(ParallelJob *pJob)
+Purpose:
+    Finds the depth at the start of each chunk and checks that the
+    parentheses are balanced.
+Parameters:
+    I/O ParallelJob *pJob       the tokenized query
+Returns:
+    0   - the parentheses are balanced
+    801 - WARN_MISSING_RPAREN
+    802 - WARN_MISSING_LPAREN
+Notes:
+    - Also sets iFirstToken of each chunk and iTokenCount.
+**************************************************************************/
+static int checkDepth(ParallelJob *pJob)
+{
+    TokenChunk *pChunk;
+    int iDepth = 0;             // depth at the start of the chunk
+    int bMissingLeft = FALSE;
+    int i;
+
+    pJob->iTokenCount = 0;
+    for (i = 0; i < pJob->iThreads; i++)
+    {
+        pChunk = &pJob->chunkM[i];
+        pChunk->iFirstToken = pJob->iTokenCount;
+        pJob->iTokenCount += pChunk->iCount;
+        if (iDepth + pChunk->iMinDepth < 0)
+            bMissingLeft = TRUE;
+        iDepth += pChunk->iDepthSum;
+    }
+    if (bMissingLeft)
+        return WARN_MISSING_LPAREN;
+    if (iDepth != 0)
+        return WARN_MISSING_RPAREN;
+    return 0;
+}
+
+/******************** matchAcrossChunks **************************************
+void matchAcrossChunks(ParallelJob *pJob)
+Purpose:
+    Matches the parentheses left unmatched in their chunks.
+Parameters:
+    I/O ParallelJob *pJob       the tokenized query, with balanced
+                                parentheses
+Returns:
+    n/a
+Notes:
+    - A right parenthesis left in a chunk matches the last left one
+      still open from the chunks before it.
+**************************************************************************/
+static void matchAcrossChunks(ParallelJob *pJob)
+{
+    TokenChunk *pChunk;
+    int *iOpenM = NULL;         // left parentheses open before the chunk
+    int iOpenCount = 0;
+    int iOpenMax = 0;
+    int iOpen;
+    int iClose;
+    int i;
+    int j;
+
+    for (i = 0; i < pJob->iThreads; i++)
+    {
+        pChunk = &pJob->chunkM[i];
+        for (j = 0; j < pChunk->iCloseCount; j++)
+        {
+            iClose = pChunk->iCloseM[j] + pChunk->iFirstToken;
+            iOpen = iOpenM[--iOpenCount];
+            pJob->iMatchM[iClose] = iOpen;
+            pJob->iMatchM[iOpen] = iClose;
+        }
+        iOpenM = growArray(iOpenM, &iOpenMax, iOpenCount + pChunk->iOpenCount, sizeof(int));
+        for (j = 0; j < pChunk->iOpenCount; j++)
+            iOpenM[iOpenCount++] = pChunk->iOpenM[j] + pChunk->iFirstToken;
+    }
+    free(iOpenM);
+}
+
+/******************** freeJob **************************************
+void freeJob(ParallelJob *pJob)
+Purpose:
+    Frees the memory of a conversion.
+Parameters:
+    I/O ParallelJob *pJob       the conversion
+Returns:
+    n/a
+**************************************************************************/
+static void freeJob(ParallelJob *pJob)
+{
+    int i;
+
+    for (i = 0; i < pJob->iThreads; i++)
+    {
+        free(pJob->chunkM[i].elementM);
+        free(pJob->chunkM[i].iMatchM);
+        free(pJob->chunkM[i].iOpenM);
+        free(pJob->chunkM[i].iCloseM);
+    }
+    for (i = 0; i <= pJob->iThreads; i++)
+        freeArena(pJob->arenaM[i]);
+    free(pJob->chunkM);
+    free(pJob->arenaM);
+    free(pJob->elementM);
+    free(pJob->iMatchM);
+    free(pJob->unitM);
+    pthread_mutex_destroy(&pJob->lock);
+    pthread_cond_destroy(&pJob->unitReady);
+}
+
+/******************** convertToPostFixParallel **************************************
+int convertToPostFixParallel(char *pszInfix, Out out, int iThreads)
+Purpose:
+    Converts a query to postfix, as convertToPostFix does, on several
+    threads.
+Parameters:
+    I   char *pszInfix          zero terminated query text
+    O   Out out                 receives the postfix.  It must be created
+                                by newOut.
+    I   int iThreads            threads to use
+Returns:
+    0   - conversion to postfix was successful
+    801 - WARN_MISSING_RPAREN
+    802 - WARN_MISSING_LPAREN
+Notes:
+    - A query shorter than PARALLEL_MIN_TEXT, or with one thread, is
+      converted by convertToPostFix.
+**************************************************************************/
+int convertToPostFixParallel(char *pszInfix, Out out, int iThreads)
+{
+    ParallelJob job;
+    char *pszEnd;
+    int iLength = (int) strlen(pszInfix);
+    int rc;
+    int i;
+
+    if (iThreads <= 1 || iLength < PARALLEL_MIN_TEXT)
+        return convertToPostFix(pszInfix, out);
+
+    memset(&job, 0, sizeof(job));
+    job.iThreads = iThreads;
+    job.chunkM = calloc(iThreads, sizeof(TokenChunk));
+    job.arenaM = malloc((iThreads + 1) * sizeof(Arena));
+    if (job.chunkM == NULL || job.arenaM == NULL)
+        ErrExit(ERR_ALGORITHM, "Unable to allocate %d conversion threads", iThreads);
+    for (i = 0; i <= iThreads; i++)
+        job.arenaM[i] = newArena(ARENA_BLOCK_SIZE * 4);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.unitReady, NULL);
+
+    // cut the text into chunks at white space
+    for (i = 0; i < iThreads; i++)
+    {
+        job.chunkM[i].pszStart = i == 0 ? pszInfix : job.chunkM[i - 1].pszEnd;
+        pszEnd = pszInfix + (long) iLength * (i + 1) / iThreads;
+        if (pszEnd < job.chunkM[i].pszStart)
+            pszEnd = job.chunkM[i].pszStart;
+        while ((unsigned char) *pszEnd > ' ')
+            pszEnd++;
+        job.chunkM[i].pszEnd = pszEnd;
+    }
+    runPhase(&job, tokenizeChunk);
+
+    rc = checkDepth(&job);
+    if (rc != 0)
+    {
+        freeJob(&job);
+        return convertToPostFix(pszInfix, out);
+    }
+    job.elementM = malloc((job.iTokenCount + 1) * sizeof(Element));
+    job.iMatchM = malloc((job.iTokenCount + 1) * sizeof(int));
+    if (job.elementM == NULL || job.iMatchM == NULL)
+        ErrExit(ERR_ALGORITHM, "Unable to allocate %d tokens", job.iTokenCount);
+    runPhase(&job, copyChunk);
+    matchAcrossChunks(&job);
+
+    job.iUnitMin = job.iTokenCount / (iThreads * PARALLEL_UNITS_PER_THREAD);
+    if (job.iUnitMin < PARALLEL_MIN_UNIT)
+        job.iUnitMin = PARALLEL_MIN_UNIT;
+    addUnits(&job, 0, job.iTokenCount, job.arenaM[iThreads]);
+    runPhase(&job, convertUnits);
+    stitchUnits(&job, out);
+    freeJob(&job);
+    return 0;
+}
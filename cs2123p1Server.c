@@ -0,0 +1,655 @@
+/******************************************************************************
+cs2123p1Server.c by Larry Clark
+Purpose:
+    A long-running query conversion server.  Clients connect to a Unix
+    domain socket and send queries; the server converts each one to
+    postfix with tryConvertToPostFix and sends back the result, so a
+    client does not start a new driver for every batch of queries.
+    The same program is also a client for the server and a latency
+    benchmark comparing the server with running the driver per request.
+Command Parameters:
+    p1server socketPath
+    p1server -q socketPath
+    p1server -l requests [-d driver] socketPath
+        socketPath  - path of the server's Unix domain socket.  The server
+                      removes an old socket at that path before binding.
+        -q          - client: send the queries on stdin to the server and
+                      print its replies
+        -l requests - latency benchmark: send the queries on stdin as one
+                      request this many times to a running server, and
+                      run the driver on them this many times
+        -d driver   - driver program run by -l (default ./p1).  It is run
+                      as "driver -f postfix" with the queries on stdin.
+Input:
+    A client sends query lines, each ending with a newline.  It may send
+    any number of queries before reading the replies (pipelining), and
+    may send more queries after reading them.
+Results:
+    The server sends one line for each query line, in the same order:
+        return code<TAB>postfix
+    The postfix is the tokens separated by one space, empty if the
+    return code is not 0.  For an error (an ERR_ constant) the ErrExit
+    message follows the tab instead, for example
+        905<TAB>More than 67108864 symbols
+    A query line longer than SERVER_MAX_LINE bytes is answered with
+        912<TAB>Query line longer than 16777216 bytes
+    and the server closes that connection, as it does when it is unable
+    to allocate a connection's buffer.
+    The latency benchmark prints a tab separated table in microseconds
+    per request after a comment line with the parameters:
+        # cs2123p1Server requests=1000 queries=6 bytes=239
+        benchmark<TAB>mean_us<TAB>p50_us<TAB>p99_us
+        server<TAB>...
+        spawn<TAB>...
+Returns:
+    0 - normal
+    906 - ERR_INPUT; an invalid parameter or driver output
+    909 - ERR_SOCKET; unable to create, bind or connect to the socket
+Notes:
+    1. Each connection is served by its own thread, which keeps one Out
+       for all of its queries.  A query that fails with an error is
+       answered with that error and the connection goes on; only the
+       symbol table is shared by the connections.
+    2. Every new operand adds a symbol to the shared symbol table, so
+       when it has more than SERVER_MAX_SYMBOLS symbols the server clears
+       it (clearSymbols) between batches.  A connection converts and
+       answers the lines of one read as a batch, holding symbolScopeLock
+       for reading; the table is cleared holding it for writing, when no
+       batch holds a symbol id.
+    3. Replies are buffered and written each time the server has no more
+       complete query lines to convert.
+    4. The client writes and reads with poll, so a batch larger than the
+       socket buffers cannot deadlock with the server's replies.
+    5. Compile with:
+           gcc -O2 -pthread -o p1server cs2123p1Server.c cs2123p1Lib.c cs2123p1.c
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "cs2123p1.h"
+
+#define ERR_SOCKET 909              // unable to use the server socket
+#define ERR_QUERY_LINE 912          // a query line longer than SERVER_MAX_LINE
+#define SERVER_READ_SIZE 65536      // bytes read from a socket at a time
+#define MAX_ERROR_TEXT 200          // longest error message sent to a client
+#define SERVER_MAX_LINE 16777216    // longest query line a client may send
+#define SERVER_MAX_SYMBOLS 1048576  // symbols kept before the table is cleared
+
+// symbolScopeLock is held for reading while a connection converts a
+// batch of lines and formats their replies, and for writing while the
+// symbol table is cleared
+static pthread_rwlock_t symbolScopeLock;
+
+/******************** openSocket **************************************
+int openSocket(char *pszPath, struct sockaddr_un *pAddress)
+Purpose:
+    Creates a Unix domain stream socket and the address of a path.
+Parameters:
+    I   char *pszPath               path of the socket
+    O   struct sockaddr_un *pAddress    address of the path
+Returns:
+    The socket file descriptor.
+**************************************************************************/
+static int openSocket(char *pszPath, struct sockaddr_un *pAddress)
+{
+    int iSocket;
+
+    if (strlen(pszPath) >= sizeof(pAddress->sun_path))
+        ErrExit(ERR_SOCKET, "Socket path %s is too long", pszPath);
+    memset(pAddress, 0, sizeof(struct sockaddr_un));
+    pAddress->sun_family = AF_UNIX;
+    strcpy(pAddress->sun_path, pszPath);
+    iSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (iSocket < 0)
+        ErrExit(ERR_SOCKET, "Unable to create a socket: %s", strerror(errno));
+    return iSocket;
+}
+
+/******************** formatReply **************************************
+void formatReply(OutputBuffer output, Out out, int rc, char *pszError)
+Purpose:
+    Formats the reply line for one query.
+Parameters:
+    O   OutputBuffer output     where the reply is formatted
+    I   Out out                 postfix of the query
+    I   int rc                  return code of tryConvertToPostFix
+    I   char *pszError          error message when rc is an ERR_ constant
+Returns:
+    n/a
+**************************************************************************/
+static void formatReply(OutputBuffer output, Out out, int rc, char *pszError)
+{
+    outputInt(output, rc);
+    outputText(output, "\t", 1);
+    if (rc == 0)
+        formatOut(output, out, FORMAT_POSTFIX);
+    else if (rc != WARN_MISSING_LPAREN && rc != WARN_MISSING_RPAREN)
+        outputString(output, pszError);
+    outputText(output, "\n", 1);
+}
+
+/******************** clearSymbolScope **************************************
+void clearSymbolScope()
+Purpose:
+    Clears the symbol table once no connection is converting a batch.
+Parameters:
+    n/a
+Returns:
+    n/a
+Notes:
+    - Several connections may find the table full at once; only the
+      first clears it.
+**************************************************************************/
+static void clearSymbolScope()
+{
+    pthread_rwlock_wrlock(&symbolScopeLock);
+    if (getSymbolCount() > SERVER_MAX_SYMBOLS)
+        clearSymbols();
+    pthread_rwlock_unlock(&symbolScopeLock);
+}
+
+/******************** serveConnection **************************************
+void *serveConnection(void *pArg)
+Purpose:
+    Converts the queries sent on one connection until the client closes
+    it.
+Parameters:
+    I   void *pArg              the connection's file descriptor, cast
+                                to a pointer
+Returns:
+    NULL
+Notes:
+    - The lines are converted in place in the read buffer.  A partial
+      line is moved to the front for the next read, and the buffer grows
+      when one line fills it, up to SERVER_MAX_LINE bytes.
+    - A last line with no newline is converted when the client closes
+      its side of the connection.
+    - A connection that cannot be served (a line that is too long, or
+      no memory for its buffer) is sent an error line and closed.  The
+      server and its other connections go on.
+**************************************************************************/
+static void *serveConnection(void *pArg)
+{
+    int iSocket = (int) (long) pArg;
+    FILE *pReplyFile = fdopen(dup(iSocket), "w");
+    OutputBuffer output;
+    Out out = newOut();
+    char szError[MAX_ERROR_TEXT];
+    char *pszBuffer;
+    char *pszGrown;
+    char *pszNewline;
+    int iBufferSize = SERVER_READ_SIZE + 1;
+    int iStart;                 // start of the next line
+    int iEnd = 0;               // end of the bytes read
+    int iRead;
+    int bEof = FALSE;
+    int rc;
+
+    pszBuffer = malloc(iBufferSize);
+    if (pReplyFile == NULL || pszBuffer == NULL)
+    {
+        if (pReplyFile != NULL)
+            fclose(pReplyFile);
+        close(iSocket);
+        free(pszBuffer);
+        freeOut(out);
+        return NULL;
+    }
+    output = newOutputBuffer(pReplyFile);
+    while (!bEof)
+    {
+        if (iEnd >= SERVER_MAX_LINE)
+        {
+            sprintf(szError, "Query line longer than %d bytes", SERVER_MAX_LINE);
+            formatReply(output, out, ERR_QUERY_LINE, szError);
+            flushOutput(output);
+            break;
+        }
+        if (iBufferSize - 1 - iEnd < SERVER_READ_SIZE / 2)
+        {
+            pszGrown = realloc(pszBuffer, iBufferSize * 2 - 1);
+            if (pszGrown == NULL)
+            {
+                sprintf(szError, "Unable to grow a connection buffer to %d bytes"
+                    , iBufferSize * 2 - 1);
+                formatReply(output, out, ERR_SOCKET, szError);
+                flushOutput(output);
+                break;
+            }
+            pszBuffer = pszGrown;
+            iBufferSize = iBufferSize * 2 - 1;
+        }
+        iRead = (int) read(iSocket, pszBuffer + iEnd, iBufferSize - 1 - iEnd);
+        if (iRead < 0 && errno == EINTR)
+            continue;
+        if (iRead <= 0)
+        {
+            bEof = TRUE;
+            if (iEnd > 0)
+                pszBuffer[iEnd++] = '\n';   // the last line had no newline
+        }
+        else
+            iEnd += iRead;
+
+        // convert every complete line, as one batch of symbol use
+        iStart = 0;
+        pthread_rwlock_rdlock(&symbolScopeLock);
+        while ((pszNewline = memchr(pszBuffer + iStart, '\n', iEnd - iStart)) != NULL)
+        {
+            *pszNewline = '\0';
+            rc = tryConvertToPostFix(pszBuffer + iStart, out, szError, sizeof(szError));
+            formatReply(output, out, rc, szError);
+            iStart = (int) (pszNewline - pszBuffer) + 1;
+        }
+        resetOut(out);
+        pthread_rwlock_unlock(&symbolScopeLock);
+        if (getSymbolCount() > SERVER_MAX_SYMBOLS)
+            clearSymbolScope();
+        memmove(pszBuffer, pszBuffer + iStart, iEnd - iStart);
+        iEnd -= iStart;
+        flushOutput(output);
+        if (ferror(pReplyFile))
+            break;              // the client went away
+    }
+    freeOutputBuffer(output);
+    fclose(pReplyFile);
+    close(iSocket);
+    free(pszBuffer);
+    freeOut(out);
+    return NULL;
+}
+
+/******************** runServer **************************************
+void runServer(char *pszPath)
+Purpose:
+    Accepts connections on a socket forever, starting a thread for each.
+Parameters:
+    I   char *pszPath           path of the socket
+Returns:
+    n/a
+**************************************************************************/
+static void runServer(char *pszPath)
+{
+    struct sockaddr_un address;
+    int iListen = openSocket(pszPath, &address);
+    int iSocket;
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_rwlockattr_t lockAttr;
+
+    // a client closing early must not end the server
+    signal(SIGPIPE, SIG_IGN);
+    unlink(pszPath);
+    if (bind(iListen, (struct sockaddr *) &address, sizeof(address)) != 0
+        || listen(iListen, SOMAXCONN) != 0)
+        ErrExit(ERR_SOCKET, "Unable to listen on %s: %s", pszPath, strerror(errno));
+    // a clear must not wait for every connection to go idle at once
+    pthread_rwlockattr_init(&lockAttr);
+#ifdef __GLIBC__
+    pthread_rwlockattr_setkind_np(&lockAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&symbolScopeLock, &lockAttr);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    while (TRUE)
+    {
+        iSocket = accept(iListen, NULL, NULL);
+        if (iSocket < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            ErrExit(ERR_SOCKET, "Unable to accept a connection: %s", strerror(errno));
+        }
+        if (pthread_create(&thread, &attr, serveConnection, (void *) (long) iSocket) != 0)
+            ErrExit(ERR_SOCKET, "Unable to start a connection thread");
+    }
+}
+
+/******************** connectServer **************************************
+int connectServer(char *pszPath)
+Purpose:
+    Connects to a running server.
+Parameters:
+    I   char *pszPath           path of the server's socket
+Returns:
+    The connection's file descriptor.
+Notes:
+    - The connection does not block; exchange waits for it with poll.
+**************************************************************************/
+static int connectServer(char *pszPath)
+{
+    struct sockaddr_un address;
+    int iSocket = openSocket(pszPath, &address);
+
+    if (connect(iSocket, (struct sockaddr *) &address, sizeof(address)) != 0)
+        ErrExit(ERR_SOCKET, "Unable to connect to %s: %s", pszPath, strerror(errno));
+    fcntl(iSocket, F_SETFL, fcntl(iSocket, F_GETFL) | O_NONBLOCK);
+    return iSocket;
+}
+
+/******************** exchange **************************************
+void exchange(int iSocket, char *pszBatch, int iLength, int iLines
+    , OutputBuffer output)
+Purpose:
+    Sends a batch of query lines to the server and receives a reply line
+    for each.
+Parameters:
+    I   int iSocket             connection to the server
+    I   char *pszBatch          query lines, the last ending with a newline
+    I   int iLength             bytes in pszBatch
+    I   int iLines              query lines in pszBatch
+    O   OutputBuffer output     receives the replies (NULL to ignore them)
+Returns:
+    n/a
+Notes:
+    - Sending and receiving are interleaved with poll, since the server
+      replies while the rest of the batch is still being sent.
+**************************************************************************/
+static void exchange(int iSocket, char *pszBatch, int iLength, int iLines
+    , OutputBuffer output)
+{
+    char szReply[SERVER_READ_SIZE];
+    struct pollfd pollFd;
+    int iSent = 0;
+    int iReplies = 0;
+    int iCount;
+    char *p;
+
+    pollFd.fd = iSocket;
+    while (iReplies < iLines)
+    {
+        pollFd.events = iSent < iLength ? POLLIN | POLLOUT : POLLIN;
+        if (poll(&pollFd, 1, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ErrExit(ERR_SOCKET, "Unable to poll the server: %s", strerror(errno));
+        }
+        if (pollFd.revents & POLLOUT)
+        {
+            iCount = (int) write(iSocket, pszBatch + iSent, iLength - iSent);
+            if (iCount < 0 && errno != EINTR && errno != EAGAIN)
+                ErrExit(ERR_SOCKET, "Unable to send to the server: %s", strerror(errno));
+            iSent += iCount > 0 ? iCount : 0;
+        }
+        if (pollFd.revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            iCount = (int) read(iSocket, szReply, sizeof(szReply));
+            if (iCount < 0 && (errno == EINTR || errno == EAGAIN))
+                continue;
+            if (iCount <= 0)
+                ErrExit(ERR_SOCKET, "The server closed the connection after %d of %d replies"
+                , iReplies, iLines);
+            for (p = szReply; (p = memchr(p, '\n', szReply + iCount - p)) != NULL; p++)
+                iReplies++;
+            if (output != NULL)
+                outputText(output, szReply, iCount);
+        }
+    }
+}
+
+/******************** readBatch **************************************
+char *readBatch(FILE *pFile, int *piLength, int *piLines)
+Purpose:
+    Reads a whole file of query lines.
+Parameters:
+    I   FILE *pFile             file opened for reading
+    O   int *piLength           bytes returned
+    O   int *piLines            lines returned
+Returns:
+    The lines, with a newline added after a last line that had none.
+**************************************************************************/
+static char *readBatch(FILE *pFile, int *piLength, int *piLines)
+{
+    LineReader reader = newLineReader(pFile);
+    OutputBuffer batch = newOutputBuffer(NULL);
+    char *pszLine;
+    int iLineLength;
+    int bNewline;
+
+    *piLines = 0;
+    while ((pszLine = readLine(reader, &iLineLength, &bNewline)) != NULL)
+    {
+        outputText(batch, pszLine, iLineLength);
+        outputText(batch, "\n", 1);
+        (*piLines)++;
+    }
+    freeLineReader(reader);
+    *piLength = batch->iLength;
+    pszLine = batch->pszBuffer;
+    free(batch);
+    return pszLine;
+}
+
+/******************** runClient **************************************
+void runClient(char *pszPath)
+Purpose:
+    Sends the queries on stdin to the server and prints the replies.
+Parameters:
+    I   char *pszPath           path of the server's socket
+Returns:
+    n/a
+**************************************************************************/
+static void runClient(char *pszPath)
+{
+    OutputBuffer output = newOutputBuffer(stdout);
+    int iSocket = connectServer(pszPath);
+    int iLength;
+    int iLines;
+    char *pszBatch = readBatch(stdin, &iLength, &iLines);
+
+    exchange(iSocket, pszBatch, iLength, iLines, output);
+    flushOutput(output);
+    freeOutputBuffer(output);
+    close(iSocket);
+    free(pszBatch);
+}
+
+/******************** spawnDriver **************************************
+void spawnDriver(char *pszDriver, int iInput, int iLines)
+Purpose:
+    Runs the driver on a batch of queries and reads all of its output.
+Parameters:
+    I   char *pszDriver         path of the driver program
+    I   int iInput              file descriptor of a file holding the batch
+    I   int iLines              query lines in the batch
+Returns:
+    n/a
+Notes:
+    - Exits with ERR_INPUT if the driver does not print one line per
+      query or fails.
+**************************************************************************/
+static void spawnDriver(char *pszDriver, int iInput, int iLines)
+{
+    char szOutput[SERVER_READ_SIZE];
+    int iPipeM[2];
+    int iReplies = 0;
+    int iCount;
+    int iStatus;
+    pid_t pid;
+    char *p;
+
+    if (pipe(iPipeM) != 0)
+        ErrExit(ERR_INPUT, "Unable to create a pipe: %s", strerror(errno));
+    lseek(iInput, 0, SEEK_SET);
+    pid = fork();
+    if (pid < 0)
+        ErrExit(ERR_INPUT, "Unable to start %s: %s", pszDriver, strerror(errno));
+    if (pid == 0)
+    {
+        dup2(iInput, 0);
+        dup2(iPipeM[1], 1);
+        close(iPipeM[0]);
+        close(iPipeM[1]);
+        execl(pszDriver, pszDriver, "-f", "postfix", (char *) NULL);
+        _exit(127);
+    }
+    close(iPipeM[1]);
+    while ((iCount = (int) read(iPipeM[0], szOutput, sizeof(szOutput))) != 0)
+    {
+        if (iCount < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (p = szOutput; (p = memchr(p, '\n', szOutput + iCount - p)) != NULL; p++)
+            iReplies++;
+    }
+    close(iPipeM[0]);
+    waitpid(pid, &iStatus, 0);
+    if (!WIFEXITED(iStatus) || WEXITSTATUS(iStatus) != 0 || iReplies != iLines)
+        ErrExit(ERR_INPUT, "%s printed %d lines for %d queries", pszDriver
+        , iReplies, iLines);
+}
+
+/******************** compareDouble **************************************
+int compareDouble(const void *pLeft, const void *pRight)
+Purpose:
+    qsort comparison of two doubles in ascending order.
+**************************************************************************/
+static int compareDouble(const void *pLeft, const void *pRight)
+{
+    double dLeft = *(const double *) pLeft;
+    double dRight = *(const double *) pRight;
+    return dLeft < dRight ? -1 : dLeft > dRight;
+}
+
+/******************** printLatency **************************************
+void printLatency(char *pszName, double dUsM[], int iRequests)
+Purpose:
+    Prints the mean, median and 99th percentile of request times.
+Parameters:
+    I   char *pszName           benchmark name
+    I/O double dUsM[]           microseconds of each request (sorted)
+    I   int iRequests           entries in dUsM
+Returns:
+    n/a
+**************************************************************************/
+static void printLatency(char *pszName, double dUsM[], int iRequests)
+{
+    double dTotal = 0;
+    int i;
+
+    qsort(dUsM, iRequests, sizeof(double), compareDouble);
+    for (i = 0; i < iRequests; i++)
+        dTotal += dUsM[i];
+    printf("%s\t%.1f\t%.1f\t%.1f\n", pszName, dTotal / iRequests
+        , dUsM[iRequests / 2], dUsM[(int) (iRequests * 0.99)]);
+}
+
+/******************** elapsedUs **************************************
+double elapsedUs(struct timespec *pStart)
+Purpose:
+    Returns the microseconds since pStart.
+**************************************************************************/
+static double elapsedUs(struct timespec *pStart)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - pStart->tv_sec) * 1e6 + (end.tv_nsec - pStart->tv_nsec) / 1e3;
+}
+
+/******************** runLatency **************************************
+void runLatency(char *pszPath, char *pszDriver, int iRequests)
+Purpose:
+    Times sending the queries on stdin to the server, and running the
+    driver on them, iRequests times each.
+Parameters:
+    I   char *pszPath           path of the server's socket
+    I   char *pszDriver         path of the driver program
+    I   int iRequests           requests timed for each
+Returns:
+    n/a
+Notes:
+    - All of the server requests use one connection, as an interactive
+      tool would.
+**************************************************************************/
+static void runLatency(char *pszPath, char *pszDriver, int iRequests)
+{
+    FILE *pBatchFile = tmpfile();
+    double *dUsM = malloc(iRequests * sizeof(double));
+    struct timespec start;
+    int iSocket;
+    int iLength;
+    int iLines;
+    char *pszBatch = readBatch(stdin, &iLength, &iLines);
+    int i;
+
+    if (pBatchFile == NULL || dUsM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate the latency benchmark");
+    if (iLines == 0)
+        ErrExit(ERR_INPUT, "No queries on stdin");
+    fwrite(pszBatch, 1, iLength, pBatchFile);
+    fflush(pBatchFile);
+
+    printf("# cs2123p1Server requests=%d queries=%d bytes=%d\n", iRequests, iLines, iLength);
+    printf("%s\t%s\t%s\t%s\n", "benchmark", "mean_us", "p50_us", "p99_us");
+    iSocket = connectServer(pszPath);
+    for (i = 0; i < iRequests; i++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        exchange(iSocket, pszBatch, iLength, iLines, NULL);
+        dUsM[i] = elapsedUs(&start);
+    }
+    close(iSocket);
+    printLatency("server", dUsM, iRequests);
+    for (i = 0; i < iRequests; i++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        spawnDriver(pszDriver, fileno(pBatchFile), iLines);
+        dUsM[i] = elapsedUs(&start);
+    }
+    printLatency("spawn", dUsM, iRequests);
+    fclose(pBatchFile);
+    free(pszBatch);
+    free(dUsM);
+}
+
+// Main program for the server
+
+int main(int argc, char *argv[])
+{
+    char *pszDriver = "./p1";
+    int iRequests = 0;          // -l requests, 0 for none
+    int bClient = FALSE;
+    int i;
+
+    // process the command line options
+    for (i = 1; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i], "-q") == 0)
+            bClient = TRUE;
+        else if (strcmp(argv[i], "-l") == 0 && i + 2 < argc)
+        {
+            iRequests = atoi(argv[++i]);
+            if (iRequests < 1)
+                ErrExit(ERR_INPUT, "Parameter %s must be at least 1", argv[i]);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 2 < argc)
+            pszDriver = argv[++i];
+        else
+            ErrExit(ERR_INPUT, "Unknown parameter %s", argv[i]);
+    }
+    if (argc < 2 || argv[argc - 1][0] == '-')
+        ErrExit(ERR_INPUT, "Usage: p1server [-q | -l requests [-d driver]] socketPath");
+
+    signal(SIGPIPE, SIG_IGN);
+    if (iRequests > 0)
+        runLatency(argv[argc - 1], pszDriver, iRequests);
+    else if (bClient)
+        runClient(argv[argc - 1]);
+    else
+        runServer(argv[argc - 1]);
+    return 0;
+}
@@ -0,0 +1,853 @@
+/******************************************************************************
+cs2123p1Shard.c by Larry Clark
+Purpose:
+    Evaluates queries against a customer file split across several shard
+    processes on one machine.  No process holds the whole customer set:
+    the coordinator sends each customer to the shard its number hashes
+    to, converts each query once, sends the compiled query to every
+    shard and merges the shards' results.
+Command Parameters:
+    p1shard [-n shards] [-i] customerFile
+    p1shard -b maxShards customerFile
+        -n shards    - number of shard processes (default 4)
+        -i           - also print the numbers of the matching customers
+        -b maxShards - scaling benchmark: run the queries on stdin with
+                       1, 2, 4, ... shards up to maxShards
+        customerFile - customer trait dataset (see cs2123p1Eval.c)
+Input:
+    The standard input file stream contains queries (one per input text
+    line), as for the driver.
+Results:
+    One tab separated line per query, the same as the driver's
+    "p1 -f postfix customerFile" output:
+        query number, return code, postfix, matching customers
+    The matching customers are -1 if the query is not a valid boolean
+    expression.  With -i another tab and the matching customer numbers
+    (1 is the first customer in customerFile) follow, in ascending order
+    and separated by spaces.
+    The number of queries decided without evaluating is written to
+    stderr.
+    The scaling benchmark prints a tab separated table after a comment
+    line with the parameters:
+        # cs2123p1Shard customers=200000 queries=10000
+        shards<TAB>load_ms<TAB>query_ms<TAB>queries_per_sec<TAB>largest_shard
+        1<TAB>...
+Returns:
+    0 - normal
+    904 - ERR_CUSTOMER_DATA; the customer file cannot be read
+    906 - ERR_INPUT; an invalid parameter
+    910 - ERR_SHARD; unable to start a shard, or a shard failed
+Notes:
+    1. Customer c (0 is the first) belongs to shard
+       hashShard(c) mod shards.  A shard numbers its own customers in the
+       order it receives them and recomputes their customer numbers from
+       the same hash.  Lines that are empty or all white space are
+       skipped as loadCustomers skips them, so the numbers agree with the
+       driver's.
+    2. Each shard is a forked process with three pipes: customer lines
+       (closed once they are all sent), requests and replies.  A request
+       is the query compiled without customer data, whose trait and value
+       ids are symbol ids.  It is sent as
+           header: instruction count, TRUE for customer numbers, text bytes
+           instructions: Instr with iTrait and iValue replaced by offsets
+               into the text (-1 for AND and OR)
+           text: each trait and value named by the query, once, zero
+               terminated
+       A reply is the match count, the number of customer numbers that
+       follow, and TRUE if the shard decided the query without
+       evaluating it.
+    3. Queries are short-circuited twice.  The coordinator runs
+       simplifyQuery without customer data, which decides queries such as
+       T ONLY A AND T ONLY B for every shard and sends nothing.  Each
+       shard runs simplifyQuery against its own customers, so a query on
+       a value the shard does not have, or a contradiction on a trait
+       that is single-valued in the shard, is answered without
+       evaluating.
+    4. A request is sent to every shard before any reply is read, so the
+       shards evaluate a query at the same time.
+    5. Compile with:
+           gcc -O2 -o p1shard cs2123p1Shard.c cs2123p1Lib.c cs2123p1.c \
+               cs2123p1Eval.c cs2123p1Index.c cs2123p1Optimize.c cs2123p1Simplify.c
+*******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+
+#define ERR_SHARD 910               // unable to start a shard, or a shard failed
+#define MAX_SHARDS 64               // most shard processes
+
+// Shard typedef is one shard process and the pipes to it
+typedef struct
+{
+    pid_t pid;
+    FILE *pDataFile;            // customer lines sent to the shard (NULL once sent)
+    int iRequestFd;             // requests sent to the shard
+    int iReplyFd;               // replies from the shard
+    int iCustomerCount;         // customers the shard holds
+} Shard;
+
+// ShardSetImp typedef holds the shard processes and the coordinator's
+// work areas
+typedef struct
+{
+    int iShardCount;
+    int iCustomerCount;         // customers in all shards
+    Shard shardM[MAX_SHARDS];
+    OutputBuffer instrBuffer;   // instructions of the request being built
+    OutputBuffer textBuffer;    // text of the request being built
+    int *iTextOffsetM;          // per symbol id: text offset in the request
+    int *iStampM;               // per symbol id: request that set iTextOffsetM
+    int iSymbolMax;             // allocated size of iTextOffsetM and iStampM
+    int iStamp;                 // number of the request being built
+    int *iIdM;                  // matching customer numbers of the last query
+    int iIdCount;
+    int iIdMax;                 // allocated size of iIdM
+    long lCoordinatorDecided;   // queries decided by the coordinator
+    long lShardDecided;         // shard replies decided without evaluating
+} ShardSetImp;
+
+// ShardSet typedef defines a pointer to a shard set
+typedef ShardSetImp *ShardSet;
+
+/******************** growArray **************************************
+void *growArray(void *pArray, int *piMax, int iNeeded, int iElementSize)
+Purpose:
+    Enlarges a dynamically allocated array so it holds at least iNeeded
+    elements, doubling its size.
+Parameters:
+    I/O void *pArray            array to enlarge (NULL if none yet)
+    I/O int *piMax              allocated number of elements
+    I   int iNeeded             number of elements needed
+    I   int iElementSize        size of one element
+Returns:
+    The (possibly moved) array.
+**************************************************************************/
+static void *growArray(void *pArray, int *piMax, int iNeeded, int iElementSize)
+{
+    int iNewMax = *piMax > 0 ? *piMax : 16;
+
+    if (iNeeded <= *piMax)
+        return pArray;
+    while (iNewMax < iNeeded)
+        iNewMax *= 2;
+    pArray = realloc(pArray, (size_t) iNewMax * iElementSize);
+    if (pArray == NULL)
+        ErrExit(ERR_SHARD, "Unable to allocate %d entries", iNewMax);
+    *piMax = iNewMax;
+    return pArray;
+}
+
+/******************** hashShard **************************************
+int hashShard(int iCustomer, int iShardCount)
+Purpose:
+    Returns the shard of a customer (see note 1).
+**************************************************************************/
+static int hashShard(int iCustomer, int iShardCount)
+{
+    unsigned long long ullHash = (unsigned long long) iCustomer * 0x9E3779B97F4A7C15ULL;
+    return (int) ((ullHash >> 32) % iShardCount);
+}
+
+/******************** writeAll **************************************
+void writeAll(int iFd, void *pData, size_t iLength)
+Purpose:
+    Writes a whole buffer to a pipe.
+Parameters:
+    I   int iFd                 file descriptor of the pipe
+    I   void *pData             bytes to write
+    I   size_t iLength          number of bytes
+Returns:
+    n/a
+Notes:
+    - Exits with ERR_SHARD if the other end is closed.
+**************************************************************************/
+static void writeAll(int iFd, void *pData, size_t iLength)
+{
+    char *p = pData;
+    ssize_t iCount;
+
+    while (iLength > 0)
+    {
+        iCount = write(iFd, p, iLength);
+        if (iCount < 0 && errno == EINTR)
+            continue;
+        if (iCount <= 0)
+            ErrExit(ERR_SHARD, "Unable to write to a shard pipe: %s", strerror(errno));
+        p += iCount;
+        iLength -= iCount;
+    }
+}
+
+/******************** readAll **************************************
+int readAll(int iFd, void *pData, size_t iLength)
+Purpose:
+    Reads a whole buffer from a pipe.
+Parameters:
+    I   int iFd                 file descriptor of the pipe
+    O   void *pData             where the bytes are read
+    I   size_t iLength          number of bytes
+Returns:
+    TRUE if the bytes were read, FALSE if the pipe was closed first.
+**************************************************************************/
+static int readAll(int iFd, void *pData, size_t iLength)
+{
+    char *p = pData;
+    ssize_t iCount;
+
+    while (iLength > 0)
+    {
+        iCount = read(iFd, p, iLength);
+        if (iCount < 0 && errno == EINTR)
+            continue;
+        if (iCount <= 0)
+            return FALSE;
+        p += iCount;
+        iLength -= iCount;
+    }
+    return TRUE;
+}
+
+/******************** compareInt **************************************
+int compareInt(const void *pLeft, const void *pRight)
+Purpose:
+    qsort comparison of two ints.
+**************************************************************************/
+static int compareInt(const void *pLeft, const void *pRight)
+{
+    int iLeft = *(const int *) pLeft;
+    int iRight = *(const int *) pRight;
+    return (iLeft > iRight) - (iLeft < iRight);
+}
+
+/******************** decodeQuery **************************************
+void decodeQuery(Instr instrM[], int iInstrCount, char *pszText
+    , CustomerSet customerSet, Query query)
+Purpose:
+    Builds a query compiled against a shard's customers from a request.
+Parameters:
+    I   Instr instrM[]              instructions of the request
+    I   int iInstrCount             number of instructions
+    I   char *pszText               text of the request
+    I   CustomerSet customerSet     the shard's customers
+    O   Query query                 compiled query
+Returns:
+    n/a
+**************************************************************************/
+static void decodeQuery(Instr instrM[], int iInstrCount, char *pszText
+    , CustomerSet customerSet, Query query)
+{
+    Instr instr;
+    int iDepth = 0;
+    int i;
+
+    query->instrM = growArray(query->instrM, &query->iInstrMax, iInstrCount
+        , sizeof(Instr));
+    query->iInstrCount = iInstrCount;
+    query->iMaxDepth = 1;
+    for (i = 0; i < iInstrCount; i++)
+    {
+        instr = instrM[i];
+        if (instr.iOp == OP_AND || instr.iOp == OP_OR)
+            iDepth--;
+        else
+        {
+            iDepth++;
+            instr.iTrait = findTrait(customerSet, pszText + instrM[i].iTrait);
+            instr.iValue = -1;
+            if (instr.iTrait >= 0)
+                instr.iValue = findTraitValue(customerSet, instr.iTrait
+                    , pszText + instrM[i].iValue);
+        }
+        if (iDepth > query->iMaxDepth)
+            query->iMaxDepth = iDepth;
+        query->instrM[i] = instr;
+    }
+}
+
+/******************** runShard **************************************
+void runShard(int iShard, int iShardCount, int iDataFd, int iRequestFd
+    , int iReplyFd)
+Purpose:
+    The body of a shard process: loads its customers, then answers
+    requests until the request pipe is closed.
+Parameters:
+    I   int iShard              number of the shard (0 is the first)
+    I   int iShardCount         number of shards
+    I   int iDataFd             pipe of customer lines
+    I   int iRequestFd          pipe of requests
+    I   int iReplyFd            pipe of replies
+Returns:
+    Does not return.
+Notes:
+    - Once loaded, the shard replies with its customer count.
+**************************************************************************/
+static void runShard(int iShard, int iShardCount, int iDataFd, int iRequestFd
+    , int iReplyFd)
+{
+    FILE *pDataFile = fdopen(iDataFd, "r");
+    CustomerSet customerSet;
+    CustomerIndex index;
+    QueryStats stats;
+    Query query = newQuery();
+    Out out = newOut();         // supplies the arena for each request
+    OutputBuffer reply = newOutputBuffer(NULL);
+    int iHeaderM[3];            // instruction count, bIds, text bytes
+    int iReplyM[3];             // count, customer numbers, bDecided
+    int *iGlobalM;              // customer number of each of the shard's customers
+    Instr *instrM;
+    char *pszText;
+    int iResult;
+    int iCustomer;
+    int i;
+
+    if (pDataFile == NULL)
+        ErrExit(ERR_SHARD, "Shard %d is unable to read its customers", iShard);
+    customerSet = loadCustomers(pDataFile);
+    fclose(pDataFile);
+    index = buildIndex(customerSet);
+    stats = collectStats(customerSet);
+    iGlobalM = malloc((customerSet->iCustomerCount + 1) * sizeof(int));
+    if (iGlobalM == NULL)
+        ErrExit(ERR_SHARD, "Shard %d is unable to allocate its customer numbers", iShard);
+    for (iCustomer = 0, i = 0; i < customerSet->iCustomerCount; iCustomer++)
+    {
+        if (hashShard(iCustomer, iShardCount) == iShard)
+            iGlobalM[i++] = iCustomer;
+    }
+    writeAll(iReplyFd, &customerSet->iCustomerCount, sizeof(int));
+
+    while (readAll(iRequestFd, iHeaderM, sizeof(iHeaderM)))
+    {
+        resetOut(out);
+        instrM = arenaAlloc(out->arena, iHeaderM[0] * sizeof(Instr));
+        pszText = arenaAlloc(out->arena, iHeaderM[2] + 1);
+        if (!readAll(iRequestFd, instrM, iHeaderM[0] * sizeof(Instr))
+            || !readAll(iRequestFd, pszText, iHeaderM[2]))
+            break;
+        decodeQuery(instrM, iHeaderM[0], pszText, customerSet, query);
+
+        reply->iLength = 0;
+        iReplyM[1] = 0;
+        iResult = simplifyQuery(query, customerSet, out->arena);
+        iReplyM[2] = iResult != SIMPLE_VARIES;
+        if (iResult == FALSE)
+            iReplyM[0] = 0;
+        else if (iResult == TRUE)
+            iReplyM[0] = customerSet->iCustomerCount;
+        else
+        {
+            optimizeQuery(query, stats, out->arena);
+            iReplyM[0] = countIndexMatches(query, index);
+        }
+        if (iHeaderM[1] && iReplyM[0] > 0)
+        {
+            for (i = 0; i < customerSet->iCustomerCount; i++)
+            {
+                if (iResult == TRUE || evaluateQuery(query, customerSet, i))
+                    outputText(reply, (char *) &iGlobalM[i], sizeof(int));
+            }
+            iReplyM[1] = reply->iLength / sizeof(int);
+        }
+        writeAll(iReplyFd, iReplyM, sizeof(iReplyM));
+        writeAll(iReplyFd, reply->pszBuffer, reply->iLength);
+    }
+    _exit(0);
+}
+
+/******************** startShards **************************************
+ShardSet startShards(int iShardCount, FILE *pCustomerFile)
+Purpose:
+    Starts the shard processes and sends each its customers.
+Parameters:
+    I   int iShardCount             number of shards
+    I   FILE *pCustomerFile         customer file opened for reading
+Returns:
+    The shard set.  Use stopShards to stop the shards and free it.
+Notes:
+    - A shard process closes the coordinator's ends of the pipes of the
+      shards started before it.  Otherwise it would keep their customer
+      pipes open and they would never see the end of their customers.
+**************************************************************************/
+static ShardSet startShards(int iShardCount, FILE *pCustomerFile)
+{
+    ShardSet set = calloc(1, sizeof(ShardSetImp));
+    LineReader reader;
+    char *pszLine;                          // entire customer line
+    char *pszField;                         // first TRAIT=VALUE field
+    int iDataM[2];
+    int iRequestM[2];
+    int iReplyM[2];
+    int iLength;
+    int bNewline;
+    int iShard;
+    int j;
+    Shard *pShard;
+
+    if (set == NULL)
+        ErrExit(ERR_SHARD, "Unable to allocate a shard set");
+    set->iShardCount = iShardCount;
+    set->instrBuffer = newOutputBuffer(NULL);
+    set->textBuffer = newOutputBuffer(NULL);
+    fflush(NULL);                           // nothing buffered is written twice
+    for (iShard = 0; iShard < iShardCount; iShard++)
+    {
+        pShard = &set->shardM[iShard];
+        if (pipe(iDataM) != 0 || pipe(iRequestM) != 0 || pipe(iReplyM) != 0)
+            ErrExit(ERR_SHARD, "Unable to create the pipes of shard %d: %s"
+            , iShard, strerror(errno));
+        pShard->pid = fork();
+        if (pShard->pid < 0)
+            ErrExit(ERR_SHARD, "Unable to start shard %d: %s", iShard, strerror(errno));
+        if (pShard->pid == 0)
+        {
+            for (j = 0; j < iShard; j++)
+            {
+                close(fileno(set->shardM[j].pDataFile));
+                close(set->shardM[j].iRequestFd);
+                close(set->shardM[j].iReplyFd);
+            }
+            close(iDataM[1]);
+            close(iRequestM[1]);
+            close(iReplyM[0]);
+            runShard(iShard, iShardCount, iDataM[0], iRequestM[0], iReplyM[1]);
+        }
+        close(iDataM[0]);
+        close(iRequestM[0]);
+        close(iReplyM[1]);
+        pShard->pDataFile = fdopen(iDataM[1], "w");
+        if (pShard->pDataFile == NULL)
+            ErrExit(ERR_SHARD, "Unable to open the customer pipe of shard %d", iShard);
+        pShard->iRequestFd = iRequestM[1];
+        pShard->iReplyFd = iReplyM[0];
+    }
+
+    // send each customer line to its shard
+    reader = newLineReader(pCustomerFile);
+    while ((pszLine = readLine(reader, &iLength, &bNewline)) != NULL)
+    {
+        if (getTokenView(pszLine, &pszField, &iLength) == NULL)
+            continue;                       // empty line
+        pShard = &set->shardM[hashShard(set->iCustomerCount, iShardCount)];
+        fputs(pszLine, pShard->pDataFile);
+        fputc('\n', pShard->pDataFile);
+        set->iCustomerCount++;
+    }
+    freeLineReader(reader);
+    for (iShard = 0; iShard < iShardCount; iShard++)
+    {
+        pShard = &set->shardM[iShard];
+        if (fclose(pShard->pDataFile) != 0)
+            ErrExit(ERR_SHARD, "Unable to send the customers of shard %d", iShard);
+        pShard->pDataFile = NULL;
+        if (!readAll(pShard->iReplyFd, &pShard->iCustomerCount, sizeof(int)))
+            ErrExit(ERR_SHARD, "Shard %d failed while loading its customers", iShard);
+    }
+    return set;
+}
+
+/******************** stopShards **************************************
+void stopShards(ShardSet set)
+Purpose:
+    Stops the shard processes and frees the shard set.
+Parameters:
+    I/O ShardSet set                shard set to stop
+Returns:
+    n/a
+**************************************************************************/
+static void stopShards(ShardSet set)
+{
+    int iStatus;
+    int iShard;
+
+    for (iShard = 0; iShard < set->iShardCount; iShard++)
+        close(set->shardM[iShard].iRequestFd);
+    for (iShard = 0; iShard < set->iShardCount; iShard++)
+    {
+        close(set->shardM[iShard].iReplyFd);
+        if (waitpid(set->shardM[iShard].pid, &iStatus, 0) < 0
+            || !WIFEXITED(iStatus) || WEXITSTATUS(iStatus) != 0)
+            ErrExit(ERR_SHARD, "Shard %d did not exit normally", iShard);
+    }
+    freeOutputBuffer(set->instrBuffer);
+    freeOutputBuffer(set->textBuffer);
+    free(set->iTextOffsetM);
+    free(set->iStampM);
+    free(set->iIdM);
+    free(set);
+}
+
+/******************** addText **************************************
+int addText(ShardSet set, int iSymbol)
+Purpose:
+    Adds the text of a symbol to the request being built, once per
+    request.
+Parameters:
+    I/O ShardSet set                shard set
+    I   int iSymbol                 symbol id
+Returns:
+    The offset of the text in the request's text.
+**************************************************************************/
+static int addText(ShardSet set, int iSymbol)
+{
+    int iOldMax = set->iSymbolMax;
+    int iOffsetMax = set->iSymbolMax;
+
+    if (iSymbol >= set->iSymbolMax)
+    {
+        set->iTextOffsetM = growArray(set->iTextOffsetM, &iOffsetMax, iSymbol + 1
+            , sizeof(int));
+        set->iStampM = growArray(set->iStampM, &set->iSymbolMax, iSymbol + 1
+            , sizeof(int));
+        memset(set->iStampM + iOldMax, 0, (set->iSymbolMax - iOldMax) * sizeof(int));
+    }
+    if (set->iStampM[iSymbol] != set->iStamp)
+    {
+        set->iStampM[iSymbol] = set->iStamp;
+        set->iTextOffsetM[iSymbol] = set->textBuffer->iLength;
+        outputText(set->textBuffer, getSymbolText(iSymbol), getSymbolLength(iSymbol) + 1);
+    }
+    return set->iTextOffsetM[iSymbol];
+}
+
+/******************** queryShards **************************************
+int queryShards(ShardSet set, Query query, Arena arena, int bIds)
+Purpose:
+    Counts the customers of every shard matching a query, and optionally
+    collects their customer numbers in set->iIdM.
+Parameters:
+    I/O ShardSet set                shard set
+    I/O Query query                 query compiled without customer data
+    I/O Arena arena                 arena for simplifyQuery
+    I   int bIds                    TRUE to collect the customer numbers
+Returns:
+    The number of matching customers.
+**************************************************************************/
+static int queryShards(ShardSet set, Query query, Arena arena, int bIds)
+{
+    Instr instr;
+    Shard *pShard;
+    int iHeaderM[3];            // instruction count, bIds, text bytes
+    int iReplyM[3];             // count, customer numbers, bDecided
+    int iResult = simplifyQuery(query, NULL, arena);
+    int iMatches = 0;
+    int iShard;
+    int i;
+
+    set->iIdCount = 0;
+    if (iResult != SIMPLE_VARIES)
+    {
+        set->lCoordinatorDecided++;
+        if (iResult == FALSE)
+            return 0;
+        if (bIds)
+        {
+            set->iIdM = growArray(set->iIdM, &set->iIdMax, set->iCustomerCount
+                , sizeof(int));
+            for (i = 0; i < set->iCustomerCount; i++)
+                set->iIdM[i] = i;
+            set->iIdCount = set->iCustomerCount;
+        }
+        return set->iCustomerCount;
+    }
+
+    // build the request
+    set->iStamp++;
+    set->instrBuffer->iLength = 0;
+    set->textBuffer->iLength = 0;
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        instr = query->instrM[i];
+        if (instr.iOp != OP_AND && instr.iOp != OP_OR)
+        {
+            instr.iTrait = addText(set, instr.iTrait);
+            instr.iValue = addText(set, instr.iValue);
+        }
+        outputText(set->instrBuffer, (char *) &instr, sizeof(Instr));
+    }
+    iHeaderM[0] = query->iInstrCount;
+    iHeaderM[1] = bIds;
+    iHeaderM[2] = set->textBuffer->iLength;
+
+    // send it to every shard, then collect the replies
+    for (iShard = 0; iShard < set->iShardCount; iShard++)
+    {
+        pShard = &set->shardM[iShard];
+        writeAll(pShard->iRequestFd, iHeaderM, sizeof(iHeaderM));
+        writeAll(pShard->iRequestFd, set->instrBuffer->pszBuffer, set->instrBuffer->iLength);
+        writeAll(pShard->iRequestFd, set->textBuffer->pszBuffer, set->textBuffer->iLength);
+    }
+    for (iShard = 0; iShard < set->iShardCount; iShard++)
+    {
+        pShard = &set->shardM[iShard];
+        if (!readAll(pShard->iReplyFd, iReplyM, sizeof(iReplyM)))
+            ErrExit(ERR_SHARD, "Shard %d failed", iShard);
+        iMatches += iReplyM[0];
+        set->lShardDecided += iReplyM[2];
+        set->iIdM = growArray(set->iIdM, &set->iIdMax, set->iIdCount + iReplyM[1]
+            , sizeof(int));
+        if (!readAll(pShard->iReplyFd, set->iIdM + set->iIdCount
+            , iReplyM[1] * sizeof(int)))
+            ErrExit(ERR_SHARD, "Shard %d failed", iShard);
+        set->iIdCount += iReplyM[1];
+    }
+    if (bIds)
+        qsort(set->iIdM, set->iIdCount, sizeof(int), compareInt);
+    return iMatches;
+}
+
+/******************** runQueries **************************************
+long runQueries(ShardSet set, char **pszLineM, int iLineCount
+    , OutputBuffer output, int bIds)
+Purpose:
+    Converts each query, evaluates it on the shards and formats the
+    result (see Results above).
+Parameters:
+    I/O ShardSet set                shard set
+    I   char **pszLineM             zero terminated query lines
+    I   int iLineCount              number of lines
+    O   OutputBuffer output         where the results are formatted.  It
+                                    is emptied after each query if it has
+                                    no file.
+    I   int bIds                    TRUE to print the customer numbers
+Returns:
+    The sum of the match counts, which the scaling benchmark compares.
+**************************************************************************/
+static long runQueries(ShardSet set, char **pszLineM, int iLineCount
+    , OutputBuffer output, int bIds)
+{
+    Out out = newOut();
+    Query query = newQuery();
+    long lTotal = 0;
+    int iMatches;
+    int rc;
+    int iQuery;
+    int i;
+
+    for (iQuery = 0; iQuery < iLineCount; iQuery++)
+    {
+        resetOut(out);
+        rc = convertToPostFix(pszLineM[iQuery], out);
+        iMatches = -1;
+        set->iIdCount = 0;
+        if (rc == 0 && compileQuery(out, NULL, query) == 0)
+            iMatches = queryShards(set, query, out->arena, bIds);
+        lTotal += iMatches;
+
+        if (output->pFile == NULL)
+            output->iLength = 0;
+        outputInt(output, iQuery + 1);
+        outputText(output, "\t", 1);
+        outputInt(output, rc);
+        outputText(output, "\t", 1);
+        if (rc == 0)
+            formatOut(output, out, FORMAT_POSTFIX);
+        outputText(output, "\t", 1);
+        outputInt(output, iMatches);
+        if (bIds)
+        {
+            outputText(output, "\t", 1);
+            for (i = 0; i < set->iIdCount; i++)
+            {
+                if (i > 0)
+                    outputText(output, " ", 1);
+                outputInt(output, set->iIdM[i] + 1);
+            }
+        }
+        outputText(output, "\n", 1);
+    }
+    freeQuery(query);
+    freeOut(out);
+    return lTotal;
+}
+
+/******************** readQueries **************************************
+char **readQueries(FILE *pFile, int *piLineCount, OutputBuffer text)
+Purpose:
+    Reads all of the query lines.
+Parameters:
+    I   FILE *pFile                 file opened for reading
+    O   int *piLineCount            number of lines
+    O   OutputBuffer text           buffer with no file that receives the
+                                    lines, each zero terminated
+Returns:
+    The lines, pointing into text.
+**************************************************************************/
+static char **readQueries(FILE *pFile, int *piLineCount, OutputBuffer text)
+{
+    LineReader reader = newLineReader(pFile);
+    char **pszLineM = NULL;
+    int *iStartM = NULL;        // offset of each line in text
+    int iStartMax = 0;
+    char *pszLine;
+    int iLineLength;
+    int bNewline;
+    int i;
+
+    *piLineCount = 0;
+    while ((pszLine = readLine(reader, &iLineLength, &bNewline)) != NULL)
+    {
+        iStartM = growArray(iStartM, &iStartMax, *piLineCount + 1, sizeof(int));
+        iStartM[(*piLineCount)++] = text->iLength;
+        outputText(text, pszLine, iLineLength + 1);
+    }
+    freeLineReader(reader);
+    pszLineM = malloc((*piLineCount + 1) * sizeof(char *));
+    if (pszLineM == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate %d queries", *piLineCount);
+    for (i = 0; i < *piLineCount; i++)
+        pszLineM[i] = text->pszBuffer + iStartM[i];
+    free(iStartM);
+    return pszLineM;
+}
+
+/******************** elapsedMs **************************************
+double elapsedMs(struct timespec *pStart)
+Purpose:
+    Returns the milliseconds since pStart.
+**************************************************************************/
+static double elapsedMs(struct timespec *pStart)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - pStart->tv_sec) * 1e3 + (end.tv_nsec - pStart->tv_nsec) / 1e6;
+}
+
+/******************** runScaling **************************************
+void runScaling(FILE *pCustomerFile, char **pszLineM, int iLineCount
+    , int iMaxShards)
+Purpose:
+    Times loading the customers and running the queries with 1, 2, 4, ...
+    shards, up to iMaxShards.
+Parameters:
+    I   FILE *pCustomerFile         customer file opened for reading
+    I   char **pszLineM             zero terminated query lines
+    I   int iLineCount              number of lines
+    I   int iMaxShards              most shards
+Returns:
+    n/a
+Notes:
+    - iMaxShards itself is always run.  Exits with ERR_SHARD if two
+      shard counts give different match counts.
+**************************************************************************/
+static void runScaling(FILE *pCustomerFile, char **pszLineM, int iLineCount
+    , int iMaxShards)
+{
+    OutputBuffer output = newOutputBuffer(NULL);
+    struct timespec start;
+    ShardSet set;
+    double dLoadMs;
+    double dQueryMs;
+    long lTotal;
+    long lFirstTotal = 0;
+    int iLargest;
+    int iShards;
+    int i;
+
+    for (iShards = 1; ; iShards = iShards * 2 < iMaxShards ? iShards * 2 : iMaxShards)
+    {
+        rewind(pCustomerFile);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        set = startShards(iShards, pCustomerFile);
+        dLoadMs = elapsedMs(&start);
+        if (iShards == 1)
+            printf("# cs2123p1Shard customers=%d queries=%d\n"
+                "%s\t%s\t%s\t%s\t%s\n", set->iCustomerCount, iLineCount
+                , "shards", "load_ms", "query_ms", "queries_per_sec", "largest_shard");
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        lTotal = runQueries(set, pszLineM, iLineCount, output, FALSE);
+        dQueryMs = elapsedMs(&start);
+        if (iShards == 1)
+            lFirstTotal = lTotal;
+        else if (lTotal != lFirstTotal)
+            ErrExit(ERR_SHARD, "%d shards matched %ld customers instead of %ld"
+            , iShards, lTotal, lFirstTotal);
+        iLargest = 0;
+        for (i = 0; i < iShards; i++)
+        {
+            if (set->shardM[i].iCustomerCount > iLargest)
+                iLargest = set->shardM[i].iCustomerCount;
+        }
+        printf("%d\t%.1f\t%.1f\t%.0f\t%d\n", iShards, dLoadMs, dQueryMs
+            , dQueryMs > 0 ? iLineCount / (dQueryMs / 1e3) : 0.0, iLargest);
+        fflush(stdout);
+        stopShards(set);
+        if (iShards == iMaxShards)
+            break;
+    }
+    freeOutputBuffer(output);
+}
+
+/******************** getShardArg **************************************
+int getShardArg(char *pszArg)
+Purpose:
+    Converts a shard count parameter, exiting if it is out of range.
+**************************************************************************/
+static int getShardArg(char *pszArg)
+{
+    int iShards = atoi(pszArg);
+    if (iShards < 1 || iShards > MAX_SHARDS)
+        ErrExit(ERR_INPUT, "Parameter %s must be from 1 to %d", pszArg, MAX_SHARDS);
+    return iShards;
+}
+
+// Main program for the shard coordinator
+
+int main(int argc, char *argv[])
+{
+    OutputBuffer text = newOutputBuffer(NULL);
+    OutputBuffer output;
+    FILE *pCustomerFile;
+    ShardSet set;
+    char **pszLineM;
+    int iLineCount;
+    int iShards = 4;
+    int iMaxShards = 0;         // -b maxShards, 0 for none
+    int bIds = FALSE;
+    int i;
+
+    // process the command line options
+    for (i = 1; i < argc - 1; i++)
+    {
+        if (strcmp(argv[i], "-i") == 0)
+            bIds = TRUE;
+        else if (strcmp(argv[i], "-n") == 0 && i + 2 < argc)
+            iShards = getShardArg(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0 && i + 2 < argc)
+            iMaxShards = getShardArg(argv[++i]);
+        else
+            ErrExit(ERR_INPUT, "Unknown parameter %s", argv[i]);
+    }
+    if (argc < 2 || argv[argc - 1][0] == '-')
+        ErrExit(ERR_INPUT, "Usage: p1shard [-n shards] [-i] | [-b maxShards] customerFile");
+    pCustomerFile = fopen(argv[argc - 1], "r");
+    if (pCustomerFile == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to open customer file %s", argv[argc - 1]);
+
+    signal(SIGPIPE, SIG_IGN);
+    pszLineM = readQueries(stdin, &iLineCount, text);
+    if (iMaxShards > 0)
+        runScaling(pCustomerFile, pszLineM, iLineCount, iMaxShards);
+    else
+    {
+        set = startShards(iShards, pCustomerFile);
+        output = newOutputBuffer(stdout);
+        runQueries(set, pszLineM, iLineCount, output, bIds);
+        flushOutput(output);
+        freeOutputBuffer(output);
+        fprintf(stderr, "Shards: %d, %d customers, %ld queries decided by the"
+            " coordinator, %ld shard replies decided without evaluating\n"
+            , iShards, set->iCustomerCount, set->lCoordinatorDecided, set->lShardDecided);
+        stopShards(set);
+    }
+    fclose(pCustomerFile);
+    free(pszLineM);
+    freeOutputBuffer(text);
+    return 0;
+}
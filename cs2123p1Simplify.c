@@ -0,0 +1,475 @@
+/**********************************************************************************
+Program cs2123p1Simplify.c by Timothy Hennessy
+Purpose:
+    Rewrites a compiled query into a simpler equivalent one: chains of the
+    same operator are flattened, repeated operands are removed, and
+    operands or whole queries that are true or false for every customer
+    are folded to constants.
+Command Parameters:
+    n/a
+Input:
+    A Query built by compileQuery and the customer set it was compiled
+    against.
+Results:
+    The query's instructions are replaced by the simplified list.  A query
+    that is the same for every customer becomes a single comparison with
+    a value id of -1, which every evaluator already treats as a constant:
+        = on an unknown value       false for every customer
+        NOTANY on an unknown value  true for every customer
+Returns:
+    FALSE or TRUE if the query has that result for every customer, and
+    SIMPLE_VARIES otherwise.
+Notes:
+    1. The rules applied to the operands of one flattened AND (OR is the
+       same with true and false exchanged):
+           a false operand makes the AND false
+           a true operand is dropped
+           an operand equal to an earlier one is dropped
+           T = v, or T ONLY v, with T NOTANY v makes the AND false
+           T ONLY v with T = w, or T ONLY w, makes the AND false (w != v)
+           T = v with T = w makes the AND false if no customer has two
+               values for T
+       For OR the comparison rules are T = v OR T NOTANY v, and
+       T NOTANY v OR T NOTANY w for a single-valued T, which are true.
+       An AND left with no operands is true, and an OR false.
+    2. Comparisons on a trait or value that no customer has are already
+       constants (see cs2123p1Eval.c), so they fold too.
+    3. Operands keep the order of the query, and the first of equal
+       operands is the one kept.  Operands are equal if their simplified
+       instructions are; A AND B and B AND A are not found equal.
+    4. The nodes are simplified in postfix order, so every operand is done
+       before its operator and nothing recurses.  A node's instructions
+       are copied into each enclosing chain of the other operator, so the
+       work grows with the size times the AND/OR alternations of the query.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+
+// SimpleNode typedef is the simplified form of one node of the query
+typedef struct
+{
+    int iResult;                // FALSE, TRUE or SIMPLE_VARIES
+    int iInstrCount;            // instructions in instrM (SIMPLE_VARIES only)
+    Instr *instrM;              // simplified postfix of the node
+    unsigned int uiHash;        // hash of instrM
+} SimpleNode;
+
+// ChainOperand typedef is one operand of a flattened AND or OR
+typedef struct
+{
+    int iNode;                  // instruction subscript of the operand's root
+    int iPosition;              // left to right position in the chain
+    int bDropped;               // TRUE if the operand is removed
+    SimpleNode *pNode;
+} ChainOperand;
+
+// SimplifyState typedef holds the work areas of simplifyQuery.  Nodes
+// are the subscripts of the compiled instructions.
+typedef struct
+{
+    Instr *instrM;              // copy of the compiled instructions
+    int *iLeftM;                // left operand of an AND or OR node
+    int *iRightM;               // right operand of an AND or OR node
+    int *iParentM;              // operator using a node (-1 for the root)
+    int *iPendingM;             // nodes waiting to be gathered into a chain
+    ChainOperand *operandM;     // operands of the chain being simplified
+    Instr *comparisonM;         // comparisons of the chain being simplified
+    SimpleNode *nodeM;          // simplified form of each node
+    CustomerSet customerSet;    // NULL if the query has symbol ids
+    Arena arena;
+} SimplifyState;
+
+/******************** hashInstrs **************************************
+unsigned int hashInstrs(Instr instrM[], int iInstrCount)
+Purpose:
+    Hashes a list of instructions.
+**************************************************************************/
+static unsigned int hashInstrs(Instr instrM[], int iInstrCount)
+{
+    unsigned int uiHash = 2166136261u;
+    int i;
+
+    for (i = 0; i < iInstrCount; i++)
+    {
+        uiHash = (uiHash ^ instrM[i].iOp) * 16777619u;
+        uiHash = (uiHash ^ instrM[i].iTrait) * 16777619u;
+        uiHash = (uiHash ^ instrM[i].iValue) * 16777619u;
+    }
+    return uiHash;
+}
+
+/******************** compareByContent **************************************
+int compareByContent(const void *pLeft, const void *pRight)
+Purpose:
+    qsort comparison putting chain operands with the same hash and
+    length together, in chain order.
+**************************************************************************/
+static int compareByContent(const void *pLeft, const void *pRight)
+{
+    const ChainOperand *pA = pLeft;
+    const ChainOperand *pB = pRight;
+    if (pA->pNode->uiHash != pB->pNode->uiHash)
+        return pA->pNode->uiHash < pB->pNode->uiHash ? -1 : 1;
+    if (pA->pNode->iInstrCount != pB->pNode->iInstrCount)
+        return pA->pNode->iInstrCount - pB->pNode->iInstrCount;
+    return pA->iPosition - pB->iPosition;
+}
+
+/******************** compareByPosition **************************************
+int compareByPosition(const void *pLeft, const void *pRight)
+Purpose:
+    qsort comparison putting chain operands back in chain order.
+**************************************************************************/
+static int compareByPosition(const void *pLeft, const void *pRight)
+{
+    const ChainOperand *pA = pLeft;
+    const ChainOperand *pB = pRight;
+    return pA->iPosition - pB->iPosition;
+}
+
+/******************** compareComparisons **************************************
+int compareComparisons(const void *pLeft, const void *pRight)
+Purpose:
+    qsort comparison ordering comparisons by trait, value and operation.
+**************************************************************************/
+static int compareComparisons(const void *pLeft, const void *pRight)
+{
+    const Instr *pA = pLeft;
+    const Instr *pB = pRight;
+    if (pA->iTrait != pB->iTrait)
+        return pA->iTrait - pB->iTrait;
+    if (pA->iValue != pB->iValue)
+        return pA->iValue - pB->iValue;
+    return pA->iOp - pB->iOp;
+}
+
+/******************** isSingleValued **************************************
+int isSingleValued(SimplifyState *pState, int iTrait)
+Purpose:
+    Determines whether no customer has two values for a trait.
+Parameters:
+    I   SimplifyState *pState       simplifier work areas
+    I   int iTrait                  trait id
+Returns:
+    TRUE if every customer has at most one value for the trait.
+    FALSE if one has more, or the query was compiled without customers.
+**************************************************************************/
+static int isSingleValued(SimplifyState *pState, int iTrait)
+{
+    if (pState->customerSet == NULL || iTrait < 0)
+        return FALSE;
+    return pState->customerSet->traitM[iTrait].iMaxValues <= 1;
+}
+
+/******************** decideComparisons **************************************
+int decideComparisons(SimplifyState *pState, int iOp, int iCount)
+Purpose:
+    Determines whether the comparisons of a chain decide it for every
+    customer (see note 1).
+Parameters:
+    I/O SimplifyState *pState       comparisonM has the chain's comparisons.
+                                    They are sorted.
+    I   int iOp                     OP_AND or OP_OR
+    I   int iCount                  number of comparisons
+Returns:
+    TRUE if the comparisons decide the chain: an AND is false or an OR
+    is true for every customer.
+**************************************************************************/
+static int decideComparisons(SimplifyState *pState, int iOp, int iCount)
+{
+    Instr *comparisonM = pState->comparisonM;
+    int iPositiveValues;        // values of the trait compared with = or ONLY
+    int iNotAnyValues;          // values of the trait compared with NOTANY
+    int bOnly;                  // TRUE if the trait is compared with ONLY
+    int bPositive;              // TRUE if the value has = or ONLY
+    int bEqual;                 // TRUE if the value has =
+    int bNotAny;                // TRUE if the value has NOTANY
+    int iTraitStart;
+    int i;
+
+    qsort(comparisonM, iCount, sizeof(Instr), compareComparisons);
+    for (iTraitStart = 0; iTraitStart < iCount; )
+    {
+        iPositiveValues = iNotAnyValues = 0;
+        bOnly = FALSE;
+        for (i = iTraitStart; i < iCount
+            && comparisonM[i].iTrait == comparisonM[iTraitStart].iTrait; )
+        {
+            // the comparisons of one value are together
+            bPositive = bEqual = bNotAny = FALSE;
+            do
+            {
+                if (comparisonM[i].iOp == OP_NOTANY)
+                    bNotAny = TRUE;
+                else
+                    bPositive = TRUE;
+                if (comparisonM[i].iOp == OP_EQUAL)
+                    bEqual = TRUE;
+                if (comparisonM[i].iOp == OP_ONLY)
+                    bOnly = TRUE;
+                i++;
+            } while (i < iCount && comparisonM[i].iTrait == comparisonM[i - 1].iTrait
+                && comparisonM[i].iValue == comparisonM[i - 1].iValue);
+            if (iOp == OP_AND && bPositive && bNotAny)
+                return TRUE;
+            if (iOp == OP_OR && bEqual && bNotAny)
+                return TRUE;
+            iPositiveValues += bPositive;
+            iNotAnyValues += bNotAny;
+        }
+        if (iOp == OP_AND && iPositiveValues > 1
+            && (bOnly || isSingleValued(pState, comparisonM[iTraitStart].iTrait)))
+            return TRUE;
+        if (iOp == OP_OR && iNotAnyValues > 1
+            && isSingleValued(pState, comparisonM[iTraitStart].iTrait))
+            return TRUE;
+        iTraitStart = i;
+    }
+    return FALSE;
+}
+
+/******************** simplifyChain **************************************
+void simplifyChain(SimplifyState *pState, int iNode)
+Purpose:
+    Simplifies a chain of AND or OR whose operands are simplified.
+Parameters:
+    I/O SimplifyState *pState       simplifier work areas
+    I   int iNode                   root of the chain
+Returns:
+    n/a
+Notes:
+    - The operands of the chain are gathered with iPendingM as an
+      explicit stack, as optimizeQuery's emitNode does.
+    - T ONLY v OR T NOTANY v is kept: it is false for a customer with v
+      and another value.
+**************************************************************************/
+static void simplifyChain(SimplifyState *pState, int iNode)
+{
+    Instr op = pState->instrM[iNode];
+    SimpleNode *pNode = &pState->nodeM[iNode];
+    SimpleNode *pChild;
+    ChainOperand *operandM = pState->operandM;
+    int iDecided = op.iOp == OP_AND ? FALSE : TRUE;   // result that ends the chain
+    int iOperandCount = 0;
+    int iComparisonCount = 0;
+    int iPending = 0;
+    int iKept = 0;
+    int iChild;
+    int iGroupStart;
+    int i;
+    int j;
+
+    // gather the operands left to right, folding constants
+    pState->iPendingM[iPending++] = iNode;
+    while (iPending > 0)
+    {
+        iChild = pState->iPendingM[--iPending];
+        if (pState->instrM[iChild].iOp == op.iOp)
+        {
+            pState->iPendingM[iPending++] = pState->iRightM[iChild];
+            pState->iPendingM[iPending++] = pState->iLeftM[iChild];
+            continue;
+        }
+        pChild = &pState->nodeM[iChild];
+        if (pChild->iResult == iDecided)
+        {
+            pNode->iResult = iDecided;
+            return;
+        }
+        if (pChild->iResult != SIMPLE_VARIES)
+            continue;                       // true in an AND, false in an OR
+        operandM[iOperandCount].iNode = iChild;
+        operandM[iOperandCount].iPosition = iOperandCount;
+        operandM[iOperandCount].bDropped = FALSE;
+        operandM[iOperandCount].pNode = pChild;
+        iOperandCount++;
+    }
+
+    // drop operands equal to an earlier one
+    qsort(operandM, iOperandCount, sizeof(ChainOperand), compareByContent);
+    for (iGroupStart = 0; iGroupStart < iOperandCount; iGroupStart = i)
+    {
+        for (i = iGroupStart + 1; i < iOperandCount
+            && operandM[i].pNode->uiHash == operandM[iGroupStart].pNode->uiHash
+            && operandM[i].pNode->iInstrCount == operandM[iGroupStart].pNode->iInstrCount
+            ; i++)
+        {
+            for (j = iGroupStart; j < i; j++)
+            {
+                if (!operandM[j].bDropped && memcmp(operandM[i].pNode->instrM
+                    , operandM[j].pNode->instrM
+                    , operandM[i].pNode->iInstrCount * sizeof(Instr)) == 0)
+                {
+                    operandM[i].bDropped = TRUE;
+                    break;
+                }
+            }
+        }
+    }
+    qsort(operandM, iOperandCount, sizeof(ChainOperand), compareByPosition);
+
+    // look for comparisons that decide the chain
+    for (i = 0; i < iOperandCount; i++)
+    {
+        if (!operandM[i].bDropped && operandM[i].pNode->iInstrCount == 1)
+            pState->comparisonM[iComparisonCount++] = operandM[i].pNode->instrM[0];
+    }
+    if (iComparisonCount > 1 && decideComparisons(pState, op.iOp, iComparisonCount))
+    {
+        pNode->iResult = iDecided;
+        return;
+    }
+
+    // the kept operands, each but the first followed by the operator
+    for (i = 0; i < iOperandCount; i++)
+    {
+        if (operandM[i].bDropped)
+            continue;
+        operandM[iKept++] = operandM[i];
+    }
+    if (iKept == 0)
+    {
+        pNode->iResult = !iDecided;
+        return;
+    }
+    pNode->iResult = SIMPLE_VARIES;
+    if (iKept == 1)
+    {
+        *pNode = *operandM[0].pNode;
+        return;
+    }
+    pNode->iInstrCount = iKept - 1;
+    for (i = 0; i < iKept; i++)
+        pNode->iInstrCount += operandM[i].pNode->iInstrCount;
+    pNode->instrM = arenaAlloc(pState->arena, pNode->iInstrCount * sizeof(Instr));
+    pNode->iInstrCount = 0;
+    for (i = 0; i < iKept; i++)
+    {
+        memcpy(pNode->instrM + pNode->iInstrCount, operandM[i].pNode->instrM
+            , operandM[i].pNode->iInstrCount * sizeof(Instr));
+        pNode->iInstrCount += operandM[i].pNode->iInstrCount;
+        if (i > 0)
+            pNode->instrM[pNode->iInstrCount++] = op;
+    }
+    pNode->uiHash = hashInstrs(pNode->instrM, pNode->iInstrCount);
+}
+
+/******************** simplifyQuery **************************************
+int simplifyQuery(Query query, CustomerSet customerSet, Arena arena)
+Purpose:
+    Replaces a compiled query with a simpler equivalent one (see the
+    notes at the top of this file).
+Parameters:
+    I/O Query query                 query from compileQuery
+    I   CustomerSet customerSet     customer set the query was compiled
+                                    against, or NULL if it was compiled
+                                    without one.  It tells which traits
+                                    are single-valued.
+    I/O Arena arena                 arena for the work areas
+Returns:
+    FALSE or TRUE if the query has that result for every customer, and
+    SIMPLE_VARIES otherwise.
+Notes:
+    - The query must not already be optimized; an optimized query is left
+      as it is.  Run optimizeQuery afterwards.
+    - The simplified query never has more instructions than the original,
+      so instrM is not reallocated.
+**************************************************************************/
+int simplifyQuery(Query query, CustomerSet customerSet, Arena arena)
+{
+    SimplifyState state;
+    SimpleNode *pNode;
+    Instr constant;
+    int iCount = query->iInstrCount;
+    int *iStackM;
+    int iTop = 0;
+    int iDepth;
+    int i;
+
+    if (iCount == 0)
+        return SIMPLE_VARIES;
+    for (i = 0; i < iCount; i++)
+    {
+        if (query->instrM[i].iOp == OP_JUMP_FALSE || query->instrM[i].iOp == OP_JUMP_TRUE)
+            return SIMPLE_VARIES;
+    }
+
+    state.arena = arena;
+    state.customerSet = customerSet;
+    state.instrM = arenaAlloc(arena, iCount * sizeof(Instr));
+    state.iLeftM = arenaAlloc(arena, iCount * sizeof(int));
+    state.iRightM = arenaAlloc(arena, iCount * sizeof(int));
+    state.iParentM = arenaAlloc(arena, iCount * sizeof(int));
+    state.iPendingM = arenaAlloc(arena, (iCount + 1) * sizeof(int));
+    state.operandM = arenaAlloc(arena, iCount * sizeof(ChainOperand));
+    state.comparisonM = arenaAlloc(arena, iCount * sizeof(Instr));
+    state.nodeM = arenaAlloc(arena, iCount * sizeof(SimpleNode));
+    iStackM = arenaAlloc(arena, iCount * sizeof(int));
+    memcpy(state.instrM, query->instrM, iCount * sizeof(Instr));
+
+    // build the expression tree
+    for (i = 0; i < iCount; i++)
+    {
+        state.iLeftM[i] = state.iRightM[i] = state.iParentM[i] = -1;
+        if (state.instrM[i].iOp == OP_AND || state.instrM[i].iOp == OP_OR)
+        {
+            state.iRightM[i] = iStackM[--iTop];
+            state.iLeftM[i] = iStackM[--iTop];
+            state.iParentM[state.iLeftM[i]] = state.iParentM[state.iRightM[i]] = i;
+        }
+        iStackM[iTop++] = i;
+    }
+
+    // simplify each comparison and each chain, operands first
+    for (i = 0; i < iCount; i++)
+    {
+        pNode = &state.nodeM[i];
+        switch (state.instrM[i].iOp)
+        {
+            case OP_AND:
+            case OP_OR:
+                if (state.iParentM[i] < 0
+                    || state.instrM[state.iParentM[i]].iOp != state.instrM[i].iOp)
+                    simplifyChain(&state, i);
+                break;
+            default:
+                pNode->iResult = SIMPLE_VARIES;
+                if (state.instrM[i].iValue < 0)
+                    pNode->iResult = state.instrM[i].iOp == OP_NOTANY;
+                pNode->iInstrCount = 1;
+                pNode->instrM = &state.instrM[i];
+                pNode->uiHash = hashInstrs(pNode->instrM, 1);
+        }
+    }
+
+    pNode = &state.nodeM[iCount - 1];
+    if (pNode->iResult != SIMPLE_VARIES)
+    {
+        constant.iOp = pNode->iResult ? OP_NOTANY : OP_EQUAL;
+        constant.iTrait = -1;
+        constant.iValue = -1;
+        query->instrM[0] = constant;
+        query->iInstrCount = 1;
+        query->iMaxDepth = 1;
+        return pNode->iResult;
+    }
+    memcpy(query->instrM, pNode->instrM, pNode->iInstrCount * sizeof(Instr));
+    query->iInstrCount = pNode->iInstrCount;
+    query->iMaxDepth = 1;
+    iDepth = 0;
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        if (query->instrM[i].iOp == OP_AND || query->instrM[i].iOp == OP_OR)
+            iDepth--;
+        else
+            iDepth++;
+        if (iDepth > query->iMaxDepth)
+            query->iMaxDepth = iDepth;
+    }
+    return SIMPLE_VARIES;
+}
@@ -0,0 +1,649 @@
+/**********************************************************************************
+Program cs2123p1Standing.c by Timothy Hennessy
+Purpose:
+    Keeps standing queries (customer segments) up to date as customer
+    records change.  An update only evaluates the queries that compare a
+    trait and value it changed, and only for the updated customer.
+Command Parameters:
+    n/a
+Input:
+    Queries as converted by convertToPostFix, and updates in the form
+        TRAIT=VALUE [TRAIT=VALUE ...]
+    Every value given for a trait replaces all of the customer's values
+    for that trait.  TRAIT= removes the trait from the customer.  For
+    example, for a customer with
+        SMOKING=Y EXERCISE=HIKE EXERCISE=BIKE
+    the update
+        SMOKING=N EXERCISE=SWIM
+    gives
+        SMOKING=N EXERCISE=SWIM
+Results:
+    updateStandingCustomer reports, as StandingEvents, each standing query
+    the customer enters or leaves.
+Returns:
+    n/a
+Notes:
+    1. Traits and values are kept as symbol ids (see internSymbol), so a
+       value first seen in an update needs no dictionary and no query
+       has to be compiled again.
+    2. The keys of the index are the (trait, value) pairs of the
+       comparisons.  Only a comparison on a trait whose set of values
+       changed, naming one of its old or new values, can change its
+       result:
+           TRAIT = V and TRAIT NOTANY V change when V is added or removed
+           TRAIT ONLY V changes when the set was or becomes just {V}
+       So an update marks the queries of the keys (T, V) for every old
+       and new value V of each trait T it changes.
+    3. A marked query is evaluated for the customer before and after the
+       update and an event is made when the results differ.
+    4. Standing queries are not optimized; they contain no jumps.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Eval.h"
+
+/******************** growArray **************************************
+void *growArray(void *pArray, int *piMax, int iNeeded, size_t iElemSize)
+Purpose:
+    Makes sure a dynamically allocated array has room for iNeeded
+    elements, doubling its size when it does not.
+Parameters:
+    I   void *pArray            array to grow (may be NULL)
+    I/O int *piMax              allocated number of elements
+    I   int iNeeded             number of elements required
+    I   size_t iElemSize        size of one element
+Returns:
+    Pointer to the (possibly moved) array.
+**************************************************************************/
+static void *growArray(void *pArray, int *piMax, int iNeeded, size_t iElemSize)
+{
+    int iNewMax;
+    if (iNeeded <= *piMax)
+        return pArray;
+    iNewMax = *piMax > 0 ? *piMax * 2 : 16;
+    while (iNewMax < iNeeded)
+        iNewMax *= 2;
+    pArray = realloc(pArray, iNewMax * iElemSize);
+    if (pArray == NULL)
+        ErrExit(ERR_CUSTOMER_DATA
+        , "Unable to allocate %d standing query entries", iNewMax);
+    *piMax = iNewMax;
+    return pArray;
+}
+
+/******************** addPair **************************************
+void addPair(CustomerRecord *pRecord, int iTrait, int iValue)
+Purpose:
+    Adds a trait value to a customer record unless it is already there.
+Parameters:
+    I/O CustomerRecord *pRecord     record to add to
+    I   int iTrait                  trait symbol
+    I   int iValue                  value symbol
+Returns:
+    n/a
+**************************************************************************/
+static void addPair(CustomerRecord *pRecord, int iTrait, int iValue)
+{
+    int i;
+
+    for (i = 0; i < pRecord->iPairCount; i++)
+    {
+        if (pRecord->iPairM[2 * i] == iTrait && pRecord->iPairM[2 * i + 1] == iValue)
+            return;
+    }
+    pRecord->iPairM = growArray(pRecord->iPairM, &pRecord->iPairMax
+        , pRecord->iPairCount + 1, 2 * sizeof(int));
+    pRecord->iPairM[2 * pRecord->iPairCount] = iTrait;
+    pRecord->iPairM[2 * pRecord->iPairCount + 1] = iValue;
+    pRecord->iPairCount++;
+}
+
+/******************** hasPair **************************************
+int hasPair(CustomerRecord *pRecord, int iTrait, int iValue, int *piCount)
+Purpose:
+    Determines whether a customer record has a value for a trait.
+Parameters:
+    I   CustomerRecord *pRecord     record to search
+    I   int iTrait                  trait symbol
+    I   int iValue                  value symbol
+    O   int *piCount                number of values the record has for
+                                    the trait
+Returns:
+    TRUE if the record has the value.
+**************************************************************************/
+static int hasPair(CustomerRecord *pRecord, int iTrait, int iValue, int *piCount)
+{
+    int bFound = FALSE;
+    int i;
+
+    *piCount = 0;
+    for (i = 0; i < pRecord->iPairCount; i++)
+    {
+        if (pRecord->iPairM[2 * i] == iTrait)
+        {
+            (*piCount)++;
+            if (pRecord->iPairM[2 * i + 1] == iValue)
+                bFound = TRUE;
+        }
+    }
+    return bFound;
+}
+
+/******************** newStandingSet **************************************
+StandingSet newStandingSet(CustomerSet customerSet)
+Purpose:
+    Creates a standing set with no queries, holding a copy of the
+    customers of a customer set.
+Parameters:
+    I   CustomerSet customerSet     customers the queries are evaluated on
+Returns:
+    The new standing set.  Use freeStandingSet to free it.
+Notes:
+    - Each trait and value is interned once, not once per customer.
+**************************************************************************/
+StandingSet newStandingSet(CustomerSet customerSet)
+{
+    StandingSet set = calloc(1, sizeof(StandingSetImp));
+    TraitColumn *pColumn;
+    int *iSymbolM;
+    int iTraitSymbol;
+    int iTrait;
+    int iCustomer;
+    int i;
+
+    if (set == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a standing set");
+    set->iCustomerCount = customerSet->iCustomerCount;
+    set->recordM = calloc(set->iCustomerCount + 1, sizeof(CustomerRecord));
+    if (set->recordM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d customer records"
+            , set->iCustomerCount);
+    for (iTrait = 0; iTrait < customerSet->iTraitCount; iTrait++)
+    {
+        pColumn = &customerSet->traitM[iTrait];
+        iTraitSymbol = internSymbol(pColumn->szTrait, strlen(pColumn->szTrait));
+        iSymbolM = malloc((pColumn->iValueCount + 1) * sizeof(int));
+        if (iSymbolM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d values", pColumn->iValueCount);
+        for (i = 0; i < pColumn->iValueCount; i++)
+            iSymbolM[i] = internSymbol(pColumn->szValueM[i], strlen(pColumn->szValueM[i]));
+        for (iCustomer = 0; iCustomer < set->iCustomerCount; iCustomer++)
+        {
+            for (i = pColumn->iOffsetM[iCustomer]; i < pColumn->iOffsetM[iCustomer + 1]; i++)
+                addPair(&set->recordM[iCustomer], iTraitSymbol
+                    , iSymbolM[pColumn->iValueIdM[i]]);
+        }
+        free(iSymbolM);
+    }
+
+    set->iHashSize = STANDING_HASH_SIZE;
+    set->iKeyTraitM = malloc(set->iHashSize * sizeof(int));
+    set->iKeyValueM = malloc(set->iHashSize * sizeof(int));
+    set->iFirstRefM = malloc(set->iHashSize * sizeof(int));
+    if (set->iKeyTraitM == NULL || set->iKeyValueM == NULL || set->iFirstRefM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a standing query index");
+    memset(set->iFirstRefM, -1, set->iHashSize * sizeof(int));
+    set->bUseIndex = TRUE;
+    return set;
+}
+
+/******************** findKey **************************************
+int findKey(StandingSet set, int iTrait, int iValue)
+Purpose:
+    Finds the slot of a (trait, value) key in the index.
+Parameters:
+    I   StandingSet set             standing set
+    I   int iTrait                  trait symbol
+    I   int iValue                  value symbol
+Returns:
+    The slot holding the key, or the empty slot where it would be added.
+Notes:
+    - The hash table uses open addressing with linear probing.
+**************************************************************************/
+static int findKey(StandingSet set, int iTrait, int iValue)
+{
+    unsigned int uHash = 2166136261u;
+    int iSlot;
+
+    uHash = (uHash ^ (unsigned int) iTrait) * 16777619u;
+    uHash = (uHash ^ (unsigned int) iValue) * 16777619u;
+    iSlot = uHash & (set->iHashSize - 1);
+    while (set->iFirstRefM[iSlot] >= 0
+        && (set->iKeyTraitM[iSlot] != iTrait || set->iKeyValueM[iSlot] != iValue))
+        iSlot = (iSlot + 1) & (set->iHashSize - 1);
+    return iSlot;
+}
+
+/******************** growKeyHash **************************************
+void growKeyHash(StandingSet set)
+Purpose:
+    Doubles the size of the index's hash table.
+Parameters:
+    I/O StandingSet set             set whose table is half full
+Returns:
+    n/a
+**************************************************************************/
+static void growKeyHash(StandingSet set)
+{
+    int *iOldTraitM = set->iKeyTraitM;
+    int *iOldValueM = set->iKeyValueM;
+    int *iOldFirstM = set->iFirstRefM;
+    int iOldSize = set->iHashSize;
+    int iSlot;
+    int i;
+
+    set->iHashSize *= 2;
+    set->iKeyTraitM = malloc(set->iHashSize * sizeof(int));
+    set->iKeyValueM = malloc(set->iHashSize * sizeof(int));
+    set->iFirstRefM = malloc(set->iHashSize * sizeof(int));
+    if (set->iKeyTraitM == NULL || set->iKeyValueM == NULL || set->iFirstRefM == NULL)
+        ErrExit(ERR_CUSTOMER_DATA, "Unable to grow a standing query index");
+    memset(set->iFirstRefM, -1, set->iHashSize * sizeof(int));
+    for (i = 0; i < iOldSize; i++)
+    {
+        if (iOldFirstM[i] < 0)
+            continue;
+        iSlot = findKey(set, iOldTraitM[i], iOldValueM[i]);
+        set->iKeyTraitM[iSlot] = iOldTraitM[i];
+        set->iKeyValueM[iSlot] = iOldValueM[i];
+        set->iFirstRefM[iSlot] = iOldFirstM[i];
+    }
+    free(iOldTraitM);
+    free(iOldValueM);
+    free(iOldFirstM);
+}
+
+/******************** addStandingQuery **************************************
+int addStandingQuery(StandingSet set, Out out, Query query)
+Purpose:
+    Registers a converted query as a standing query.
+Parameters:
+    I/O StandingSet set             standing set to add to
+    I/O Out out                     postfix expression from convertToPostFix
+    I/O Query query                 work area for compileQuery
+Returns:
+    The standing query id (0 is the first), or -1 if the postfix is not
+    a valid query (compileQuery returns WARN_INVALID_QUERY).
+Notes:
+    - The query is added to the list of each of its comparison's keys,
+      once even if it compares the same key twice.
+**************************************************************************/
+int addStandingQuery(StandingSet set, Out out, Query query)
+{
+    StandingQuery *pQuery;
+    Instr *pInstr;
+    int iQuery = set->iQueryCount;
+    int iQueryMax = set->iQueryMax;
+    int iSlot;
+    int i;
+
+    if (compileQuery(out, NULL, query) != 0)
+        return -1;
+
+    set->queryM = growArray(set->queryM, &set->iQueryMax, iQuery + 1
+        , sizeof(StandingQuery));
+    if (set->iQueryMax != iQueryMax)
+    {
+        set->iMarkM = realloc(set->iMarkM, set->iQueryMax * sizeof(int));
+        set->iAffectedM = realloc(set->iAffectedM, set->iQueryMax * sizeof(int));
+        set->bBeforeM = realloc(set->bBeforeM, set->iQueryMax * sizeof(int));
+        if (set->iMarkM == NULL || set->iAffectedM == NULL || set->bBeforeM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate %d standing queries"
+                , set->iQueryMax);
+    }
+    set->instrM = growArray(set->instrM, &set->iInstrMax
+        , set->iInstrCount + query->iInstrCount, sizeof(Instr));
+    set->bStackM = growArray(set->bStackM, &set->iStackMax, query->iMaxDepth, sizeof(int));
+
+    pQuery = &set->queryM[iQuery];
+    pQuery->iFirstInstr = set->iInstrCount;
+    pQuery->iInstrCount = query->iInstrCount;
+    pQuery->iMaxDepth = query->iMaxDepth;
+    memcpy(set->instrM + set->iInstrCount, query->instrM, query->iInstrCount * sizeof(Instr));
+    set->iInstrCount += query->iInstrCount;
+    set->iMarkM[iQuery] = set->iMark;
+    set->iQueryCount++;
+
+    for (i = 0; i < query->iInstrCount; i++)
+    {
+        pInstr = &query->instrM[i];
+        if (pInstr->iOp == OP_AND || pInstr->iOp == OP_OR)
+            continue;
+        iSlot = findKey(set, pInstr->iTrait, pInstr->iValue);
+        if (set->iFirstRefM[iSlot] >= 0 && set->iRefQueryM[set->iFirstRefM[iSlot]] == iQuery)
+            continue;           // the query already compares this key
+        set->iRefQueryM = growArray(set->iRefQueryM, &set->iRefMax, set->iRefCount + 1
+            , sizeof(int));
+        set->iRefNextM = realloc(set->iRefNextM, set->iRefMax * sizeof(int));
+        if (set->iRefNextM == NULL)
+            ErrExit(ERR_CUSTOMER_DATA, "Unable to allocate a standing query index");
+        if (set->iFirstRefM[iSlot] < 0)
+        {
+            set->iKeyTraitM[iSlot] = pInstr->iTrait;
+            set->iKeyValueM[iSlot] = pInstr->iValue;
+            set->iKeyCount++;
+        }
+        set->iRefQueryM[set->iRefCount] = iQuery;
+        set->iRefNextM[set->iRefCount] = set->iFirstRefM[iSlot];
+        set->iFirstRefM[iSlot] = set->iRefCount++;
+        if (2 * set->iKeyCount > set->iHashSize)
+            growKeyHash(set);
+    }
+    return iQuery;
+}
+
+/******************** evaluateRecord **************************************
+int evaluateRecord(Instr *instrM, int iInstrCount, CustomerRecord *pRecord
+    , int *bStackM)
+Purpose:
+    Determines whether a customer record satisfies a query compiled with
+    a NULL customer set.
+Parameters:
+    I   Instr *instrM               instructions of the query (no jumps)
+    I   int iInstrCount             number of instructions
+    I   CustomerRecord *pRecord     customer record
+    I/O int *bStackM                evaluation stack with room for the
+                                    query's iMaxDepth entries
+Returns:
+    TRUE if the record matches.
+**************************************************************************/
+int evaluateRecord(Instr *instrM, int iInstrCount, CustomerRecord *pRecord
+    , int *bStackM)
+{
+    Instr *pInstr = instrM;
+    int iTop = 0;
+    int bFound;
+    int iCount;
+    int i;
+
+    for (i = 0; i < iInstrCount; i++, pInstr++)
+    {
+        switch (pInstr->iOp)
+        {
+            case OP_AND:
+                iTop--;
+                bStackM[iTop - 1] = bStackM[iTop - 1] && bStackM[iTop];
+                break;
+            case OP_OR:
+                iTop--;
+                bStackM[iTop - 1] = bStackM[iTop - 1] || bStackM[iTop];
+                break;
+            default:
+                bFound = hasPair(pRecord, pInstr->iTrait, pInstr->iValue, &iCount);
+                if (pInstr->iOp == OP_NOTANY)
+                    bStackM[iTop++] = !bFound;
+                else if (pInstr->iOp == OP_ONLY)
+                    bStackM[iTop++] = bFound && iCount == 1;
+                else
+                    bStackM[iTop++] = bFound;
+        }
+    }
+    return bStackM[0];
+}
+
+/******************** evaluateStanding **************************************
+int evaluateStanding(StandingSet set, int iQuery, CustomerRecord *pRecord)
+Purpose:
+    Determines whether a customer record satisfies a standing query.
+Parameters:
+    I/O StandingSet set             standing set (its bStackM is used)
+    I   int iQuery                  standing query id
+    I   CustomerRecord *pRecord     customer record
+Returns:
+    TRUE if the record matches.
+**************************************************************************/
+static int evaluateStanding(StandingSet set, int iQuery, CustomerRecord *pRecord)
+{
+    StandingQuery *pQuery = &set->queryM[iQuery];
+    return evaluateRecord(set->instrM + pQuery->iFirstInstr, pQuery->iInstrCount
+        , pRecord, set->bStackM);
+}
+
+/******************** markKey **************************************
+void markKey(StandingSet set, int iTrait, int iValue)
+Purpose:
+    Adds the queries comparing a (trait, value) key to the queries the
+    current update may change.
+Parameters:
+    I/O StandingSet set             standing set
+    I   int iTrait                  trait symbol
+    I   int iValue                  value symbol
+Returns:
+    n/a
+**************************************************************************/
+static void markKey(StandingSet set, int iTrait, int iValue)
+{
+    int iRef = set->iFirstRefM[findKey(set, iTrait, iValue)];
+    int iQuery;
+
+    for (; iRef >= 0; iRef = set->iRefNextM[iRef])
+    {
+        iQuery = set->iRefQueryM[iRef];
+        if (set->iMarkM[iQuery] == set->iMark)
+            continue;
+        set->iMarkM[iQuery] = set->iMark;
+        set->iAffectedM[set->iAffectedCount++] = iQuery;
+    }
+}
+
+/******************** parseUpdate **************************************
+void parseUpdate(StandingSet set, int iCustomer, char *pszFields)
+Purpose:
+    Parses the fields of an update into set->update.
+Parameters:
+    I/O StandingSet set             standing set
+    I   int iCustomer               subscript of the customer (for messages)
+    I   char *pszFields             TRAIT=VALUE fields separated by white space
+Returns:
+    n/a
+Notes:
+    - A field TRAIT= is stored with a value of -1.
+**************************************************************************/
+static void parseUpdate(StandingSet set, int iCustomer, char *pszFields)
+{
+    char *pszRemainingText;
+    char *pszToken;
+    char *pszEqual;
+    int iTokenLength;
+    int iTraitLength;
+
+    set->update.iPairCount = 0;
+    pszRemainingText = getTokenView(pszFields, &pszToken, &iTokenLength);
+    while (pszRemainingText != NULL)
+    {
+        pszEqual = memchr(pszToken, '=', iTokenLength);
+        if (pszEqual == NULL || pszEqual == pszToken)
+            ErrExit(ERR_CUSTOMER_DATA, "Update of customer %d has a malformed field '%.*s'"
+                , iCustomer + 1, iTokenLength, pszToken);
+        iTraitLength = (int) (pszEqual - pszToken);
+        set->update.iPairM = growArray(set->update.iPairM, &set->update.iPairMax
+            , set->update.iPairCount + 1, 2 * sizeof(int));
+        set->update.iPairM[2 * set->update.iPairCount] = internSymbol(pszToken, iTraitLength);
+        set->update.iPairM[2 * set->update.iPairCount + 1] = iTraitLength + 1 < iTokenLength
+            ? internSymbol(pszEqual + 1, iTokenLength - iTraitLength - 1) : -1;
+        set->update.iPairCount++;
+        pszRemainingText = getTokenView(pszRemainingText, &pszToken, &iTokenLength);
+    }
+}
+
+/******************** markTrait **************************************
+void markTrait(StandingSet set, CustomerRecord *pRecord, int iTrait)
+Purpose:
+    Marks the queries an update of one trait may change.
+Parameters:
+    I/O StandingSet set             standing set; set->update holds the update
+    I   CustomerRecord *pRecord     record before the update
+    I   int iTrait                  trait symbol changed by the update
+Returns:
+    n/a
+Notes:
+    - Nothing is marked if the trait keeps the same set of values.
+      Otherwise every old and new value is marked (see note 2 above).
+**************************************************************************/
+static void markTrait(StandingSet set, CustomerRecord *pRecord, int iTrait)
+{
+    CustomerRecord *pUpdate = &set->update;
+    int bSame = TRUE;
+    int iValue;
+    int iOldCount;
+    int iNewCount = 0;
+    int i;
+    int j;
+
+    // the set is the same if it has as many values and each new one is old
+    hasPair(pRecord, iTrait, -1, &iOldCount);
+    for (i = 0; i < pUpdate->iPairCount; i++)
+    {
+        iValue = pUpdate->iPairM[2 * i + 1];
+        if (pUpdate->iPairM[2 * i] != iTrait || iValue < 0)
+            continue;
+        for (j = 0; j < i; j++)
+        {
+            if (pUpdate->iPairM[2 * j] == iTrait && pUpdate->iPairM[2 * j + 1] == iValue)
+                break;
+        }
+        if (j < i)
+            continue;           // value given twice
+        iNewCount++;
+        if (!hasPair(pRecord, iTrait, iValue, &iOldCount))
+            bSame = FALSE;
+    }
+    if (bSame && iNewCount == iOldCount)
+        return;
+
+    for (i = 0; i < pRecord->iPairCount; i++)
+    {
+        if (pRecord->iPairM[2 * i] == iTrait)
+            markKey(set, iTrait, pRecord->iPairM[2 * i + 1]);
+    }
+    for (i = 0; i < pUpdate->iPairCount; i++)
+    {
+        if (pUpdate->iPairM[2 * i] == iTrait && pUpdate->iPairM[2 * i + 1] >= 0)
+            markKey(set, iTrait, pUpdate->iPairM[2 * i + 1]);
+    }
+}
+
+/******************** updateStandingCustomer **************************************
+int updateStandingCustomer(StandingSet set, int iCustomer, char *pszFields)
+Purpose:
+    Changes some of a customer's traits and finds the standing queries
+    the customer enters or leaves.
+Parameters:
+    I/O StandingSet set             standing set
+    I   int iCustomer               subscript of the customer (0 is first)
+    I   char *pszFields             TRAIT=VALUE fields separated by white
+                                    space (see the Input notes above)
+Returns:
+    The number of events, which are in set->eventM until the next update.
+Notes:
+    - With set->bUseIndex FALSE every query is evaluated, which gives the
+      same events; it is used to measure what the index saves.
+**************************************************************************/
+int updateStandingCustomer(StandingSet set, int iCustomer, char *pszFields)
+{
+    CustomerRecord *pRecord;
+    CustomerRecord *pUpdate = &set->update;
+    int iTrait;
+    int iCount;
+    int bAfter;
+    int i;
+    int j;
+
+    if (iCustomer < 0 || iCustomer >= set->iCustomerCount)
+        ErrExit(ERR_CUSTOMER_DATA, "Update of customer %d, but there are %d customers"
+            , iCustomer + 1, set->iCustomerCount);
+    pRecord = &set->recordM[iCustomer];
+    parseUpdate(set, iCustomer, pszFields);
+
+    // find the queries the update may change
+    set->iMark++;
+    set->iAffectedCount = 0;
+    if (set->bUseIndex)
+    {
+        for (i = 0; i < pUpdate->iPairCount; i++)
+        {
+            iTrait = pUpdate->iPairM[2 * i];
+            for (j = 0; j < i && pUpdate->iPairM[2 * j] != iTrait; j++)
+                ;
+            if (j == i)         // first field of the trait
+                markTrait(set, pRecord, iTrait);
+        }
+    }
+    else
+    {
+        for (i = 0; i < set->iQueryCount; i++)
+            set->iAffectedM[set->iAffectedCount++] = i;
+    }
+    for (i = 0; i < set->iAffectedCount; i++)
+        set->bBeforeM[i] = evaluateStanding(set, set->iAffectedM[i], pRecord);
+
+    // remove the values of the updated traits, then add the new values
+    for (i = 0, j = 0; i < pRecord->iPairCount; i++)
+    {
+        hasPair(pUpdate, pRecord->iPairM[2 * i], -2, &iCount);
+        if (iCount > 0)
+            continue;           // a trait being updated
+        pRecord->iPairM[2 * j] = pRecord->iPairM[2 * i];
+        pRecord->iPairM[2 * j + 1] = pRecord->iPairM[2 * i + 1];
+        j++;
+    }
+    pRecord->iPairCount = j;
+    for (i = 0; i < pUpdate->iPairCount; i++)
+    {
+        if (pUpdate->iPairM[2 * i + 1] >= 0)
+            addPair(pRecord, pUpdate->iPairM[2 * i], pUpdate->iPairM[2 * i + 1]);
+    }
+
+    // report the queries whose result changed
+    set->iEventCount = 0;
+    for (i = 0; i < set->iAffectedCount; i++)
+    {
+        bAfter = evaluateStanding(set, set->iAffectedM[i], pRecord);
+        if (bAfter == set->bBeforeM[i])
+            continue;
+        set->eventM = growArray(set->eventM, &set->iEventMax, set->iEventCount + 1
+            , sizeof(StandingEvent));
+        set->eventM[set->iEventCount].iQuery = set->iAffectedM[i];
+        set->eventM[set->iEventCount].iCustomer = iCustomer;
+        set->eventM[set->iEventCount].bEnter = bAfter;
+        set->iEventCount++;
+    }
+    set->lEvaluations += 2 * set->iAffectedCount;
+    return set->iEventCount;
+}
+
+/******************** freeStandingSet **************************************
+void freeStandingSet(StandingSet set)
+Purpose:
+    Frees a standing set.
+Parameters:
+    I/O StandingSet set             set to free
+Returns:
+    n/a
+**************************************************************************/
+void freeStandingSet(StandingSet set)
+{
+    int i;
+
+    for (i = 0; i < set->iCustomerCount; i++)
+        free(set->recordM[i].iPairM);
+    free(set->recordM);
+    free(set->update.iPairM);
+    free(set->queryM);
+    free(set->instrM);
+    free(set->iKeyTraitM);
+    free(set->iKeyValueM);
+    free(set->iFirstRefM);
+    free(set->iRefQueryM);
+    free(set->iRefNextM);
+    free(set->iMarkM);
+    free(set->iAffectedM);
+    free(set->bBeforeM);
+    free(set->eventM);
+    free(set->bStackM);
+    free(set);
+}
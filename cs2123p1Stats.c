@@ -0,0 +1,412 @@
+/**********************************************************************************
+Program cs2123p1Stats.c by Timothy Hennessy
+Purpose:
+    Optional instrumentation of the conversion hot path: phase latency
+    histograms, Out length distribution, deepest stack and return code
+    counts.  See cs2123p1Stats.h for the STATS_ macros.
+Command Parameters:
+    n/a
+Input:
+    n/a
+Results:
+    statsDump writes, as text or as one JSON object, for each phase the
+    number of times it was timed, its total time and its mean, p50, p99,
+    p999 and maximum latency in nanoseconds.  Then it writes the same
+    figures for the Out length, the deepest stack and the return codes.
+Returns:
+    n/a
+Notes:
+    1. Everything in this file is compiled only with -DCS2123P1_STATS.
+    2. Latencies are measured in ticks of the time stamp counter on x86
+       compilers supporting __rdtsc, and in nanoseconds elsewhere.  Ticks
+       are converted to nanoseconds by comparing the counter with
+       CLOCK_MONOTONIC between statsInit and the dump.
+    3. SIGUSR1 requests a dump.  The signal handler only sets a flag; the
+       dump is written by the next statsPoll, which the driver calls
+       for every query.
+    4. A dump taken while other threads are converting may be off by the
+       queries being counted at that moment.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs2123p1.h"
+#include "cs2123p1Stats.h"
+
+#ifdef CS2123P1_STATS
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+__thread ThreadStats *pMyStats = NULL;          // counters of this thread
+static ThreadStats *pStatsList = NULL;          // counters of every thread
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t bDumpRequested = FALSE;
+static int iStatsFormat = FORMAT_TEXT;          // FORMAT_TEXT or FORMAT_JSON
+static unsigned long long ullStartTicks;
+static struct timespec startTime;
+
+// names of the phases in the dump
+static char *pszPhaseNameM[STATS_PHASES] =
+{
+    "read", "convert", "tokenize", "categorize", "stack", "evaluate"
+    , "format", "query"
+};
+
+/******************** statsTicks **************************************
+unsigned long long statsTicks()
+Purpose:
+    Returns the current time in ticks.
+**************************************************************************/
+unsigned long long statsTicks()
+{
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+/******************** statsThread **************************************
+ThreadStats *statsThread()
+Purpose:
+    Returns the counters of the calling thread, creating them the first
+    time.
+Notes:
+    - STATS_THREAD calls this only until the thread has counters.
+**************************************************************************/
+ThreadStats *statsThread()
+{
+    if (pMyStats != NULL)
+        return pMyStats;
+    pMyStats = calloc(1, sizeof(ThreadStats));
+    if (pMyStats == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate statistics");
+    pthread_mutex_lock(&statsLock);
+    pMyStats->pNext = pStatsList;
+    pStatsList = pMyStats;
+    pthread_mutex_unlock(&statsLock);
+    return pMyStats;
+}
+
+/******************** bucketOf **************************************
+int bucketOf(unsigned long long ullValue)
+Purpose:
+    Returns the histogram bucket of a value.
+**************************************************************************/
+static int bucketOf(unsigned long long ullValue)
+{
+    int iExponent;
+    if (ullValue < 8)
+        return (int) ullValue;
+    iExponent = 63 - __builtin_clzll(ullValue);
+    return (iExponent - 2) * 8 + (int) ((ullValue >> (iExponent - 3)) & 7);
+}
+
+/******************** bucketValue **************************************
+unsigned long long bucketValue(int iBucket)
+Purpose:
+    Returns the largest value counted in a histogram bucket.
+**************************************************************************/
+static unsigned long long bucketValue(int iBucket)
+{
+    int iExponent;
+    if (iBucket < 8)
+        return iBucket;
+    iExponent = iBucket / 8 + 2;
+    return ((unsigned long long) (8 + iBucket % 8 + 1) << (iExponent - 3)) - 1;
+}
+
+/******************** statsAdd **************************************
+void statsAdd(Histogram *pHistogram, unsigned long long ullValue)
+Purpose:
+    Counts a value in a histogram.
+**************************************************************************/
+void statsAdd(Histogram *pHistogram, unsigned long long ullValue)
+{
+    pHistogram->lCount++;
+    pHistogram->ullTotal += ullValue;
+    if (ullValue > pHistogram->ullMax)
+        pHistogram->ullMax = ullValue;
+    pHistogram->lBucketM[bucketOf(ullValue)]++;
+}
+
+/******************** statsQueryDone **************************************
+void statsQueryDone(int rc, int iOutCount)
+Purpose:
+    Counts the query, its return code and its Out length.
+**************************************************************************/
+void statsQueryDone(int rc, int iOutCount)
+{
+    ThreadStats *pStats = STATS_THREAD();
+    pStats->iQueryCount++;
+    switch (rc)
+    {
+        case 0:
+            pStats->lRcCountM[0]++;
+            break;
+        case WARN_MISSING_RPAREN:
+            pStats->lRcCountM[1]++;
+            break;
+        case WARN_MISSING_LPAREN:
+            pStats->lRcCountM[2]++;
+            break;
+        default:
+            pStats->lRcCountM[3]++;
+    }
+    statsAdd(&pStats->outLength, iOutCount);
+}
+
+/******************** statsSamplePhases **************************************
+void statsSamplePhases(char *pszInfix, unsigned long long ullConvertTicks)
+Purpose:
+    Splits the conversion time of a sampled query into TOKENIZE,
+    CATEGORIZE and STACK.  The query is tokenized, and then tokenized,
+    interned and categorized, again; each pass is timed as a whole.
+Parameters:
+    I   char *pszInfix                  the query that was converted
+    I   unsigned long long ullConvertTicks  ticks its conversion took
+Notes:
+    1. CATEGORIZE is the second pass less the first, and STACK is the
+       conversion less the second pass, so the three phases add up to the
+       conversion time.  Negative differences, which noise can cause on
+       short queries, are counted as 0.
+    2. The symbols were interned by the conversion, so the second pass
+       finds them all; the cost of adding a new symbol counts as STACK.
+**************************************************************************/
+void statsSamplePhases(char *pszInfix, unsigned long long ullConvertTicks)
+{
+    ThreadStats *pStats = STATS_THREAD();
+    char *pszRemainingText;
+    char *pszToken;
+    int iTokenLength;
+    Element element;
+    long lSink = 0;                 // keeps the passes from being optimized away
+    unsigned long long ullStart;
+    unsigned long long ullTokenized;
+    unsigned long long ullCategorized;
+    unsigned long long ullTokenize;
+    unsigned long long ullBoth;
+
+    pStats->lSampleCount++;
+    ullStart = statsTicks();
+    pszRemainingText = getTokenView(pszInfix, &pszToken, &iTokenLength);
+    while (pszRemainingText != NULL)
+    {
+        lSink += iTokenLength;
+        pszRemainingText = getTokenView(pszRemainingText, &pszToken, &iTokenLength);
+    }
+    ullTokenized = statsTicks();
+    pszRemainingText = getTokenView(pszInfix, &pszToken, &iTokenLength);
+    while (pszRemainingText != NULL)
+    {
+        element.iSymbol = internSymbol(pszToken, iTokenLength);
+        categorize(&element);
+        lSink += element.iCategory;
+        pszRemainingText = getTokenView(pszRemainingText, &pszToken, &iTokenLength);
+    }
+    ullCategorized = statsTicks();
+
+    ullTokenize = ullTokenized - ullStart;
+    ullBoth = ullCategorized - ullTokenized;
+    statsAdd(&pStats->phaseM[PHASE_TOKENIZE], ullTokenize);
+    statsAdd(&pStats->phaseM[PHASE_CATEGORIZE]
+        , ullBoth > ullTokenize ? ullBoth - ullTokenize : 0);
+    statsAdd(&pStats->phaseM[PHASE_STACK]
+        , ullConvertTicks > ullBoth ? ullConvertTicks - ullBoth : 0);
+    pStats->lSink += lSink;
+}
+
+/******************** requestDump **************************************
+void requestDump(int iSignal)
+Purpose:
+    SIGUSR1 handler.  Asks the next statsPoll for a dump.
+**************************************************************************/
+static void requestDump(int iSignal)
+{
+    (void) iSignal;
+    bDumpRequested = TRUE;
+}
+
+/******************** statsInit **************************************
+void statsInit(int iFormat)
+Purpose:
+    Starts the clock used to convert ticks and installs the SIGUSR1
+    handler.
+Parameters:
+    I   int iFormat             FORMAT_TEXT or FORMAT_JSON for the dumps
+**************************************************************************/
+void statsInit(int iFormat)
+{
+    iStatsFormat = iFormat;
+    ullStartTicks = statsTicks();
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    signal(SIGUSR1, requestDump);
+}
+
+/******************** statsPoll **************************************
+void statsPoll()
+Purpose:
+    Writes a dump to stderr if one was requested by SIGUSR1.
+**************************************************************************/
+void statsPoll()
+{
+    if (!bDumpRequested)
+        return;
+    bDumpRequested = FALSE;
+    statsDump(stderr);
+}
+
+/******************** percentile **************************************
+unsigned long long percentile(Histogram *pHistogram, double dFraction)
+Purpose:
+    Returns the value below which dFraction of the counted values are.
+**************************************************************************/
+static unsigned long long percentile(Histogram *pHistogram, double dFraction)
+{
+    long lTarget = (long) (dFraction * pHistogram->lCount);
+    long lSeen = 0;
+    int i;
+
+    for (i = 0; i < STATS_BUCKETS; i++)
+    {
+        lSeen += pHistogram->lBucketM[i];
+        if (lSeen > lTarget)
+            break;
+    }
+    if (i == STATS_BUCKETS || bucketValue(i) > pHistogram->ullMax)
+        return pHistogram->ullMax;
+    return bucketValue(i);
+}
+
+/******************** addHistogram **************************************
+void addHistogram(Histogram *pSum, Histogram *pHistogram)
+Purpose:
+    Adds the counts of one histogram to another.
+**************************************************************************/
+static void addHistogram(Histogram *pSum, Histogram *pHistogram)
+{
+    int i;
+    pSum->lCount += pHistogram->lCount;
+    pSum->ullTotal += pHistogram->ullTotal;
+    if (pHistogram->ullMax > pSum->ullMax)
+        pSum->ullMax = pHistogram->ullMax;
+    for (i = 0; i < STATS_BUCKETS; i++)
+        pSum->lBucketM[i] += pHistogram->lBucketM[i];
+}
+
+/******************** printHistogram **************************************
+void printHistogram(FILE *pFile, char *pszName, Histogram *pHistogram
+    , double dScale)
+Purpose:
+    Writes the summary of a histogram in the dump format.
+Parameters:
+    I   FILE *pFile             file to write
+    I   char *pszName           name of the histogram
+    I   Histogram *pHistogram   counts
+    I   double dScale           multiplier converting the values (ticks
+                                to nanoseconds, or 1)
+**************************************************************************/
+static void printHistogram(FILE *pFile, char *pszName, Histogram *pHistogram
+    , double dScale)
+{
+    double dMean = pHistogram->lCount > 0
+        ? (double) pHistogram->ullTotal / pHistogram->lCount : 0;
+
+    if (iStatsFormat == FORMAT_JSON)
+        fprintf(pFile, "\"%s\":{\"count\":%ld,\"total\":%.0f,\"mean\":%.1f"
+            ",\"p50\":%.0f,\"p99\":%.0f,\"p999\":%.0f,\"max\":%.0f}"
+            , pszName, pHistogram->lCount, pHistogram->ullTotal * dScale, dMean * dScale
+            , percentile(pHistogram, 0.5) * dScale, percentile(pHistogram, 0.99) * dScale
+            , percentile(pHistogram, 0.999) * dScale, pHistogram->ullMax * dScale);
+    else
+        fprintf(pFile, "%-12s %10ld %14.0f %10.1f %10.0f %10.0f %10.0f %10.0f\n"
+            , pszName, pHistogram->lCount, pHistogram->ullTotal * dScale, dMean * dScale
+            , percentile(pHistogram, 0.5) * dScale, percentile(pHistogram, 0.99) * dScale
+            , percentile(pHistogram, 0.999) * dScale, pHistogram->ullMax * dScale);
+}
+
+/******************** statsDump **************************************
+void statsDump(FILE *pFile)
+Purpose:
+    Writes the counters of every thread, added up, in the format given
+    to statsInit.
+Parameters:
+    I   FILE *pFile             file to write
+**************************************************************************/
+void statsDump(FILE *pFile)
+{
+    ThreadStats *pSum = calloc(1, sizeof(ThreadStats));
+    ThreadStats *pStats;
+    struct timespec now;
+    unsigned long long ullTicks = statsTicks() - ullStartTicks;
+    double dNsPerTick = 1.0;
+    double dNs;
+    int i;
+
+    if (pSum == NULL)
+        ErrExit(ERR_INPUT, "Unable to allocate statistics");
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    dNs = (now.tv_sec - startTime.tv_sec) * 1e9 + (now.tv_nsec - startTime.tv_nsec);
+#ifdef HAVE_RDTSC
+    if (ullTicks > 0)
+        dNsPerTick = dNs / ullTicks;
+#endif
+
+    pthread_mutex_lock(&statsLock);
+    for (pStats = pStatsList; pStats != NULL; pStats = pStats->pNext)
+    {
+        for (i = 0; i < STATS_PHASES; i++)
+            addHistogram(&pSum->phaseM[i], &pStats->phaseM[i]);
+        addHistogram(&pSum->outLength, &pStats->outLength);
+        if (pStats->iMaxStackDepth > pSum->iMaxStackDepth)
+            pSum->iMaxStackDepth = pStats->iMaxStackDepth;
+        for (i = 0; i < 4; i++)
+            pSum->lRcCountM[i] += pStats->lRcCountM[i];
+        pSum->lSampleCount += pStats->lSampleCount;
+    }
+
+    if (iStatsFormat == FORMAT_JSON)
+    {
+        fprintf(pFile, "{\"elapsed_ns\":%.0f,\"phases_ns\":{", dNs);
+        for (i = 0; i < STATS_PHASES; i++)
+        {
+            if (i > 0)
+                fprintf(pFile, ",");
+            printHistogram(pFile, pszPhaseNameM[i], &pSum->phaseM[i], dNsPerTick);
+        }
+        fprintf(pFile, "},");
+        printHistogram(pFile, "out_length", &pSum->outLength, 1.0);
+        fprintf(pFile, ",\"max_stack_depth\":%d,\"rc\":{\"0\":%ld,\"801\":%ld"
+            ",\"802\":%ld,\"other\":%ld},\"sampled_queries\":%ld}\n"
+            , pSum->iMaxStackDepth, pSum->lRcCountM[0], pSum->lRcCountM[1]
+            , pSum->lRcCountM[2], pSum->lRcCountM[3], pSum->lSampleCount);
+    }
+    else
+    {
+        fprintf(pFile, "Conversion statistics after %.3f seconds (times in ns)\n", dNs / 1e9);
+        fprintf(pFile, "%-12s %10s %14s %10s %10s %10s %10s %10s\n", "phase", "count"
+            , "total", "mean", "p50", "p99", "p999", "max");
+        for (i = 0; i < STATS_PHASES; i++)
+            printHistogram(pFile, pszPhaseNameM[i], &pSum->phaseM[i], dNsPerTick);
+        printHistogram(pFile, "out length", &pSum->outLength, 1.0);
+        fprintf(pFile, "max stack depth %d\n", pSum->iMaxStackDepth);
+        fprintf(pFile, "return codes: 0=%ld 801=%ld 802=%ld other=%ld\n"
+            , pSum->lRcCountM[0], pSum->lRcCountM[1], pSum->lRcCountM[2]
+            , pSum->lRcCountM[3]);
+        fprintf(pFile, "tokenize, categorize and stack are timed for %ld sampled queries\n"
+            , pSum->lSampleCount);
+    }
+    pthread_mutex_unlock(&statsLock);
+    fflush(pFile);
+    free(pSum);
+}
+#endif
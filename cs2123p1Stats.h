@@ -0,0 +1,142 @@
+/**********************************************************************
+cs2123p1Stats.h
+Purpose:
+   Defines constants:
+       conversion phases that are timed
+       sizes of the latency histograms
+   Defines typedef for
+       Histogram       (log-linear histogram of latencies or lengths)
+       ThreadStats     (counters of one thread)
+   Defines the STATS_ macros that instrument the hot path.
+Notes:
+   - The instrumentation is compiled only with -DCS2123P1_STATS.  Without
+     it every STATS_ macro is empty, so the hot path is unchanged.
+   - Each thread counts into its own ThreadStats, so counting takes no
+     lock.  The counters of all threads are added up when they are dumped.
+     STATS_THREAD finds them with one load of a thread local pointer.
+   - Only phase boundaries are timed.  STATS_MARK ends a phase and starts
+     the next with one reading of the clock, kept in the thread's
+     ThreadStats, so the query loop reads the clock once per phase.
+   - TOKENIZE, CATEGORIZE and STACK are interleaved token by token, so
+     they are not timed in convertToPostFix: timing each token costs
+     about as much as the work being timed, and inflates it.  Instead,
+     every STATS_SAMPLE_EVERY-th query is tokenized, and then tokenized
+     and categorized, again by statsSamplePhases, each pass timed as a
+     whole; the rest of the query's conversion time is the stack work.
+   - Include cs2123p1.h before this file.
+**********************************************************************/
+/*** constants ***/
+// timed phases
+#define PHASE_READ        0     // reading a query line
+#define PHASE_CONVERT     1     // convertToPostFix (or the query cache)
+#define PHASE_TOKENIZE    2     // getTokenView (sampled)
+#define PHASE_CATEGORIZE  3     // internSymbol and categorize (sampled)
+#define PHASE_STACK       4     // stack and out work (sampled)
+#define PHASE_EVALUATE    5     // compiling and counting the matches
+#define PHASE_FORMAT      6     // formatting the result
+#define PHASE_QUERY       7     // the whole query after it was read
+#define STATS_PHASES      8
+
+#define STATS_SAMPLE_EVERY 64   // queries per query whose phases are timed
+#define STATS_BUCKETS 512       // 8 buckets for each power of 2
+
+/*** typedef ***/
+
+// Histogram typedef counts values in log-linear buckets.  Values below 8
+// have their own bucket; above that, each power of 2 is split in 8.
+// Percentiles are therefore within 12.5% of the exact value.
+typedef struct
+{
+    long lCount;
+    unsigned long long ullTotal;
+    unsigned long long ullMax;
+    long lBucketM[STATS_BUCKETS];
+} Histogram;
+
+// ThreadStats typedef holds the counters of one thread
+typedef struct ThreadStats
+{
+    Histogram phaseM[STATS_PHASES];     // latency of each phase in ticks
+    Histogram outLength;                // elements in each query's Out
+    int iMaxStackDepth;                 // deepest conversion stack
+    long lRcCountM[4];                  // queries returning 0, 801, 802, other
+    long lSampleCount;                  // queries whose phases were timed
+    int iQueryCount;                    // queries converted by the thread
+    long lSink;                         // results of the sampling passes
+    unsigned long long ullMarkTicks;    // tick the last STATS_MARK phase ended
+    struct ThreadStats *pNext;          // next thread's counters
+} ThreadStats;
+
+/**********   prototypes ***********/
+
+#ifdef CS2123P1_STATS
+extern __thread ThreadStats *pMyStats;  // counters of this thread (NULL at first)
+
+unsigned long long statsTicks();
+ThreadStats *statsThread();
+void statsAdd(Histogram *pHistogram, unsigned long long ullValue);
+void statsQueryDone(int rc, int iOutCount);
+void statsSamplePhases(char *pszInfix, unsigned long long ullConvertTicks);
+void statsInit(int iFormat);
+void statsPoll();
+void statsDump(FILE *pFile);
+
+// the calling thread's counters
+#define STATS_THREAD() (pMyStats != NULL ? pMyStats : statsThread())
+
+// time a phase: STATS_START(t) ... STATS_STOP(PHASE_x, t)
+#define STATS_DECLARE(t) unsigned long long t = 0
+#define STATS_DECLARE_INT(i) int i = 0
+#define STATS_START(t) ((t) = statsTicks())
+#define STATS_STOP(iPhase, t) \
+    statsAdd(&STATS_THREAD()->phaseM[iPhase], statsTicks() - (t))
+
+// time consecutive phases: STATS_MARK_START() starts the first, and each
+// STATS_MARK(PHASE_x) ends one and starts the next.  STATS_MARKED(t)
+// saves the tick the current phase started, and STATS_MARK_TOTAL adds
+// the time from t to the last mark to a phase.
+#define STATS_MARK_START() (STATS_THREAD()->ullMarkTicks = statsTicks())
+#define STATS_MARK(iPhase) \
+    do { ThreadStats *pMarkStats = STATS_THREAD(); \
+        unsigned long long ullNow = statsTicks(); \
+        statsAdd(&pMarkStats->phaseM[iPhase], ullNow - pMarkStats->ullMarkTicks); \
+        pMarkStats->ullMarkTicks = ullNow; } while (0)
+#define STATS_MARKED(t) ((t) = STATS_THREAD()->ullMarkTicks)
+#define STATS_MARK_TOTAL(iPhase, t) \
+    statsAdd(&STATS_THREAD()->phaseM[iPhase], STATS_THREAD()->ullMarkTicks - (t))
+
+// after STATS_MARK(PHASE_CONVERT) ended a conversion started at tick t:
+// time the parts of every STATS_SAMPLE_EVERY-th query converted by
+// convertToPostFix itself (bDirect).  t and the mark are moved past the
+// sampling, so it is not counted in the later phases.
+#define STATS_SAMPLE_PHASES(bDirect, pszInfix, t) \
+    do { ThreadStats *pMarkStats = STATS_THREAD(); \
+        unsigned long long ullBefore = pMarkStats->ullMarkTicks; \
+        if (pMarkStats->iQueryCount % STATS_SAMPLE_EVERY == 0 && (bDirect)) { \
+            statsSamplePhases((pszInfix), ullBefore - (t)); \
+            pMarkStats->ullMarkTicks = statsTicks(); \
+            (t) += pMarkStats->ullMarkTicks - ullBefore; } } while (0)
+
+#define STATS_MAX(iMax, iValue) \
+    do { if ((iValue) > (iMax)) (iMax) = (iValue); } while (0)
+#define STATS_QUERY_DONE(rc, iOutCount) statsQueryDone((rc), (iOutCount))
+#define STATS_STACK_DEPTH(iDepth) \
+    do { ThreadStats *pStats = STATS_THREAD(); \
+        if ((iDepth) > pStats->iMaxStackDepth) pStats->iMaxStackDepth = (iDepth); \
+    } while (0)
+#define STATS_POLL() statsPoll()
+#else
+#define STATS_DECLARE(t)
+#define STATS_DECLARE_INT(i)
+#define STATS_START(t)
+#define STATS_STOP(iPhase, t)
+#define STATS_MARK_START()
+#define STATS_MARK(iPhase)
+#define STATS_MARKED(t)
+#define STATS_MARK_TOTAL(iPhase, t)
+#define STATS_SAMPLE_PHASES(bDirect, pszInfix, t)
+#define STATS_MAX(iMax, iValue)
+#define STATS_QUERY_DONE(rc, iOutCount)
+#define STATS_STACK_DEPTH(iDepth)
+#define STATS_POLL()
+#endif
@@ -0,0 +1,466 @@
+/**********************************************************************************
+Program cs2123p1Store.c by Timothy Hennessy
+Purpose:
+    Saves converted queries in a postfix file and maps the file back into
+    memory, so that a program using the same queries again does not have
+    to convert them.
+Command Parameters:
+    n/a
+Input:
+    A postfix file written by writePostfixFile (see cs2123p1Store.h for
+    its layout).
+Results:
+    getPostfixQuery gives the Out, return code and text of a query
+    exactly as convertToPostFix produced them when the file was written.
+Returns:
+    n/a
+Notes:
+    1. openPostfixFile maps the file with mmap and checks its header and
+       index.  It does not read the queries.
+    2. A query's Out points into the mapped file.  Its symbol ids must be
+       this program's symbol ids.  openPostfixFile interns the file's
+       string table in order, so in a program that has interned nothing
+       else yet, the ids are the same and the elements are used where
+       they are.  Otherwise the elements are copied once with the ids
+       translated.
+    3. The file is an array of fixed width records, so it is written in
+       the byte order and Element layout of the machine writing it.  The
+       header records both.
+    4. cs2123p1Test.sh checks that the sample queries read back from a
+       postfix file give Output.txt.
+**********************************************************************************/
+
+/* include files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cs2123p1.h"
+#include "cs2123p1Store.h"
+
+#define POSTFIX_ALIGN(l) (((l) + 7) & ~7L)
+
+/******************** growArray **************************************
+void *growArray(void *pArray, long lNeeded, long *plMax, size_t iSize)
+Purpose:
+    Makes sure an array of a postfix writer has room for lNeeded entries.
+Parameters:
+    I/O void *pArray                the array (NULL if none yet)
+    I   long lNeeded                entries needed
+    I/O long *plMax                 allocated entries
+    I   size_t iSize                size of an entry
+Returns:
+    The array, which may have moved.
+**************************************************************************/
+static void *growArray(void *pArray, long lNeeded, long *plMax, size_t iSize)
+{
+    long lNewMax = *plMax > 0 ? *plMax : 1024;
+
+    if (lNeeded <= *plMax)
+        return pArray;
+    while (lNewMax < lNeeded)
+        lNewMax *= 2;
+    pArray = realloc(pArray, lNewMax * iSize);
+    if (pArray == NULL)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to allocate %ld postfix file entries", lNewMax);
+    *plMax = lNewMax;
+    return pArray;
+}
+
+/******************** addText **************************************
+long addText(PostfixWriter writer, char *pszText, int iLength)
+Purpose:
+    Adds zero terminated text to the text of a postfix writer.
+Parameters:
+    I/O PostfixWriter writer        writer to add to
+    I   char *pszText               text (need not be zero terminated)
+    I   int iLength                 number of characters in the text
+Returns:
+    The offset of the text in the writer's text.
+**************************************************************************/
+static long addText(PostfixWriter writer, char *pszText, int iLength)
+{
+    long lOffset = writer->lTextSize;
+
+    writer->textM = growArray(writer->textM, lOffset + iLength + 1
+        , &writer->lTextMax, 1);
+    memcpy(writer->textM + lOffset, pszText, iLength);
+    writer->textM[lOffset + iLength] = '\0';
+    writer->lTextSize += iLength + 1;
+    return lOffset;
+}
+
+/******************** fileSymbol **************************************
+int fileSymbol(PostfixWriter writer, int iSymbol)
+Purpose:
+    Returns the file symbol id of a symbol, adding the symbol to the
+    writer's string table the first time.
+Parameters:
+    I/O PostfixWriter writer        writer whose string table is used
+    I   int iSymbol                 symbol id from internSymbol
+Returns:
+    The subscript of the symbol in the string table.
+**************************************************************************/
+static int fileSymbol(PostfixWriter writer, int iSymbol)
+{
+    long lOldMax = writer->lFileSymbolMax;
+    PostfixSymbol *pSymbol;
+
+    if (iSymbol >= writer->lFileSymbolMax)
+    {
+        writer->iFileSymbolM = growArray(writer->iFileSymbolM, iSymbol + 1
+            , &writer->lFileSymbolMax, sizeof(int));
+        memset(writer->iFileSymbolM + lOldMax, -1
+            , (writer->lFileSymbolMax - lOldMax) * sizeof(int));
+    }
+    if (writer->iFileSymbolM[iSymbol] >= 0)
+        return writer->iFileSymbolM[iSymbol];
+
+    writer->symbolM = growArray(writer->symbolM, writer->lSymbolCount + 1
+        , &writer->lSymbolMax, sizeof(PostfixSymbol));
+    pSymbol = &writer->symbolM[writer->lSymbolCount];
+    pSymbol->iLength = getSymbolLength(iSymbol);
+    pSymbol->iPad = 0;
+    pSymbol->lTextOffset = addText(writer, getSymbolText(iSymbol), pSymbol->iLength);
+    writer->iFileSymbolM[iSymbol] = (int) writer->lSymbolCount;
+    return (int) writer->lSymbolCount++;
+}
+
+/******************** newPostfixWriter **************************************
+PostfixWriter newPostfixWriter()
+Purpose:
+    Creates a postfix writer with no queries.
+Parameters:
+    n/a
+Returns:
+    The new writer.  Use freePostfixWriter to free it.
+Notes:
+    - The string table starts with the parentheses and operators, which
+      every program has as its first symbols, so their file ids are
+      their SYMBOL_ ids (see note 2).
+**************************************************************************/
+PostfixWriter newPostfixWriter()
+{
+    PostfixWriter writer = calloc(1, sizeof(PostfixWriterImp));
+    int iSymbol;
+
+    if (writer == NULL)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to allocate a postfix writer");
+    internSymbol("(", 1);               // the first call adds the operators
+    for (iSymbol = SYMBOL_LPAREN; iSymbol <= SYMBOL_OR; iSymbol++)
+        fileSymbol(writer, iSymbol);
+    return writer;
+}
+
+/******************** addPostfixQuery **************************************
+void addPostfixQuery(PostfixWriter writer, Out out, int rc, char *pszQuery
+    , int bNewline)
+Purpose:
+    Adds a converted query to a postfix writer.
+Parameters:
+    I/O PostfixWriter writer        writer to add to
+    I   Out out                     postfix from convertToPostFix
+    I   int rc                      return code of convertToPostFix
+    I   char *pszQuery              zero terminated query text
+    I   int bNewline                TRUE if the query line ended with a newline
+Returns:
+    n/a
+**************************************************************************/
+void addPostfixQuery(PostfixWriter writer, Out out, int rc, char *pszQuery
+    , int bNewline)
+{
+    PostfixQuery *pQuery;
+    Element *pElement;
+    int i;
+
+    writer->queryM = growArray(writer->queryM, writer->lQueryCount + 1
+        , &writer->lQueryMax, sizeof(PostfixQuery));
+    writer->elementM = growArray(writer->elementM, writer->lElementCount + out->iOutCount
+        , &writer->lElementMax, sizeof(Element));
+    pQuery = &writer->queryM[writer->lQueryCount++];
+    pQuery->iTextLength = strlen(pszQuery);
+    pQuery->lTextOffset = addText(writer, pszQuery, pQuery->iTextLength);
+    pQuery->lFirstElement = writer->lElementCount;
+    pQuery->iElementCount = out->iOutCount;
+    pQuery->rc = rc;
+    pQuery->bNewline = bNewline;
+    for (i = 0; i < out->iOutCount; i++)
+    {
+        pElement = &writer->elementM[writer->lElementCount++];
+        *pElement = out->outM[i];
+        pElement->iSymbol = fileSymbol(writer, out->outM[i].iSymbol);
+    }
+}
+
+/******************** writePart **************************************
+long writePart(FILE *pFile, void *pData, long lSize, long lOffset)
+Purpose:
+    Writes one part of a postfix file and pads it to 8 bytes.
+Parameters:
+    I   FILE *pFile                 file being written
+    I   void *pData                 bytes to write
+    I   long lSize                  number of bytes
+    I   long lOffset                offset in the file of pData
+Returns:
+    The offset of the next part.
+**************************************************************************/
+static long writePart(FILE *pFile, void *pData, long lSize, long lOffset)
+{
+    static char zeroM[8];
+    long lNext = POSTFIX_ALIGN(lOffset + lSize);
+
+    if (lSize > 0 && fwrite(pData, 1, lSize, pFile) != (size_t) lSize)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to write a postfix file");
+    if (lNext > lOffset + lSize
+        && fwrite(zeroM, 1, lNext - lOffset - lSize, pFile) != (size_t) (lNext - lOffset - lSize))
+        ErrExit(ERR_POSTFIX_FILE, "Unable to write a postfix file");
+    return lNext;
+}
+
+/******************** writePostfixFile **************************************
+void writePostfixFile(PostfixWriter writer, char *pszFileName)
+Purpose:
+    Writes the queries added to a postfix writer to a file.
+Parameters:
+    I   PostfixWriter writer        queries to write
+    I   char *pszFileName           name of the file to create
+Returns:
+    n/a
+**************************************************************************/
+void writePostfixFile(PostfixWriter writer, char *pszFileName)
+{
+    PostfixFileHeader header;
+    FILE *pFile;
+    long lOffset;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.szMagic, POSTFIX_MAGIC, sizeof(header.szMagic));
+    header.iVersion = POSTFIX_VERSION;
+    header.iElementSize = sizeof(Element);
+    header.iSymbolCount = (int32_t) writer->lSymbolCount;
+    header.iQueryCount = (int32_t) writer->lQueryCount;
+    header.lElementCount = writer->lElementCount;
+    header.lTextSize = writer->lTextSize;
+    header.lSymbolOffset = POSTFIX_ALIGN((long) sizeof(header));
+    header.lQueryOffset = POSTFIX_ALIGN(header.lSymbolOffset
+        + writer->lSymbolCount * (long) sizeof(PostfixSymbol));
+    header.lElementOffset = POSTFIX_ALIGN(header.lQueryOffset
+        + writer->lQueryCount * (long) sizeof(PostfixQuery));
+    header.lTextOffset = POSTFIX_ALIGN(header.lElementOffset
+        + writer->lElementCount * (long) sizeof(Element));
+
+    pFile = fopen(pszFileName, "wb");
+    if (pFile == NULL)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to create postfix file %s", pszFileName);
+    lOffset = writePart(pFile, &header, sizeof(header), 0);
+    lOffset = writePart(pFile, writer->symbolM
+        , writer->lSymbolCount * sizeof(PostfixSymbol), lOffset);
+    lOffset = writePart(pFile, writer->queryM
+        , writer->lQueryCount * sizeof(PostfixQuery), lOffset);
+    lOffset = writePart(pFile, writer->elementM
+        , writer->lElementCount * sizeof(Element), lOffset);
+    writePart(pFile, writer->textM, writer->lTextSize, lOffset);
+    if (fclose(pFile) != 0)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to write postfix file %s", pszFileName);
+}
+
+/******************** freePostfixWriter **************************************
+void freePostfixWriter(PostfixWriter writer)
+Purpose:
+    Frees a postfix writer.
+Parameters:
+    I/O PostfixWriter writer        writer to free
+Returns:
+    n/a
+**************************************************************************/
+void freePostfixWriter(PostfixWriter writer)
+{
+    free(writer->iFileSymbolM);
+    free(writer->symbolM);
+    free(writer->queryM);
+    free(writer->elementM);
+    free(writer->textM);
+    free(writer);
+}
+
+/******************** checkPart **************************************
+int checkPart(long lFileSize, int64_t lOffset, int64_t lCount, long lSize)
+Purpose:
+    Checks that a part of a postfix file is aligned and inside the file.
+Parameters:
+    I   long lFileSize              bytes in the file
+    I   int64_t lOffset             offset of the part
+    I   int64_t lCount              entries in the part
+    I   long lSize                  size of an entry
+Returns:
+    TRUE if the part is good.
+**************************************************************************/
+static int checkPart(long lFileSize, int64_t lOffset, int64_t lCount, long lSize)
+{
+    if (lOffset < (int64_t) sizeof(PostfixFileHeader) || lOffset % 8 != 0
+        || lOffset > lFileSize || lCount < 0)
+        return FALSE;
+    return lCount <= (lFileSize - lOffset) / lSize;
+}
+
+/******************** openPostfixFile **************************************
+PostfixFile openPostfixFile(char *pszFileName)
+Purpose:
+    Maps a postfix file into memory and prepares its queries for use.
+Parameters:
+    I   char *pszFileName           name of the file
+Returns:
+    The mapped file.  Use closePostfixFile to unmap it.
+Notes:
+    - The header, string table and query index are checked so that a
+      damaged or foreign file is reported instead of being used.
+    - The file's string table is interned in order (see note 2 above).
+**************************************************************************/
+PostfixFile openPostfixFile(char *pszFileName)
+{
+    PostfixFile file = calloc(1, sizeof(PostfixFileImp));
+    PostfixFileHeader *pHeader;
+    PostfixSymbol *symbolM;
+    PostfixQuery *pQuery;
+    struct stat fileStat;
+    int *iSymbolM;
+    int bSameIds = TRUE;
+    int iFd;
+    long l;
+    int i;
+
+    if (file == NULL)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to allocate a postfix file");
+    iFd = open(pszFileName, O_RDONLY);
+    if (iFd < 0 || fstat(iFd, &fileStat) != 0)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to open postfix file %s", pszFileName);
+    file->lFileSize = fileStat.st_size;
+    if (file->lFileSize < (long) sizeof(PostfixFileHeader))
+        ErrExit(ERR_POSTFIX_FILE, "%s is not a postfix file", pszFileName);
+    file->pFile = mmap(NULL, file->lFileSize, PROT_READ, MAP_PRIVATE, iFd, 0);
+    close(iFd);
+    if (file->pFile == MAP_FAILED)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to map postfix file %s", pszFileName);
+
+    // check the header
+    pHeader = file->pHeader = (PostfixFileHeader *) file->pFile;
+    if (memcmp(pHeader->szMagic, POSTFIX_MAGIC, sizeof(pHeader->szMagic)) != 0)
+        ErrExit(ERR_POSTFIX_FILE, "%s is not a postfix file", pszFileName);
+    if (pHeader->iVersion != POSTFIX_VERSION)
+        ErrExit(ERR_POSTFIX_FILE, "%s is postfix file version %d, not %d"
+            , pszFileName, pHeader->iVersion, POSTFIX_VERSION);
+    if (pHeader->iElementSize != sizeof(Element))
+        ErrExit(ERR_POSTFIX_FILE, "%s has %d byte elements, not %d"
+            , pszFileName, pHeader->iElementSize, (int) sizeof(Element));
+    if (!checkPart(file->lFileSize, pHeader->lSymbolOffset
+            , pHeader->iSymbolCount, sizeof(PostfixSymbol))
+        || !checkPart(file->lFileSize, pHeader->lQueryOffset
+            , pHeader->iQueryCount, sizeof(PostfixQuery))
+        || !checkPart(file->lFileSize, pHeader->lElementOffset
+            , pHeader->lElementCount, sizeof(Element))
+        || !checkPart(file->lFileSize, pHeader->lTextOffset
+            , pHeader->lTextSize, 1))
+        ErrExit(ERR_POSTFIX_FILE, "Postfix file %s is damaged", pszFileName);
+    symbolM = (PostfixSymbol *) (file->pFile + pHeader->lSymbolOffset);
+    file->queryM = (PostfixQuery *) (file->pFile + pHeader->lQueryOffset);
+    file->elementM = (Element *) (file->pFile + pHeader->lElementOffset);
+    file->textM = file->pFile + pHeader->lTextOffset;
+
+    // check the query index
+    for (i = 0; i < pHeader->iQueryCount; i++)
+    {
+        pQuery = &file->queryM[i];
+        if (pQuery->lTextOffset < 0 || pQuery->iTextLength < 0
+            || pQuery->lTextOffset + pQuery->iTextLength >= pHeader->lTextSize
+            || file->textM[pQuery->lTextOffset + pQuery->iTextLength] != '\0'
+            || pQuery->lFirstElement < 0 || pQuery->iElementCount < 0
+            || pQuery->lFirstElement + pQuery->iElementCount > pHeader->lElementCount)
+            ErrExit(ERR_POSTFIX_FILE, "Postfix file %s is damaged at query %d"
+                , pszFileName, i + 1);
+    }
+
+    // give the file's symbols this program's ids
+    iSymbolM = malloc((pHeader->iSymbolCount + 1) * sizeof(int));
+    if (iSymbolM == NULL)
+        ErrExit(ERR_POSTFIX_FILE, "Unable to allocate %d symbols", pHeader->iSymbolCount);
+    for (i = 0; i < pHeader->iSymbolCount; i++)
+    {
+        if (symbolM[i].lTextOffset < 0 || symbolM[i].iLength <= 0
+            || symbolM[i].lTextOffset + symbolM[i].iLength >= pHeader->lTextSize)
+            ErrExit(ERR_POSTFIX_FILE, "Postfix file %s is damaged at symbol %d"
+                , pszFileName, i);
+        iSymbolM[i] = internSymbol(file->textM + symbolM[i].lTextOffset, symbolM[i].iLength);
+        if (iSymbolM[i] != i)
+            bSameIds = FALSE;
+    }
+    for (l = 0; l < pHeader->lElementCount; l++)
+    {
+        if (file->elementM[l].iSymbol < 0 || file->elementM[l].iSymbol >= pHeader->iSymbolCount)
+            ErrExit(ERR_POSTFIX_FILE, "Postfix file %s is damaged at element %ld"
+                , pszFileName, l);
+    }
+    if (!bSameIds)
+    {
+        file->elementM = malloc((pHeader->lElementCount + 1) * sizeof(Element));
+        if (file->elementM == NULL)
+            ErrExit(ERR_POSTFIX_FILE, "Unable to allocate %ld elements"
+                , (long) pHeader->lElementCount);
+        file->bCopied = TRUE;
+        for (l = 0; l < pHeader->lElementCount; l++)
+        {
+            file->elementM[l] = ((Element *) (file->pFile + pHeader->lElementOffset))[l];
+            file->elementM[l].iSymbol = iSymbolM[file->elementM[l].iSymbol];
+        }
+    }
+    free(iSymbolM);
+    return file;
+}
+
+/******************** getPostfixQuery **************************************
+int getPostfixQuery(PostfixFile file, int iQuery, Out view, char **ppszQuery
+    , int *pbNewline)
+Purpose:
+    Gets a query from a mapped postfix file.
+Parameters:
+    I   PostfixFile file            mapped file
+    I   int iQuery                  subscript of the query (0 is the first)
+    O   Out view                    its outM is pointed at the query's
+                                    elements; its arena is not changed
+    O   char **ppszQuery            zero terminated query text
+    O   int *pbNewline              TRUE if the query line ended with a newline
+Returns:
+    The return code of convertToPostFix for the query.
+Notes:
+    - view->outM must not be changed or grown, since it is in the file.
+**************************************************************************/
+int getPostfixQuery(PostfixFile file, int iQuery, Out view, char **ppszQuery
+    , int *pbNewline)
+{
+    PostfixQuery *pQuery = &file->queryM[iQuery];
+
+    view->outM = file->elementM + pQuery->lFirstElement;
+    view->iOutCount = view->iOutMax = pQuery->iElementCount;
+    *ppszQuery = file->textM + pQuery->lTextOffset;
+    *pbNewline = pQuery->bNewline;
+    return pQuery->rc;
+}
+
+/******************** closePostfixFile **************************************
+void closePostfixFile(PostfixFile file)
+Purpose:
+    Unmaps a postfix file.
+Parameters:
+    I/O PostfixFile file            file to close
+Returns:
+    n/a
+**************************************************************************/
+void closePostfixFile(PostfixFile file)
+{
+    if (file->bCopied)
+        free(file->elementM);
+    munmap(file->pFile, file->lFileSize);
+    free(file);
+}
@@ -0,0 +1,124 @@
+/**********************************************************************
+cs2123p1Store.h
+Purpose:
+   Defines constants:
+       error constant for postfix files
+       magic number and version of the postfix file format
+   Defines typedef for
+       PostfixFileHeader   (start of a postfix file)
+       PostfixSymbol       (one entry in the file's string table)
+       PostfixQuery        (one entry in the file's query index)
+       PostfixWriterImp    (collects converted queries for a file)
+       PostfixWriter       (pointer to a PostfixWriterImp)
+       PostfixFileImp      (postfix file mapped into memory)
+       PostfixFile         (pointer to a PostfixFileImp)
+Notes:
+   - A postfix file holds the result of convertToPostFix for each query
+     so that it can be used again without converting the query text.
+     Its parts are, each starting on an 8 byte boundary:
+         PostfixFileHeader
+         PostfixSymbol    symbolM[iSymbolCount]
+         PostfixQuery     queryM[iQueryCount]
+         Element          elementM[iElementCount]
+         char             textM[]  (symbol and query text, each zero
+                                    terminated)
+   - The elements of a query are its Out.  Their iSymbol is a subscript
+     of symbolM.
+   - The file is written in the byte order of the machine writing it.
+     A file whose header does not match the reading program is rejected.
+   - Include cs2123p1.h before this file.
+**********************************************************************/
+#include <stdint.h>
+
+/*** constants ***/
+#define ERR_POSTFIX_FILE   908      // unable to read or write a postfix file
+
+#define POSTFIX_MAGIC "CS2123PF"    // first 8 bytes of a postfix file
+#define POSTFIX_VERSION 1           // changed whenever the format changes
+
+/*** typedef ***/
+
+// PostfixFileHeader typedef is the start of a postfix file.  The offsets
+// are from the start of the file.
+typedef struct
+{
+    char szMagic[8];                // POSTFIX_MAGIC (not zero terminated)
+    int32_t iVersion;               // POSTFIX_VERSION
+    int32_t iElementSize;           // sizeof(Element) of the writer
+    int32_t iSymbolCount;           // entries in symbolM
+    int32_t iQueryCount;            // entries in queryM
+    int64_t lElementCount;          // entries in elementM
+    int64_t lTextSize;              // bytes in textM
+    int64_t lSymbolOffset;          // offset of symbolM
+    int64_t lQueryOffset;           // offset of queryM
+    int64_t lElementOffset;         // offset of elementM
+    int64_t lTextOffset;            // offset of textM
+} PostfixFileHeader;
+
+// PostfixSymbol typedef is one entry in the string table
+typedef struct
+{
+    int64_t lTextOffset;            // offset of the text in textM
+    int32_t iLength;                // length of the text
+    int32_t iPad;                   // always 0
+} PostfixSymbol;
+
+// PostfixQuery typedef is one entry in the query index
+typedef struct
+{
+    int64_t lTextOffset;            // offset of the query text in textM
+    int64_t lFirstElement;          // subscript in elementM of the first element
+    int32_t iElementCount;          // elements in the query's Out
+    int32_t rc;                     // return code of convertToPostFix
+    int32_t iTextLength;            // length of the query text
+    int32_t bNewline;               // TRUE if the query line ended with a newline
+} PostfixQuery;
+
+// PostfixWriterImp typedef collects queries until writePostfixFile
+typedef struct
+{
+    int *iFileSymbolM;              // file symbol id of each symbol id (-1 if none)
+    long lFileSymbolMax;            // allocated size of iFileSymbolM
+    PostfixSymbol *symbolM;
+    long lSymbolCount;
+    long lSymbolMax;                // allocated size of symbolM
+    PostfixQuery *queryM;
+    long lQueryCount;
+    long lQueryMax;                 // allocated size of queryM
+    Element *elementM;
+    long lElementCount;
+    long lElementMax;               // allocated size of elementM
+    char *textM;
+    long lTextSize;
+    long lTextMax;                  // allocated size of textM
+} PostfixWriterImp;
+
+// PostfixWriter typedef defines a pointer to a postfix writer
+typedef PostfixWriterImp *PostfixWriter;
+
+// PostfixFileImp typedef is a postfix file mapped into memory
+typedef struct
+{
+    char *pFile;                    // start of the mapped file
+    long lFileSize;                 // bytes mapped
+    PostfixFileHeader *pHeader;
+    PostfixQuery *queryM;
+    Element *elementM;              // in the file, or translated (see bCopied)
+    char *textM;
+    int bCopied;                    // TRUE if elementM was malloced by openPostfixFile
+} PostfixFileImp;
+
+// PostfixFile typedef defines a pointer to a mapped postfix file
+typedef PostfixFileImp *PostfixFile;
+
+/**********   prototypes ***********/
+
+PostfixWriter newPostfixWriter();
+void addPostfixQuery(PostfixWriter writer, Out out, int rc, char *pszQuery
+    , int bNewline);
+void writePostfixFile(PostfixWriter writer, char *pszFileName);
+void freePostfixWriter(PostfixWriter writer);
+PostfixFile openPostfixFile(char *pszFileName);
+int getPostfixQuery(PostfixFile file, int iQuery, Out view, char **ppszQuery
+    , int *pbNewline);
+void closePostfixFile(PostfixFile file);
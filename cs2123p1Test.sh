@@ -0,0 +1,176 @@
+#!/bin/sh
+###############################################################################
+# cs2123p1Test.sh
+# Purpose:
+#     Builds p1 and checks its output against the expected output in
+#     Output.txt, directly and through a postfix file (cs2123p1Store.c),
+#     and its conversion of deeply nested queries against postfix built
+#     with awk, and the customers matched by =, NOTANY and ONLY, counted
+#     with the bitmap index and with the value masks of a column file,
+#     and in batch mode, shared or counted a query at a time.
+# Command Parameters:
+#     sh cs2123p1Test.sh
+# Results:
+#     One line per check, "ok" or "FAILED", followed by the differences
+#     of a failed check.
+# Returns:
+#     0 - every check passed
+#     1 - a check failed or p1 could not be built
+# Notes:
+#     1. Run it from the directory holding the source files.  The program
+#        and the files it writes are kept in a temporary directory that is
+#        removed at the end.
+###############################################################################
+
+TMP=${TMPDIR:-/tmp}/cs2123p1Test.$$
+mkdir -p "$TMP" || exit 1
+trap 'rm -rf "$TMP"' 0
+iFailed=0
+
+# check name expectedFile actualFile
+check()
+{
+    if cmp -s "$2" "$3"
+    then
+        echo "ok      $1"
+    else
+        echo "FAILED  $1"
+        diff "$2" "$3" | head -20
+        iFailed=1
+    fi
+}
+
+# checkMessage name message actualFile
+checkMessage()
+{
+    if grep "$2" "$3" > /dev/null
+    then
+        echo "ok      $1"
+    else
+        echo "FAILED  $1: no '$2' message"
+        head -20 "$3"
+        iFailed=1
+    fi
+}
+
+gcc -O2 -pthread -o "$TMP/p1" cs2123p1Driver.c cs2123p1Lib.c cs2123p1.c cs2123p1Eval.c \
+    cs2123p1Index.c cs2123p1Cache.c cs2123p1Optimize.c cs2123p1Batch.c cs2123p1Stats.c \
+    cs2123p1Store.c cs2123p1Standing.c cs2123p1Match.c cs2123p1Parallel.c \
+    cs2123p1Simplify.c cs2123p1Column.c || exit 1
+
+# conversion of the sample queries
+"$TMP/p1" < cs2123p1Input.txt > "$TMP/out.txt"
+check "convert cs2123p1Input.txt" Output.txt "$TMP/out.txt"
+
+# the same queries written to a postfix file and read back
+"$TMP/p1" -w "$TMP/input.pf" < cs2123p1Input.txt > "$TMP/write.txt"
+check "write postfix file" Output.txt "$TMP/write.txt"
+"$TMP/p1" -r "$TMP/input.pf" > "$TMP/read.txt"
+check "read postfix file" Output.txt "$TMP/read.txt"
+
+# a postfix file written with a different Element size is rejected.  The
+# element size is the int after the 8 byte magic and the 4 byte version.
+cp "$TMP/input.pf" "$TMP/element.pf"
+printf '\377' | dd of="$TMP/element.pf" bs=1 seek=12 conv=notrunc 2> /dev/null
+"$TMP/p1" -r "$TMP/element.pf" > "$TMP/element.txt"
+checkMessage "postfix file element size" "has 255 byte elements, not" "$TMP/element.txt"
+
+# deeply nested queries, which convertToPostFix takes without a fixed
+# stack size: NEST groups around one comparison, a chain of NEST
+# comparisons each ANDed with the group after it, and NEST unmatched
+# left parentheses
+NEST=5000
+awk -v n=$NEST 'BEGIN {
+    s = ""
+    for (i = 0; i < n; i++) s = s "( "
+    s = s "SMOKING = N"
+    for (i = 0; i < n; i++) s = s " )"
+    print s
+    s = "EXERCISE = V1"
+    for (i = 2; i <= n; i++) s = s " AND ( EXERCISE = V" i
+    for (i = 2; i <= n; i++) s = s " )"
+    print s
+    s = ""
+    for (i = 0; i < n; i++) s = s "( "
+    print s "GENDER = F"
+}' > "$TMP/nest.txt"
+awk -v n=$NEST 'BEGIN {
+    print "1\t0\tSMOKING N ="
+    s = "2\t0\tEXERCISE V1 ="
+    for (i = 2; i <= n; i++) s = s " EXERCISE V" i " ="
+    for (i = 2; i <= n; i++) s = s " AND"
+    print s
+    print "3\t801\t"
+}' > "$TMP/nest.expected"
+"$TMP/p1" -f postfix < "$TMP/nest.txt" > "$TMP/nest.out"
+check "$NEST nested parentheses" "$TMP/nest.expected" "$TMP/nest.out"
+
+# NOTANY and ONLY on cs2123p1Customers.txt, counted by the bitmap index
+# and, through a column file, by the value masks (cs2123p1Eval.c).  A
+# customer with no BOOK has NOTANY SCIFI.
+printf '%s\n' "BOOK NOTANY SCIFI" "BOOK ONLY SCIFI" "EXERCISE ONLY HIKE" \
+    "EXERCISE NOTANY HIKE AND SMOKING = N" > "$TMP/semantics.txt"
+printf '1\t0\tBOOK SCIFI NOTANY\t3\n2\t0\tBOOK SCIFI ONLY\t3\n3\t0\tEXERCISE HIKE ONLY\t1\n4\t0\tEXERCISE HIKE NOTANY SMOKING N = AND\t2\n' \
+    > "$TMP/semantics.expected"
+"$TMP/p1" -f postfix cs2123p1Customers.txt < "$TMP/semantics.txt" > "$TMP/semantics.out"
+check "NOTANY and ONLY with the index" "$TMP/semantics.expected" "$TMP/semantics.out"
+"$TMP/p1" -K "$TMP/customers.col" cs2123p1Customers.txt < /dev/null > /dev/null
+"$TMP/p1" -f postfix -k "$TMP/customers.col" < "$TMP/semantics.txt" \
+    > "$TMP/semantics.col" 2> /dev/null
+check "NOTANY and ONLY with the value masks" "$TMP/semantics.expected" "$TMP/semantics.col"
+
+# a COLOR trait with 100 values, so the value ids from MASK_VALUES (63) up
+# are kept outside the mask (MASK_SPILL).  Customers 1 to 100 have C0 to
+# C99 in order, so C90 is value id 90; the next 200 have C(i % 100), and
+# every third of them also C((i + 37) % 100).  awk counts the customers
+# each query matches.
+awk 'BEGIN {
+    for (i = 0; i < 300; i++)
+    {
+        a = i % 100
+        b = -1
+        s = "COLOR=C" a
+        if (i >= 100 && i % 3 == 0)
+        {
+            b = (i + 37) % 100
+            s = s " COLOR=C" b
+        }
+        print s
+        b90 = a == 90 || b == 90
+        b5 = a == 5 || b == 5
+        n90 += b90
+        nOnly90 += a == 90 && b == -1
+        nOnly5 += a == 5 && b == -1
+        nNotany90 += !b90
+        nOr += !b5 || b90
+    }
+    printf "1\t0\tCOLOR C90 =\t%d\n", n90 > "/dev/stderr"
+    printf "2\t0\tCOLOR C90 ONLY\t%d\n", nOnly90 > "/dev/stderr"
+    printf "3\t0\tCOLOR C90 NOTANY\t%d\n", nNotany90 > "/dev/stderr"
+    printf "4\t0\tCOLOR C5 ONLY\t%d\n", nOnly5 > "/dev/stderr"
+    printf "5\t0\tCOLOR C5 NOTANY COLOR C90 = OR\t%d\n", nOr > "/dev/stderr"
+}' > "$TMP/spill.txt" 2> "$TMP/spill.expected"
+printf '%s\n' "COLOR = C90" "COLOR ONLY C90" "COLOR NOTANY C90" "COLOR ONLY C5" \
+    "COLOR NOTANY C5 OR COLOR = C90" > "$TMP/spillq.txt"
+"$TMP/p1" -f postfix "$TMP/spill.txt" < "$TMP/spillq.txt" > "$TMP/spill.out"
+check "values past the mask with the index" "$TMP/spill.expected" "$TMP/spill.out"
+"$TMP/p1" -K "$TMP/spill.col" "$TMP/spill.txt" < /dev/null > /dev/null
+"$TMP/p1" -f postfix -k "$TMP/spill.col" < "$TMP/spillq.txt" > "$TMP/spill.colout" 2> /dev/null
+check "values past the mask with the value masks" "$TMP/spill.expected" "$TMP/spill.colout"
+
+# batch mode (-b) on the NOTANY and ONLY queries, which share nothing and
+# are counted a query at a time, and on them twice, which share every node
+"$TMP/p1" -f postfix -b cs2123p1Customers.txt < "$TMP/semantics.txt" \
+    > "$TMP/batch.out" 2> "$TMP/batch.err"
+check "batch counted a query at a time" "$TMP/semantics.expected" "$TMP/batch.out"
+checkMessage "batch without sharing" "1 of 1 chunks evaluated a query at a time" "$TMP/batch.err"
+cat "$TMP/semantics.txt" "$TMP/semantics.txt" > "$TMP/batch2.txt"
+{ cat "$TMP/semantics.expected"
+  awk 'BEGIN { FS = OFS = "\t" } { $1 += 4; print }' "$TMP/semantics.expected"
+} > "$TMP/batch2.expected"
+"$TMP/p1" -f postfix -b cs2123p1Customers.txt < "$TMP/batch2.txt" \
+    > "$TMP/batch2.out" 2> "$TMP/batch2.err"
+check "batch of shared nodes" "$TMP/batch2.expected" "$TMP/batch2.out"
+checkMessage "batch with sharing" "0 of 1 chunks evaluated a query at a time" "$TMP/batch2.err"
+
+exit $iFailed